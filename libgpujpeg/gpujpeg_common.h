@@ -33,6 +33,9 @@
 #include <stdint.h>
 #include <cuda_runtime.h>
 #include <libgpujpeg/gpujpeg_type.h>
+#include <libgpujpeg/gpujpeg_route.h>
+#include <libgpujpeg/gpujpeg_stats.h>
+#include <libgpujpeg/gpujpeg_trace.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,7 +51,7 @@ extern "C" {
     #define GPUJPEG_API
 #endif
 
-/** @return current time in seconds */
+/** @return current time in seconds (by monotonic clock when available) */
 GPUJPEG_API double
 gpujpeg_get_time();
 
@@ -114,8 +117,13 @@ gpujpeg_print_devices_info();
  * Init CUDA device
  *
  * @param device_id  CUDA device id (starting at 0)
- * @param flags  Flags, e.g. if device info should be printed out (GPUJPEG_VERBOSE) or
- *               enable OpenGL interoperability (GPUJPEG_OPENGL_INTEROPERABILITY)
+ * @param flags  Flags, e.g. if device info should be printed out (GPUJPEG_VERBOSE),
+ *               enable OpenGL interoperability (GPUJPEG_OPENGL_INTEROPERABILITY) or
+ *               use host runtime instead of CUDA device (GPUJPEG_HOST_RUNTIME), which
+ *               runs pipeline kernels as CPU functions (slow, intended for testing),
+ *               it codes only 8-bit images of one scan by MCU rows (pixel format must
+ *               match component count, resizing, resolution pyramid, alpha channel and
+ *               tensor output are rejected by encoder and decoder)
  * @return 0 if succeeds, otherwise nonzero
  */
 GPUJPEG_API int
@@ -155,6 +163,16 @@ struct gpujpeg_parameters
     // Color space that is used inside JPEG stream = that is carried in JPEG format = to
     // which are input data converted (default value is JPEG YCbCr)
     enum gpujpeg_color_space color_space_internal;
+
+    // Sample precision inside JPEG stream in bits, 8 (baseline) or 12 (extended sequential).
+    // 12-bit images are coded only from/to 16bit pixel formats with 4:4:4 sampling and
+    // without resizing, huffman coding is always performed on CPU for them.
+    int precision;
+
+    // Filter used by encoder for downsampling of subsampled components (default
+    // GPUJPEG_SAMPLING_FILTER_NEAREST), it is used only for 8-bit images without
+    // resizing (decoder upsampling filter is set by gpujpeg_decoder_set_sampling_filter)
+    enum gpujpeg_sampling_filter sampling_filter;
 };
 
 /**
@@ -211,6 +229,37 @@ struct gpujpeg_image_parameters {
 GPUJPEG_API void
 gpujpeg_image_set_default_parameters(struct gpujpeg_image_parameters* param);
 
+/**
+ * Quantized DCT coefficients of image (output of entropy decoding, input of entropy
+ * coding). Component plane consists of 8x8 blocks stored by block rows, each block
+ * is 64 coefficients in natural (row-major) order. Planes of image with given
+ * parameters and sampling factors have the same layout in decoder and encoder.
+ */
+struct gpujpeg_coefficients {
+    // Component count
+    int comp_count;
+    // Coefficients of component plane
+    int16_t* data[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Block count in row of component plane
+    int block_count_x[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Block row count of component plane
+    int block_count_y[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Quantization table of component in natural order
+    uint16_t quantization_table[GPUJPEG_MAX_COMPONENT_COUNT][64];
+};
+
+/**
+ * Image planes with row pitches (strided image in host or device memory). Packed
+ * pixel formats have one plane, planar formats have plane for every component
+ * (see gpujpeg_image_get_plane_size for plane geometry).
+ */
+struct gpujpeg_image_planes {
+    // Plane data (first row)
+    uint8_t* data[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Distance between plane rows in bytes (zero for rows without padding)
+    int pitch[GPUJPEG_MAX_COMPONENT_COUNT];
+};
+
 /** Image file formats */
 enum gpujpeg_image_file_format {
     // Unknown image file format
@@ -415,9 +464,45 @@ struct gpujpeg_coder
     uint8_t* d_data_raw_allocated;
     // Allocated data size
     size_t data_raw_allocated_size;
-
-    // Preprocessor data in device memory (output/input for encoder/decoder)
+    // Raw image size when it differs from image size and the raw image is resampled
+    // by preprocessor/postprocessor (zero when raw image has image size)
+    int data_raw_width;
+    int data_raw_height;
+    // Filter used for resampling raw image
+    enum gpujpeg_resize_filter data_raw_filter;
+    // Raw image is normalized tensor of data_raw_tensor_format instead of 8-bit samples (decoder only)
+    int data_raw_tensor;
+    struct gpujpeg_tensor_format data_raw_tensor_format;
+    // Raw image planes in device memory with row pitches, they are used by
+    // preprocessor/postprocessor instead of d_data_raw when data[0] is not NULL
+    struct gpujpeg_image_planes data_raw_planes;
+    // Value of the ignored (alpha) byte of 4-byte pixels written by postprocessor
+    uint8_t data_raw_alpha;
+    // Plane (without row padding) to which preprocessor extracts the fourth byte
+    // of 4-byte pixels, NULL when the byte is ignored (encoder only)
+    uint8_t* d_data_alpha;
+    // Filter used by preprocessor/postprocessor for downsampling/upsampling of subsampled components
+    enum gpujpeg_sampling_filter sampling_filter;
+    // Full resolution planes of subsampled components filtered by other than nearest filter (device memory)
+    uint8_t* d_data_sampling;
+    // Allocated size of full resolution planes
+    size_t data_sampling_allocated_size;
+    // Component planes followed by full resolution planes of subsampled components
+    // filtered by other than nearest filter on CPU (host memory)
+    uint8_t* data_sampling;
+    // Allocated size of host sampling planes
+    size_t data_sampling_host_allocated_size;
+
+    // Preprocessor data in device memory (output/input for encoder/decoder), it is
+    // allocated only for stages which aren't fused (see gpujpeg_coder_init_data)
     uint8_t* d_data;
+    // Allocated size of preprocessor data in device memory
+    size_t d_data_allocated_size;
+    // Downscale factor of component data produced by scaled IDCT (1, 2, 4 or 8),
+    // decoded component planes have data_width / data_scale stride then
+    int data_scale;
+    // Only the first (luminance) component is decoded and output, chroma is skipped (decoder only)
+    int luminance_only;
     // DCT and quantizer data in host memory (output/input for encoder/decoder)
     int16_t* data_quantized;
     // DCT and quantizer data in device memory (output/input for encoder/decoder)
@@ -425,6 +510,18 @@ struct gpujpeg_coder
     // Allocated size
     size_t data_allocated_size;
 
+    // Sparse coefficients used to transfer DCT and quantizer data between host
+    // and device memory (see gpujpeg_sparse.h), nonzero mask of each block
+    uint64_t* data_sparse_mask;
+    uint64_t* d_data_sparse_mask;
+    // Packed nonzero values of sparse coefficients
+    int16_t* data_sparse_value;
+    int16_t* d_data_sparse_value;
+    // Offsets of packed values of blocks and chunks of blocks (in device memory only)
+    unsigned int* d_data_sparse_offset;
+    // Number of blocks for which sparse coefficient buffers are allocated
+    int data_sparse_allocated_count;
+
     // Huffman coder data in host memory (output/input for encoder/decoder)
     uint8_t* data_compressed;
     // Huffman coder data in device memory (output/input for encoder/decoder)
@@ -438,13 +535,13 @@ struct gpujpeg_coder
     int cuda_cc_major;
     int cuda_cc_minor;
 
-    // Operation durations
-    float duration_memory_from;
-    float duration_memory_map;
-    float duration_memory_unmap;
-    float duration_stream;
-    float duration_in_gpu;
-    float duration_waiting;
+    // Statistics of the last image (see gpujpeg_stats)
+    struct gpujpeg_stats stats;
+    // Recorder of stage durations, NULL when statistics are disabled (see gpujpeg_stats_internal.h)
+    struct gpujpeg_stats_recorder* stats_recorder;
+
+    // Routing decision of the last image (see gpujpeg_route_decide)
+    struct gpujpeg_route_decision route;
 };
 
 /**
@@ -468,6 +565,18 @@ gpujpeg_coder_init(struct gpujpeg_coder* coder);
 size_t
 gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters * param, struct gpujpeg_image_parameters * param_image, cudaStream_t * stream);
 
+/**
+ * Allocate component planes in device memory (coder->d_data) for current image,
+ * planes are needed only by preprocessing, DCT, IDCT and postprocessing which
+ * aren't fused (fused kernels and CPU pipeline don't materialize them), so they
+ * are allocated only before such stage is launched
+ *
+ * @param coder  Coder structure (initialized for the image)
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_coder_init_data(struct gpujpeg_coder* coder);
+
 /**
  * Deinitialize JPEG coder (free buffers)
  *
@@ -477,6 +586,18 @@ gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters
 int
 gpujpeg_coder_deinit(struct gpujpeg_coder* coder);
 
+/**
+ * Get type of component, that selects its quantization and huffman tables
+ * (all components of CMYK image and Y and K components of YCCK image use
+ * luminance tables as written by libjpeg)
+ *
+ * @param color_space_internal  Color space of JPEG stream
+ * @param comp  Component index
+ * @return component type
+ */
+enum gpujpeg_component_type
+gpujpeg_component_get_type(enum gpujpeg_color_space color_space_internal, int comp);
+
 /**
  * Calculate size for image by parameters
  *
@@ -486,6 +607,31 @@ gpujpeg_coder_deinit(struct gpujpeg_coder* coder);
 GPUJPEG_API int
 gpujpeg_image_calculate_size(struct gpujpeg_image_parameters* param);
 
+/**
+ * Get geometry of image plane in pixel format of image
+ *
+ * @param param  Image parameters
+ * @param plane  Plane index
+ * @param[out] width  Plane row size in bytes
+ * @param[out] height  Plane row count
+ * @return 0 if pixel format has the plane, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_image_get_plane_size(const struct gpujpeg_image_parameters* param, int plane, int* width, int* height);
+
+/**
+ * Complete image planes for pixel format of image. When contiguous image buffer
+ * is given, its planes are described (rows without padding), otherwise zero row
+ * pitches of given planes are set to plane row size.
+ *
+ * @param param  Image parameters
+ * @param buffer  Contiguous image buffer or NULL
+ * @param[in,out] planes  Image planes
+ * @return 0 if succeeds, otherwise nonzero (missing plane or too small pitch)
+ */
+int
+gpujpeg_image_planes_init(const struct gpujpeg_image_parameters* param, uint8_t* buffer, struct gpujpeg_image_planes* planes);
+
 /**
  * Load RGB image from file
  *
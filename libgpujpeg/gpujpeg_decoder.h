@@ -64,6 +64,15 @@ enum gpujpeg_decoder_output_type {
     GPUJPEG_DECODER_OUTPUT_CUDA_BUFFER,
     // Decoder will use custom CUDA buffer as output buffer
     GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_BUFFER,
+    // Decoder will write normalized float tensor into custom CUDA buffer
+    GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR,
+    // Decoder will stop after entropy decoding and output quantized DCT coefficients
+    // in its internal buffer (see gpujpeg_decoder_get_coefficients)
+    GPUJPEG_DECODER_OUTPUT_COEFFICIENTS,
+    // Decoder will use custom output image planes with row pitches
+    GPUJPEG_DECODER_OUTPUT_CUSTOM_PLANES,
+    // Decoder will use custom CUDA output image planes with row pitches
+    GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_PLANES,
 };
 
 /**
@@ -82,6 +91,20 @@ struct gpujpeg_decoder_output
 
     // OpenGL texture
     struct gpujpeg_opengl_texture* texture;
+
+    // Requested output image size (zero for image size)
+    int width;
+    int height;
+
+    // Filter used for resizing to requested output size
+    enum gpujpeg_resize_filter filter;
+
+    // Tensor format (for GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR)
+    struct gpujpeg_tensor_format tensor;
+
+    // Image planes with row pitches (for GPUJPEG_DECODER_OUTPUT_CUSTOM_PLANES
+    // and GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_PLANES)
+    struct gpujpeg_image_planes planes;
 };
 
 /**
@@ -130,6 +153,71 @@ gpujpeg_decoder_output_set_cuda_buffer(struct gpujpeg_decoder_output* output);
 GPUJPEG_API void
 gpujpeg_decoder_output_set_custom_cuda(struct gpujpeg_decoder_output* output, uint8_t* d_custom_buffer);
 
+/**
+ * Setup decoder output to custom image planes with row pitches (e.g. image with
+ * padded rows or planar image with planes in separate buffers)
+ *
+ * @param output  Decoder output structure
+ * @param planes  Output image planes in host memory
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_decoder_output_set_custom_planes(struct gpujpeg_decoder_output* output, const struct gpujpeg_image_planes* planes);
+
+/**
+ * Setup decoder output to custom CUDA image planes with row pitches, they are
+ * written directly by postprocessor
+ *
+ * @param output  Decoder output structure
+ * @param planes  Output image planes in CUDA device memory
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_decoder_output_set_custom_cuda_planes(struct gpujpeg_decoder_output* output, const struct gpujpeg_image_planes* planes);
+
+/**
+ * Setup decoder output to normalized tensor in custom CUDA buffer. Tensor has
+ * as many channels as the image has components and the normalization is fused
+ * into postprocessor. Buffer must hold width * height * comp_count elements
+ * (of output size, see gpujpeg_decoder_output_set_resize).
+ *
+ * @param output    Decoder output structure
+ * @param d_tensor  Tensor buffer in CUDA device memory
+ * @param type      Tensor element type
+ * @param layout    Tensor layout
+ * @param scale     Per-channel scale (NULL for 1.0)
+ * @param bias      Per-channel bias (NULL for 0.0)
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_decoder_output_set_cuda_tensor(struct gpujpeg_decoder_output* output, void* d_tensor, enum gpujpeg_tensor_type type,
+                                       enum gpujpeg_tensor_layout layout, const float* scale, const float* bias);
+
+/**
+ * Set decoder output to quantized DCT coefficients (IDCT and postprocessing are skipped)
+ *
+ * @param output  Decoder output structure
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_decoder_output_set_coefficients(struct gpujpeg_decoder_output* output);
+
+/**
+ * Request decoding to different size than the size of JPEG image (must be called
+ * after setting output type, because these reset the size). When downscaling, image
+ * is first reduced by power of two in DCT domain (only low frequency coefficients
+ * are inverse transformed) and the remaining ratio is resampled by the filter in
+ * postprocessor. Only GPUJPEG_444_U8_P012 (or one component) output is supported.
+ *
+ * @param output  Decoder output structure
+ * @param width   Output image width (zero for JPEG image width)
+ * @param height  Output image height (zero for JPEG image height)
+ * @param filter  Resampling filter
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_decoder_output_set_resize(struct gpujpeg_decoder_output* output, int width, int height, enum gpujpeg_resize_filter filter);
+
 /**
  * Create JPEG decoder
  *
@@ -155,6 +243,8 @@ gpujpeg_decoder_init(struct gpujpeg_decoder* decoder, struct gpujpeg_parameters*
  * Read image info from JPEG file
  *
  * Values read (if present) are: width, height, comp_count, color_space.
+ * For 12-bit image (SOF1) also pixel_format is set to GPUJPEG_U16 or
+ * GPUJPEG_444_U16_P012 which the image must be decoded to.
  * If a value of a parameter cannot be read/deduced, corresponding member
  * of gpujpeg_image_parameters is not modified. Thus the caller may initialize
  * the members with some distictive values to detect this.
@@ -180,6 +270,34 @@ gpujpeg_decoder_get_image_info(uint8_t* image, int image_size, struct gpujpeg_im
 GPUJPEG_API int
 gpujpeg_decoder_decode(struct gpujpeg_decoder* decoder, uint8_t* image, int image_size, struct gpujpeg_decoder_output* output);
 
+/**
+ * Decompress batch of images into one contiguous tensor ([N,C,H,W] or [N,H,W,C]).
+ * All images must decode to the same size (same image size or the same
+ * requested output size).
+ *
+ * @param decoder  Decoder structure
+ * @param image  Array of source image data
+ * @param image_size  Array of source image data sizes
+ * @param image_count  Number of images in batch
+ * @param output  Decoder output structure of GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR type,
+ *                data_size is set to size of whole batch tensor in bytes
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_decoder_decode_batch(struct gpujpeg_decoder* decoder, uint8_t** image, int* image_size, int image_count, struct gpujpeg_decoder_output* output);
+
+/**
+ * Get quantized DCT coefficients and quantization tables of last decoded image
+ * (decoded with GPUJPEG_DECODER_OUTPUT_COEFFICIENTS output). Coefficients point
+ * to decoder internal buffer valid until next decoding.
+ *
+ * @param decoder  Decoder structure
+ * @param coefficients  Coefficients description to be filled
+ * @return 0 if succeeds, otherwise nonzero (also when last image wasn't decoded to coefficients)
+ */
+GPUJPEG_API int
+gpujpeg_decoder_get_coefficients(struct gpujpeg_decoder* decoder, struct gpujpeg_coefficients* coefficients);
+
 /**
  * Destory JPEG decoder
  *
@@ -192,6 +310,25 @@ gpujpeg_decoder_destroy(struct gpujpeg_decoder* decoder);
 /**
  * Sets output format
  *
+ * GPUJPEG_U8 pixel format for color (YCbCr) image requests luminance only
+ * decoding. Chroma scans are skipped (chroma blocks of interleaved scan are
+ * only entropy decoded in skip mode) and chroma IDCT and color conversion
+ * are not performed. Coefficient output (gpujpeg_decoder_output_set_coefficients)
+ * always contains all components.
+ *
+ * Display and video layouts are written directly by postprocessor, e.g.
+ * GPUJPEG_444_U8_P012X/GPUJPEG_444_U8_P210X with GPUJPEG_RGB for RGBX/BGRX
+ * (see gpujpeg_decoder_set_output_alpha), GPUJPEG_444_U8_P0P1P2 with
+ * GPUJPEG_RGB for planar RGB or GPUJPEG_420_U8_P0P12 with YCbCr color space
+ * for NV12.
+ *
+ * Image with 4 components (CMYK or YCCK stream signaled by APP14 marker) must
+ * be decoded to GPUJPEG_4444_U8_P0123 pixel format, YCCK is converted to CMYK
+ * with GPUJPEG_CMYK color space (inverted CMYK of Adobe files is kept).
+ *
+ * Image with 12-bit precision must be decoded to GPUJPEG_U16 (grayscale) or
+ * GPUJPEG_444_U16_P012 (3 components) pixel format without resampling.
+ *
  * @param decoder         Decoder structure
  * @param color_space     Requested output color space
  * @param sampling_factor Requestd color sampling factor
@@ -201,6 +338,95 @@ gpujpeg_decoder_set_output_format(struct gpujpeg_decoder* decoder,
                 enum gpujpeg_color_space color_space,
                 enum gpujpeg_pixel_format sampling_factor);
 
+/**
+ * Sets value written to the fourth byte of output pixels of 4-byte pixel
+ * formats (default 255, i.e. opaque alpha)
+ *
+ * @param decoder  Decoder structure
+ * @param alpha    Alpha fill value
+ */
+GPUJPEG_API void
+gpujpeg_decoder_set_output_alpha(struct gpujpeg_decoder* decoder, uint8_t alpha);
+
+/**
+ * Sets filter used by postprocessor for upsampling of subsampled components
+ * (default GPUJPEG_SAMPLING_FILTER_NEAREST). Other filters are applied only to
+ * 8-bit images decoded at full size (without IDCT downscaling, resizing and
+ * tensor output).
+ *
+ * @param decoder  Decoder structure
+ * @param filter   Sampling filter
+ */
+GPUJPEG_API void
+gpujpeg_decoder_set_sampling_filter(struct gpujpeg_decoder* decoder, enum gpujpeg_sampling_filter filter);
+
+/**
+ * Enables decoding on CPU (default disabled). Image is streamed by MCU rows
+ * through huffman decoding, IDCT, upsampling and color conversion while each
+ * row stays in cache, MCU rows are spread across threads by restart intervals
+ * (an image without restart interval is decoded by one thread). Only images
+ * decoded to host memory (internal buffer, custom buffer or custom planes)
+ * with 8-bit precision, one scan and full size are decoded on CPU, other images
+ * are still decoded on GPU. Upsampling by other than nearest filter needs
+ * neighbouring MCU rows, so whole component planes are upsampled after all
+ * MCU rows are decoded then.
+ *
+ * @param decoder       Decoder structure
+ * @param thread_count  Number of threads (negative for number of hardware threads, 0 disables CPU decoding)
+ */
+GPUJPEG_API void
+gpujpeg_decoder_set_host_threads(struct gpujpeg_decoder* decoder, int thread_count);
+
+/**
+ * Sets cost model which routes decoding pipeline stages per image (default
+ * none). Image is decoded on CPU (see gpujpeg_decoder_set_host_threads) when
+ * the model estimates it faster than GPU and huffman decoding of images decoded
+ * on GPU is routed to CPU or GPU by the model, so small images are decoded
+ * entirely on CPU. Host thread count 0 means number of hardware threads while
+ * model is set. Leading segments of images whose huffman decoding is routed
+ * to GPU are decoded on CPU concurrently, split by costs which start from the
+ * model and are refined by measurements. Without model, huffman decoding is
+ * performed on CPU for images with less than 256 segments and segments are
+ * never split. Decision is available in coder.route.
+ *
+ * @param decoder  Decoder structure
+ * @param model    Cost model (copied), NULL disables routing by cost model and resets it to default
+ */
+GPUJPEG_API void
+gpujpeg_decoder_set_route_model(struct gpujpeg_decoder* decoder, const struct gpujpeg_route_model* model);
+
+/**
+ * Enables measuring of stage durations (default disabled, see gpujpeg_encoder_set_stats)
+ *
+ * @param decoder  Decoder structure
+ * @param enabled  Flag if durations are measured
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_decoder_set_stats(struct gpujpeg_decoder* decoder, int enabled);
+
+/**
+ * Attaches trace which records frames, pipeline stages and worker threads of
+ * the decoder (see gpujpeg_trace), stage durations are measured while the trace
+ * is attached. The trace must not be destroyed before it is detached or the
+ * decoder is destroyed.
+ *
+ * @param decoder  Decoder structure
+ * @param trace  Trace structure or NULL for detaching
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_decoder_set_trace(struct gpujpeg_decoder* decoder, struct gpujpeg_trace* trace);
+
+/**
+ * Gets statistics of the last decoded image
+ *
+ * @param decoder  Decoder structure
+ * @param stats    Statistics structure to be filled
+ */
+GPUJPEG_API void
+gpujpeg_decoder_get_stats(struct gpujpeg_decoder* decoder, struct gpujpeg_stats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -53,6 +53,10 @@ struct gpujpeg_decoder
     struct gpujpeg_table_huffman_decoder table_huffman[GPUJPEG_COMPONENT_TYPE_COUNT][GPUJPEG_HUFFMAN_TYPE_COUNT];
     // Huffman coder tables in device memory
     struct gpujpeg_table_huffman_decoder* d_table_huffman[GPUJPEG_COMPONENT_TYPE_COUNT][GPUJPEG_HUFFMAN_TYPE_COUNT];
+    // Cache entries of huffman coder tables (tables are rebuilt only for DHT content not found in cache)
+    struct gpujpeg_table_huffman_decoder_cache_entry* table_huffman_entry[GPUJPEG_COMPONENT_TYPE_COUNT][GPUJPEG_HUFFMAN_TYPE_COUNT];
+    // Cache of built huffman coder tables
+    struct gpujpeg_table_huffman_decoder_cache table_huffman_cache;
     
     // Current segment count for decoded image
     int segment_count;
@@ -60,13 +64,29 @@ struct gpujpeg_decoder
     // Current data compressed size for decoded image
     int data_compressed_size;
 
+    // Flag if last image was successfully decoded to GPUJPEG_DECODER_OUTPUT_COEFFICIENTS output
+    // (host coefficients are otherwise stale, see gpujpeg_decoder_get_coefficients)
+    int coefficients_decoded;
+
+    // Filter used for upsampling of subsampled components
+    enum gpujpeg_sampling_filter sampling_filter;
+
+    // Number of threads of host decoding pipeline (0 when images are decoded on GPU)
+    int host_thread_count;
+
+    // Cost model used to route pipeline stages (default model when route_enabled isn't set)
+    struct gpujpeg_route_model route_model;
+    // Flag if pipeline stages are routed by cost model, otherwise fixed rules are used
+    int route_enabled;
+
+    // Measured costs of huffman decoding on CPU and on GPU (GPU cost is amortized
+    // over concurrently decoded segments) used to split segments between them [ns per sample]
+    double huffman_host_cost;
+    double huffman_device_cost;
+
     // Stream
     cudaStream_t * stream;
     cudaStream_t * allocatedStream;
-
-    // Timers
-    GPUJPEG_CUSTOM_TIMER_DECLARE(def)
-    GPUJPEG_CUSTOM_TIMER_DECLARE(in_gpu)
 };
 
 #endif // GPUJPEG_DECODER_INTERNAL_H
@@ -49,6 +49,12 @@ enum gpujpeg_encoder_input_type {
     GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE,
     // Encoder will use custom GPU input buffer
     GPUJPEG_ENCODER_INPUT_GPU_IMAGE,
+    // Encoder will use quantized DCT coefficients (preprocessing and DCT are skipped)
+    GPUJPEG_ENCODER_INPUT_COEFFICIENTS,
+    // Encoder will use custom input image planes with row pitches
+    GPUJPEG_ENCODER_INPUT_IMAGE_PLANES,
+    // Encoder will use custom GPU input image planes with row pitches
+    GPUJPEG_ENCODER_INPUT_GPU_IMAGE_PLANES,
 };
 
 /**
@@ -64,6 +70,20 @@ struct gpujpeg_encoder_input
 
     // Registered OpenGL Texture
     struct gpujpeg_opengl_texture* texture;
+
+    // Quantized DCT coefficients with quantization tables
+    const struct gpujpeg_coefficients* coefficients;
+
+    // Image planes with row pitches
+    struct gpujpeg_image_planes planes;
+
+    // Input image size when it differs from encoded image size, the input
+    // is then resampled by preprocessor (zero if no resampling is required)
+    int width;
+    int height;
+
+    // Filter used for resampling the input image
+    enum gpujpeg_resize_filter filter;
 };
 
 /**
@@ -96,6 +116,56 @@ gpujpeg_encoder_input_set_gpu_image(struct gpujpeg_encoder_input* input, uint8_t
 GPUJPEG_API void
 gpujpeg_encoder_input_set_texture(struct gpujpeg_encoder_input* input, struct gpujpeg_opengl_texture* texture);
 
+/**
+ * Set encoder input to quantized DCT coefficients. Image is entropy coded with
+ * given coefficients and quantization tables (lossless transcoding), image
+ * parameters and sampling factors must correspond to the coefficient planes.
+ * Quantization tables of second and third component must be the same.
+ *
+ * @param encoder_input  Encoder input structure
+ * @param coefficients  Quantized DCT coefficients (e.g. from gpujpeg_decoder_get_coefficients)
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_encoder_input_set_coefficients(struct gpujpeg_encoder_input* input, const struct gpujpeg_coefficients* coefficients);
+
+/**
+ * Set encoder input to image planes with row pitches (e.g. image with padded rows
+ * or planar image with planes in separate buffers)
+ *
+ * @param encoder_input  Encoder input structure
+ * @param planes  Input image planes in host memory
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_encoder_input_set_image_planes(struct gpujpeg_encoder_input* input, const struct gpujpeg_image_planes* planes);
+
+/**
+ * Set encoder input to GPU image planes with row pitches, they are read directly
+ * by preprocessor
+ *
+ * @param encoder_input  Encoder input structure
+ * @param planes  Input image planes in device memory
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_encoder_input_set_gpu_image_planes(struct gpujpeg_encoder_input* input, const struct gpujpeg_image_planes* planes);
+
+/**
+ * Set encoder input image size which differs from encoded image size (set by
+ * image parameters), the input image is resampled to encoded image size during
+ * color conversion in preprocessor. Must be called after encoder input data are set.
+ * Supported only for pixel formats GPUJPEG_U8 and GPUJPEG_444_U8_P012.
+ *
+ * @param encoder_input  Encoder input structure
+ * @param width  Input image width
+ * @param height  Input image height
+ * @param filter  Resampling filter
+ * @return void
+ */
+GPUJPEG_API void
+gpujpeg_encoder_input_set_resize(struct gpujpeg_encoder_input* input, int width, int height, enum gpujpeg_resize_filter filter);
+
 /**
  * Create JPEG encoder
  *
@@ -147,6 +217,13 @@ gpujpeg_encoder_allocate(struct gpujpeg_encoder* encoder, struct gpujpeg_paramet
 /**
  * Compress image by encoder
  *
+ * Image with 12-bit precision (see gpujpeg_parameters.precision) must be given
+ * in GPUJPEG_U16 or GPUJPEG_444_U16_P012 pixel format and it is encoded only with
+ * 4:4:4 sampling and without input resampling, other combinations are rejected.
+ * Its huffman coding is always performed on CPU after preprocessing, DCT and
+ * quantization on GPU (GPU huffman coder and CPU encoding enabled by
+ * gpujpeg_encoder_set_host_threads handle only 8-bit images).
+ *
  * @param encoder  Encoder structure
  * @param param  Parameters for coder
  * @param param_image  Parameters for image data
@@ -158,6 +235,124 @@ gpujpeg_encoder_allocate(struct gpujpeg_encoder* encoder, struct gpujpeg_paramet
 GPUJPEG_API int
 gpujpeg_encoder_encode(struct gpujpeg_encoder* encoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image, struct gpujpeg_encoder_input* input, uint8_t** image_compressed, int* image_compressed_size);
 
+/**
+ * Compress image and its 2x downsampled versions (resolution pyramid) by encoder
+ *
+ * Level 0 is the full resolution image, each next level has half width and height
+ * (rounded up) of the previous level. The input image is uploaded and preprocessed
+ * only once, each next level is filtered from the preprocessed component planes of
+ * the previous level and all levels share quantization and huffman tables and the
+ * header. Compressed levels are placed in a buffer owned by the encoder, which is
+ * valid until next encoding. Image with 12-bit precision can't be encoded as
+ * resolution pyramid.
+ *
+ * @param encoder  Encoder structure
+ * @param param  Parameters for coder
+ * @param param_image  Parameters for image data (full resolution)
+ * @param input  Source image data
+ * @param filter  Filter used for downsampling the levels
+ * @param level_count  Number of pyramid levels to encode (including full resolution)
+ * @param image_compressed  Array of level_count pointers where compressed level data will be placed
+ * @param image_compressed_size  Array of level_count variables where compressed level sizes will be placed
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_encoder_encode_pyramid(struct gpujpeg_encoder* encoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image, struct gpujpeg_encoder_input* input,
+                               enum gpujpeg_resize_filter filter, int level_count, uint8_t** image_compressed, int* image_compressed_size);
+
+/**
+ * Compress image with alpha channel by encoder, the color components and the alpha
+ * channel are compressed to two JPEG images (the alpha channel as grayscale image)
+ *
+ * Input must have GPUJPEG_444_U8_P012X or GPUJPEG_444_U8_P210X pixel format where the
+ * fourth byte of each pixel is alpha. The input image is uploaded and preprocessed
+ * only once, the preprocessor extracts the alpha plane in the same pass. Alpha image
+ * is encoded with the same quality, restart interval and luminance tables as the
+ * color image. Both images are placed in a buffer owned by the encoder, which is
+ * valid until next encoding.
+ *
+ * @param encoder  Encoder structure
+ * @param param  Parameters for coder
+ * @param param_image  Parameters for image data
+ * @param input  Source image data (resampling is not supported)
+ * @param image_compressed  Pointer to variable where compressed color image data buffer will be placed
+ * @param image_compressed_size  Pointer to variable where compressed color image size will be placed
+ * @param alpha_compressed  Pointer to variable where compressed alpha image data buffer will be placed
+ * @param alpha_compressed_size  Pointer to variable where compressed alpha image size will be placed
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_encoder_encode_alpha(struct gpujpeg_encoder* encoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image, struct gpujpeg_encoder_input* input,
+                             uint8_t** image_compressed, int* image_compressed_size, uint8_t** alpha_compressed, int* alpha_compressed_size);
+
+/**
+ * Enables encoding on CPU (default disabled). Image is streamed by MCU rows
+ * through color conversion, sampling, DCT, quantization and huffman coding
+ * while each row stays in cache, restart intervals are spread across threads
+ * and stitched in order (an image without restart interval is encoded by one
+ * thread). Only images from host memory (image or image planes input) with
+ * 8-bit precision, one scan and no resampling are encoded on CPU, other images
+ * are still encoded on GPU. Downsampling by other than nearest filter needs
+ * neighbouring rows, so each MCU row is then downsampled from its rows
+ * extended by a halo of rows of neighbouring MCU rows.
+ *
+ * @param encoder       Encoder structure
+ * @param thread_count  Number of threads (negative for number of hardware threads, 0 disables CPU encoding)
+ */
+GPUJPEG_API void
+gpujpeg_encoder_set_host_threads(struct gpujpeg_encoder* encoder, int thread_count);
+
+/**
+ * Sets cost model which routes encoding pipeline stages per image (default
+ * none). Image is encoded on CPU (see gpujpeg_encoder_set_host_threads) when
+ * the model estimates it faster than GPU and huffman coding of images encoded
+ * on GPU is routed to CPU or GPU by the model, so small images are encoded
+ * entirely on CPU. Host thread count 0 means number of hardware threads while
+ * model is set. Without model, huffman coding is performed on CPU only for
+ * images without restart interval or with 12-bit precision. Decision is
+ * available in coder.route.
+ *
+ * @param encoder  Encoder structure
+ * @param model    Cost model (copied), NULL disables routing by cost model and resets it to default
+ */
+GPUJPEG_API void
+gpujpeg_encoder_set_route_model(struct gpujpeg_encoder* encoder, const struct gpujpeg_route_model* model);
+
+/**
+ * Enables measuring of stage durations (default disabled). Stages performed on
+ * CPU are timed by monotonic clock, stages in CUDA stream by CUDA events, so
+ * enabling adds only a few event records per image. Byte and segment counters
+ * and backends are filled also when disabled.
+ *
+ * @param encoder  Encoder structure
+ * @param enabled  Flag if durations are measured
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_encoder_set_stats(struct gpujpeg_encoder* encoder, int enabled);
+
+/**
+ * Attaches trace which records frames, pipeline stages and worker threads of
+ * the encoder (see gpujpeg_trace), stage durations are measured while the trace
+ * is attached. The trace must not be destroyed before it is detached or the
+ * encoder is destroyed.
+ *
+ * @param encoder  Encoder structure
+ * @param trace  Trace structure or NULL for detaching
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_encoder_set_trace(struct gpujpeg_encoder* encoder, struct gpujpeg_trace* trace);
+
+/**
+ * Gets statistics of the last encoded image (all images of pyramid or alpha encoding)
+ *
+ * @param encoder  Encoder structure
+ * @param stats    Statistics structure to be filled
+ */
+GPUJPEG_API void
+gpujpeg_encoder_get_stats(struct gpujpeg_encoder* encoder, struct gpujpeg_stats* stats);
+
 /**
  * Destory JPEG encoder
  *
@@ -51,6 +51,8 @@ struct gpujpeg_encoder
 
     // Quantization tables
     struct gpujpeg_table_quantization table_quantization[GPUJPEG_COMPONENT_TYPE_COUNT];
+    // Quantization tables were replaced by coefficient input (must be reinitialized)
+    int table_quantization_custom;
 
     // Huffman coder tables
     struct gpujpeg_table_huffman_encoder table_huffman[GPUJPEG_COMPONENT_TYPE_COUNT][GPUJPEG_HUFFMAN_TYPE_COUNT];
@@ -58,13 +60,27 @@ struct gpujpeg_encoder
     // Huffman GPU encoder
     struct gpujpeg_huffman_gpu_encoder * huffman_gpu_encoder;
 
+    // Component planes of previous resolution pyramid level (or alpha plane) in device memory
+    uint8_t* d_pyramid_data;
+    // Allocated size of previous pyramid level planes
+    size_t pyramid_data_allocated_size;
+
+    // Compressed resolution pyramid levels (or color and alpha images) one after another
+    uint8_t* pyramid_buffer;
+    // Allocated size of compressed resolution pyramid buffer
+    size_t pyramid_buffer_allocated_size;
+
+    // Number of threads of host encoding pipeline (0 when images are encoded on GPU)
+    int host_thread_count;
+
+    // Cost model used to route pipeline stages (default model when route_enabled isn't set)
+    struct gpujpeg_route_model route_model;
+    // Flag if pipeline stages are routed by cost model, otherwise fixed rules are used
+    int route_enabled;
+
     // Stream
     cudaStream_t * stream;
     cudaStream_t * allocatedStream;
-
-    // Timers
-    GPUJPEG_CUSTOM_TIMER_DECLARE(def)
-    GPUJPEG_CUSTOM_TIMER_DECLARE(in_gpu)
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_ROUTE_H
+#define GPUJPEG_ROUTE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (defined(_MSC_VER) || defined(__MINGW32__)) && !defined(GPUJPEG_STATIC)
+    #ifdef GPUJPEG_EXPORTS
+        #define GPUJPEG_API __declspec(dllexport)
+    #else
+        #define GPUJPEG_API __declspec(dllimport)
+    #endif
+#else
+    #define GPUJPEG_API
+#endif
+
+/**
+ * Backend which performs pipeline stage
+ */
+enum gpujpeg_route_backend {
+    // Stage is performed on GPU
+    GPUJPEG_ROUTE_DEVICE = 0,
+    // Stage is performed on CPU
+    GPUJPEG_ROUTE_HOST = 1,
+};
+
+/**
+ * Cost model of coding pipeline, durations are linear in number of samples
+ * (or bytes) of the image plus fixed overhead of the backend
+ */
+struct gpujpeg_route_model
+{
+    // Fixed overhead of whole image pipeline on CPU [us]
+    double host_overhead;
+    // Transform (color conversion, sampling and DCT) on one CPU thread [ns per sample]
+    double host_transform;
+    // Huffman coding on one CPU thread [ns per sample]
+    double host_huffman;
+    // Fixed overhead of whole image pipeline on GPU (launches and synchronization) [us]
+    double device_overhead;
+    // Transform (color conversion, sampling and DCT) on GPU [ns per sample]
+    double device_transform;
+    // Fixed overhead of huffman coding on GPU [us]
+    double device_huffman_overhead;
+    // Huffman coding of one segment by one GPU thread [ns per sample]
+    double device_huffman;
+    // Number of segments coded concurrently by GPU
+    int device_huffman_parallelism;
+    // Transfer between host and device memory [ns per byte]
+    double transfer;
+};
+
+/**
+ * Properties of image which are needed by routing decision
+ */
+struct gpujpeg_route_image
+{
+    // Size of raw image in bytes
+    size_t raw_size;
+    // Number of samples of all components
+    size_t sample_count;
+    // Number of segments (restart intervals)
+    int segment_count;
+    // Number of threads available for CPU pipeline
+    int host_thread_count;
+    // Flag if whole image can be coded by CPU pipeline
+    int host_image_supported;
+    // Flag if huffman coding can be performed on GPU
+    int device_huffman_supported;
+    // Flag if raw image already resides in device memory (no transfer is needed)
+    int raw_on_device;
+};
+
+/**
+ * Routing decision for one image
+ */
+struct gpujpeg_route_decision
+{
+    // Backend of whole image (CPU pipeline or GPU pipeline)
+    enum gpujpeg_route_backend image;
+    // Backend of huffman coding when image is coded by GPU pipeline
+    enum gpujpeg_route_backend huffman;
+    // Number of leading segments whose huffman decoding is performed on CPU
+    // concurrently with the rest on GPU (0 when huffman coding isn't split)
+    int huffman_host_segment_count;
+    // Estimated duration of CPU pipeline [ms] (0 when not supported)
+    double duration_host;
+    // Estimated duration of GPU pipeline [ms]
+    double duration_device;
+};
+
+/**
+ * Set default cost model (rough numbers for a current desktop CPU and GPU)
+ *
+ * @param model  Cost model
+ */
+GPUJPEG_API void
+gpujpeg_route_model_set_default(struct gpujpeg_route_model* model);
+
+/**
+ * Load cost model from profile file with "key value" lines (keys are names
+ * of gpujpeg_route_model fields, missing keys keep current values)
+ *
+ * @param model  Cost model
+ * @param filename  Profile filename
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_route_model_load(struct gpujpeg_route_model* model, const char* filename);
+
+/**
+ * Save cost model to profile file (see gpujpeg_route_model_load)
+ *
+ * @param model  Cost model
+ * @param filename  Profile filename
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_route_model_save(const struct gpujpeg_route_model* model, const char* filename);
+
+/**
+ * Calibrate cost model by microbenchmark, synthetic images of two sizes are
+ * encoded on CPU and then decoded on CPU and on GPU, fixed overheads and per
+ * sample costs are fitted from measured durations (CUDA device or host runtime
+ * must be initialized, calibration fails when a pipeline isn't really used)
+ *
+ * @param model  Cost model (fields which are not measured keep current values)
+ * @param host_thread_count  Number of CPU threads the model is calibrated for
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_route_model_calibrate(struct gpujpeg_route_model* model, int host_thread_count);
+
+/**
+ * Decide backends of image pipeline stages by cost model
+ *
+ * @param model  Cost model
+ * @param image  Image properties
+ * @param decision  Routing decision
+ */
+GPUJPEG_API void
+gpujpeg_route_decide(const struct gpujpeg_route_model* model, const struct gpujpeg_route_image* image, struct gpujpeg_route_decision* decision);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_ROUTE_H
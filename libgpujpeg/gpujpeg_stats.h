@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_STATS_H
+#define GPUJPEG_STATS_H
+
+#include <stddef.h>
+#include <libgpujpeg/gpujpeg_route.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Stage of encoding or decoding pipeline. Stages performed on CPU are timed by
+ * monotonic clock, stages performed in CUDA stream by CUDA events (they measure
+ * device time between the events, not time which CPU spends by launching).
+ */
+enum gpujpeg_stats_stage {
+    // Parsing of JPEG stream (decoder only, without building of tables)
+    GPUJPEG_STATS_READER = 0,
+    // Building of quantization and huffman tables (including copy to device memory)
+    GPUJPEG_STATS_TABLES = 1,
+    // Copy of raw image, coefficients or compressed data to device memory
+    GPUJPEG_STATS_UPLOAD = 2,
+    // Color conversion and sampling (postprocessing of decoder)
+    GPUJPEG_STATS_PREPROCESS = 3,
+    // DCT and quantization (IDCT and dequantization of decoder), stages fused with
+    // preprocessing are accounted here as whole
+    GPUJPEG_STATS_DCT = 4,
+    // Huffman coding, whole image coded on CPU by MCU rows is accounted here
+    GPUJPEG_STATS_HUFFMAN = 5,
+    // Formatting of JPEG stream (encoder only)
+    GPUJPEG_STATS_FORMATTER = 6,
+    // Copy of coefficients, compressed data or raw image from device memory
+    GPUJPEG_STATS_DOWNLOAD = 7,
+    // CPU waiting for completion of CUDA stream
+    GPUJPEG_STATS_WAIT = 8,
+    // Mapping and unmapping of OpenGL texture
+    GPUJPEG_STATS_OPENGL = 9,
+    // Number of stages
+    GPUJPEG_STATS_STAGE_COUNT = 10
+};
+
+/**
+ * Statistics of the last encoded or decoded image, counters and backends are
+ * always filled, durations only when statistics are enabled (see
+ * gpujpeg_encoder_set_stats and gpujpeg_decoder_set_stats) or trace is attached
+ */
+struct gpujpeg_stats
+{
+    // Flag if durations are measured
+    int enabled;
+    // Duration of each stage [ms], stage coded concurrently on CPU and GPU
+    // (split huffman decoding) sums both durations
+    double duration[GPUJPEG_STATS_STAGE_COUNT];
+    // Duration of whole encoding or decoding call [ms]
+    double duration_total;
+    // Size of raw image [bytes]
+    size_t raw_size;
+    // Size of JPEG image (all images of pyramid or alpha encoding) [bytes]
+    size_t compressed_size;
+    // Number of bytes copied to device memory
+    size_t upload_size;
+    // Number of bytes copied from device memory
+    size_t download_size;
+    // Number of segments (restart intervals) of all coded images
+    int segment_count;
+    // Number of segments whose huffman coding was performed on CPU
+    int huffman_host_segment_count;
+    // Backend of whole image (CPU pipeline or GPU pipeline)
+    enum gpujpeg_route_backend image;
+    // Backend of huffman coding (GPU when at least part of segments was coded on GPU)
+    enum gpujpeg_route_backend huffman;
+};
+
+/**
+ * Get name of pipeline stage
+ *
+ * @param stage  Pipeline stage
+ * @return stage name (e.g. "huffman")
+ */
+GPUJPEG_API const char*
+gpujpeg_stats_stage_get_name(enum gpujpeg_stats_stage stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_STATS_H
@@ -0,0 +1,217 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_STATS_INTERNAL_H
+#define GPUJPEG_STATS_INTERNAL_H
+
+#include <libgpujpeg/gpujpeg_common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of stages recorded in CUDA stream for one image (further ones aren't timed) */
+#define GPUJPEG_STATS_MAX_RECORD_COUNT 64
+
+/** Stage recorded in CUDA stream */
+struct gpujpeg_stats_record
+{
+    // Recorded stage
+    enum gpujpeg_stats_stage stage;
+    // Events recorded before and after the stage
+    cudaEvent_t start;
+    cudaEvent_t stop;
+    // Flag if the stop event is recorded
+    int stopped;
+    // Time when the start event was recorded by CPU (device can't reach it earlier) [s]
+    double host_time;
+};
+
+/**
+ * Recorder of stage durations of coder, it exists only while statistics are
+ * enabled or trace is attached, so timing calls cost only a pointer check otherwise
+ */
+struct gpujpeg_stats_recorder
+{
+    // Flag if statistics are enabled
+    int enabled;
+    // Attached trace (NULL when not tracing), process of the coder in the trace
+    // and number of frames traced
+    struct gpujpeg_trace* trace;
+    int trace_process;
+    int trace_frame_count;
+    // Start of whole call [s]
+    double start;
+    // Start of each stage performed on CPU [s]
+    double host_start[GPUJPEG_STATS_STAGE_COUNT];
+    // Stages recorded in CUDA stream for current image
+    struct gpujpeg_stats_record record[GPUJPEG_STATS_MAX_RECORD_COUNT];
+    int record_count;
+    // Number of records whose events are created (they are reused by next images)
+    int record_allocated_count;
+};
+
+/**
+ * Enable or disable measuring of stage durations
+ *
+ * @param coder  Coder structure
+ * @param enabled  Flag if durations are measured
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_stats_set_enabled(struct gpujpeg_coder* coder, int enabled);
+
+/**
+ * Attach trace which records stages of coder or detach it
+ *
+ * @param coder  Coder structure
+ * @param trace  Trace structure or NULL for detaching
+ * @param name  Name of coder process in the trace (e.g. "encoder")
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_stats_set_trace(struct gpujpeg_coder* coder, struct gpujpeg_trace* trace, const char* name);
+
+/**
+ * Disable statistics and detach trace
+ *
+ * @param coder  Coder structure
+ */
+void
+gpujpeg_stats_deinit(struct gpujpeg_coder* coder);
+
+/**
+ * Reset statistics at the beginning of encoding or decoding call
+ *
+ * @param coder  Coder structure
+ */
+void
+gpujpeg_stats_begin(struct gpujpeg_coder* coder);
+
+/**
+ * Collect durations of stages recorded in CUDA stream at the end of successful
+ * encoding or decoding call (the stream is already synchronized)
+ *
+ * @param coder  Coder structure
+ */
+void
+gpujpeg_stats_end(struct gpujpeg_coder* coder);
+
+/**
+ * Start timing of stage performed on CPU
+ *
+ * @param coder  Coder structure
+ * @param stage  Pipeline stage
+ */
+void
+gpujpeg_stats_host_start(struct gpujpeg_coder* coder, enum gpujpeg_stats_stage stage);
+
+/**
+ * Stop timing of stage performed on CPU, duration is added to the stage
+ *
+ * @param coder  Coder structure
+ * @param stage  Pipeline stage
+ */
+void
+gpujpeg_stats_host_stop(struct gpujpeg_coder* coder, enum gpujpeg_stats_stage stage);
+
+/**
+ * Record start of stage performed in CUDA stream
+ *
+ * @param coder  Coder structure
+ * @param stage  Pipeline stage
+ * @param stream  CUDA stream
+ */
+void
+gpujpeg_stats_device_start(struct gpujpeg_coder* coder, enum gpujpeg_stats_stage stage, cudaStream_t stream);
+
+/**
+ * Record stop of stage performed in CUDA stream (stage must be started by
+ * gpujpeg_stats_device_start), duration is added to the stage at gpujpeg_stats_end
+ *
+ * @param coder  Coder structure
+ * @param stage  Pipeline stage
+ * @param stream  CUDA stream
+ */
+void
+gpujpeg_stats_device_stop(struct gpujpeg_coder* coder, enum gpujpeg_stats_stage stage, cudaStream_t stream);
+
+/**
+ * Trace work of worker thread (may be called concurrently from worker threads,
+ * it doesn't affect statistics)
+ *
+ * @param coder  Coder structure
+ * @param thread_index  Index of worker thread
+ * @param begin  Time when the thread started work [s]
+ * @param end  Time when the thread finished work [s]
+ */
+void
+gpujpeg_stats_trace_worker(struct gpujpeg_coder* coder, int thread_index, double begin, double end);
+
+/**
+ * Timelines (threads) of coder process in trace
+ */
+enum gpujpeg_trace_thread {
+    // Thread which calls encoder or decoder
+    GPUJPEG_TRACE_THREAD_HOST = 0,
+    // CUDA stream of coder
+    GPUJPEG_TRACE_THREAD_DEVICE = 1,
+    // First worker thread (following ones have consecutive indexes)
+    GPUJPEG_TRACE_THREAD_WORKER = 2
+};
+
+/**
+ * Add coder process to trace
+ *
+ * @param trace  Trace structure
+ * @param name  Name of the process
+ * @return index of the process
+ */
+int
+gpujpeg_trace_add_process(struct gpujpeg_trace* trace, const char* name);
+
+/**
+ * Add event to trace (thread safe)
+ *
+ * @param trace  Trace structure
+ * @param name  Name of the event (static string)
+ * @param process  Index of coder process
+ * @param thread  Timeline of the process (see gpujpeg_trace_thread)
+ * @param begin  Begin of the event [s] (by gpujpeg_get_time)
+ * @param end  End of the event [s] (by gpujpeg_get_time)
+ * @param frame  Index of frame for frame events, otherwise -1
+ */
+void
+gpujpeg_trace_add_event(struct gpujpeg_trace* trace, const char* name, int process, int thread, double begin, double end, int frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_STATS_INTERNAL_H
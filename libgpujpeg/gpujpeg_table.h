@@ -85,14 +85,16 @@ static const int gpujpeg_order_natural[GPUJPEG_ORDER_NATURAL_SIZE] = {
 /** JPEG quantization table structure */
 struct gpujpeg_table_quantization
 {
-    // Quantization raw table
-    uint8_t table_raw[64];
+    // Quantization raw table (values above 255 are allowed only for 12-bit precision)
+    uint16_t table_raw[64];
     // Quantization forward/inverse table
     uint16_t table[64];
     // Quantization forward/inverse table in device memory
     uint16_t* d_table;
     // Quantization table for forward DCT, pre-divided with output DCT weights and transposed for coealescent access
     float* d_table_forward;
+    // Quantization table for forward DCT in host memory (the same as d_table_forward)
+    float table_forward[64];
 };
 
 /** JPEG table for huffman encoding */
@@ -130,6 +132,33 @@ struct gpujpeg_table_huffman_decoder {
     unsigned char huffval[256];
 };
 
+/** Maximum number of built huffman decoder tables kept in cache */
+#define GPUJPEG_TABLE_HUFFMAN_DECODER_CACHE_SIZE 8
+
+/** Built huffman decoder table in cache */
+struct gpujpeg_table_huffman_decoder_cache_entry {
+    // Hash of DHT content (bits and huffval arrays)
+    uint32_t hash;
+    // Identifier of built table, unique in process (0 when entry is unused)
+    unsigned int id;
+    // Value of cache use counter when entry was used last time
+    unsigned int last_use;
+    // Number of decoder table slots which refer to the entry (it is not replaced when referred)
+    int ref_count;
+    // Built table
+    struct gpujpeg_table_huffman_decoder table;
+    // Built table in device memory
+    struct gpujpeg_table_huffman_decoder* d_table;
+};
+
+/** Cache of built huffman decoder tables keyed by DHT content */
+struct gpujpeg_table_huffman_decoder_cache {
+    // Cache entries (least recently used entry which is not referred is replaced)
+    struct gpujpeg_table_huffman_decoder_cache_entry entry[GPUJPEG_TABLE_HUFFMAN_DECODER_CACHE_SIZE];
+    // Use counter
+    unsigned int use_counter;
+};
+
 /**
  * Init JPEG quantization table for encoder
  * 
@@ -176,10 +205,11 @@ gpujpeg_table_quantization_print(struct gpujpeg_table_quantization* table);
  * @param table  Table structure
  * @param comp_type  Component type (luminance/chrominance)
  * @param huff_type  Huffman type (DC/AC)
+ * @param precision  Sample precision (for 12-bit the default table is extended by codes of additional categories)
  * @return void
  */
 int
-gpujpeg_table_huffman_encoder_init(struct gpujpeg_table_huffman_encoder* table, enum gpujpeg_component_type comp_type, enum gpujpeg_huffman_type huff_type);
+gpujpeg_table_huffman_encoder_init(struct gpujpeg_table_huffman_encoder* table, enum gpujpeg_component_type comp_type, enum gpujpeg_huffman_type huff_type, int precision);
 
 /**
  * Initialize decoder huffman DC and AC table for component type. It copies bit and values arrays to table and call compute routine.
@@ -203,6 +233,39 @@ gpujpeg_table_huffman_decoder_init(struct gpujpeg_table_huffman_decoder* table,
 void
 gpujpeg_table_huffman_decoder_compute(struct gpujpeg_table_huffman_decoder* table, struct gpujpeg_table_huffman_decoder* d_table);
 
+/**
+ * Init cache of huffman decoder tables, device tables are allocated and the
+ * standard tables (Annex K) are built into the cache beforehand
+ *
+ * @param cache  Cache structure
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_table_huffman_decoder_cache_init(struct gpujpeg_table_huffman_decoder_cache* cache);
+
+/**
+ * Destroy cache of huffman decoder tables
+ *
+ * @param cache  Cache structure
+ * @return void
+ */
+void
+gpujpeg_table_huffman_decoder_cache_destroy(struct gpujpeg_table_huffman_decoder_cache* cache);
+
+/**
+ * Set decoder table slot to cached table built from given bits and values arrays,
+ * the table is built (and copied to device memory) only when it is not cached
+ *
+ * @param cache  Cache structure
+ * @param slot  Decoder table slot, pointer to entry which the slot refers to (or NULL)
+ * @param bits  Number of symbols with codes of length k bits (bits[0] is unused)
+ * @param huffval  Symbols in order of increasing code length
+ * @return 1 if slot refers to another table now, 0 if it is unchanged, -1 if fails
+ */
+int
+gpujpeg_table_huffman_decoder_cache_set(struct gpujpeg_table_huffman_decoder_cache* cache, struct gpujpeg_table_huffman_decoder_cache_entry** slot,
+                                        const unsigned char bits[17], const unsigned char* huffval);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_TRACE_H
+#define GPUJPEG_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (defined(_MSC_VER) || defined(__MINGW32__)) && !defined(GPUJPEG_STATIC)
+    #ifdef GPUJPEG_EXPORTS
+        #define GPUJPEG_API __declspec(dllexport)
+    #else
+        #define GPUJPEG_API __declspec(dllimport)
+    #endif
+#else
+    #define GPUJPEG_API
+#endif
+
+/**
+ * Trace of pipeline execution. Encoders and decoders attached to the trace
+ * (see gpujpeg_encoder_set_trace and gpujpeg_decoder_set_trace) record begin
+ * and end of each frame, pipeline stage and worker thread, stages performed
+ * in CUDA stream are placed on separate device timeline. Trace can be shared
+ * by several coders (also used from different threads), each of them is shown
+ * as separate process. Events are kept in memory until the trace is destroyed.
+ */
+struct gpujpeg_trace;
+
+/**
+ * Create trace
+ *
+ * @return trace structure if succeeds, otherwise NULL
+ */
+GPUJPEG_API struct gpujpeg_trace*
+gpujpeg_trace_create(void);
+
+/**
+ * Save recorded events in Chrome trace event format (JSON), which can be
+ * opened by chrome://tracing or Perfetto UI
+ *
+ * @param trace  Trace structure
+ * @param filename  Output file name
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_trace_save(struct gpujpeg_trace* trace, const char* filename);
+
+/**
+ * Destroy trace (it must be detached from all encoders and decoders or they
+ * must be already destroyed)
+ *
+ * @param trace  Trace structure
+ */
+GPUJPEG_API void
+gpujpeg_trace_destroy(struct gpujpeg_trace* trace);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_TRACE_H
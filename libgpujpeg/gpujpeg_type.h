@@ -45,7 +45,7 @@ extern "C" {
 /** Contants */
 #define GPUJPEG_BLOCK_SIZE                      8
 #define GPUJPEG_BLOCK_SQUARED_SIZE              64
-#define GPUJPEG_MAX_COMPONENT_COUNT             3
+#define GPUJPEG_MAX_COMPONENT_COUNT             4
 #define GPUJPEG_MAX_BLOCK_COMPRESSED_SIZE       (GPUJPEG_BLOCK_SIZE * GPUJPEG_BLOCK_SIZE * 4)
 
 /** Maximum JPEG header size (MUST be divisible by 4!!!) */
@@ -54,6 +54,7 @@ extern "C" {
 /** Flags */
 #define GPUJPEG_VERBOSE                         1
 #define GPUJPEG_OPENGL_INTEROPERABILITY         2
+#define GPUJPEG_HOST_RUNTIME                    4
 
 /** Maximum number of segment info header in stream */
 #define GPUJPEG_MAX_SEGMENT_INFO_HEADER_COUNT   100
@@ -68,7 +69,9 @@ enum gpujpeg_color_space {
     GPUJPEG_YCBCR_BT601_256LVLS = 3,
     GPUJPEG_YCBCR_BT709 = 4,
     GPUJPEG_YCBCR = GPUJPEG_YCBCR_BT709,
-    GPUJPEG_YUV = 5
+    GPUJPEG_YUV = 5,
+    GPUJPEG_CMYK = 6,
+    GPUJPEG_YCCK = 7
 };
 
 /**
@@ -92,6 +95,10 @@ gpujpeg_color_space_get_name(enum gpujpeg_color_space color_space)
         return "YCbCr BT.601 256 Levels";
     case GPUJPEG_YCBCR_BT709:
         return "YCbCr BT.709";
+    case GPUJPEG_CMYK:
+        return "CMYK";
+    case GPUJPEG_YCCK:
+        return "YCCK";
     default:
         return "Unknown";
     }
@@ -119,7 +126,114 @@ enum gpujpeg_pixel_format {
     GPUJPEG_422_U8_P0P1P2 = 4,
 
     /// 8bit unsigned samples, planar, 3 components, 4:2:0, planar
-    GPUJPEG_420_U8_P0P1P2 = 5
+    GPUJPEG_420_U8_P0P1P2 = 5,
+
+    /// 8bit unsigned samples, 3 components, 4:4:4, 4 bytes per pixel,
+    /// sample order: comp#0 comp#1 comp#2 and ignored byte (e.g. RGBA, RGBX), interleaved,
+    /// rows must be 4-byte aligned
+    GPUJPEG_444_U8_P012X = 6,
+
+    /// 8bit unsigned samples, 3 components, 4:4:4, 4 bytes per pixel,
+    /// sample order: comp#2 comp#1 comp#0 and ignored byte (e.g. BGRA, BGRX), interleaved,
+    /// rows must be 4-byte aligned
+    GPUJPEG_444_U8_P210X = 7,
+
+    /// 8bit unsigned samples, 3 components, 4:2:2,
+    /// order of samples: comp#0 comp#1 comp#0 comp#2 (YUYV), interleaved
+    GPUJPEG_422_U8_P0102 = 8,
+
+    /// 8bit unsigned samples, 3 components, 4:2:0, plane of comp#0 followed
+    /// by plane of interleaved comp#1 comp#2 samples (NV12), semi-planar
+    GPUJPEG_420_U8_P0P12 = 9,
+
+    /// 8bit unsigned samples, 4 components, 4:4:4 sampling,
+    /// sample order: comp#0 comp#1 comp#2 comp#3 (e.g. CMYK), interleaved,
+    /// rows must be 4-byte aligned
+    GPUJPEG_4444_U8_P0123 = 10,
+
+    /// 16bit unsigned samples holding 12-bit values (0-4095), 1 component
+    GPUJPEG_U16 = 11,
+
+    /// 16bit unsigned samples holding 12-bit values (0-4095), 3 components, 4:4:4 sampling,
+    /// sample order: comp#0 comp#1 comp#2, interleaved
+    GPUJPEG_444_U16_P012 = 12
+};
+
+/**
+ * Get sample precision of pixel format in bits (16bit formats carry 12-bit samples)
+ *
+ * @param pixel_format
+ */
+static int
+gpujpeg_pixel_format_get_precision(enum gpujpeg_pixel_format pixel_format)
+{
+    return (pixel_format == GPUJPEG_U16 || pixel_format == GPUJPEG_444_U16_P012) ? 12 : 8;
+}
+
+/**
+ * Filter used when resampling component planes
+ */
+enum gpujpeg_resize_filter {
+    /// Box filter (average of source samples covered by target sample)
+    GPUJPEG_RESIZE_FILTER_BOX = 0,
+
+    /// Lanczos filter with 2 lobes (sharper, slower)
+    GPUJPEG_RESIZE_FILTER_LANCZOS = 1
+};
+
+/**
+ * Filter used for chroma subsampling (downsampling of subsampled components by
+ * encoder and their upsampling by decoder), chroma samples are centered between
+ * the pixels they cover
+ */
+enum gpujpeg_sampling_filter {
+    /// Downsampling drops samples, upsampling replicates them (nearest neighbor)
+    GPUJPEG_SAMPLING_FILTER_NEAREST = 0,
+
+    /// Downsampling averages covered samples, upsampling replicates them
+    GPUJPEG_SAMPLING_FILTER_BOX = 1,
+
+    /// Triangle filter, downsampling by tent of two target samples width and
+    /// upsampling by linear interpolation ("fancy" upsampling)
+    GPUJPEG_SAMPLING_FILTER_TRIANGLE = 2
+};
+
+/**
+ * Element type of decoded tensor
+ */
+enum gpujpeg_tensor_type {
+    /// 32-bit floating point
+    GPUJPEG_TENSOR_FLOAT32 = 0,
+
+    /// 16-bit floating point (IEEE half)
+    GPUJPEG_TENSOR_FLOAT16 = 1
+};
+
+/**
+ * Memory layout of decoded tensor
+ */
+enum gpujpeg_tensor_layout {
+    /// Planar channels [C,H,W] (batches form [N,C,H,W])
+    GPUJPEG_TENSOR_NCHW = 0,
+
+    /// Interleaved channels [H,W,C] (batches form [N,H,W,C])
+    GPUJPEG_TENSOR_NHWC = 1
+};
+
+/**
+ * Tensor format, every decoded sample is stored as value * scale + bias of its channel
+ * (channels are in the order of decoder output color space, e.g. R, G, B)
+ */
+struct gpujpeg_tensor_format
+{
+    // Element type
+    enum gpujpeg_tensor_type type;
+    // Memory layout
+    enum gpujpeg_tensor_layout layout;
+    // Per-channel scale (e.g. 1 / (255 * std))
+    float scale[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Per-channel bias (e.g. -mean / std)
+    float bias[GPUJPEG_MAX_COMPONENT_COUNT];
 };
 
 /**
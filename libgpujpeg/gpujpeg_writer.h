@@ -132,6 +132,19 @@ gpujpeg_writer_destroy(struct gpujpeg_writer* writer);
 void
 gpujpeg_writer_write_header(struct gpujpeg_encoder* encoder);
 
+/**
+ * Write JPEG header by copying header previously written for the same encoder
+ * parameters and tables, only image dimensions in SOF block are updated to
+ * current coder image size (used for resolution pyramid levels)
+ *
+ * @param encoder  Encoder structure
+ * @param header  Header template (from SOI up to the first scan)
+ * @param header_size  Header template size in bytes
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_writer_write_header_template(struct gpujpeg_encoder* encoder, const uint8_t* header, int header_size);
+
 /**
  * Write segment info for current position in write buffer
  *
@@ -151,6 +164,16 @@ gpujpeg_writer_write_segment_info(struct gpujpeg_encoder* encoder);
 void
 gpujpeg_writer_write_scan_header(struct gpujpeg_encoder* encoder, int scan_index);
 
+/**
+ * Write scans of compressed segments (each terminated by restart marker) from
+ * coder->data_compressed to writer buffer
+ *
+ * @param encoder  Encoder structure
+ * @return void
+ */
+void
+gpujpeg_writer_write_segments(struct gpujpeg_encoder* encoder);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,847 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Benchmark of encoder and decoder stages on synthetic images. Each case is
+ * coded by GPU pipeline (with GPU or CPU huffman coding) and by CPU pipeline,
+ * stage durations are taken from coder statistics (see gpujpeg_stats). Then
+ * single stages are called in loops on inputs prepared by the coding (by stage
+ * hooks of library, see gpujpeg_bench_stage.h). Durations are reported as JSON with ns per pixel and MB/s of raw image.
+ * Without CUDA device only the CPU pipeline is measured (by host runtime).
+ */
+
+#include <libgpujpeg/gpujpeg.h>
+#include "gpujpeg_bench_stage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Maximum number of values of one benchmark dimension */
+#define GPUJPEG_BENCH_MAX_VALUE_COUNT 16
+
+/** Pixel format measured by benchmark */
+struct gpujpeg_bench_format
+{
+    // Name of pixel format (as in gpujpeg tester)
+    const char* name;
+    enum gpujpeg_pixel_format pixel_format;
+    int comp_count;
+    // JPEG chroma subsampling of the pixel format (444, 422 or 420)
+    int subsampling;
+    // Color space of samples (luminance for single component, subsampled pixel formats carry YCbCr)
+    enum gpujpeg_color_space color_space;
+};
+
+/** Pixel formats of pixel format suite */
+static const struct gpujpeg_bench_format gpujpeg_bench_format[] = {
+    { "u8", GPUJPEG_U8, 1, 444, GPUJPEG_RGB },
+    { "444-u8-p012", GPUJPEG_444_U8_P012, 3, 444, GPUJPEG_RGB },
+    { "444-u8-p0p1p2", GPUJPEG_444_U8_P0P1P2, 3, 444, GPUJPEG_RGB },
+    { "444-u8-p012x", GPUJPEG_444_U8_P012X, 3, 444, GPUJPEG_RGB },
+    { "444-u8-p210x", GPUJPEG_444_U8_P210X, 3, 444, GPUJPEG_RGB },
+    { "422-u8-p1020", GPUJPEG_422_U8_P1020, 3, 422, GPUJPEG_YCBCR_BT601_256LVLS },
+    { "422-u8-p0102", GPUJPEG_422_U8_P0102, 3, 422, GPUJPEG_YCBCR_BT601_256LVLS },
+    { "422-u8-p0p1p2", GPUJPEG_422_U8_P0P1P2, 3, 422, GPUJPEG_YCBCR_BT601_256LVLS },
+    { "420-u8-p0p1p2", GPUJPEG_420_U8_P0P1P2, 3, 420, GPUJPEG_YCBCR_BT601_256LVLS },
+    { "420-u8-p0p12", GPUJPEG_420_U8_P0P12, 3, 420, GPUJPEG_YCBCR_BT601_256LVLS },
+    { "4444-u8-p0123", GPUJPEG_4444_U8_P0123, 4, 444, GPUJPEG_CMYK },
+};
+
+/** Backend configuration of coder */
+enum gpujpeg_bench_backend {
+    // GPU pipeline with GPU huffman coding
+    GPUJPEG_BENCH_GPU = 0,
+    // GPU pipeline with CPU huffman coding
+    GPUJPEG_BENCH_GPU_HOST_HUFFMAN = 1,
+    // CPU pipeline by MCU rows
+    GPUJPEG_BENCH_CPU = 2,
+    // Number of backends
+    GPUJPEG_BENCH_BACKEND_COUNT = 3
+};
+
+/** Names of backend configurations */
+static const char* gpujpeg_bench_backend_name[GPUJPEG_BENCH_BACKEND_COUNT] = { "gpu", "gpu-host-huffman", "cpu" };
+
+/** Benchmark settings and output */
+struct gpujpeg_bench
+{
+    // Number of measured iterations of each case (after one warm-up iteration)
+    int iterations;
+    // Number of CPU threads of CPU pipeline
+    int host_threads;
+    // Flag if only CPU pipeline is measured (no CUDA device)
+    int host_only;
+    // Image sizes
+    int width[GPUJPEG_BENCH_MAX_VALUE_COUNT];
+    int height[GPUJPEG_BENCH_MAX_VALUE_COUNT];
+    int size_count;
+    // Qualities, restart intervals and subsamplings of end-to-end suite
+    int quality[GPUJPEG_BENCH_MAX_VALUE_COUNT];
+    int quality_count;
+    int restart[GPUJPEG_BENCH_MAX_VALUE_COUNT];
+    int restart_count;
+    int subsampling[GPUJPEG_BENCH_MAX_VALUE_COUNT];
+    int subsampling_count;
+    // Output of JSON results and number of written results
+    FILE* output;
+    int result_count;
+};
+
+/** Measured durations of one case */
+struct gpujpeg_bench_measurement
+{
+    // Minimum of whole call and of each stage over iterations [ms]
+    double total;
+    double duration[GPUJPEG_STATS_STAGE_COUNT];
+    // Statistics of the last iteration
+    struct gpujpeg_stats stats;
+};
+
+/** Coding case */
+struct gpujpeg_bench_case
+{
+    // Name of suite the case belongs to
+    const char* suite;
+    const struct gpujpeg_bench_format* format;
+    // JPEG chroma subsampling (444, 422 or 420)
+    int subsampling;
+    struct gpujpeg_parameters param;
+    struct gpujpeg_image_parameters param_image;
+};
+
+static void
+print_help()
+{
+    printf("gpujpeg_bench [options]\n"
+           "   -h, --help             print help\n"
+           "   -D, --device           set cuda device id (default 0)\n"
+           "       --host-only        measure only CPU pipeline (by host runtime,\n"
+           "                          used also when no CUDA device is available)\n"
+           "       --host-threads     number of CPU threads of CPU pipeline\n"
+           "                          (default -1 for all cores)\n"
+           "   -n, --iterations       number of measured iterations (default 10)\n"
+           "   -s, --size             list of image sizes (default\n"
+           "                          1280x720,1920x1080,3840x2160)\n"
+           "   -q, --quality          list of qualities (default 50,75,95)\n"
+           "   -r, --restart          list of restart intervals (default 0,8,16)\n"
+           "       --subsampling      list of subsamplings (default 444,422,420)\n"
+           "   -o, --output           write JSON to file instead of stdout\n"
+           "\n"
+           "End-to-end suite codes 444-u8-p012 images of all combinations of sizes,\n"
+           "qualities, restart intervals and subsamplings, pixel format suite codes\n"
+           "the first size in each pixel format. Each result contains durations of\n"
+           "whole call and of pipeline stages from coder statistics (stages fused on\n"
+           "CPU pipeline are reported as huffman), decoder tables are built once and\n"
+           "then found in table cache as for video stream. Stage suite calls entry\n"
+           "point of each stage in loop on inputs of the coded case (CPU stages in\n"
+           "single thread), tables are built with empty cache and parse reads all\n"
+           "markers and segments. MB/s are related to size of raw image.\n");
+}
+
+/**
+ * Parse comma separated list of values
+ *
+ * @param text  List of values
+ * @param value  Parsed values
+ * @param value2  Second parsed values of "AxB" items (NULL when not used)
+ * @return number of values if succeeds, otherwise -1
+ */
+static int
+gpujpeg_bench_parse_list(const char* text, int* value, int* value2)
+{
+    int count = 0;
+    while ( *text != '\0' ) {
+        if ( count == GPUJPEG_BENCH_MAX_VALUE_COUNT ) {
+            return -1;
+        }
+        char* end = NULL;
+        value[count] = (int)strtol(text, &end, 10);
+        if ( end == text ) {
+            return -1;
+        }
+        if ( value2 != NULL ) {
+            if ( *end != 'x' ) {
+                return -1;
+            }
+            text = end + 1;
+            value2[count] = (int)strtol(text, &end, 10);
+            if ( end == text ) {
+                return -1;
+            }
+        }
+        count++;
+        text = end;
+        if ( *text == ',' ) {
+            text++;
+        }
+        else if ( *text != '\0' ) {
+            return -1;
+        }
+    }
+    return count;
+}
+
+/**
+ * Get sample stored at byte of image plane row in pixel format
+ *
+ * @param pixel_format  Pixel format
+ * @param plane  Plane index
+ * @param index  Byte index in plane row
+ * @param[out] comp  Component index (padding byte when it isn't less than component count)
+ * @param[out] x  First pixel column covered by the sample
+ * @param[out] factor_h  Number of pixel columns covered by the sample
+ * @param[out] factor_v  Number of pixel rows covered by the sample
+ */
+static void
+gpujpeg_bench_image_get_sample(enum gpujpeg_pixel_format pixel_format, int plane, int index, int* comp, int* x, int* factor_h, int* factor_v)
+{
+    // Component of each byte of pixel pair in 4:2:2 packed pixel formats
+    static const int comp_p1020[4] = { 1, 0, 2, 0 };
+    static const int comp_p0102[4] = { 0, 1, 0, 2 };
+
+    *comp = plane;
+    *x = index;
+    *factor_h = 1;
+    *factor_v = 1;
+    switch ( pixel_format ) {
+    case GPUJPEG_444_U8_P012:
+        *comp = index % 3;
+        *x = index / 3;
+        break;
+    case GPUJPEG_444_U8_P012X:
+    case GPUJPEG_4444_U8_P0123:
+        *comp = index % 4;
+        *x = index / 4;
+        break;
+    case GPUJPEG_444_U8_P210X:
+        *comp = index % 4 == 3 ? 3 : 2 - index % 4;
+        *x = index / 4;
+        break;
+    case GPUJPEG_422_U8_P1020:
+        *comp = comp_p1020[index % 4];
+        *x = index / 4 * 2 + (index % 4 == 3 ? 1 : 0);
+        *factor_h = *comp == 0 ? 1 : 2;
+        break;
+    case GPUJPEG_422_U8_P0102:
+        *comp = comp_p0102[index % 4];
+        *x = index / 4 * 2 + (index % 4 == 2 ? 1 : 0);
+        *factor_h = *comp == 0 ? 1 : 2;
+        break;
+    case GPUJPEG_422_U8_P0P1P2:
+        if ( plane > 0 ) {
+            *x = index * 2;
+            *factor_h = 2;
+        }
+        break;
+    case GPUJPEG_420_U8_P0P1P2:
+    case GPUJPEG_420_U8_P0P12:
+        if ( plane > 0 ) {
+            if ( pixel_format == GPUJPEG_420_U8_P0P12 ) {
+                *comp = 1 + index % 2;
+                index /= 2;
+            }
+            *x = index * 2;
+            *factor_h = 2;
+            *factor_v = 2;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Generate synthetic image (smooth pattern with noise, similar to photographs in entropy).
+ * The same RGB image is generated for each image size and it is converted to color space
+ * and pixel format of the image (subsampled samples are averages of covered pixels), so
+ * that results of pixel formats are comparable.
+ *
+ * @param param_image  Image parameters
+ * @return image buffer if succeeds, otherwise NULL
+ */
+static uint8_t*
+gpujpeg_bench_image_create(struct gpujpeg_image_parameters* param_image)
+{
+    int width = param_image->width;
+    int height = param_image->height;
+    int comp_count = param_image->comp_count;
+    size_t pixel_count = (size_t)width * height;
+    uint8_t* component = (uint8_t*)malloc(pixel_count * comp_count);
+    uint8_t* image = (uint8_t*)malloc(gpujpeg_image_calculate_size(param_image));
+    if ( component == NULL || image == NULL ) {
+        free(component);
+        free(image);
+        return NULL;
+    }
+
+    // RGB image converted to components of the image at full resolution
+    unsigned int seed = 1;
+    for ( int y = 0; y < height; y++ ) {
+        for ( int x = 0; x < width; x++ ) {
+            int rgb[3];
+            for ( int c = 0; c < 3; c++ ) {
+                seed = seed * 1103515245 + 12345;
+                rgb[c] = x * 191 / width / (c + 1) + y * 48 / height + ((seed >> 16) & 15);
+            }
+            int value[GPUJPEG_MAX_COMPONENT_COUNT];
+            int luminance = (19595 * rgb[0] + 38470 * rgb[1] + 7471 * rgb[2] + 32768) >> 16;
+            if ( comp_count == 1 ) {
+                value[0] = luminance;
+            }
+            else if ( param_image->color_space == GPUJPEG_CMYK ) {
+                int max = rgb[0] > rgb[1] ? rgb[0] : rgb[1];
+                max = max > rgb[2] ? max : rgb[2];
+                value[0] = max - rgb[0];
+                value[1] = max - rgb[1];
+                value[2] = max - rgb[2];
+                value[3] = 255 - max;
+            }
+            else if ( param_image->color_space == GPUJPEG_YCBCR_BT601_256LVLS ) {
+                // JFIF conversion (chrominance is in range 0..255, so it isn't clamped)
+                value[0] = luminance;
+                value[1] = (-11059 * rgb[0] - 21709 * rgb[1] + 32768 * rgb[2] + (128 << 16) + 32768) >> 16;
+                value[2] = (32768 * rgb[0] - 27439 * rgb[1] - 5329 * rgb[2] + (128 << 16) + 32768) >> 16;
+            }
+            else {
+                value[0] = rgb[0];
+                value[1] = rgb[1];
+                value[2] = rgb[2];
+            }
+            for ( int comp = 0; comp < comp_count; comp++ ) {
+                component[comp * pixel_count + (size_t)y * width + x] = (uint8_t)value[comp];
+            }
+        }
+    }
+
+    // Store components in planes of pixel format
+    uint8_t* data = image;
+    int plane_width;
+    int plane_height;
+    for ( int plane = 0; gpujpeg_image_get_plane_size(param_image, plane, &plane_width, &plane_height) == 0; plane++ ) {
+        for ( int row = 0; row < plane_height; row++ ) {
+            for ( int index = 0; index < plane_width; index++ ) {
+                int comp;
+                int x0;
+                int factor_h;
+                int factor_v;
+                gpujpeg_bench_image_get_sample(param_image->pixel_format, plane, index, &comp, &x0, &factor_h, &factor_v);
+                if ( comp >= comp_count ) {
+                    *data++ = 0;
+                    continue;
+                }
+                // Pixels beyond odd sized image are replaced by the last ones
+                int sum = 0;
+                for ( int dy = 0; dy < factor_v; dy++ ) {
+                    for ( int dx = 0; dx < factor_h; dx++ ) {
+                        int x = x0 + dx < width ? x0 + dx : width - 1;
+                        int y = row * factor_v + dy < height ? row * factor_v + dy : height - 1;
+                        sum += component[comp * pixel_count + (size_t)y * width + x];
+                    }
+                }
+                int count = factor_h * factor_v;
+                *data++ = (uint8_t)((sum + count / 2) / count);
+            }
+        }
+    }
+    free(component);
+    return image;
+}
+
+/**
+ * Apply backend configuration to encoder or decoder, GPU pipeline is forced by
+ * cost model with prohibitive CPU costs, CPU huffman coding in GPU pipeline by
+ * prohibitive GPU huffman costs and CPU pipeline by host threads without routing
+ *
+ * @param backend  Backend configuration
+ * @param model  Cost model to be filled
+ * @return nonzero if cost model should be set
+ */
+static int
+gpujpeg_bench_backend_model(enum gpujpeg_bench_backend backend, struct gpujpeg_route_model* model)
+{
+    gpujpeg_route_model_set_default(model);
+    if ( backend == GPUJPEG_BENCH_CPU ) {
+        return 0;
+    }
+    model->host_overhead = 1e12;
+    if ( backend == GPUJPEG_BENCH_GPU ) {
+        model->host_huffman = 1e12;
+    }
+    else {
+        model->device_huffman_overhead = 1e12;
+        model->device_huffman = 1e12;
+    }
+    return 1;
+}
+
+/**
+ * Get pipeline of stages measured for backend configuration (stages of GPU pipeline
+ * for GPU backend, otherwise stages of CPU pipeline)
+ *
+ * @param backend  Backend configuration
+ * @return pipeline of stages
+ */
+static enum gpujpeg_bench_stage_pipeline
+gpujpeg_bench_stage_pipeline_of(enum gpujpeg_bench_backend backend)
+{
+    return backend == GPUJPEG_BENCH_GPU ? GPUJPEG_BENCH_STAGE_GPU : GPUJPEG_BENCH_STAGE_CPU;
+}
+
+/**
+ * Update measurement by statistics of one iteration
+ *
+ * @param measurement  Measurement
+ * @param iteration  Index of iteration
+ * @param total  Duration of whole call [ms]
+ * @param stats  Statistics of the iteration
+ */
+static void
+gpujpeg_bench_measurement_add(struct gpujpeg_bench_measurement* measurement, int iteration, double total, const struct gpujpeg_stats* stats)
+{
+    if ( iteration == 0 || total < measurement->total ) {
+        measurement->total = total;
+    }
+    for ( int stage = 0; stage < GPUJPEG_STATS_STAGE_COUNT; stage++ ) {
+        if ( iteration == 0 || stats->duration[stage] < measurement->duration[stage] ) {
+            measurement->duration[stage] = stats->duration[stage];
+        }
+    }
+    measurement->stats = *stats;
+}
+
+/**
+ * Write duration of stage as JSON object
+ *
+ * @param bench  Benchmark
+ * @param name  Stage name
+ * @param duration  Duration [ms]
+ * @param pixel_count  Number of pixels of image
+ * @param raw_size  Size of raw image [bytes]
+ */
+static void
+gpujpeg_bench_write_stage(struct gpujpeg_bench* bench, const char* name, double duration, double pixel_count, double raw_size)
+{
+    fprintf(bench->output, "\"%s\":{\"ms\":%.4f,\"ns_per_pixel\":%.4f,\"mb_per_s\":%.2f}", name, duration,
+            duration * 1e6 / pixel_count, duration > 0.0 ? raw_size / (duration * 1e3) : 0.0);
+}
+
+/**
+ * Write result of one case as JSON object
+ *
+ * @param bench  Benchmark
+ * @param bench_case  Coding case
+ * @param operation  Name of operation
+ * @param backend  Name of backend configuration
+ * @param measurement  Measurement
+ */
+static void
+gpujpeg_bench_write_result(struct gpujpeg_bench* bench, const struct gpujpeg_bench_case* bench_case, const char* operation,
+                           const char* backend, const struct gpujpeg_bench_measurement* measurement)
+{
+    const struct gpujpeg_stats* stats = &measurement->stats;
+    double pixel_count = (double)bench_case->param_image.width * bench_case->param_image.height;
+    double raw_size = (double)gpujpeg_image_calculate_size((struct gpujpeg_image_parameters*)&bench_case->param_image);
+    fprintf(bench->output, "%s    {\"suite\":\"%s\",\"operation\":\"%s\",\"backend\":\"%s\",", bench->result_count > 0 ? ",\n" : "",
+            bench_case->suite, operation, backend);
+    fprintf(bench->output, "\"image_backend\":\"%s\",\"huffman_backend\":\"%s\",",
+            stats->image == GPUJPEG_ROUTE_HOST ? "cpu" : "gpu", stats->huffman == GPUJPEG_ROUTE_HOST ? "cpu" : "gpu");
+    fprintf(bench->output, "\"width\":%d,\"height\":%d,\"pixel_format\":\"%s\",\"subsampling\":%d,\"quality\":%d,\"restart_interval\":%d,",
+            bench_case->param_image.width, bench_case->param_image.height, bench_case->format->name, bench_case->subsampling,
+            bench_case->param.quality, bench_case->param.restart_interval);
+    fprintf(bench->output, "\"compressed_size\":%d,\"segments\":%d,\"host_huffman_segments\":%d,\"upload_bytes\":%lu,\"download_bytes\":%lu,\"stages\":{",
+            (int)stats->compressed_size, stats->segment_count, stats->huffman_host_segment_count,
+            (unsigned long)stats->upload_size, (unsigned long)stats->download_size);
+    gpujpeg_bench_write_stage(bench, "total", measurement->total, pixel_count, raw_size);
+    for ( int stage = 0; stage < GPUJPEG_STATS_STAGE_COUNT; stage++ ) {
+        if ( measurement->duration[stage] > 0.0 ) {
+            fprintf(bench->output, ",");
+            gpujpeg_bench_write_stage(bench, gpujpeg_stats_stage_get_name((enum gpujpeg_stats_stage)stage), measurement->duration[stage], pixel_count, raw_size);
+        }
+    }
+    fprintf(bench->output, "}}");
+    fflush(bench->output);
+    bench->result_count++;
+}
+
+/**
+ * Measure stages by direct calls of their entry points on inputs of coded case
+ *
+ * @param bench  Benchmark
+ * @param bench_case  Coding case
+ * @param backend  Backend configuration which coded the case (GPU or CPU pipeline)
+ * @param param  Stage inputs
+ * @param stats  Statistics of decoding of the case
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_bench_run_stages(struct gpujpeg_bench* bench, const struct gpujpeg_bench_case* bench_case, enum gpujpeg_bench_backend backend,
+                         struct gpujpeg_bench_stage_param* param, const struct gpujpeg_stats* stats)
+{
+    int stage_count = 0;
+    const struct gpujpeg_bench_stage* stage = gpujpeg_bench_stage_get(gpujpeg_bench_stage_pipeline_of(backend), &stage_count);
+    enum gpujpeg_route_backend route = backend == GPUJPEG_BENCH_GPU ? GPUJPEG_ROUTE_DEVICE : GPUJPEG_ROUTE_HOST;
+    struct gpujpeg_bench_case stage_case = *bench_case;
+    stage_case.suite = "stage";
+
+    for ( int index = 0; index < stage_count; index++ ) {
+        struct gpujpeg_bench_measurement measurement;
+        memset(&measurement, 0, sizeof(measurement));
+        for ( int iteration = -1; iteration < bench->iterations; iteration++ ) {
+            double start = gpujpeg_get_time();
+            if ( stage[index].run(param) != 0 ) {
+                fprintf(stderr, "Stage %s failed!\n", stage[index].name);
+                return -1;
+            }
+            double total = (gpujpeg_get_time() - start) * 1000.0;
+            if ( iteration >= 0 && (iteration == 0 || total < measurement.total) ) {
+                measurement.total = total;
+            }
+        }
+        measurement.stats = *stats;
+        measurement.stats.upload_size = 0;
+        measurement.stats.download_size = 0;
+        measurement.stats.image = route;
+        measurement.stats.huffman = route;
+        gpujpeg_bench_write_result(bench, &stage_case, stage[index].name, backend == GPUJPEG_BENCH_GPU ? "gpu" : "cpu", &measurement);
+    }
+    return 0;
+}
+
+/**
+ * Measure encoding and decoding of one case by all backends
+ *
+ * @param bench  Benchmark
+ * @param bench_case  Coding case
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_bench_run_case(struct gpujpeg_bench* bench, struct gpujpeg_bench_case* bench_case)
+{
+    uint8_t* image = gpujpeg_bench_image_create(&bench_case->param_image);
+    if ( image == NULL ) {
+        fprintf(stderr, "Failed to allocate image!\n");
+        return -1;
+    }
+    struct gpujpeg_encoder_input input;
+    gpujpeg_encoder_input_set_image(&input, image);
+
+    // Image which is decoded (encoded by the first backend)
+    uint8_t* image_compressed = NULL;
+    int image_compressed_size = 0;
+
+    int backend_begin = bench->host_only ? GPUJPEG_BENCH_CPU : GPUJPEG_BENCH_GPU;
+    for ( int backend = backend_begin; backend < GPUJPEG_BENCH_BACKEND_COUNT; backend++ ) {
+        struct gpujpeg_route_model model;
+        int route = gpujpeg_bench_backend_model((enum gpujpeg_bench_backend)backend, &model);
+
+        // Encode
+        struct gpujpeg_encoder* encoder = gpujpeg_encoder_create(NULL);
+        if ( encoder == NULL ) {
+            fprintf(stderr, "Failed to create encoder!\n");
+            free(image);
+            free(image_compressed);
+            return -1;
+        }
+        gpujpeg_encoder_set_stats(encoder, 1);
+        if ( route )
+            gpujpeg_encoder_set_route_model(encoder, &model);
+        else
+            gpujpeg_encoder_set_host_threads(encoder, bench->host_threads);
+        struct gpujpeg_bench_measurement measurement;
+        int result = 0;
+        for ( int iteration = -1; iteration < bench->iterations && result == 0; iteration++ ) {
+            uint8_t* output = NULL;
+            int output_size = 0;
+            double start = gpujpeg_get_time();
+            result = gpujpeg_encoder_encode(encoder, &bench_case->param, &bench_case->param_image, &input, &output, &output_size);
+            double total = (gpujpeg_get_time() - start) * 1000.0;
+            if ( result == 0 && image_compressed == NULL ) {
+                image_compressed = (uint8_t*)malloc(output_size);
+                if ( image_compressed != NULL ) {
+                    memcpy(image_compressed, output, output_size);
+                    image_compressed_size = output_size;
+                }
+            }
+            if ( result == 0 && iteration >= 0 ) {
+                struct gpujpeg_stats stats;
+                gpujpeg_encoder_get_stats(encoder, &stats);
+                gpujpeg_bench_measurement_add(&measurement, iteration, total, &stats);
+            }
+        }
+        int encoded = (result == 0);
+        if ( result == 0 && bench->iterations > 0 ) {
+            gpujpeg_bench_write_result(bench, bench_case, "encode", gpujpeg_bench_backend_name[backend], &measurement);
+        }
+        else if ( result != 0 ) {
+            fprintf(stderr, "Skipping %s encoding of %s %dx%d (not supported)\n", gpujpeg_bench_backend_name[backend],
+                    bench_case->format->name, bench_case->param_image.width, bench_case->param_image.height);
+        }
+        if ( image_compressed == NULL ) {
+            gpujpeg_encoder_destroy(encoder);
+            continue;
+        }
+
+        // Decode (decoder can't be reinitialized for another image size, so it is created for each case)
+        struct gpujpeg_decoder* decoder = gpujpeg_decoder_create(NULL);
+        if ( decoder == NULL ) {
+            fprintf(stderr, "Failed to create decoder!\n");
+            gpujpeg_encoder_destroy(encoder);
+            free(image);
+            free(image_compressed);
+            return -1;
+        }
+        gpujpeg_decoder_set_stats(decoder, 1);
+        gpujpeg_decoder_set_output_format(decoder, bench_case->param_image.color_space, bench_case->param_image.pixel_format);
+        if ( route )
+            gpujpeg_decoder_set_route_model(decoder, &model);
+        else
+            gpujpeg_decoder_set_host_threads(decoder, bench->host_threads);
+        result = 0;
+        for ( int iteration = -1; iteration < bench->iterations && result == 0; iteration++ ) {
+            struct gpujpeg_decoder_output output;
+            gpujpeg_decoder_output_set_default(&output);
+            double start = gpujpeg_get_time();
+            result = gpujpeg_decoder_decode(decoder, image_compressed, image_compressed_size, &output);
+            double total = (gpujpeg_get_time() - start) * 1000.0;
+            if ( result == 0 && iteration >= 0 ) {
+                struct gpujpeg_stats stats;
+                gpujpeg_decoder_get_stats(decoder, &stats);
+                gpujpeg_bench_measurement_add(&measurement, iteration, total, &stats);
+            }
+        }
+        if ( result == 0 && bench->iterations > 0 ) {
+            gpujpeg_bench_write_result(bench, bench_case, "decode", gpujpeg_bench_backend_name[backend], &measurement);
+        }
+        else if ( result != 0 ) {
+            fprintf(stderr, "Skipping %s decoding of %s %dx%d (not supported)\n", gpujpeg_bench_backend_name[backend],
+                    bench_case->format->name, bench_case->param_image.width, bench_case->param_image.height);
+        }
+
+        // Single stages of GPU and CPU pipeline on inputs left by the coding (CPU stages need
+        // image which can be coded by MCU rows)
+        int stages = encoded && result == 0 && bench->iterations > 0 && backend != GPUJPEG_BENCH_GPU_HOST_HUFFMAN
+                     && gpujpeg_bench_stage_available(gpujpeg_bench_stage_pipeline_of((enum gpujpeg_bench_backend)backend), encoder, decoder);
+        if ( stages ) {
+            struct gpujpeg_bench_stage_param param;
+            if ( gpujpeg_bench_stage_param_init(&param, encoder, decoder, image, image_compressed, image_compressed_size) != 0 ) {
+                fprintf(stderr, "Failed to prepare stage inputs!\n");
+                result = -1;
+            }
+            else {
+                result = gpujpeg_bench_run_stages(bench, bench_case, (enum gpujpeg_bench_backend)backend, &param, &measurement.stats);
+            }
+            gpujpeg_bench_stage_param_destroy(&param);
+        }
+        gpujpeg_decoder_destroy(decoder);
+        gpujpeg_encoder_destroy(encoder);
+        if ( result != 0 && stages ) {
+            free(image);
+            free(image_compressed);
+            return -1;
+        }
+    }
+
+    free(image_compressed);
+    free(image);
+    return 0;
+}
+
+/**
+ * Initialize coding case
+ *
+ * @param bench_case  Coding case
+ * @param suite  Name of suite
+ * @param format  Pixel format
+ * @param width  Image width
+ * @param height  Image height
+ * @param quality  Quality
+ * @param restart  Restart interval
+ * @param subsampling  JPEG chroma subsampling (444, 422 or 420)
+ */
+static void
+gpujpeg_bench_case_init(struct gpujpeg_bench_case* bench_case, const char* suite, const struct gpujpeg_bench_format* format,
+                        int width, int height, int quality, int restart, int subsampling)
+{
+    bench_case->suite = suite;
+    bench_case->format = format;
+    bench_case->subsampling = subsampling;
+    gpujpeg_set_default_parameters(&bench_case->param);
+    bench_case->param.quality = quality;
+    bench_case->param.restart_interval = restart;
+    // CPU pipeline codes MCU rows of single interleaved scan
+    bench_case->param.interleaved = 1;
+    if ( subsampling == 422 )
+        gpujpeg_parameters_chroma_subsampling_422(&bench_case->param);
+    else if ( subsampling == 420 )
+        gpujpeg_parameters_chroma_subsampling_420(&bench_case->param);
+    gpujpeg_image_set_default_parameters(&bench_case->param_image);
+    bench_case->param_image.width = width;
+    bench_case->param_image.height = height;
+    bench_case->param_image.comp_count = format->comp_count;
+    bench_case->param_image.pixel_format = format->pixel_format;
+    bench_case->param_image.color_space = format->color_space;
+
+    // Image with 4 components is CMYK image, that is encoded in YCCK color space
+    if ( format->comp_count == 4 ) {
+        bench_case->param.color_space_internal = GPUJPEG_YCCK;
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct gpujpeg_bench bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.iterations = 10;
+    bench.host_threads = -1;
+    bench.output = stdout;
+    bench.size_count = gpujpeg_bench_parse_list("1280x720,1920x1080,3840x2160", bench.width, bench.height);
+    bench.quality_count = gpujpeg_bench_parse_list("50,75,95", bench.quality, NULL);
+    bench.restart_count = gpujpeg_bench_parse_list("0,8,16", bench.restart, NULL);
+    bench.subsampling_count = gpujpeg_bench_parse_list("444,422,420", bench.subsampling, NULL);
+    int device_id = 0;
+    const char* output_filename = NULL;
+
+    for ( int index = 1; index < argc; index++ ) {
+        const char* option = argv[index];
+        const char* value = index + 1 < argc ? argv[index + 1] : NULL;
+        int count = 0;
+        if ( strcmp(option, "-h") == 0 || strcmp(option, "--help") == 0 ) {
+            print_help();
+            return 0;
+        }
+        else if ( strcmp(option, "--host-only") == 0 ) {
+            bench.host_only = 1;
+            continue;
+        }
+        if ( value == NULL ) {
+            fprintf(stderr, "Option %s requires value!\n", option);
+            return -1;
+        }
+        index++;
+        if ( strcmp(option, "-D") == 0 || strcmp(option, "--device") == 0 )
+            device_id = atoi(value);
+        else if ( strcmp(option, "--host-threads") == 0 )
+            bench.host_threads = atoi(value);
+        else if ( strcmp(option, "-n") == 0 || strcmp(option, "--iterations") == 0 )
+            bench.iterations = atoi(value);
+        else if ( strcmp(option, "-o") == 0 || strcmp(option, "--output") == 0 )
+            output_filename = value;
+        else if ( strcmp(option, "-s") == 0 || strcmp(option, "--size") == 0 )
+            count = bench.size_count = gpujpeg_bench_parse_list(value, bench.width, bench.height);
+        else if ( strcmp(option, "-q") == 0 || strcmp(option, "--quality") == 0 )
+            count = bench.quality_count = gpujpeg_bench_parse_list(value, bench.quality, NULL);
+        else if ( strcmp(option, "-r") == 0 || strcmp(option, "--restart") == 0 )
+            count = bench.restart_count = gpujpeg_bench_parse_list(value, bench.restart, NULL);
+        else if ( strcmp(option, "--subsampling") == 0 )
+            count = bench.subsampling_count = gpujpeg_bench_parse_list(value, bench.subsampling, NULL);
+        else {
+            fprintf(stderr, "Unknown option %s!\n", option);
+            print_help();
+            return -1;
+        }
+        if ( count < 0 ) {
+            fprintf(stderr, "Wrong value of option %s: %s\n", option, value);
+            return -1;
+        }
+    }
+    if ( bench.size_count == 0 ) {
+        fprintf(stderr, "At least one image size must be specified!\n");
+        return -1;
+    }
+
+    // Host-only stages are measured by host runtime when there is no CUDA device
+    if ( bench.host_only || gpujpeg_init_device(device_id, 0) != 0 ) {
+        if ( !bench.host_only ) {
+            fprintf(stderr, "CUDA device isn't available, only CPU pipeline is measured.\n");
+        }
+        bench.host_only = 1;
+        if ( gpujpeg_init_device(device_id, GPUJPEG_HOST_RUNTIME) != 0 ) {
+            fprintf(stderr, "Failed to initialize host runtime!\n");
+            return -1;
+        }
+    }
+
+    if ( output_filename != NULL ) {
+        bench.output = fopen(output_filename, "w");
+        if ( bench.output == NULL ) {
+            fprintf(stderr, "Failed to open output file %s!\n", output_filename);
+            return -1;
+        }
+    }
+    const char* device_name = "host";
+    struct gpujpeg_devices_info devices_info;
+    if ( !bench.host_only ) {
+        devices_info = gpujpeg_get_devices_info();
+        for ( int device = 0; device < devices_info.device_count; device++ ) {
+            if ( devices_info.device[device].id == device_id )
+                device_name = devices_info.device[device].name;
+        }
+    }
+    fprintf(bench.output, "{\"device\":\"%s\",\"host_only\":%s,\"iterations\":%d,\"host_threads\":%d,\"results\":[\n",
+            device_name, bench.host_only ? "true" : "false", bench.iterations, bench.host_threads);
+
+    int result = 0;
+
+    // Pixel format suite (stages of preprocessing and postprocessing for each pixel format)
+    for ( size_t format = 0; format < sizeof(gpujpeg_bench_format) / sizeof(gpujpeg_bench_format[0]) && result == 0; format++ ) {
+        struct gpujpeg_bench_case bench_case;
+        gpujpeg_bench_case_init(&bench_case, "pixel-format", &gpujpeg_bench_format[format], bench.width[0], bench.height[0],
+                                75, 8, gpujpeg_bench_format[format].subsampling);
+        fprintf(stderr, "Measuring %s %dx%d\n", bench_case.format->name, bench.width[0], bench.height[0]);
+        result = gpujpeg_bench_run_case(&bench, &bench_case);
+    }
+
+    // End-to-end suite
+    for ( int size = 0; size < bench.size_count && result == 0; size++ ) {
+        for ( int quality = 0; quality < bench.quality_count && result == 0; quality++ ) {
+            for ( int restart = 0; restart < bench.restart_count && result == 0; restart++ ) {
+                for ( int subsampling = 0; subsampling < bench.subsampling_count && result == 0; subsampling++ ) {
+                    struct gpujpeg_bench_case bench_case;
+                    gpujpeg_bench_case_init(&bench_case, "end-to-end", &gpujpeg_bench_format[1], bench.width[size], bench.height[size],
+                                            bench.quality[quality], bench.restart[restart], bench.subsampling[subsampling]);
+                    fprintf(stderr, "Measuring %dx%d quality %d restart %d subsampling %d\n", bench.width[size], bench.height[size],
+                            bench.quality[quality], bench.restart[restart], bench.subsampling[subsampling]);
+                    result = gpujpeg_bench_run_case(&bench, &bench_case);
+                }
+            }
+        }
+    }
+
+    fprintf(bench.output, "\n]}\n");
+    if ( bench.output != stdout ) {
+        fclose(bench.output);
+    }
+    else {
+        fflush(bench.output);
+    }
+    return result;
+}
+
+/* vim: set expandtab sw=4: */
@@ -0,0 +1,308 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gpujpeg_bench_stage.h"
+#include "gpujpeg_dct_cpu.h"
+#include "gpujpeg_dct_gpu.h"
+#include "gpujpeg_device.h"
+#include "gpujpeg_huffman_cpu_decoder.h"
+#include "gpujpeg_huffman_cpu_encoder.h"
+#include "gpujpeg_huffman_gpu_decoder.h"
+#include "gpujpeg_huffman_gpu_encoder.h"
+#include "gpujpeg_preprocessor.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Perform color conversion, sampling, DCT and quantization of all MCU rows on CPU
+ * (see gpujpeg_bench_stage)
+ */
+static int
+gpujpeg_bench_stage_preprocess_dct_cpu(struct gpujpeg_bench_stage_param* param)
+{
+    struct gpujpeg_coder* coder = &param->encoder->coder;
+    size_t buffer_size = gpujpeg_dct_cpu_encode_buffer_size(param->encoder);
+    uint8_t* buffer = NULL;
+    if ( buffer_size > 0 && (buffer = (uint8_t*)malloc(buffer_size)) == NULL ) {
+        return -1;
+    }
+    int result = 0;
+    int mcu_row_count = coder->component[0].mcu_count / coder->component[0].mcu_count_x;
+    for ( int mcu_row = 0; mcu_row < mcu_row_count && result == 0; mcu_row++ ) {
+        int16_t* output[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+        for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+            struct gpujpeg_component* component = &coder->component[comp];
+            output[comp] = component->data_quantized + (size_t)mcu_row * component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE * component->data_width;
+        }
+        result = gpujpeg_dct_cpu_encode_mcu_row(param->encoder, &param->encoder_planes, mcu_row, buffer, output);
+    }
+    free(buffer);
+    return result;
+}
+
+/** Perform huffman encoding of all segments on CPU (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_huffman_encode_cpu(struct gpujpeg_bench_stage_param* param)
+{
+    return gpujpeg_huffman_cpu_encoder_encode(param->encoder);
+}
+
+/** Format JPEG image from encoded segments (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_writer(struct gpujpeg_bench_stage_param* param)
+{
+    struct gpujpeg_writer* writer = param->encoder->writer;
+    writer->buffer_current = writer->buffer;
+    gpujpeg_writer_write_header(param->encoder);
+    gpujpeg_writer_write_segments(param->encoder);
+    gpujpeg_writer_emit_marker(writer, GPUJPEG_MARKER_EOI);
+    return 0;
+}
+
+/** Build quantization and huffman tables of encoder (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_tables_encode(struct gpujpeg_bench_stage_param* param)
+{
+    struct gpujpeg_encoder* encoder = param->encoder;
+    for ( int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++ ) {
+        if ( gpujpeg_table_quantization_encoder_init(&encoder->table_quantization[comp_type], (enum gpujpeg_component_type)comp_type,
+                                                     encoder->coder.param.quality) != 0 ) {
+            return -1;
+        }
+        for ( int huff_type = 0; huff_type < GPUJPEG_HUFFMAN_TYPE_COUNT; huff_type++ ) {
+            if ( gpujpeg_table_huffman_encoder_init(&encoder->table_huffman[comp_type][huff_type], (enum gpujpeg_component_type)comp_type,
+                                                    (enum gpujpeg_huffman_type)huff_type, encoder->coder.param.precision) != 0 ) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/** Read all markers and segments of compressed image (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_parse(struct gpujpeg_bench_stage_param* param)
+{
+    return gpujpeg_reader_read_image(param->decoder, param->image_compressed, param->image_compressed_size);
+}
+
+/**
+ * Build quantization and huffman tables of decoder from tables of compressed image,
+ * cache is cleared, so that each huffman table is built as for the first image of
+ * stream (see gpujpeg_bench_stage)
+ */
+static int
+gpujpeg_bench_stage_tables_decode(struct gpujpeg_bench_stage_param* param)
+{
+    struct gpujpeg_decoder* decoder = param->decoder;
+    struct gpujpeg_table_huffman_decoder_cache* cache = &param->table_huffman_cache;
+    for ( int index = 0; index < GPUJPEG_TABLE_HUFFMAN_DECODER_CACHE_SIZE; index++ ) {
+        cache->entry[index].id = 0;
+        cache->entry[index].last_use = 0;
+        cache->entry[index].ref_count = 0;
+    }
+    cache->use_counter = 0;
+    for ( int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++ ) {
+        if ( gpujpeg_table_quantization_decoder_compute(&decoder->table_quantization[comp_type]) != 0 ) {
+            return -1;
+        }
+        for ( int huff_type = 0; huff_type < GPUJPEG_HUFFMAN_TYPE_COUNT; huff_type++ ) {
+            struct gpujpeg_table_huffman_decoder_cache_entry* entry = decoder->table_huffman_entry[comp_type][huff_type];
+            struct gpujpeg_table_huffman_decoder_cache_entry* slot = NULL;
+            if ( entry != NULL && gpujpeg_table_huffman_decoder_cache_set(cache, &slot, entry->table.bits, entry->table.huffval) < 0 ) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/** Perform huffman decoding of all segments on CPU (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_huffman_decode_cpu(struct gpujpeg_bench_stage_param* param)
+{
+    return gpujpeg_huffman_cpu_decoder_decode(param->decoder);
+}
+
+/**
+ * Perform dequantization, inverse DCT, sampling and color conversion of all MCU rows
+ * on CPU (see gpujpeg_bench_stage)
+ */
+static int
+gpujpeg_bench_stage_idct_postprocess_cpu(struct gpujpeg_bench_stage_param* param)
+{
+    struct gpujpeg_coder* coder = &param->decoder->coder;
+    if ( gpujpeg_idct_cpu_decode_prepare(param->decoder) != 0 ) {
+        return -1;
+    }
+    int mcu_row_count = coder->component[0].mcu_count / coder->component[0].mcu_count_x;
+    for ( int mcu_row = 0; mcu_row < mcu_row_count; mcu_row++ ) {
+        int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+        for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+            struct gpujpeg_component* component = &coder->component[comp];
+            coefficients[comp] = component->data_quantized + (size_t)mcu_row * component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE * component->data_width;
+        }
+        if ( gpujpeg_idct_cpu_decode_mcu_row(param->decoder, coefficients, mcu_row, &param->decoder_planes) != 0 ) {
+            return -1;
+        }
+    }
+    return gpujpeg_idct_cpu_decode_finish(param->decoder, &param->decoder_planes);
+}
+
+/**
+ * Wait for completion of stage launched to stream
+ *
+ * @param result  Result of stage entry point
+ * @param stream  CUDA stream
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_bench_stage_synchronize(int result, cudaStream_t stream)
+{
+    if ( gpujpeg_device_stream_synchronize(stream) != cudaSuccess ) {
+        return -1;
+    }
+    return result;
+}
+
+/** Perform color conversion and sampling on GPU (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_preprocess_gpu(struct gpujpeg_bench_stage_param* param)
+{
+    return gpujpeg_bench_stage_synchronize(gpujpeg_preprocessor_encode(param->encoder), *(param->encoder->stream));
+}
+
+/** Perform DCT and quantization on GPU (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_dct_gpu(struct gpujpeg_bench_stage_param* param)
+{
+    return gpujpeg_bench_stage_synchronize(gpujpeg_dct_gpu(param->encoder), *(param->encoder->stream));
+}
+
+/** Perform huffman encoding of all segments on GPU (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_huffman_encode_gpu(struct gpujpeg_bench_stage_param* param)
+{
+    unsigned int output_size = 0;
+    struct gpujpeg_encoder* encoder = param->encoder;
+    return gpujpeg_bench_stage_synchronize(gpujpeg_huffman_gpu_encoder_encode(encoder, encoder->huffman_gpu_encoder, &output_size),
+                                           *(encoder->stream));
+}
+
+/** Perform huffman decoding of all segments on GPU (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_huffman_decode_gpu(struct gpujpeg_bench_stage_param* param)
+{
+    return gpujpeg_bench_stage_synchronize(gpujpeg_huffman_gpu_decoder_decode(param->decoder), *(param->decoder->stream));
+}
+
+/** Perform dequantization and inverse DCT on GPU (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_idct_gpu(struct gpujpeg_bench_stage_param* param)
+{
+    return gpujpeg_bench_stage_synchronize(gpujpeg_idct_gpu(param->decoder), *(param->decoder->stream));
+}
+
+/** Perform sampling and color conversion on GPU (see gpujpeg_bench_stage) */
+static int
+gpujpeg_bench_stage_postprocess_gpu(struct gpujpeg_bench_stage_param* param)
+{
+    return gpujpeg_bench_stage_synchronize(gpujpeg_preprocessor_decode(&param->decoder->coder, *(param->decoder->stream)),
+                                           *(param->decoder->stream));
+}
+
+/** Stages of CPU pipeline (in order, each stage gets inputs from the previous ones) */
+static const struct gpujpeg_bench_stage gpujpeg_bench_stage_cpu[] = {
+    { "tables-encode", &gpujpeg_bench_stage_tables_encode },
+    { "preprocess-dct", &gpujpeg_bench_stage_preprocess_dct_cpu },
+    { "huffman-encode", &gpujpeg_bench_stage_huffman_encode_cpu },
+    { "writer", &gpujpeg_bench_stage_writer },
+    { "parse", &gpujpeg_bench_stage_parse },
+    { "tables-decode", &gpujpeg_bench_stage_tables_decode },
+    { "huffman-decode", &gpujpeg_bench_stage_huffman_decode_cpu },
+    { "idct-postprocess", &gpujpeg_bench_stage_idct_postprocess_cpu },
+};
+
+/** Stages of GPU pipeline (in order, each stage gets inputs from the previous ones) */
+static const struct gpujpeg_bench_stage gpujpeg_bench_stage_gpu[] = {
+    { "preprocess", &gpujpeg_bench_stage_preprocess_gpu },
+    { "dct", &gpujpeg_bench_stage_dct_gpu },
+    { "huffman-encode", &gpujpeg_bench_stage_huffman_encode_gpu },
+    { "huffman-decode", &gpujpeg_bench_stage_huffman_decode_gpu },
+    { "idct", &gpujpeg_bench_stage_idct_gpu },
+    { "postprocess", &gpujpeg_bench_stage_postprocess_gpu },
+};
+
+/** Documented at declaration */
+const struct gpujpeg_bench_stage*
+gpujpeg_bench_stage_get(enum gpujpeg_bench_stage_pipeline pipeline, int* count)
+{
+    if ( pipeline == GPUJPEG_BENCH_STAGE_GPU ) {
+        *count = sizeof(gpujpeg_bench_stage_gpu) / sizeof(gpujpeg_bench_stage_gpu[0]);
+        return gpujpeg_bench_stage_gpu;
+    }
+    *count = sizeof(gpujpeg_bench_stage_cpu) / sizeof(gpujpeg_bench_stage_cpu[0]);
+    return gpujpeg_bench_stage_cpu;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_bench_stage_available(enum gpujpeg_bench_stage_pipeline pipeline, struct gpujpeg_encoder* encoder, struct gpujpeg_decoder* decoder)
+{
+    if ( pipeline == GPUJPEG_BENCH_STAGE_GPU ) {
+        return encoder->huffman_gpu_encoder != NULL;
+    }
+    return gpujpeg_dct_cpu_encode_available(encoder) && gpujpeg_idct_cpu_decode_available(decoder);
+}
+
+/** Documented at declaration */
+int
+gpujpeg_bench_stage_param_init(struct gpujpeg_bench_stage_param* param, struct gpujpeg_encoder* encoder, struct gpujpeg_decoder* decoder,
+                               uint8_t* image, uint8_t* image_compressed, int image_compressed_size)
+{
+    memset(param, 0, sizeof(struct gpujpeg_bench_stage_param));
+    param->encoder = encoder;
+    param->decoder = decoder;
+    param->image_compressed = image_compressed;
+    param->image_compressed_size = image_compressed_size;
+    if ( gpujpeg_image_planes_init(&encoder->coder.param_image, image, &param->encoder_planes) != 0 ) {
+        return -1;
+    }
+    if ( gpujpeg_image_planes_init(&decoder->coder.param_image, decoder->coder.data_raw, &param->decoder_planes) != 0 ) {
+        return -1;
+    }
+    return gpujpeg_table_huffman_decoder_cache_init(&param->table_huffman_cache);
+}
+
+/** Documented at declaration */
+void
+gpujpeg_bench_stage_param_destroy(struct gpujpeg_bench_stage_param* param)
+{
+    gpujpeg_table_huffman_decoder_cache_destroy(&param->table_huffman_cache);
+}
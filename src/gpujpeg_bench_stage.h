@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_BENCH_STAGE_H
+#define GPUJPEG_BENCH_STAGE_H
+
+#include <libgpujpeg/gpujpeg_encoder_internal.h>
+#include <libgpujpeg/gpujpeg_decoder_internal.h>
+#include <libgpujpeg/gpujpeg_table.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Stage hooks of gpujpeg_bench, they call entry points of single encoder and
+ * decoder stages, so that the benchmark doesn't depend on internal functions
+ * (which aren't exported from shared library on all platforms).
+ */
+
+/** Pipeline of stages */
+enum gpujpeg_bench_stage_pipeline {
+    // Stages of CPU pipeline by MCU rows (single thread)
+    GPUJPEG_BENCH_STAGE_CPU = 0,
+    // Stages of GPU pipeline (each stage is synchronized)
+    GPUJPEG_BENCH_STAGE_GPU = 1,
+};
+
+/** Inputs of stages measured by direct calls of their entry points */
+struct gpujpeg_bench_stage_param
+{
+    // Encoder and decoder which coded the case (their buffers hold stage inputs)
+    struct gpujpeg_encoder* encoder;
+    struct gpujpeg_decoder* decoder;
+    // Input image planes of encoder and output image planes of decoder
+    struct gpujpeg_image_planes encoder_planes;
+    struct gpujpeg_image_planes decoder_planes;
+    // Compressed image
+    uint8_t* image_compressed;
+    int image_compressed_size;
+    // Cache of huffman decoder tables which is cleared before tables are built
+    struct gpujpeg_table_huffman_decoder_cache table_huffman_cache;
+};
+
+/** Stage measured by direct calls of its entry point */
+struct gpujpeg_bench_stage
+{
+    // Name of stage (operation of result)
+    const char* name;
+    // Function calling entry point of stage
+    int (*run)(struct gpujpeg_bench_stage_param* param);
+};
+
+/**
+ * Get stages of pipeline
+ *
+ * @param pipeline  Pipeline
+ * @param[out] count  Number of stages
+ * @return stages in order, each stage gets inputs from the previous ones
+ */
+GPUJPEG_API const struct gpujpeg_bench_stage*
+gpujpeg_bench_stage_get(enum gpujpeg_bench_stage_pipeline pipeline, int* count);
+
+/**
+ * Check whether stages of pipeline can be called on inputs left by coding (GPU
+ * stages need GPU huffman encoder, CPU stages need image which can be coded by
+ * MCU rows)
+ *
+ * @param pipeline  Pipeline
+ * @param encoder  Encoder which encoded the image
+ * @param decoder  Decoder which decoded the image
+ * @return 1 if stages are available, otherwise 0
+ */
+GPUJPEG_API int
+gpujpeg_bench_stage_available(enum gpujpeg_bench_stage_pipeline pipeline, struct gpujpeg_encoder* encoder, struct gpujpeg_decoder* decoder);
+
+/**
+ * Initialize stage inputs
+ *
+ * @param param  Stage inputs
+ * @param encoder  Encoder which encoded the image
+ * @param decoder  Decoder which decoded the image
+ * @param image  Raw image which was encoded
+ * @param image_compressed  Compressed image which was decoded
+ * @param image_compressed_size  Size of compressed image
+ * @return 0 if succeeds, otherwise nonzero
+ */
+GPUJPEG_API int
+gpujpeg_bench_stage_param_init(struct gpujpeg_bench_stage_param* param, struct gpujpeg_encoder* encoder, struct gpujpeg_decoder* decoder,
+                               uint8_t* image, uint8_t* image_compressed, int image_compressed_size);
+
+/**
+ * Destroy stage inputs (encoder, decoder and images aren't destroyed)
+ *
+ * @param param  Stage inputs
+ */
+GPUJPEG_API void
+gpujpeg_bench_stage_param_destroy(struct gpujpeg_bench_stage_param* param);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_BENCH_STAGE_H
@@ -31,6 +31,18 @@
 #define GPUJPEG_COLORSPACE_H
 
 #include <libgpujpeg/gpujpeg_type.h>
+#include <assert.h>
+#include <math.h>
+
+/**
+ * Color transform functions are usable in both device and host code
+ * (host implementation is in gpujpeg_colorspace_cpu.h)
+ */
+#ifdef __CUDACC__
+#define GPUJPEG_COLOR_FUNC __host__ __device__
+#else
+#define GPUJPEG_COLOR_FUNC
+#endif
 
 /**
  * Color transform debug info
@@ -47,7 +59,7 @@
 /**
  * Clip [0,255] range
  */
-inline __device__ uint8_t gpujpeg_clamp(int value)
+inline GPUJPEG_COLOR_FUNC uint8_t gpujpeg_clamp(int value)
 {
     value = (value >= 0) ? value : 0;
     value = (value <= 255) ? value : 255;
@@ -60,7 +72,7 @@ inline __device__ uint8_t gpujpeg_clamp(int value)
  * @param bit_depth
  */
 template<int bit_depth>
-inline __device__ void
+inline GPUJPEG_COLOR_FUNC void
 gpujpeg_color_transform_to(uint8_t & c1, uint8_t & c2, uint8_t & c3, const int matrix[9], int base1, int base2, int base3)
 {
     // Prepare integer constants
@@ -81,7 +93,7 @@ gpujpeg_color_transform_to(uint8_t & c1, uint8_t & c2, uint8_t & c3, const int m
  * @param bit_depth
  */
 template<int bit_depth>
-inline __device__ void
+inline GPUJPEG_COLOR_FUNC void
 gpujpeg_color_transform_from(uint8_t & c1, uint8_t & c2, uint8_t & c3, const int matrix[9], int base1, int base2, int base3)
 {
     // Prepare integer constants
@@ -102,7 +114,7 @@ gpujpeg_color_transform_from(uint8_t & c1, uint8_t & c2, uint8_t & c3, const int
  * @param bit_depth
  */
 template<int bit_depth>
-inline __device__ void
+inline GPUJPEG_COLOR_FUNC void
 gpujpeg_color_transform_to(uint8_t & c1, uint8_t & c2, uint8_t & c3, const double matrix[9], int base1, int base2, int base3)
 {
     // Prepare integer matrix
@@ -129,7 +141,7 @@ gpujpeg_color_transform_to(uint8_t & c1, uint8_t & c2, uint8_t & c3, const doubl
  * @param bit_depth
  */
 template<int bit_depth>
-inline __device__ void
+inline GPUJPEG_COLOR_FUNC void
 gpujpeg_color_transform_from(uint8_t & c1, uint8_t & c2, uint8_t & c3, const double matrix[9], int base1, int base2, int base3)
 {
     // Prepare integer matrix
@@ -159,7 +171,7 @@ gpujpeg_color_transform_from(uint8_t & c1, uint8_t & c2, uint8_t & c3, const dou
 template<enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to>
 struct gpujpeg_color_transform
 {
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(color_space_from, color_space_to, "Undefined");
         assert(false);
@@ -170,7 +182,7 @@ struct gpujpeg_color_transform
 template<enum gpujpeg_color_space color_space>
 struct gpujpeg_color_transform<color_space, color_space> {
     /** None transform */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(color_space, color_space, "Do nothing");
         // Same color space thus do nothing
@@ -181,7 +193,7 @@ struct gpujpeg_color_transform<color_space, color_space> {
 template<enum gpujpeg_color_space color_space>
 struct gpujpeg_color_transform<GPUJPEG_NONE, color_space> {
     /** None transform */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_NONE, color_space, "Do nothing");
         // None color space thus do nothing
@@ -191,7 +203,7 @@ struct gpujpeg_color_transform<GPUJPEG_NONE, color_space> {
 template<enum gpujpeg_color_space color_space>
 struct gpujpeg_color_transform<color_space, GPUJPEG_NONE> {
     /** None transform */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(color_space, GPUJPEG_NONE, "Do nothing");
         // None color space thus do nothing
@@ -201,7 +213,7 @@ struct gpujpeg_color_transform<color_space, GPUJPEG_NONE> {
 template<>
 struct gpujpeg_color_transform<GPUJPEG_NONE, GPUJPEG_NONE> {
     /** None transform */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_NONE, GPUJPEG_NONE, "Do nothing");
         // None color space thus do nothing
@@ -212,34 +224,58 @@ struct gpujpeg_color_transform<GPUJPEG_NONE, GPUJPEG_NONE> {
 template<>
 struct gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601> {
     /** RGB -> YCbCr (ITU-R Recommendation BT.601) transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_RGB, GPUJPEG_YCBCR_BT601, "Transformation");
+        int matrix[9];
+        int base[3];
+        coefficients(matrix, base);
+        gpujpeg_color_transform_to<8>(c1, c2, c3, matrix, base[0], base[1], base[2]);
+    }
+    /** Integer matrix (8 fraction bits) and component bases of the transform */
+    static GPUJPEG_COLOR_FUNC void
+    coefficients(int matrix[9], int base[3]) {
         // Source: http://www.equasys.de/colorconversion.html
         /*const double matrix[] = {
               0.257000,  0.504000,  0.098000,
              -0.148000, -0.291000,  0.439000,
               0.439000, -0.368000, -0.071000
         };*/
-        const int matrix[] = {66, 129, 25, -38, -74, 112, 112, -94, -18};
-        gpujpeg_color_transform_to<8>(c1, c2, c3, matrix, 16, 128, 128);
+        const int values[] = {66, 129, 25, -38, -74, 112, 112, -94, -18};
+        for ( int i = 0; i < 9; i++ )
+            matrix[i] = values[i];
+        base[0] = 16;
+        base[1] = 128;
+        base[2] = 128;
     }
 };
 /** Specialization [color_space_from = GPUJPEG_YCBCR_BT601, color_space_to = GPUJPEG_RGB] */
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601, GPUJPEG_RGB> {
     /** YCbCr (ITU-R Recommendation BT.601) -> RGB transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_YCBCR_BT601, GPUJPEG_RGB, "Transformation");
+        int matrix[9];
+        int base[3];
+        coefficients(matrix, base);
+        gpujpeg_color_transform_from<8>(c1, c2, c3, matrix, base[0], base[1], base[2]);
+    }
+    /** Integer matrix (8 fraction bits) and component bases of the transform */
+    static GPUJPEG_COLOR_FUNC void
+    coefficients(int matrix[9], int base[3]) {
         // Source: http://www.equasys.de/colorconversion.html
         /*const double matrix[] = {
              1.164000,  0.000000,  1.596000,
              1.164000, -0.392000, -0.813000,
              1.164000,  2.017000,  0.000000
         };*/
-        const int matrix[] = {298, 0, 409, 298, -100, -208, 298, 516, 0};
-        gpujpeg_color_transform_from<8>(c1, c2, c3, matrix, 16, 128, 128);
+        const int values[] = {298, 0, 409, 298, -100, -208, 298, 516, 0};
+        for ( int i = 0; i < 9; i++ )
+            matrix[i] = values[i];
+        base[0] = 16;
+        base[1] = 128;
+        base[2] = 128;
     }
 };
 
@@ -247,34 +283,58 @@ struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601, GPUJPEG_RGB> {
 template<>
 struct gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601_256LVLS> {
     /** RGB -> YCbCr (ITU-R Recommendation BT.601 with 256 levels) transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_RGB, GPUJPEG_YCBCR_BT601_256LVLS, "Transformation");
+        int matrix[9];
+        int base[3];
+        coefficients(matrix, base);
+        gpujpeg_color_transform_to<8>(c1, c2, c3, matrix, base[0], base[1], base[2]);
+    }
+    /** Integer matrix (8 fraction bits) and component bases of the transform */
+    static GPUJPEG_COLOR_FUNC void
+    coefficients(int matrix[9], int base[3]) {
         // Source: http://www.ecma-international.org/publications/files/ECMA-TR/TR-098.pdf, page 3
         /*const double matrix[] = {
              0.299000,  0.587000,  0.114000,
             -0.168700, -0.331300,  0.500000,
              0.500000, -0.418700, -0.081300
         };*/
-        const int matrix[] = {77, 150, 29, -43, -85, 128, 128, -107, -21};
-        gpujpeg_color_transform_to<8>(c1, c2, c3, matrix, 0, 128, 128);
+        const int values[] = {77, 150, 29, -43, -85, 128, 128, -107, -21};
+        for ( int i = 0; i < 9; i++ )
+            matrix[i] = values[i];
+        base[0] = 0;
+        base[1] = 128;
+        base[2] = 128;
     }
 };
 /** Specialization [color_space_from = GPUJPEG_YCBCR_BT601_256LVLS, color_space_to = GPUJPEG_RGB] */
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB> {
     /** YCbCr (ITU-R Recommendation BT.601 with 256 levels) -> RGB transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB, "Transformation");
+        int matrix[9];
+        int base[3];
+        coefficients(matrix, base);
+        gpujpeg_color_transform_from<8>(c1, c2, c3, matrix, base[0], base[1], base[2]);
+    }
+    /** Integer matrix (8 fraction bits) and component bases of the transform */
+    static GPUJPEG_COLOR_FUNC void
+    coefficients(int matrix[9], int base[3]) {
         // Source: http://www.ecma-international.org/publications/files/ECMA-TR/TR-098.pdf, page 4
         /*const double matrix[] = {
             1.000000,  0.000000,  1.402000,
             1.000000, -0.344140, -0.714140,
             1.000000,  1.772000,  0.000000
         };*/
-        const int matrix[] = {256, 0, 359, 256, -88, -183, 256, 454, 0};
-        gpujpeg_color_transform_from<8>(c1, c2, c3, matrix, 0, 128, 128);
+        const int values[] = {256, 0, 359, 256, -88, -183, 256, 454, 0};
+        for ( int i = 0; i < 9; i++ )
+            matrix[i] = values[i];
+        base[0] = 0;
+        base[1] = 128;
+        base[2] = 128;
     }
 };
 
@@ -282,34 +342,58 @@ struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB> {
 template<>
 struct gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT709> {
     /** RGB -> YCbCr (ITU-R Recommendation BT.709) transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_RGB, GPUJPEG_YCBCR_BT709, "Transformation");
+        int matrix[9];
+        int base[3];
+        coefficients(matrix, base);
+        gpujpeg_color_transform_to<8>(c1, c2, c3, matrix, base[0], base[1], base[2]);
+    }
+    /** Integer matrix (8 fraction bits) and component bases of the transform */
+    static GPUJPEG_COLOR_FUNC void
+    coefficients(int matrix[9], int base[3]) {
         // Source: http://www.equasys.de/colorconversion.html
         /*const double matrix[] = {
               0.182586,  0.614231,  0.062007,
              -0.100644, -0.338572,  0.439216,
               0.439216, -0.398942, -0.040274
         };*/
-        const int matrix[] = {47, 157, 16, -26, -87, 112, 112, -102, -10};
-        gpujpeg_color_transform_to<8>(c1, c2, c3, matrix, 16, 128, 128);
+        const int values[] = {47, 157, 16, -26, -87, 112, 112, -102, -10};
+        for ( int i = 0; i < 9; i++ )
+            matrix[i] = values[i];
+        base[0] = 16;
+        base[1] = 128;
+        base[2] = 128;
     }
 };
 /** Specialization [color_space_from = GPUJPEG_YCBCR_BT709, color_space_to = GPUJPEG_RGB] */
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT709, GPUJPEG_RGB> {
     /** YCbCr (ITU-R Recommendation BT.709) -> RGB transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_YCBCR_BT709, GPUJPEG_RGB, "Transformation");
+        int matrix[9];
+        int base[3];
+        coefficients(matrix, base);
+        gpujpeg_color_transform_from<8>(c1, c2, c3, matrix, base[0], base[1], base[2]);
+    }
+    /** Integer matrix (8 fraction bits) and component bases of the transform */
+    static GPUJPEG_COLOR_FUNC void
+    coefficients(int matrix[9], int base[3]) {
         // Source: http://www.equasys.de/colorconversion.html
         /*const double matrix[] = {
              1.164384,  0.000000,  1.792741,
              1.164384, -0.213249, -0.532909,
              1.164384,  2.112402,  0.000000
         };*/
-        const int matrix[] = {298, 0, 459, 298, -55, -136, 298, 541, 0};
-        gpujpeg_color_transform_from<8>(c1, c2, c3, matrix, 16, 128, 128);
+        const int values[] = {298, 0, 459, 298, -55, -136, 298, 541, 0};
+        for ( int i = 0; i < 9; i++ )
+            matrix[i] = values[i];
+        base[0] = 16;
+        base[1] = 128;
+        base[2] = 128;
     }
 };
 
@@ -317,32 +401,56 @@ struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT709, GPUJPEG_RGB> {
 template<>
 struct gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YUV> {
     /** RGB -> YUV transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_RGB, GPUJPEG_YUV, "Transformation");
+        int matrix[9];
+        int base[3];
+        coefficients(matrix, base);
+        gpujpeg_color_transform_to<8>(c1, c2, c3, matrix, base[0], base[1], base[2]);
+    }
+    /** Integer matrix (8 fraction bits) and component bases of the transform */
+    static GPUJPEG_COLOR_FUNC void
+    coefficients(int matrix[9], int base[3]) {
         /*const double matrix[] = {
               0.299000,  0.587000,  0.114000,
              -0.147400, -0.289500,  0.436900,
               0.615000, -0.515000, -0.100000
         };*/
-        const int matrix[] = {77, 150, 29, -38, -74, 112, 157, -132, -26};
-        gpujpeg_color_transform_to<8>(c1, c2, c3, matrix, 0, 128, 128);
+        const int values[] = {77, 150, 29, -38, -74, 112, 157, -132, -26};
+        for ( int i = 0; i < 9; i++ )
+            matrix[i] = values[i];
+        base[0] = 0;
+        base[1] = 128;
+        base[2] = 128;
     }
 };
 /** Specialization [color_space_from = GPUJPEG_YUV, color_space_to = GPUJPEG_RGB] */
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YUV, GPUJPEG_RGB> {
     /** YUV -> RGB transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         GPUJPEG_COLOR_TRANSFORM_DEBUG(GPUJPEG_YUV, GPUJPEG_RGB, "Transformation");
+        int matrix[9];
+        int base[3];
+        coefficients(matrix, base);
+        gpujpeg_color_transform_from<8>(c1, c2, c3, matrix, base[0], base[1], base[2]);
+    }
+    /** Integer matrix (8 fraction bits) and component bases of the transform */
+    static GPUJPEG_COLOR_FUNC void
+    coefficients(int matrix[9], int base[3]) {
         /*const double matrix[] = {
              1.000000,  0.000000,  1.140000,
              1.000000, -0.395000, -0.581000,
              1.000000,  2.032000,  0.000000
         };*/
-        const int matrix[] = {256, 0, 292, 256, -101, -149, 256, 520, 0};
-        gpujpeg_color_transform_from<8>(c1, c2, c3, matrix, 0, 128, 128);
+        const int values[] = {256, 0, 292, 256, -101, -149, 256, 520, 0};
+        for ( int i = 0; i < 9; i++ )
+            matrix[i] = values[i];
+        base[0] = 0;
+        base[1] = 128;
+        base[2] = 128;
     }
 };
 
@@ -350,7 +458,7 @@ struct gpujpeg_color_transform<GPUJPEG_YUV, GPUJPEG_RGB> {
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601, GPUJPEG_YCBCR_BT601_256LVLS> {
     /** YCbCr (ITU-R Recommendation BT.709) -> YCbCr (ITU-R Recommendation BT.601 with 256 levels) transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         gpujpeg_color_transform<GPUJPEG_YCBCR_BT601, GPUJPEG_RGB>::perform(c1,c2,c3);
         gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601_256LVLS>::perform(c1,c2,c3);
@@ -361,7 +469,7 @@ struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601, GPUJPEG_YCBCR_BT601_256LVLS>
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_YCBCR_BT601> {
     /** YCbCr (ITU-R Recommendation BT.601 with 256 levels) -> YCbCr (ITU-R Recommendation BT.709) transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB>::perform(c1,c2,c3);
         gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601>::perform(c1,c2,c3);
@@ -372,7 +480,7 @@ struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_YCBCR_BT601>
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT709, GPUJPEG_YCBCR_BT601_256LVLS> {
     /** YCbCr (ITU-R Recommendation BT.709) -> YCbCr (ITU-R Recommendation BT.601 with 256 levels) transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         gpujpeg_color_transform<GPUJPEG_YCBCR_BT709, GPUJPEG_RGB>::perform(c1,c2,c3);
         gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601_256LVLS>::perform(c1,c2,c3);
@@ -383,7 +491,7 @@ struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT709, GPUJPEG_YCBCR_BT601_256LVLS>
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_YCBCR_BT709> {
     /** YCbCr (ITU-R Recommendation BT.601 with 256 levels) -> YCbCr (ITU-R Recommendation BT.709) transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB>::perform(c1,c2,c3);
         gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT709>::perform(c1,c2,c3);
@@ -394,7 +502,7 @@ struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_YCBCR_BT709>
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YUV, GPUJPEG_YCBCR_BT601_256LVLS> {
     /** YUV -> YCbCr (ITU-R Recommendation BT.601 with 256 levels) transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         gpujpeg_color_transform<GPUJPEG_YUV, GPUJPEG_RGB>::perform(c1,c2,c3);
         gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601_256LVLS>::perform(c1,c2,c3);
@@ -405,13 +513,39 @@ struct gpujpeg_color_transform<GPUJPEG_YUV, GPUJPEG_YCBCR_BT601_256LVLS> {
 template<>
 struct gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_YUV> {
     /** YCbCr (ITU-R Recommendation BT.601 with 256 levels) -> YUV transform (8 bit) */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB>::perform(c1,c2,c3);
         gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YUV>::perform(c1,c2,c3);
     }
 };
 
+/** Specialization [color_space_from = GPUJPEG_CMYK, color_space_to = GPUJPEG_YCCK] */
+template<>
+struct gpujpeg_color_transform<GPUJPEG_CMYK, GPUJPEG_YCCK> {
+    /** CMY -> YCC transform (8 bit), K component is not transformed */
+    static GPUJPEG_COLOR_FUNC void
+    perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
+        // Inverted CMY components are transformed as RGB (as by libjpeg)
+        c1 = 255 - c1;
+        c2 = 255 - c2;
+        c3 = 255 - c3;
+        gpujpeg_color_transform<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601_256LVLS>::perform(c1,c2,c3);
+    }
+};
+/** Specialization [color_space_from = GPUJPEG_YCCK, color_space_to = GPUJPEG_CMYK] */
+template<>
+struct gpujpeg_color_transform<GPUJPEG_YCCK, GPUJPEG_CMYK> {
+    /** YCC -> CMY transform (8 bit), K component is not transformed */
+    static GPUJPEG_COLOR_FUNC void
+    perform(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
+        gpujpeg_color_transform<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB>::perform(c1,c2,c3);
+        c1 = 255 - c1;
+        c2 = 255 - c2;
+        c3 = 255 - c3;
+    }
+};
+
 /**
  * Color components load order
  *
@@ -421,12 +555,12 @@ template<enum gpujpeg_color_space color_space>
 struct gpujpeg_color_order
 {
     /** Change load order */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_load(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         // Default order is not changed
     }
     /** Change load order */
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_store(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         // Default order is not changed
     }
@@ -435,11 +569,11 @@ struct gpujpeg_color_order
 template<>
 struct gpujpeg_color_order<GPUJPEG_YCBCR_BT601>
 {
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_load(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         uint8_t tmp = c1; c1 = c2; c2 = tmp;
     }
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_store(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         uint8_t tmp = c1; c1 = c2; c2 = tmp;
     }
@@ -447,11 +581,11 @@ struct gpujpeg_color_order<GPUJPEG_YCBCR_BT601>
 template<>
 struct gpujpeg_color_order<GPUJPEG_YCBCR_BT601_256LVLS>
 {
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_load(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         uint8_t tmp = c1; c1 = c2; c2 = tmp;
     }
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_store(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         uint8_t tmp = c1; c1 = c2; c2 = tmp;
     }
@@ -459,11 +593,11 @@ struct gpujpeg_color_order<GPUJPEG_YCBCR_BT601_256LVLS>
 template<>
 struct gpujpeg_color_order<GPUJPEG_YCBCR_BT709>
 {
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_load(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         uint8_t tmp = c1; c1 = c2; c2 = tmp;
     }
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_store(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         uint8_t tmp = c1; c1 = c2; c2 = tmp;
     }
@@ -471,11 +605,11 @@ struct gpujpeg_color_order<GPUJPEG_YCBCR_BT709>
 template<>
 struct gpujpeg_color_order<GPUJPEG_YUV>
 {
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_load(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         uint8_t tmp = c1; c1 = c2; c2 = tmp;
     }
-    static __device__ void
+    static GPUJPEG_COLOR_FUNC void
     perform_store(uint8_t & c1, uint8_t & c2, uint8_t & c3) {
         uint8_t tmp = c1; c1 = c2; c2 = tmp;
     }
@@ -0,0 +1,406 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gpujpeg_colorspace_cpu.h"
+#include "gpujpeg_colorspace.h"
+#include <stdio.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GPUJPEG_COLOR_CPU_SSE2
+#include <emmintrin.h>
+#if (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || defined(__clang__) || defined(_MSC_VER)
+#define GPUJPEG_COLOR_CPU_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define GPUJPEG_COLOR_CPU_TARGET_AVX2
+#else
+#define GPUJPEG_COLOR_CPU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
+/** Primitive color transformation between RGB and other color space */
+struct gpujpeg_color_transform_cpu_matrix
+{
+    // Integer matrix (8 fraction bits)
+    int matrix[9];
+    // Component bases
+    int base[3];
+    // Transformation is performed to RGB (bases are subtracted from input), otherwise from RGB (bases are added to output)
+    int inverse;
+};
+
+/**
+ * Get integer matrix of transformation between RGB and color space
+ *
+ * @param inverse  Get transformation color_space -> RGB, otherwise RGB -> color_space
+ * @param transform  Output matrix
+ */
+template<enum gpujpeg_color_space color_space>
+static void
+gpujpeg_color_transform_cpu_coefficients(int inverse, struct gpujpeg_color_transform_cpu_matrix* transform)
+{
+    if ( inverse )
+        gpujpeg_color_transform<color_space, GPUJPEG_RGB>::coefficients(transform->matrix, transform->base);
+    else
+        gpujpeg_color_transform<GPUJPEG_RGB, color_space>::coefficients(transform->matrix, transform->base);
+    transform->inverse = inverse;
+}
+
+/**
+ * Transform samples [begin, count) by scalar code (the same code as in preprocessor kernels)
+ */
+static void
+gpujpeg_color_transform_cpu_scalar(const struct gpujpeg_color_transform_cpu_matrix* transform,
+                                   uint8_t* c1, uint8_t* c2, uint8_t* c3, int begin, int count)
+{
+    const int* base = transform->base;
+    if ( transform->inverse ) {
+        for ( int index = begin; index < count; index++ )
+            gpujpeg_color_transform_from<8>(c1[index], c2[index], c3[index], transform->matrix, base[0], base[1], base[2]);
+    } else {
+        for ( int index = begin; index < count; index++ )
+            gpujpeg_color_transform_to<8>(c1[index], c2[index], c3[index], transform->matrix, base[0], base[1], base[2]);
+    }
+}
+
+#ifdef GPUJPEG_COLOR_CPU_SSE2
+
+/**
+ * Compute one output component for 8 samples, input samples are already scaled by 256/255
+ * and interleaved to pairs (r1, r2) and (r3, 1)
+ *
+ * @return 8 output samples as 16-bit integers
+ */
+static inline __m128i
+gpujpeg_color_transform_cpu_sse2_row(__m128i r12_lo, __m128i r12_hi, __m128i r3_lo, __m128i r3_hi,
+                                     const int* matrix, int base)
+{
+    const __m128i m12 = _mm_set1_epi32((int)(((uint32_t)(uint16_t)matrix[1] << 16) | (uint16_t)matrix[0]));
+    const __m128i m3 = _mm_set1_epi32((int)((128u << 16) | (uint16_t)matrix[2]));
+    const __m128i b = _mm_set1_epi32(base);
+    __m128i lo = _mm_add_epi32(_mm_madd_epi16(r12_lo, m12), _mm_madd_epi16(r3_lo, m3));
+    __m128i hi = _mm_add_epi32(_mm_madd_epi16(r12_hi, m12), _mm_madd_epi16(r3_hi, m3));
+    lo = _mm_add_epi32(_mm_srai_epi32(lo, 8), b);
+    hi = _mm_add_epi32(_mm_srai_epi32(hi, 8), b);
+    return _mm_packs_epi32(lo, hi);
+}
+
+/**
+ * Load 8 samples, subtract base and scale them by 256/255 (value 255 is the only one
+ * which is changed by integer scaling in [-255, 255] range)
+ */
+static inline __m128i
+gpujpeg_color_transform_cpu_sse2_load(const uint8_t* c, int base)
+{
+    __m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)c), _mm_setzero_si128());
+    x = _mm_sub_epi16(x, _mm_set1_epi16(base));
+    return _mm_sub_epi16(x, _mm_cmpeq_epi16(x, _mm_set1_epi16(255)));
+}
+
+/**
+ * Transform samples by SSE2 code, 8 samples per iteration
+ *
+ * @return number of processed samples
+ */
+static int
+gpujpeg_color_transform_cpu_sse2(const struct gpujpeg_color_transform_cpu_matrix* transform,
+                                 uint8_t* c1, uint8_t* c2, uint8_t* c3, int count)
+{
+    const int* m = transform->matrix;
+    const int* base_in = transform->inverse ? transform->base : NULL;
+    const int* base_out = transform->inverse ? NULL : transform->base;
+    const __m128i one = _mm_set1_epi16(1);
+    int index = 0;
+    for ( ; index + 8 <= count; index += 8 ) {
+        __m128i r1 = gpujpeg_color_transform_cpu_sse2_load(&c1[index], base_in ? base_in[0] : 0);
+        __m128i r2 = gpujpeg_color_transform_cpu_sse2_load(&c2[index], base_in ? base_in[1] : 0);
+        __m128i r3 = gpujpeg_color_transform_cpu_sse2_load(&c3[index], base_in ? base_in[2] : 0);
+        __m128i r12_lo = _mm_unpacklo_epi16(r1, r2);
+        __m128i r12_hi = _mm_unpackhi_epi16(r1, r2);
+        __m128i r3_lo = _mm_unpacklo_epi16(r3, one);
+        __m128i r3_hi = _mm_unpackhi_epi16(r3, one);
+        __m128i o1 = gpujpeg_color_transform_cpu_sse2_row(r12_lo, r12_hi, r3_lo, r3_hi, &m[0], base_out ? base_out[0] : 0);
+        __m128i o2 = gpujpeg_color_transform_cpu_sse2_row(r12_lo, r12_hi, r3_lo, r3_hi, &m[3], base_out ? base_out[1] : 0);
+        __m128i o3 = gpujpeg_color_transform_cpu_sse2_row(r12_lo, r12_hi, r3_lo, r3_hi, &m[6], base_out ? base_out[2] : 0);
+        _mm_storel_epi64((__m128i*)&c1[index], _mm_packus_epi16(o1, o1));
+        _mm_storel_epi64((__m128i*)&c2[index], _mm_packus_epi16(o2, o2));
+        _mm_storel_epi64((__m128i*)&c3[index], _mm_packus_epi16(o3, o3));
+    }
+    return index;
+}
+
+#endif // GPUJPEG_COLOR_CPU_SSE2
+
+#ifdef GPUJPEG_COLOR_CPU_AVX2
+
+/** AVX2 version of gpujpeg_color_transform_cpu_sse2_row (16 samples) */
+static inline GPUJPEG_COLOR_CPU_TARGET_AVX2 __m128i
+gpujpeg_color_transform_cpu_avx2_row(__m256i r12_lo, __m256i r12_hi, __m256i r3_lo, __m256i r3_hi,
+                                     const int* matrix, int base)
+{
+    const __m256i m12 = _mm256_set1_epi32((int)(((uint32_t)(uint16_t)matrix[1] << 16) | (uint16_t)matrix[0]));
+    const __m256i m3 = _mm256_set1_epi32((int)((128u << 16) | (uint16_t)matrix[2]));
+    const __m256i b = _mm256_set1_epi32(base);
+    __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(r12_lo, m12), _mm256_madd_epi16(r3_lo, m3));
+    __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(r12_hi, m12), _mm256_madd_epi16(r3_hi, m3));
+    lo = _mm256_add_epi32(_mm256_srai_epi32(lo, 8), b);
+    hi = _mm256_add_epi32(_mm256_srai_epi32(hi, 8), b);
+    // Packing works within 128-bit lanes which keeps samples in order
+    __m256i out = _mm256_packs_epi32(lo, hi);
+    return _mm_packus_epi16(_mm256_castsi256_si128(out), _mm256_extracti128_si256(out, 1));
+}
+
+/** AVX2 version of gpujpeg_color_transform_cpu_sse2_load (16 samples) */
+static inline GPUJPEG_COLOR_CPU_TARGET_AVX2 __m256i
+gpujpeg_color_transform_cpu_avx2_load(const uint8_t* c, int base)
+{
+    __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)c));
+    x = _mm256_sub_epi16(x, _mm256_set1_epi16(base));
+    return _mm256_sub_epi16(x, _mm256_cmpeq_epi16(x, _mm256_set1_epi16(255)));
+}
+
+/**
+ * Transform samples by AVX2 code, 16 samples per iteration
+ *
+ * @return number of processed samples
+ */
+static GPUJPEG_COLOR_CPU_TARGET_AVX2 int
+gpujpeg_color_transform_cpu_avx2(const struct gpujpeg_color_transform_cpu_matrix* transform,
+                                 uint8_t* c1, uint8_t* c2, uint8_t* c3, int count)
+{
+    const int* m = transform->matrix;
+    const int* base_in = transform->inverse ? transform->base : NULL;
+    const int* base_out = transform->inverse ? NULL : transform->base;
+    const __m256i one = _mm256_set1_epi16(1);
+    int index = 0;
+    for ( ; index + 16 <= count; index += 16 ) {
+        __m256i r1 = gpujpeg_color_transform_cpu_avx2_load(&c1[index], base_in ? base_in[0] : 0);
+        __m256i r2 = gpujpeg_color_transform_cpu_avx2_load(&c2[index], base_in ? base_in[1] : 0);
+        __m256i r3 = gpujpeg_color_transform_cpu_avx2_load(&c3[index], base_in ? base_in[2] : 0);
+        __m256i r12_lo = _mm256_unpacklo_epi16(r1, r2);
+        __m256i r12_hi = _mm256_unpackhi_epi16(r1, r2);
+        __m256i r3_lo = _mm256_unpacklo_epi16(r3, one);
+        __m256i r3_hi = _mm256_unpackhi_epi16(r3, one);
+        __m128i o1 = gpujpeg_color_transform_cpu_avx2_row(r12_lo, r12_hi, r3_lo, r3_hi, &m[0], base_out ? base_out[0] : 0);
+        __m128i o2 = gpujpeg_color_transform_cpu_avx2_row(r12_lo, r12_hi, r3_lo, r3_hi, &m[3], base_out ? base_out[1] : 0);
+        __m128i o3 = gpujpeg_color_transform_cpu_avx2_row(r12_lo, r12_hi, r3_lo, r3_hi, &m[6], base_out ? base_out[2] : 0);
+        _mm_storeu_si128((__m128i*)&c1[index], o1);
+        _mm_storeu_si128((__m128i*)&c2[index], o2);
+        _mm_storeu_si128((__m128i*)&c3[index], o3);
+    }
+    return index;
+}
+
+/**
+ * Check whether CPU and OS support AVX2
+ */
+static int
+gpujpeg_color_transform_cpu_has_avx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if ( info[0] < 7 )
+        return 0;
+    __cpuid(info, 1);
+    // OSXSAVE and YMM state enabled by OS
+    if ( (info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6 )
+        return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // GPUJPEG_COLOR_CPU_AVX2
+
+/**
+ * Perform primitive color transformation by the best available code
+ */
+static void
+gpujpeg_color_transform_cpu_perform(const struct gpujpeg_color_transform_cpu_matrix* transform,
+                                    uint8_t* c1, uint8_t* c2, uint8_t* c3, int count)
+{
+    int index = 0;
+#ifdef GPUJPEG_COLOR_CPU_AVX2
+    static int has_avx2 = -1;
+    if ( has_avx2 == -1 )
+        has_avx2 = gpujpeg_color_transform_cpu_has_avx2();
+    if ( has_avx2 )
+        index = gpujpeg_color_transform_cpu_avx2(transform, c1, c2, c3, count);
+#endif
+#ifdef GPUJPEG_COLOR_CPU_SSE2
+    index += gpujpeg_color_transform_cpu_sse2(transform, &c1[index], &c2[index], &c3[index], count - index);
+#endif
+    gpujpeg_color_transform_cpu_scalar(transform, c1, c2, c3, index, count);
+}
+
+/**
+ * Perform color transformation between RGB and color space
+ *
+ * @param inverse  Perform transformation color_space -> RGB, otherwise RGB -> color_space
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_color_transform_cpu_rgb(enum gpujpeg_color_space color_space, int inverse,
+                                uint8_t* c1, uint8_t* c2, uint8_t* c3, int count)
+{
+    struct gpujpeg_color_transform_cpu_matrix transform;
+    switch ( color_space ) {
+    case GPUJPEG_NONE:
+    case GPUJPEG_RGB:
+        return 0;
+    case GPUJPEG_YCBCR_BT601:
+        gpujpeg_color_transform_cpu_coefficients<GPUJPEG_YCBCR_BT601>(inverse, &transform);
+        break;
+    case GPUJPEG_YCBCR_BT601_256LVLS:
+        gpujpeg_color_transform_cpu_coefficients<GPUJPEG_YCBCR_BT601_256LVLS>(inverse, &transform);
+        break;
+    case GPUJPEG_YCBCR_BT709:
+        gpujpeg_color_transform_cpu_coefficients<GPUJPEG_YCBCR_BT709>(inverse, &transform);
+        break;
+    case GPUJPEG_YUV:
+        gpujpeg_color_transform_cpu_coefficients<GPUJPEG_YUV>(inverse, &transform);
+        break;
+    default:
+        return -1;
+    }
+    gpujpeg_color_transform_cpu_perform(&transform, c1, c2, c3, count);
+    return 0;
+}
+
+/**
+ * Invert samples (CMY <-> RGB)
+ */
+static void
+gpujpeg_color_transform_cpu_invert(uint8_t* c1, uint8_t* c2, uint8_t* c3, int count)
+{
+    for ( int index = 0; index < count; index++ ) {
+        c1[index] = 255 - c1[index];
+        c2[index] = 255 - c2[index];
+        c3[index] = 255 - c3[index];
+    }
+}
+
+/** Documented at declaration */
+int
+gpujpeg_color_transform_cpu(enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to,
+                            uint8_t* c1, uint8_t* c2, uint8_t* c3, int count)
+{
+    if ( color_space_from == color_space_to || color_space_from == GPUJPEG_NONE || color_space_to == GPUJPEG_NONE )
+        return 0;
+
+    // Inverted CMY components are transformed as RGB, K component is not transformed
+    if ( color_space_from == GPUJPEG_CMYK && color_space_to == GPUJPEG_YCCK ) {
+        gpujpeg_color_transform_cpu_invert(c1, c2, c3, count);
+        return gpujpeg_color_transform_cpu_rgb(GPUJPEG_YCBCR_BT601_256LVLS, 0, c1, c2, c3, count);
+    }
+    if ( color_space_from == GPUJPEG_YCCK && color_space_to == GPUJPEG_CMYK ) {
+        gpujpeg_color_transform_cpu_rgb(GPUJPEG_YCBCR_BT601_256LVLS, 1, c1, c2, c3, count);
+        gpujpeg_color_transform_cpu_invert(c1, c2, c3, count);
+        return 0;
+    }
+
+    // Other color spaces are transformed through RGB (in the same way as by preprocessor)
+    if ( gpujpeg_color_transform_cpu_rgb(color_space_from, 1, c1, c2, c3, count) != 0
+         || gpujpeg_color_transform_cpu_rgb(color_space_to, 0, c1, c2, c3, count) != 0 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Color transformation from %s to %s is not supported!\n",
+            gpujpeg_color_space_get_name(color_space_from), gpujpeg_color_space_get_name(color_space_to));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Check whether color space swaps first two components at load/store
+ */
+template<enum gpujpeg_color_space color_space>
+static int
+gpujpeg_color_order_cpu_swapped()
+{
+    uint8_t c1 = 1;
+    uint8_t c2 = 2;
+    uint8_t c3 = 3;
+    gpujpeg_color_order<color_space>::perform_load(c1, c2, c3);
+    return c1 != 1;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_color_order_cpu_swapped(enum gpujpeg_color_space color_space)
+{
+    switch ( color_space ) {
+    case GPUJPEG_YCBCR_BT601:
+        return gpujpeg_color_order_cpu_swapped<GPUJPEG_YCBCR_BT601>();
+    case GPUJPEG_YCBCR_BT601_256LVLS:
+        return gpujpeg_color_order_cpu_swapped<GPUJPEG_YCBCR_BT601_256LVLS>();
+    case GPUJPEG_YCBCR_BT709:
+        return gpujpeg_color_order_cpu_swapped<GPUJPEG_YCBCR_BT709>();
+    case GPUJPEG_YUV:
+        return gpujpeg_color_order_cpu_swapped<GPUJPEG_YUV>();
+    default:
+        return 0;
+    }
+}
+
+/** Documented at declaration */
+int
+gpujpeg_color_transform_cpu_interleaved(enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to,
+                                        uint8_t* data, int pixel_count)
+{
+    const int swap_load = gpujpeg_color_order_cpu_swapped(color_space_from);
+    const int swap_store = gpujpeg_color_order_cpu_swapped(color_space_to);
+
+    // Pixels are processed in chunks deinterleaved to component planes
+    enum { chunk_size = 1024 };
+    uint8_t c1[chunk_size];
+    uint8_t c2[chunk_size];
+    uint8_t c3[chunk_size];
+    for ( int begin = 0; begin < pixel_count; begin += chunk_size ) {
+        int count = pixel_count - begin < chunk_size ? pixel_count - begin : (int)chunk_size;
+        uint8_t* pixel = &data[begin * 3];
+        for ( int index = 0; index < count; index++ ) {
+            c1[index] = pixel[index * 3 + (swap_load ? 1 : 0)];
+            c2[index] = pixel[index * 3 + (swap_load ? 0 : 1)];
+            c3[index] = pixel[index * 3 + 2];
+        }
+        if ( gpujpeg_color_transform_cpu(color_space_from, color_space_to, c1, c2, c3, count) != 0 )
+            return -1;
+        for ( int index = 0; index < count; index++ ) {
+            pixel[index * 3 + (swap_store ? 1 : 0)] = c1[index];
+            pixel[index * 3 + (swap_store ? 0 : 1)] = c2[index];
+            pixel[index * 3 + 2] = c3[index];
+        }
+    }
+    return 0;
+}
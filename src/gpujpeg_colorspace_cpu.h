@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_COLORSPACE_CPU_H
+#define GPUJPEG_COLORSPACE_CPU_H
+
+#include <libgpujpeg/gpujpeg_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Perform color transformation of 8-bit component planes on CPU (in place).
+ * Results are identical with color transformation performed by preprocessor
+ * kernels (the same integer matrices from gpujpeg_colorspace.h are used),
+ * SSE2/AVX2 code is used when available. Transformations between two non-RGB
+ * color spaces are performed through RGB.
+ *
+ * @param color_space_from  Color space of input samples
+ * @param color_space_to  Color space of output samples
+ * @param c1  First component plane
+ * @param c2  Second component plane
+ * @param c3  Third component plane
+ * @param count  Number of samples in each plane
+ * @return 0 if succeeds, otherwise nonzero (transformation is not supported)
+ */
+int
+gpujpeg_color_transform_cpu(enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to,
+                            uint8_t* c1, uint8_t* c2, uint8_t* c3, int count);
+
+/**
+ * Perform color transformation of interleaved 8-bit image (three samples per pixel,
+ * as GPUJPEG_444_U8_P012) on CPU (in place). Components are reordered by load/store
+ * order of both color spaces in the same way as by preprocessor kernels.
+ *
+ * @param color_space_from  Color space of input image
+ * @param color_space_to  Color space of output image
+ * @param data  Image data
+ * @param pixel_count  Number of pixels
+ * @return 0 if succeeds, otherwise nonzero (transformation is not supported)
+ */
+int
+gpujpeg_color_transform_cpu_interleaved(enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to,
+                                        uint8_t* data, int pixel_count);
+
+/**
+ * Check whether first two components of packed pixel formats are swapped at
+ * load/store for given color space (as by gpujpeg_color_order in preprocessor)
+ *
+ * @param color_space  Color space of image
+ * @return 1 if components are swapped, otherwise 0
+ */
+int
+gpujpeg_color_order_cpu_swapped(enum gpujpeg_color_space color_space);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_COLORSPACE_CPU_H
@@ -33,9 +33,13 @@
 
 #include <algorithm>
 #include <ctype.h>
+#include <string.h>
 #include <libgpujpeg/gpujpeg_common.h>
 #include <libgpujpeg/gpujpeg_util.h>
+#include <libgpujpeg/gpujpeg_stats_internal.h>
+#include "gpujpeg_device.h"
 #include "gpujpeg_preprocessor.h"
+#include "gpujpeg_colorspace_cpu.h"
 #include <math.h>
 #if defined(_MSC_VER)
   #include <windows.h>
@@ -76,10 +80,18 @@
     }
 #elif defined(__linux__) || defined(__APPLE__)
     #include <sys/time.h>
+    #include <time.h>
 
     /** Documented at declaration */
     double gpujpeg_get_time(void)
     {
+    #ifdef CLOCK_MONOTONIC
+        // Monotonic clock isn't affected by changes of system time
+        struct timespec ts;
+        if ( clock_gettime(CLOCK_MONOTONIC, &ts) == 0 ) {
+            return (double) ts.tv_sec + (double) ts.tv_nsec * 0.000000001;
+        }
+    #endif
         struct timeval tv;
         gettimeofday(&tv, 0);
         return (double) tv.tv_sec + (double) tv.tv_usec * 0.000001;
@@ -154,6 +166,16 @@ gpujpeg_print_devices_info()
 int
 gpujpeg_init_device(int device_id, int flags)
 {
+    // Host runtime doesn't use CUDA at all
+    if ( flags & GPUJPEG_HOST_RUNTIME ) {
+        gpujpeg_device_set_runtime(&gpujpeg_device_runtime_host);
+        if ( flags & GPUJPEG_VERBOSE ) {
+            printf("Using host runtime (kernels are run on CPU)\n");
+        }
+        return 0;
+    }
+    gpujpeg_device_set_runtime(&gpujpeg_device_runtime_cuda);
+
     int dev_count;
     cudaGetDeviceCount(&dev_count);
     gpujpeg_cuda_check_error("Cannot get number of CUDA devices", return -1);
@@ -235,6 +257,8 @@ gpujpeg_set_default_parameters(struct gpujpeg_parameters* param)
         param->sampling_factor[comp].vertical = 1;
     }
     param->color_space_internal = GPUJPEG_YCBCR_BT601_256LVLS;
+    param->precision = 8;
+    param->sampling_filter = GPUJPEG_SAMPLING_FILTER_NEAREST;
 }
 
 /** Documented at declaration */
@@ -242,7 +266,8 @@ void
 gpujpeg_parameters_chroma_subsampling_422(struct gpujpeg_parameters* param)
 {
     for (int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++) {
-        if (comp == 0) {
+        // K component of YCCK image has resolution of Y component
+        if (comp == 0 || comp == 3) {
             param->sampling_factor[comp].horizontal = 2;
         }
         else {
@@ -257,7 +282,8 @@ void
 gpujpeg_parameters_chroma_subsampling_420(struct gpujpeg_parameters* param)
 {
     for (int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++) {
-        if (comp == 0) {
+        // K component of YCCK image has resolution of Y component
+        if (comp == 0 || comp == 3) {
             param->sampling_factor[comp].horizontal = 2;
             param->sampling_factor[comp].vertical = 2;
         }
@@ -318,8 +344,8 @@ gpujpeg_component_print8(struct gpujpeg_component* component, uint8_t* d_data)
 {
     int data_size = component->data_width * component->data_height;
     uint8_t* data = NULL;
-    cudaMallocHost((void**)&data, data_size * sizeof(uint8_t));
-    cudaMemcpy(data, d_data, data_size * sizeof(uint8_t), cudaMemcpyDeviceToHost);
+    gpujpeg_device_malloc_host((void**)&data, data_size * sizeof(uint8_t));
+    gpujpeg_device_memcpy(data, d_data, data_size * sizeof(uint8_t), cudaMemcpyDeviceToHost);
 
     printf("Print Data\n");
     for ( int y = 0; y < component->data_height; y++ ) {
@@ -328,7 +354,7 @@ gpujpeg_component_print8(struct gpujpeg_component* component, uint8_t* d_data)
         }
         printf("\n");
     }
-    cudaFreeHost(data);
+    gpujpeg_device_free_host(data);
 }
 
 /** Documented at declaration */
@@ -337,8 +363,8 @@ gpujpeg_component_print16(struct gpujpeg_component* component, int16_t* d_data)
 {
     int data_size = component->data_width * component->data_height;
     int16_t* data = NULL;
-    cudaMallocHost((void**)&data, data_size * sizeof(int16_t));
-    cudaMemcpy(data, d_data, data_size * sizeof(int16_t), cudaMemcpyDeviceToHost);
+    gpujpeg_device_malloc_host((void**)&data, data_size * sizeof(int16_t));
+    gpujpeg_device_memcpy(data, d_data, data_size * sizeof(int16_t), cudaMemcpyDeviceToHost);
 
     printf("Print Data\n");
     for ( int y = 0; y < component->data_height; y++ ) {
@@ -347,24 +373,30 @@ gpujpeg_component_print16(struct gpujpeg_component* component, int16_t* d_data)
         }
         printf("\n");
     }
-    cudaFreeHost(data);
+    gpujpeg_device_free_host(data);
 }
 
 /** Documented at declaration */
 int
 gpujpeg_coder_init(struct gpujpeg_coder * coder)
 {
-    // Get info about the device
-    struct cudaDeviceProp device_properties;
-    int device_idx;
-    cudaGetDevice(&device_idx);
-    cudaGetDeviceProperties(&device_properties, device_idx);
-    gpujpeg_cuda_check_error("Device info getting", return -1);
-    coder->cuda_cc_major = device_properties.major;
-    coder->cuda_cc_minor = device_properties.minor;
-    if (device_properties.major < 2) {
-        fprintf(stderr, "GPUJPEG coder is currently broken on cards with cc < 2.0\n");
-        return -1;
+    // Get info about the device (host runtime has no device)
+    if ( gpujpeg_device_get_runtime()->host ) {
+        coder->cuda_cc_major = 0;
+        coder->cuda_cc_minor = 0;
+    }
+    else {
+        struct cudaDeviceProp device_properties;
+        int device_idx;
+        cudaGetDevice(&device_idx);
+        cudaGetDeviceProperties(&device_properties, device_idx);
+        gpujpeg_cuda_check_error("Device info getting", return -1);
+        coder->cuda_cc_major = device_properties.major;
+        coder->cuda_cc_minor = device_properties.minor;
+        if (device_properties.major < 2) {
+            fprintf(stderr, "GPUJPEG coder is currently broken on cards with cc < 2.0\n");
+            return -1;
+        }
     }
 
     // Initialize coder for no image
@@ -373,6 +405,7 @@ gpujpeg_coder_init(struct gpujpeg_coder * coder)
     coder->param.interleaved = -1;
     coder->param.segment_info = -1;
     coder->param.color_space_internal = GPUJPEG_NONE;
+    coder->param.precision = 0;
     coder->param_image.color_space = GPUJPEG_NONE;
     coder->preprocessor = NULL;
     coder->component = NULL;
@@ -385,13 +418,36 @@ gpujpeg_coder_init(struct gpujpeg_coder * coder)
     coder->d_block_list = NULL;
     coder->block_allocated_size = 0;
     coder->d_data = NULL;
+    coder->d_data_allocated_size = 0;
+    coder->data_scale = 1;
+    coder->luminance_only = 0;
+    memset(&coder->data_raw_planes, 0, sizeof(struct gpujpeg_image_planes));
+    coder->data_raw_alpha = 255;
+    coder->d_data_alpha = NULL;
+    coder->sampling_filter = GPUJPEG_SAMPLING_FILTER_NEAREST;
+    memset(&coder->stats, 0, sizeof(struct gpujpeg_stats));
+    coder->stats_recorder = NULL;
+    coder->d_data_sampling = NULL;
+    coder->data_sampling_allocated_size = 0;
+    coder->data_sampling = NULL;
+    coder->data_sampling_host_allocated_size = 0;
     coder->data_quantized = NULL;
     coder->d_data_quantized = NULL;
     coder->data_allocated_size = 0;
+    coder->data_sparse_mask = NULL;
+    coder->d_data_sparse_mask = NULL;
+    coder->data_sparse_value = NULL;
+    coder->d_data_sparse_value = NULL;
+    coder->d_data_sparse_offset = NULL;
+    coder->data_sparse_allocated_count = 0;
     coder->data_raw = NULL;
     coder->d_data_raw = NULL;
     coder->d_data_raw_allocated = NULL;
     coder->data_raw_allocated_size = 0;
+    coder->data_raw_width = 0;
+    coder->data_raw_height = 0;
+    coder->data_raw_filter = GPUJPEG_RESIZE_FILTER_BOX;
+    coder->data_raw_tensor = 0;
     coder->data_compressed = NULL;
     coder->d_data_compressed = NULL;
     coder->d_temp_huffman = NULL;
@@ -400,6 +456,26 @@ gpujpeg_coder_init(struct gpujpeg_coder * coder)
     return 0;
 }
 
+/**
+ * Set component planes in device memory to coder->d_data, they are unset when
+ * it isn't allocated for current image
+ *
+ * @param coder  Coder structure (initialized for the image)
+ * @return void
+ */
+static void
+gpujpeg_coder_set_data(struct gpujpeg_coder* coder)
+{
+    int sample_size = (coder->param.precision > 8) ? 2 : 1;
+    int allocated = (coder->d_data != NULL && coder->data_size * sample_size <= coder->d_data_allocated_size);
+    uint8_t* d_comp_data = coder->d_data;
+    for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        component->d_data = allocated ? d_comp_data : NULL;
+        d_comp_data += component->data_width * component->data_height * sample_size;
+    }
+}
+
 size_t
 gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters * param, struct gpujpeg_image_parameters * param_image, cudaStream_t * stream)
 {
@@ -415,26 +491,31 @@ gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters
 
         // (Re)allocate color components in host memory
         if (coder->component != NULL) {
-            cudaFreeHost(coder->component);
+            gpujpeg_device_free_host(coder->component);
             coder->component = NULL;
         }
-        cudaMallocHost((void**)&coder->component, param_image->comp_count * sizeof(struct gpujpeg_component));
-        gpujpeg_cuda_check_error("Coder color component host allocation", return 0);
+        gpujpeg_device_malloc_host((void**)&coder->component, param_image->comp_count * sizeof(struct gpujpeg_component));
+        gpujpeg_device_check_error("Coder color component host allocation", return 0);
 
         // (Re)allocate color components in device memory
         if (coder->d_component != NULL) {
-            cudaFree(coder->d_component);
+            gpujpeg_device_free(coder->d_component);
             coder->d_component = NULL;
         }
-        cudaMalloc((void**)&coder->d_component, param_image->comp_count * sizeof(struct gpujpeg_component));
-        gpujpeg_cuda_check_error("Coder color component device allocation", return 0);
+        gpujpeg_device_malloc((void**)&coder->d_component, param_image->comp_count * sizeof(struct gpujpeg_component));
+        gpujpeg_device_check_error("Coder color component device allocation", return 0);
 
         coder->component_allocated_size = param_image->comp_count;
     }
     allocated_gpu_memory_size += coder->component_allocated_size * sizeof(struct gpujpeg_component);
 
-    // Calculate raw data size
+    // Calculate raw data size (raw image has image size unless resampling is set later)
     coder->data_raw_size = gpujpeg_image_calculate_size(&coder->param_image);
+    coder->data_raw_width = 0;
+    coder->data_raw_height = 0;
+    memset(&coder->data_raw_planes, 0, sizeof(struct gpujpeg_image_planes));
+    coder->d_data_alpha = NULL;
+    coder->data_scale = 1;
 
     // Initialize color components and compute maximum sampling factor to coder->sampling_factor
     coder->data_size = 0;
@@ -456,7 +537,7 @@ gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters
         }
 
         // Set type
-        component->type = (comp == 0) ? GPUJPEG_COMPONENT_LUMINANCE : GPUJPEG_COMPONENT_CHROMINANCE;
+        component->type = gpujpeg_component_get_type(coder->param.color_space_internal, comp);
 
         // Set proper color component sizes in pixels based on sampling factors
         int width = ((coder->param_image.width + coder->sampling_factor.horizontal - 1) / coder->sampling_factor.horizontal) * coder->sampling_factor.horizontal;
@@ -550,19 +631,19 @@ gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters
 
         // (Re)allocate segments  in host memory
         if (coder->segment != NULL) {
-            cudaFreeHost(coder->segment);
+            gpujpeg_device_free_host(coder->segment);
             coder->segment = NULL;
         }
-        cudaMallocHost((void**)&coder->segment, coder->segment_count * sizeof(struct gpujpeg_segment));
-        gpujpeg_cuda_check_error("Coder segment host allocation", return 0);
+        gpujpeg_device_malloc_host((void**)&coder->segment, coder->segment_count * sizeof(struct gpujpeg_segment));
+        gpujpeg_device_check_error("Coder segment host allocation", return 0);
 
         // (Re)allocate segments in device memory
         if (coder->d_segment != NULL) {
-            cudaFree(coder->d_segment);
+            gpujpeg_device_free(coder->d_segment);
             coder->d_segment = NULL;
         }
-        cudaMalloc((void**)&coder->d_segment, coder->segment_count * sizeof(struct gpujpeg_segment));
-        gpujpeg_cuda_check_error("Coder segment device allocation", return 0);
+        gpujpeg_device_malloc((void**)&coder->d_segment, coder->segment_count * sizeof(struct gpujpeg_segment));
+        gpujpeg_device_check_error("Coder segment device allocation", return 0);
 
         coder->segment_allocated_size = coder->segment_count;
     }
@@ -666,50 +747,44 @@ gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters
     }
     int idct_overhead = (GPUJPEG_IDCT_BLOCK_X * GPUJPEG_IDCT_BLOCK_Y * GPUJPEG_IDCT_BLOCK_Z / coder->component[0].data_width + 1)
       * GPUJPEG_BLOCK_SIZE * coder->component[0].data_width;
-    if (coder->data_size + idct_overhead > coder->data_allocated_size) {
+    // Component planes of 12-bit image have 16-bit samples, the allocated size is then
+    // counted in bytes of preprocessor data (quantized data are allocated for the same count)
+    int sample_size = (coder->param.precision > 8) ? 2 : 1;
+    if ((coder->data_size + idct_overhead) * sample_size > coder->data_allocated_size) {
         coder->data_allocated_size = 0;
 
-        // (Re)allocate preprocessor data in device memory
-        if (coder->d_data != NULL) {
-            cudaFree(coder->d_data);
-            coder->d_data = NULL;
-        }
-        cudaMalloc((void**)&coder->d_data, (coder->data_size + idct_overhead) * sizeof(uint8_t));
-        gpujpeg_cuda_check_error("Coder data device allocation", return 0);
-
         // (Re)allocated DCT and quantizer data in host memory
         if (coder->data_quantized != NULL) {
-            cudaFreeHost(coder->data_quantized);
+            gpujpeg_device_free_host(coder->data_quantized);
             coder->data_quantized = NULL;
         }
-        cudaMallocHost((void**)&coder->data_quantized, coder->data_size * sizeof(int16_t));
-        gpujpeg_cuda_check_error("Coder quantized data host allocation", return 0);
+        gpujpeg_device_malloc_host((void**)&coder->data_quantized, (coder->data_size + idct_overhead) * sample_size * sizeof(int16_t));
+        gpujpeg_device_check_error("Coder quantized data host allocation", return 0);
 
         // (Re)allocated DCT and quantizer data in device memory
         if (coder->d_data_quantized != NULL) {
-            cudaFree(coder->d_data_quantized);
+            gpujpeg_device_free(coder->d_data_quantized);
             coder->d_data_quantized = NULL;
         }
-        cudaMalloc((void**)&coder->d_data_quantized, (coder->data_size + idct_overhead) * sizeof(int16_t));
-        gpujpeg_cuda_check_error("Coder quantized data device allocation", return 0);
+        gpujpeg_device_malloc((void**)&coder->d_data_quantized, (coder->data_size + idct_overhead) * sample_size * sizeof(int16_t));
+        gpujpeg_device_check_error("Coder quantized data device allocation", return 0);
 
-        coder->data_allocated_size = coder->data_size + idct_overhead;
+        coder->data_allocated_size = (coder->data_size + idct_overhead) * sample_size;
     }
+    // Component planes are counted although they are allocated only when needed
     allocated_gpu_memory_size += coder->data_allocated_size * sizeof(uint8_t);
     allocated_gpu_memory_size += coder->data_allocated_size * sizeof(int16_t);
 
-    // Set data buffer to color components
-    uint8_t* d_comp_data = coder->d_data;
+    // Set data buffer to color components (component planes are set only when allocated)
+    gpujpeg_coder_set_data(coder);
     int16_t* d_comp_data_quantized = coder->d_data_quantized;
     int16_t* comp_data_quantized = coder->data_quantized;
     unsigned int data_quantized_index = 0;
     for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
         struct gpujpeg_component* component = &coder->component[comp];
-        component->d_data = d_comp_data;
         component->d_data_quantized = d_comp_data_quantized;
         component->data_quantized_index = data_quantized_index;
         component->data_quantized = comp_data_quantized;
-        d_comp_data += component->data_width * component->data_height;
         d_comp_data_quantized += component->data_width * component->data_height;
         comp_data_quantized += component->data_width * component->data_height;
         data_quantized_index += component->data_width * component->data_height;
@@ -724,27 +799,27 @@ gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters
 
         // (Re)allocate huffman coder data in host memory
         if (coder->data_compressed != NULL) {
-            cudaFreeHost(coder->data_compressed);
+            gpujpeg_device_free_host(coder->data_compressed);
             coder->data_compressed = NULL;
         }
-        cudaMallocHost((void**)&coder->data_compressed, max_compressed_data_size * sizeof(uint8_t));
-        gpujpeg_cuda_check_error("Coder data compressed host allocation", return 0);
+        gpujpeg_device_malloc_host((void**)&coder->data_compressed, max_compressed_data_size * sizeof(uint8_t));
+        gpujpeg_device_check_error("Coder data compressed host allocation", return 0);
 
         // (Re)allocate huffman coder data in device memory
         if (coder->d_data_compressed != NULL) {
-            cudaFree(coder->d_data_compressed);
+            gpujpeg_device_free(coder->d_data_compressed);
             coder->d_data_compressed = NULL;
         }
-        cudaMalloc((void**)&coder->d_data_compressed, max_compressed_data_size * sizeof(uint8_t));
-        gpujpeg_cuda_check_error("Coder data compressed device allocation", return 0);
+        gpujpeg_device_malloc((void**)&coder->d_data_compressed, max_compressed_data_size * sizeof(uint8_t));
+        gpujpeg_device_check_error("Coder data compressed device allocation", return 0);
 
         // (Re)allocate Huffman coder temporary buffer
         if (coder->d_temp_huffman != NULL) {
-            cudaFree(coder->d_temp_huffman);
+            gpujpeg_device_free(coder->d_temp_huffman);
             coder->d_temp_huffman = NULL;
         }
-        cudaMalloc((void**)&coder->d_temp_huffman, max_compressed_data_size * sizeof(uint8_t));
-        gpujpeg_cuda_check_error("Huffman temp buffer device allocation", return 0);
+        gpujpeg_device_malloc((void**)&coder->d_temp_huffman, max_compressed_data_size * sizeof(uint8_t));
+        gpujpeg_device_check_error("Huffman temp buffer device allocation", return 0);
 
         coder->data_compressed_allocated_size = max_compressed_data_size;
     }
@@ -761,19 +836,19 @@ gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters
 
         // (Re)allocate list of block indices in host memory
         if (coder->block_list != NULL) {
-            cudaFreeHost(coder->block_list);
+            gpujpeg_device_free_host(coder->block_list);
             coder->block_list = NULL;
         }
-        cudaMallocHost((void**)&coder->block_list, coder->block_count * sizeof(*coder->block_list));
-        gpujpeg_cuda_check_error("Coder block list host allocation", return 0);
+        gpujpeg_device_malloc_host((void**)&coder->block_list, coder->block_count * sizeof(*coder->block_list));
+        gpujpeg_device_check_error("Coder block list host allocation", return 0);
 
         // (Re)allocate list of block indices in device memory
         if (coder->d_block_list != NULL) {
-            cudaFree(coder->d_block_list);
+            gpujpeg_device_free(coder->d_block_list);
             coder->d_block_list = NULL;
         }
-        cudaMalloc((void**)&coder->d_block_list, coder->block_count * sizeof(*coder->d_block_list));
-        gpujpeg_cuda_check_error("Coder block list device allocation", return 0);
+        gpujpeg_device_malloc((void**)&coder->d_block_list, coder->block_count * sizeof(*coder->d_block_list));
+        gpujpeg_device_check_error("Coder block list device allocation", return 0);
 
         coder->block_allocated_size = coder->block_count;
     }
@@ -840,90 +915,251 @@ gpujpeg_coder_init_image(struct gpujpeg_coder * coder, struct gpujpeg_parameters
 
     // Copy components to device memory
     if (stream != NULL) {
-        cudaMemcpyAsync(coder->d_component, coder->component, coder->param_image.comp_count * sizeof(struct gpujpeg_component), cudaMemcpyHostToDevice, *stream);
+        gpujpeg_device_memcpy_async(coder->d_component, coder->component, coder->param_image.comp_count * sizeof(struct gpujpeg_component), cudaMemcpyHostToDevice, *stream);
     }
     else {
-        cudaMemcpy(coder->d_component, coder->component, coder->param_image.comp_count * sizeof(struct gpujpeg_component), cudaMemcpyHostToDevice);
+        gpujpeg_device_memcpy(coder->d_component, coder->component, coder->param_image.comp_count * sizeof(struct gpujpeg_component), cudaMemcpyHostToDevice);
     }
-    gpujpeg_cuda_check_error("Coder component copy", return 0);
+    gpujpeg_device_check_error("Coder component copy", return 0);
 
     // Copy block lists to device memory
     if (stream != NULL) {
-        cudaMemcpyAsync(coder->d_block_list, coder->block_list, coder->block_count * sizeof(*coder->d_block_list), cudaMemcpyHostToDevice, *stream);
+        gpujpeg_device_memcpy_async(coder->d_block_list, coder->block_list, coder->block_count * sizeof(*coder->d_block_list), cudaMemcpyHostToDevice, *stream);
     }
     else {
-        cudaMemcpy(coder->d_block_list, coder->block_list, coder->block_count * sizeof(*coder->d_block_list), cudaMemcpyHostToDevice);
+        gpujpeg_device_memcpy(coder->d_block_list, coder->block_list, coder->block_count * sizeof(*coder->d_block_list), cudaMemcpyHostToDevice);
     }
-    gpujpeg_cuda_check_error("Coder block list copy", return 0);
+    gpujpeg_device_check_error("Coder block list copy", return 0);
 
     // Copy segments to device memory
     if (stream) {
-        cudaMemcpyAsync(coder->d_segment, coder->segment, coder->segment_count * sizeof(struct gpujpeg_segment), cudaMemcpyHostToDevice, *stream);
+        gpujpeg_device_memcpy_async(coder->d_segment, coder->segment, coder->segment_count * sizeof(struct gpujpeg_segment), cudaMemcpyHostToDevice, *stream);
     }
     else {
-        cudaMemcpy(coder->d_segment, coder->segment, coder->segment_count * sizeof(struct gpujpeg_segment), cudaMemcpyHostToDevice);
+        gpujpeg_device_memcpy(coder->d_segment, coder->segment, coder->segment_count * sizeof(struct gpujpeg_segment), cudaMemcpyHostToDevice);
     }
-    gpujpeg_cuda_check_error("Coder segment copy", return 0);
+    gpujpeg_device_check_error("Coder segment copy", return 0);
 
     return allocated_gpu_memory_size;
 }
 
+/** Documented at declaration */
+int
+gpujpeg_coder_init_data(struct gpujpeg_coder* coder)
+{
+    // IDCT kernel rounds up the block count, so extra rows are allocated (as for quantized data)
+    int idct_overhead = (GPUJPEG_IDCT_BLOCK_X * GPUJPEG_IDCT_BLOCK_Y * GPUJPEG_IDCT_BLOCK_Z / coder->component[0].data_width + 1)
+      * GPUJPEG_BLOCK_SIZE * coder->component[0].data_width;
+    int sample_size = (coder->param.precision > 8) ? 2 : 1;
+    size_t data_size = (coder->data_size + idct_overhead) * sample_size;
+    if (data_size > coder->d_data_allocated_size) {
+        coder->d_data_allocated_size = 0;
+        if (coder->d_data != NULL) {
+            gpujpeg_device_free(coder->d_data);
+            coder->d_data = NULL;
+        }
+        gpujpeg_device_malloc((void**)&coder->d_data, data_size * sizeof(uint8_t));
+        gpujpeg_device_check_error("Coder data device allocation", return -1);
+        coder->d_data_allocated_size = data_size;
+    }
+    gpujpeg_coder_set_data(coder);
+    return 0;
+}
+
 /** Documented at declaration */
 int
 gpujpeg_coder_deinit(struct gpujpeg_coder* coder)
 {
     if ( coder->data_raw != NULL )
-        cudaFreeHost(coder->data_raw);
+        gpujpeg_device_free_host(coder->data_raw);
     if ( coder->d_data_raw_allocated != NULL )
-        cudaFree(coder->d_data_raw_allocated);
+        gpujpeg_device_free(coder->d_data_raw_allocated);
     if ( coder->d_data != NULL )
-        cudaFree(coder->d_data);
+        gpujpeg_device_free(coder->d_data);
+    if ( coder->d_data_sampling != NULL )
+        gpujpeg_device_free(coder->d_data_sampling);
+    if ( coder->data_sampling != NULL )
+        free(coder->data_sampling);
     if ( coder->data_quantized != NULL )
-        cudaFreeHost(coder->data_quantized);
+        gpujpeg_device_free_host(coder->data_quantized);
     if ( coder->d_data_quantized != NULL )
-        cudaFree(coder->d_data_quantized);
+        gpujpeg_device_free(coder->d_data_quantized);
+    if ( coder->data_sparse_mask != NULL )
+        gpujpeg_device_free_host(coder->data_sparse_mask);
+    if ( coder->d_data_sparse_mask != NULL )
+        gpujpeg_device_free(coder->d_data_sparse_mask);
+    if ( coder->data_sparse_value != NULL )
+        gpujpeg_device_free_host(coder->data_sparse_value);
+    if ( coder->d_data_sparse_value != NULL )
+        gpujpeg_device_free(coder->d_data_sparse_value);
+    if ( coder->d_data_sparse_offset != NULL )
+        gpujpeg_device_free(coder->d_data_sparse_offset);
     if ( coder->data_compressed != NULL )
-        cudaFreeHost(coder->data_compressed);
+        gpujpeg_device_free_host(coder->data_compressed);
     if ( coder->d_data_compressed != NULL )
-        cudaFree(coder->d_data_compressed);
+        gpujpeg_device_free(coder->d_data_compressed);
     if ( coder->segment != NULL )
-        cudaFreeHost(coder->segment);
+        gpujpeg_device_free_host(coder->segment);
     if ( coder->d_segment != NULL )
-        cudaFree(coder->d_segment);
+        gpujpeg_device_free(coder->d_segment);
     if ( coder->d_temp_huffman != NULL )
-        cudaFree(coder->d_temp_huffman);
+        gpujpeg_device_free(coder->d_temp_huffman);
     if ( coder->block_list != NULL )
-        cudaFreeHost(coder->block_list);
+        gpujpeg_device_free_host(coder->block_list);
     if ( coder->d_block_list != NULL )
-        cudaFree(coder->d_block_list);
+        gpujpeg_device_free(coder->d_block_list);
+    if ( coder->component != NULL )
+        gpujpeg_device_free_host(coder->component);
+    if ( coder->d_component != NULL )
+        gpujpeg_device_free(coder->d_component);
+    gpujpeg_stats_deinit(coder);
     return 0;
 }
 
+/** Documented at declaration */
+enum gpujpeg_component_type
+gpujpeg_component_get_type(enum gpujpeg_color_space color_space_internal, int comp)
+{
+    if ( (comp == 1 || comp == 2) && color_space_internal != GPUJPEG_CMYK ) {
+        return GPUJPEG_COMPONENT_CHROMINANCE;
+    }
+    return GPUJPEG_COMPONENT_LUMINANCE;
+}
+
 /** Documented at declaration */
 int
 gpujpeg_image_calculate_size(struct gpujpeg_image_parameters* param)
 {
     switch (param->pixel_format) {
     case GPUJPEG_U8:
-        assert(param->comp_count == 1);
+        // Color image decoded as luminance only has also one sample per pixel
         return param->width * param->height;
     case GPUJPEG_444_U8_P012:
     case GPUJPEG_444_U8_P0P1P2:
         assert(param->comp_count == 3);
         return param->width * param->height * param->comp_count;
-    case GPUJPEG_422_U8_P1020:
-    case GPUJPEG_422_U8_P0P1P2:
+    case GPUJPEG_444_U8_P012X:
+    case GPUJPEG_444_U8_P210X:
         assert(param->comp_count == 3);
+        return param->width * param->height * 4;
+    case GPUJPEG_4444_U8_P0123:
+        assert(param->comp_count == 4);
+        return param->width * param->height * 4;
+    case GPUJPEG_U16:
         return param->width * param->height * 2;
+    case GPUJPEG_444_U16_P012:
+        assert(param->comp_count == 3);
+        return param->width * param->height * 3 * 2;
+    case GPUJPEG_422_U8_P1020:
+    case GPUJPEG_422_U8_P0102:
+    case GPUJPEG_422_U8_P0P1P2:
     case GPUJPEG_420_U8_P0P1P2:
+    case GPUJPEG_420_U8_P0P12:
+    {
+        // Sum of planes (subsampled chroma of odd sized image is rounded up)
         assert(param->comp_count == 3);
-        return ((param->width * param->height) * 3) / 2;
+        int size = 0;
+        int width;
+        int height;
+        for (int plane = 0; gpujpeg_image_get_plane_size(param, plane, &width, &height) == 0; plane++) {
+            size += width * height;
+        }
+        return size;
+    }
     default:
         assert(0);
         return 0;
     }
 }
 
+/** Documented at declaration */
+int
+gpujpeg_image_get_plane_size(const struct gpujpeg_image_parameters* param, int plane, int* width, int* height)
+{
+    int plane_count = 1;
+    *width = param->width;
+    *height = param->height;
+    switch (param->pixel_format) {
+    case GPUJPEG_U8:
+        break;
+    case GPUJPEG_444_U8_P012:
+        *width = param->width * 3;
+        break;
+    case GPUJPEG_444_U8_P012X:
+    case GPUJPEG_444_U8_P210X:
+    case GPUJPEG_4444_U8_P0123:
+        *width = param->width * 4;
+        break;
+    case GPUJPEG_U16:
+        *width = param->width * 2;
+        break;
+    case GPUJPEG_444_U16_P012:
+        *width = param->width * 3 * 2;
+        break;
+    case GPUJPEG_422_U8_P1020:
+    case GPUJPEG_422_U8_P0102:
+        // Rows of odd width image contain whole last pixel pair
+        *width = gpujpeg_div_and_round_up(param->width, 2) * 4;
+        break;
+    case GPUJPEG_444_U8_P0P1P2:
+        plane_count = 3;
+        break;
+    case GPUJPEG_422_U8_P0P1P2:
+        plane_count = 3;
+        if (plane > 0) {
+            *width = gpujpeg_div_and_round_up(param->width, 2);
+        }
+        break;
+    case GPUJPEG_420_U8_P0P1P2:
+        plane_count = 3;
+        if (plane > 0) {
+            *width = gpujpeg_div_and_round_up(param->width, 2);
+            *height = gpujpeg_div_and_round_up(param->height, 2);
+        }
+        break;
+    case GPUJPEG_420_U8_P0P12:
+        plane_count = 2;
+        if (plane > 0) {
+            *width = gpujpeg_div_and_round_up(param->width, 2) * 2;
+            *height = gpujpeg_div_and_round_up(param->height, 2);
+        }
+        break;
+    default:
+        assert(0);
+        return -1;
+    }
+    return (plane >= 0 && plane < plane_count) ? 0 : -1;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_image_planes_init(const struct gpujpeg_image_parameters* param, uint8_t* buffer, struct gpujpeg_image_planes* planes)
+{
+    for (int plane = 0; plane < GPUJPEG_MAX_COMPONENT_COUNT; plane++) {
+        int width;
+        int height;
+        if (gpujpeg_image_get_plane_size(param, plane, &width, &height) != 0) {
+            planes->data[plane] = NULL;
+            planes->pitch[plane] = 0;
+            continue;
+        }
+        if (buffer != NULL) {
+            planes->data[plane] = buffer;
+            planes->pitch[plane] = width;
+            buffer += width * height;
+            continue;
+        }
+        if (planes->pitch[plane] == 0) {
+            planes->pitch[plane] = width;
+        }
+        if (planes->data[plane] == NULL || planes->pitch[plane] < width) {
+            fprintf(stderr, "[GPUJPEG] [Error] Image plane %d is missing or its pitch %d is smaller than row size %d!\n", plane, planes->pitch[plane], width);
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /** Documented at declaration */
 int
 gpujpeg_image_load_from_file(const char* filename, uint8_t** image, int* image_size)
@@ -942,8 +1178,8 @@ gpujpeg_image_load_from_file(const char* filename, uint8_t** image, int* image_s
     }
 
     uint8_t* data = NULL;
-    cudaMallocHost((void**)&data, *image_size * sizeof(uint8_t));
-    gpujpeg_cuda_check_error("Initialize CUDA host buffer", return -1);
+    gpujpeg_device_malloc_host((void**)&data, *image_size * sizeof(uint8_t));
+    gpujpeg_device_check_error("Initialize CUDA host buffer", return -1);
     if ( *image_size != fread(data, sizeof(uint8_t), *image_size, file) ) {
         fprintf(stderr, "[GPUJPEG] [Error] Failed to load image data [%d bytes] from file %s!\n", *image_size, filename);
         return -1;
@@ -979,7 +1215,7 @@ gpujpeg_image_save_to_file(const char* filename, uint8_t* image, int image_size)
 int
 gpujpeg_image_destroy(uint8_t* image)
 {
-    cudaFreeHost(image);
+    gpujpeg_device_free_host(image);
 
     return 0;
 }
@@ -1064,6 +1300,18 @@ gpujpeg_image_convert(const char* input, const char* output, struct gpujpeg_imag
         return;
     }
 
+    // Interleaved 8-bit images are converted on CPU (with the same results as by preprocessor)
+    if ( param_image_from.pixel_format == GPUJPEG_444_U8_P012 && param_image_to.pixel_format == GPUJPEG_444_U8_P012 ) {
+        if ( gpujpeg_color_transform_cpu_interleaved(param_image_from.color_space, param_image_to.color_space,
+                                                     image, param_image_from.width * param_image_from.height) == 0 ) {
+            if ( gpujpeg_image_save_to_file(output, image, image_size) != 0 ) {
+                fprintf(stderr, "[GPUJPEG] [Error] Failed to save image [%s]!\n", output);
+            }
+        }
+        gpujpeg_image_destroy(image);
+        return;
+    }
+
     struct gpujpeg_encoder * encoder = (struct gpujpeg_encoder *) malloc(sizeof(struct gpujpeg_encoder));
     struct gpujpeg_coder * coder = &encoder->coder;
     gpujpeg_set_default_parameters(&coder->param);
@@ -1076,12 +1324,12 @@ gpujpeg_image_convert(const char* input, const char* output, struct gpujpeg_imag
 
     // Create buffers if not already created
     if (coder->data_raw == NULL) {
-        if (cudaSuccess != cudaMallocHost((void**)&coder->data_raw, coder->data_raw_size * sizeof(uint8_t))) {
+        if (cudaSuccess != gpujpeg_device_malloc_host((void**)&coder->data_raw, coder->data_raw_size * sizeof(uint8_t))) {
             return;
         }
     }
     if (coder->d_data_raw_allocated == NULL) {
-        if (cudaSuccess != cudaMalloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size * sizeof(uint8_t))) {
+        if (cudaSuccess != gpujpeg_device_malloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size * sizeof(uint8_t))) {
             return;
         }
     }
@@ -1089,13 +1337,13 @@ gpujpeg_image_convert(const char* input, const char* output, struct gpujpeg_imag
     coder->d_data_raw = coder->d_data_raw_allocated;
 
     // Perform preprocessor
-    assert(cudaMemcpy(coder->d_data_raw, image, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyHostToDevice) == cudaSuccess);
+    assert(gpujpeg_device_memcpy(coder->d_data_raw, image, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyHostToDevice) == cudaSuccess);
     assert(gpujpeg_preprocessor_encode(encoder) == 0);
     // Save preprocessor result
     uint8_t* buffer = NULL;
-    assert(cudaMallocHost((void**)&buffer, coder->data_size * sizeof(uint8_t)) == cudaSuccess);
+    assert(gpujpeg_device_malloc_host((void**)&buffer, coder->data_size * sizeof(uint8_t)) == cudaSuccess);
     assert(buffer != NULL);
-    assert(cudaMemcpy(buffer, coder->d_data, coder->data_size * sizeof(uint8_t), cudaMemcpyDeviceToHost) == cudaSuccess);
+    assert(gpujpeg_device_memcpy(buffer, coder->d_data, coder->data_size * sizeof(uint8_t), cudaMemcpyDeviceToHost) == cudaSuccess);
     // Deinitialize decoder
     gpujpeg_coder_deinit(coder);
 
@@ -1104,10 +1352,10 @@ gpujpeg_image_convert(const char* input, const char* output, struct gpujpeg_imag
     assert(gpujpeg_coder_init(coder) == 0);
     assert(gpujpeg_preprocessor_decoder_init(coder) == 0);
     // Perform postprocessor
-    assert(cudaMemcpy(coder->d_data, buffer, coder->data_size * sizeof(uint8_t), cudaMemcpyHostToDevice) == cudaSuccess);
+    assert(gpujpeg_device_memcpy(coder->d_data, buffer, coder->data_size * sizeof(uint8_t), cudaMemcpyHostToDevice) == cudaSuccess);
     assert(gpujpeg_preprocessor_decode(coder, NULL) == 0);
     // Save preprocessor result
-    assert(cudaMemcpy(coder->data_raw, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToHost) == cudaSuccess);
+    assert(gpujpeg_device_memcpy(coder->data_raw, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToHost) == cudaSuccess);
     if ( gpujpeg_image_save_to_file(output, coder->data_raw, coder->data_raw_size) != 0 ) {
         fprintf(stderr, "[GPUJPEG] [Error] Failed to save image [%s]!\n", output);
         return;
@@ -1267,7 +1515,7 @@ struct gpujpeg_opengl_texture*
 gpujpeg_opengl_texture_register(int texture_id, enum gpujpeg_opengl_texture_type texture_type)
 {
     struct gpujpeg_opengl_texture* texture = NULL;
-    cudaMallocHost((void**)&texture, sizeof(struct gpujpeg_opengl_texture));
+    gpujpeg_device_malloc_host((void**)&texture, sizeof(struct gpujpeg_opengl_texture));
     assert(texture != NULL);
 
     texture->texture_id = texture_id;
@@ -1337,7 +1585,7 @@ gpujpeg_opengl_texture_unregister(struct gpujpeg_opengl_texture* texture)
 #endif
 
     assert(texture != NULL);
-    cudaFreeHost(texture);
+    gpujpeg_device_free_host(texture);
 }
 
 /** Documented at declaration */
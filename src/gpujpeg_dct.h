@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_DCT_H
+#define GPUJPEG_DCT_H
+
+#include <libgpujpeg/gpujpeg_type.h>
+#include <math.h>
+
+/**
+ * DCT functions are usable in both device and host code (DCT kernels, fused
+ * preprocessor kernels and host coders use the same transforms)
+ */
+#ifdef __CUDACC__
+#define GPUJPEG_DCT_FUNC __host__ __device__
+#else
+#define GPUJPEG_DCT_FUNC
+#endif
+
+/**
+ * 1D 8point DCT, with optional level shift (must be premultiplied).
+ * Based on based on Arai, Agui, and Nakajima's DCT algorithm. (Trans. IEICE E-71(11):1095)
+ * Implementation inspired by Independent JPEG Group JPEG implementation, file jfdctflt.c,
+ * but optimized for CUDA (cheap floating point MAD instructions).
+ */
+template <typename T>
+inline GPUJPEG_DCT_FUNC void
+gpujpeg_dct_forward_1d(const T in0, const T in1, const T in2, const T in3, const T in4, const T in5, const T in6, const T in7,
+                       T & out0, T & out1, T & out2, T & out3, T & out4, T & out5, T & out6, T & out7,
+                       const float level_shift_8 = 0.0f)
+{
+    const float diff0 = in0 + in7;
+    const float diff1 = in1 + in6;
+    const float diff2 = in2 + in5;
+    const float diff3 = in3 + in4;
+    const float diff4 = in3 - in4;
+    const float diff5 = in2 - in5;
+    const float diff6 = in1 - in6;
+    const float diff7 = in0 - in7;
+
+    const float even0 = diff0 + diff3;
+    const float even1 = diff1 + diff2;
+    const float even2 = diff1 - diff2;
+    const float even3 = diff0 - diff3;
+
+    const float even_diff = even2 + even3;
+
+    const float odd0 = diff4 + diff5;
+    const float odd1 = diff5 + diff6;
+    const float odd2 = diff6 + diff7;
+
+    const float odd_diff5 = (odd0 - odd2) * 0.382683433f;
+    const float odd_diff4 = 1.306562965f * odd2 + odd_diff5;
+    const float odd_diff3 = diff7 - odd1 * 0.707106781f;
+    const float odd_diff2 = 0.541196100f * odd0 + odd_diff5;
+    const float odd_diff1 = diff7 + odd1 * 0.707106781f;
+
+    out0 = even0 + even1 + level_shift_8;
+    out1 = odd_diff1 + odd_diff4;
+    out2 = even3 + even_diff * 0.707106781f;
+    out3 = odd_diff3 - odd_diff2;
+    out4 = even0 - even1;
+    out5 = odd_diff3 + odd_diff2;
+    out6 = even3 - even_diff * 0.707106781f;
+    out7 = odd_diff1 - odd_diff4;
+}
+
+/**
+ * Performs in-place IDCT of vector of 8 elements (used to access rows 
+ * or columns in a vector).
+ * With a use of a scheme presented in Jie Liang - Approximating the DCT 
+ * with the lifting scheme: systematic design and applications; online:
+ * http://ieeexplore.ieee.org/stamp/stamp.jsp?tp=&arnumber=910943
+ *
+ * @param V8 [IN/OUT] - Pointer to the first element of vector
+ * @return None
+ */
+inline GPUJPEG_DCT_FUNC void
+gpujpeg_idct_inverse_1d(float* V8)
+{
+	//costants which are used more than once
+	const float koeficient[6] = {0.4142135623f, 0.3535533905f, 0.4619397662f, 0.1989123673f, 0.7071067811f, -2.0f};
+	
+	V8[2] *= 0.5411961f;
+	V8[4] *= 0.509795579f;
+	V8[5] *= 0.601344887f;
+	
+	V8[1] = (V8[0] - V8[1]) * koeficient[1];
+	V8[0] = V8[0] * koeficient[4] - V8[1];
+
+	V8[3] = V8[2] * koeficient[1] + V8[3] * koeficient[2];
+	V8[2] = V8[3] * koeficient[0] - V8[2];
+
+	V8[6] = V8[5] * koeficient[2] + V8[6] * koeficient[0];
+	V8[5] = -0.6681786379f * V8[6] + V8[5];
+
+	V8[7] = V8[4] * koeficient[3] + V8[7] * 0.49039264f;
+	V8[4] = V8[7] * koeficient[3] - V8[4];
+
+	//instead of float tmp = V8[1]; V8[1] = V8[2] + V8[1]; V8[2] = tmp - V8[2];
+	//we use this two operations (with a use of a multiply-add instruction)
+	V8[1] = V8[2] + V8[1];
+	V8[2] = koeficient[5] * V8[2] + V8[1];
+
+	V8[4] = V8[5] + V8[4];
+	V8[5] = 2.0f * V8[5] - V8[4];
+
+	V8[7] = V8[6] + V8[7];
+	V8[6] = koeficient[5] * V8[6] + V8[7];
+
+	V8[0] = V8[3] + V8[0];
+	V8[3] = koeficient[5] * V8[3] + V8[0];
+
+	V8[5] = V8[6] * koeficient[0] + V8[5];
+	V8[6] = V8[5] * -koeficient[4] + V8[6];
+	V8[5] = V8[6] * koeficient[0] + V8[5];
+
+	V8[3] = V8[3] + V8[4];
+	V8[4] = koeficient[5] * V8[4] + V8[3];
+
+	V8[2] = V8[2] + V8[5];
+	V8[5] = koeficient[5] * V8[5] + V8[2];
+
+	V8[1] = V8[6] + V8[1];
+	V8[6] = koeficient[5] * V8[6] + V8[1];
+
+	V8[0] = V8[0] + V8[7];
+	V8[7] = koeficient[5] * V8[7] + V8[0];
+}
+
+/**
+ * Convert reconstructed sample to 8-bit sample (level shifted, rounded to nearest
+ * even and saturated in the same way as by gpujpeg_idct_gpu_kernel)
+ *
+ * @param value  Reconstructed sample
+ * @return 8-bit sample
+ */
+inline GPUJPEG_DCT_FUNC uint8_t
+gpujpeg_idct_sample(float value)
+{
+#ifdef __CUDA_ARCH__
+    uint32_t sample;
+    asm("cvt.rni.u8.f32.sat	%0, %1;" : "=r"(sample) : "f"(value + ((float) 128.0)));
+    return sample;
+#else
+    const float sample = rintf(value + 128.0f);
+    return sample < 0.0f ? 0 : (sample > 255.0f ? 255 : (uint8_t)sample);
+#endif
+}
+
+#endif // GPUJPEG_DCT_H
@@ -28,7 +28,15 @@
  */
 
 #include "gpujpeg_dct_cpu.h"
+#include "gpujpeg_dct.h"
+#include "gpujpeg_device.h"
+#include "gpujpeg_colorspace_cpu.h"
+#include "gpujpeg_sampling.h"
+#include "gpujpeg_sampling_cpu.h"
 #include <libgpujpeg/gpujpeg_util.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define W1 2841 // 2048*sqrt(2)*cos(1*pi/16)
 #define W2 2676 // 2048*sqrt(2)*cos(2*pi/16)
@@ -206,6 +214,9 @@ gpujpeg_idct_cpu(struct gpujpeg_decoder* decoder)
 
     // Get coder
     struct gpujpeg_coder* coder = &decoder->coder;
+    if (0 != gpujpeg_coder_init_data(coder)) {
+        return;
+    }
 
     // Perform IDCT and dequantization
     for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
@@ -213,10 +224,10 @@ gpujpeg_idct_cpu(struct gpujpeg_decoder* decoder)
         struct gpujpeg_component* component = &coder->component[comp];
 
         // Determine table type
-        enum gpujpeg_component_type type = (comp == 0) ? GPUJPEG_COMPONENT_LUMINANCE : GPUJPEG_COMPONENT_CHROMINANCE;
+        enum gpujpeg_component_type type = component->type;
 
         // Copy data to host
-        cudaMemcpy(component->data_quantized, component->d_data_quantized, component->data_size * sizeof(uint16_t), cudaMemcpyDeviceToHost);
+        gpujpeg_device_memcpy(component->data_quantized, component->d_data_quantized, component->data_size * sizeof(uint16_t), cudaMemcpyDeviceToHost);
 
         // Perform IDCT on CPU
         int width = component->data_width / GPUJPEG_BLOCK_SIZE;
@@ -233,7 +244,7 @@ gpujpeg_idct_cpu(struct gpujpeg_decoder* decoder)
 
         // Copy results to device
         uint8_t* data = NULL;
-        assert(cudaMallocHost((void**)&data, component->data_size * sizeof(uint8_t)) == cudaSuccess);
+        assert(gpujpeg_device_malloc_host((void**)&data, component->data_size * sizeof(uint8_t)) == cudaSuccess);
         for ( int y = 0; y < height; y++ ) {
             for ( int x = 0; x < width; x++ ) {
                 for ( int c = 0; c < (GPUJPEG_BLOCK_SIZE * GPUJPEG_BLOCK_SIZE); c++ ) {
@@ -249,7 +260,818 @@ gpujpeg_idct_cpu(struct gpujpeg_decoder* decoder)
                 }
             }
         }
-        cudaMemcpy(component->d_data, data, component->data_size * sizeof(uint8_t), cudaMemcpyHostToDevice);
-        cudaFreeHost(data);
+        gpujpeg_device_memcpy(component->d_data, data, component->data_size * sizeof(uint8_t), cudaMemcpyHostToDevice);
+        gpujpeg_device_free_host(data);
+    }
+}
+
+/** Width of raw image tile converted at once by host forward DCT (multiple of 8 * maximum sampling factor ratio) */
+#define GPUJPEG_DCT_CPU_TILE_WIDTH 64
+
+/**
+ * Perform forward DCT and quantization of 8x8 block on CPU, columns are transformed
+ * first (with level shift) and rows then, in the same way as by gpujpeg_dct_gpu_kernel
+ *
+ * @param block  Samples of block
+ * @param table  Quantization table pre-divided with DCT output weights (transposed)
+ * @param output  Quantized coefficients
+ */
+static void
+gpujpeg_dct_cpu_forward_perform(const float* block, const float* table, int16_t* output)
+{
+    // Vertical frequencies of each column are stored in row of transposed block
+    float transposed[64];
+    for ( int x = 0; x < 8; x++ ) {
+        const float* in = block + x;
+        float* out = transposed + x * 8;
+        gpujpeg_dct_forward_1d(in[0 * 8], in[1 * 8], in[2 * 8], in[3 * 8], in[4 * 8], in[5 * 8], in[6 * 8], in[7 * 8],
+                               out[0], out[1], out[2], out[3], out[4], out[5], out[6], out[7],
+                               -1024.0f); // = 8 * -128 ... level shift sum for all 8 coefficients
+    }
+    for ( int v = 0; v < 8; v++ ) {
+        const float* in = transposed + v;
+        float dct[8];
+        gpujpeg_dct_forward_1d(in[0 * 8], in[1 * 8], in[2 * 8], in[3 * 8], in[4 * 8], in[5 * 8], in[6 * 8], in[7 * 8],
+                               dct[0], dct[1], dct[2], dct[3], dct[4], dct[5], dct[6], dct[7]);
+        for ( int u = 0; u < 8; u++ )
+            output[v * 8 + u] = (int16_t)lrintf(dct[u] * table[u * 8 + v]);
+    }
+}
+
+/**
+ * Load part of raw image row to component samples (in the same way as by preprocessor
+ * planes kernels, chroma of subsampled formats is replicated to all pixels it covers)
+ *
+ * @param planes  Raw image planes
+ * @param pixel_format  Pixel format of raw image
+ * @param swap  First two components of packed formats are swapped
+ * @param y  Row index
+ * @param x0  First pixel
+ * @param count  Number of pixels
+ * @param c  Output samples of each component
+ */
+static void
+gpujpeg_dct_cpu_load_row(const struct gpujpeg_image_planes* planes, enum gpujpeg_pixel_format pixel_format, int swap,
+                         int y, int x0, int count, uint8_t* c[GPUJPEG_MAX_COMPONENT_COUNT])
+{
+    const uint8_t* row = planes->data[0] + y * planes->pitch[0];
+    uint8_t* c1 = swap ? c[1] : c[0];
+    uint8_t* c2 = swap ? c[0] : c[1];
+    uint8_t* c3 = c[2];
+    switch ( pixel_format ) {
+    case GPUJPEG_U8:
+        memcpy(c[0], row + x0, count);
+        break;
+    case GPUJPEG_444_U8_P012:
+        for ( int i = 0; i < count; i++ ) {
+            const uint8_t* pixel = row + (x0 + i) * 3;
+            c1[i] = pixel[0];
+            c2[i] = pixel[1];
+            c3[i] = pixel[2];
+        }
+        break;
+    case GPUJPEG_444_U8_P012X:
+    case GPUJPEG_444_U8_P210X:
+    case GPUJPEG_4444_U8_P0123:
+    {
+        const int first = (pixel_format == GPUJPEG_444_U8_P210X) ? 2 : 0;
+        for ( int i = 0; i < count; i++ ) {
+            const uint8_t* pixel = row + (x0 + i) * 4;
+            c1[i] = pixel[first];
+            c2[i] = pixel[1];
+            c3[i] = pixel[2 - first];
+        }
+        // Fourth byte is K component (not color transformed)
+        if ( pixel_format == GPUJPEG_4444_U8_P0123 ) {
+            for ( int i = 0; i < count; i++ )
+                c[3][i] = row[(x0 + i) * 4 + 3];
+        }
+        break;
+    }
+    case GPUJPEG_422_U8_P1020:
+    case GPUJPEG_422_U8_P0102:
+    {
+        // Components are loaded in UYVY order
+        const int luma = (pixel_format == GPUJPEG_422_U8_P1020) ? 1 : 0;
+        const int chroma = 1 - luma;
+        for ( int i = 0; i < count; i++ ) {
+            const int x = x0 + i;
+            const uint8_t* pixel = row + (x & ~1) * 2;
+            c1[i] = pixel[chroma];
+            c2[i] = pixel[luma + (x & 1) * 2];
+            c3[i] = pixel[chroma + 2];
+        }
+        break;
+    }
+    case GPUJPEG_420_U8_P0P12:
+    {
+        const uint8_t* chroma = planes->data[1] + (y >> 1) * planes->pitch[1];
+        memcpy(c[0], row + x0, count);
+        for ( int i = 0; i < count; i++ ) {
+            c[1][i] = chroma[((x0 + i) >> 1) * 2];
+            c[2][i] = chroma[((x0 + i) >> 1) * 2 + 1];
+        }
+        break;
+    }
+    default:
+    {
+        const int shift_x = (pixel_format == GPUJPEG_444_U8_P0P1P2) ? 0 : 1;
+        const int shift_y = (pixel_format == GPUJPEG_420_U8_P0P1P2) ? 1 : 0;
+        const uint8_t* row1 = planes->data[1] + (y >> shift_y) * planes->pitch[1];
+        const uint8_t* row2 = planes->data[2] + (y >> shift_y) * planes->pitch[2];
+        memcpy(c[0], row + x0, count);
+        for ( int i = 0; i < count; i++ ) {
+            c[1][i] = row1[(x0 + i) >> shift_x];
+            c[2][i] = row2[(x0 + i) >> shift_x];
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * Get raw image width and order of packed components, chroma of 4:2:2 packed
+ * formats is converted by pixel pairs so the width is rounded up to even
+ *
+ * @param coder  Coder structure
+ * @param swap  First two components of packed formats are swapped
+ * @return width of processed raw image
+ */
+static int
+gpujpeg_dct_cpu_image_width(struct gpujpeg_coder* coder, int* swap)
+{
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    int image_width = coder->param_image.width;
+    if ( pixel_format == GPUJPEG_422_U8_P1020 || pixel_format == GPUJPEG_422_U8_P0102 ) {
+        image_width = gpujpeg_div_and_round_up(image_width, 2) * 2;
+    }
+    *swap = 0;
+    if ( pixel_format == GPUJPEG_444_U8_P012 || pixel_format == GPUJPEG_444_U8_P012X || pixel_format == GPUJPEG_444_U8_P210X
+            || pixel_format == GPUJPEG_4444_U8_P0123 || pixel_format == GPUJPEG_422_U8_P1020 || pixel_format == GPUJPEG_422_U8_P0102 ) {
+        *swap = gpujpeg_color_order_cpu_swapped(coder->param_image.color_space);
+    }
+    return image_width;
+}
+
+/**
+ * Check whether subsampled components are resampled by sampling filter (in the same
+ * cases as by preprocessor), MCU rows are then encoded from band of component rows
+ * (see gpujpeg_dct_cpu_encode_buffer_size) and decoded to whole component planes in
+ * coder->data_sampling instead of MCU row tiles
+ *
+ * @param coder  Coder structure
+ * @param comp_count  Number of processed components
+ * @return 1 if sampling filter is used, otherwise 0
+ */
+static int
+gpujpeg_dct_cpu_sampling_filtered(struct gpujpeg_coder* coder, int comp_count)
+{
+    if ( coder->sampling_filter == GPUJPEG_SAMPLING_FILTER_NEAREST ) {
+        return 0;
+    }
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        if ( coder->sampling_factor.horizontal != coder->component[comp].sampling_factor.horizontal
+                || coder->sampling_factor.vertical != coder->component[comp].sampling_factor.vertical ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Get component plane in host sampling buffer, planes have the same layout
+ * as component data in coder->d_data
+ *
+ * @param coder  Coder structure
+ * @param comp  Component index
+ * @return component plane
+ */
+static uint8_t*
+gpujpeg_dct_cpu_sampling_plane(struct gpujpeg_coder* coder, int comp)
+{
+    size_t offset = 0;
+    for ( int i = 0; i < comp; i++ ) {
+        offset += (size_t)coder->component[i].data_width * coder->component[i].data_height;
+    }
+    return coder->data_sampling + offset;
+}
+
+/**
+ * Allocate host sampling buffer (on demand) and get full resolution planes of
+ * subsampled components which follow after component planes
+ *
+ * @param coder  Coder structure
+ * @param comp_count  Number of processed components
+ * @param image_width  Full resolution plane width (and pitch)
+ * @param image_height  Full resolution plane height
+ * @param plane  Full resolution plane of each subsampled component, NULL for other components
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_dct_cpu_sampling_init(struct gpujpeg_coder* coder, int comp_count, int image_width, int image_height,
+                              uint8_t* plane[GPUJPEG_MAX_COMPONENT_COUNT])
+{
+    size_t plane_size = (size_t)image_width * image_height;
+    size_t size = 0;
+    for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+        size += (size_t)coder->component[comp].data_width * coder->component[comp].data_height;
+    }
+    size_t component_size = size;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        if ( coder->sampling_factor.horizontal != coder->component[comp].sampling_factor.horizontal
+                || coder->sampling_factor.vertical != coder->component[comp].sampling_factor.vertical ) {
+            size += plane_size;
+        }
+    }
+    if ( size > coder->data_sampling_host_allocated_size ) {
+        free(coder->data_sampling);
+        coder->data_sampling_host_allocated_size = 0;
+        coder->data_sampling = (uint8_t*)malloc(size * sizeof(uint8_t));
+        if ( coder->data_sampling == NULL ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate host sampling buffer!\n");
+            return -1;
+        }
+        coder->data_sampling_host_allocated_size = size;
+    }
+
+    uint8_t* next = coder->data_sampling + component_size;
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ ) {
+        plane[comp] = NULL;
+        if ( comp < comp_count && (coder->sampling_factor.horizontal != coder->component[comp].sampling_factor.horizontal
+                || coder->sampling_factor.vertical != coder->component[comp].sampling_factor.vertical) ) {
+            plane[comp] = next;
+            next += plane_size;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Get number of source rows needed by downsampling filter above and below MCU row
+ * (triangle filter of ratio factor covers factor / 2 rows above and factor - factor / 2
+ * rows below, so one row on both sides for ratios 1 and 2)
+ *
+ * @param coder  Coder structure
+ * @param comp_count  Number of processed components
+ * @return number of rows on each side
+ */
+static int
+gpujpeg_dct_cpu_sampling_halo(struct gpujpeg_coder* coder, int comp_count)
+{
+    int halo = 0;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        int factor_v = coder->sampling_factor.vertical / coder->component[comp].sampling_factor.vertical;
+        if ( (factor_v + 1) / 2 > halo )
+            halo = (factor_v + 1) / 2;
+    }
+    return halo;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_dct_cpu_encode_available(struct gpujpeg_encoder* encoder)
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    int comp_count = coder->param_image.comp_count;
+
+    if ( coder->param.precision > 8 || coder->data_raw_width != 0 || coder->d_data_alpha != NULL ) {
+        return 0;
+    }
+    if ( (comp_count == 1) != (pixel_format == GPUJPEG_U8) || (comp_count == 4) != (pixel_format == GPUJPEG_4444_U8_P0123) ) {
+        return 0;
+    }
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        int factor_h = coder->sampling_factor.horizontal / component->sampling_factor.horizontal;
+        int factor_v = coder->sampling_factor.vertical / component->sampling_factor.vertical;
+        if ( coder->sampling_factor.horizontal % component->sampling_factor.horizontal != 0
+                || coder->sampling_factor.vertical % component->sampling_factor.vertical != 0
+                || factor_h > GPUJPEG_SAMPLING_MAX_FACTOR || factor_v > GPUJPEG_SAMPLING_MAX_FACTOR
+                || GPUJPEG_DCT_CPU_TILE_WIDTH % (GPUJPEG_BLOCK_SIZE * factor_h) != 0 ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_dct_cpu_encode_mcu_row(struct gpujpeg_encoder* encoder, const struct gpujpeg_image_planes* planes, int mcu_row, uint8_t* buffer,
+                               int16_t* output[GPUJPEG_MAX_COMPONENT_COUNT])
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    int comp_count = coder->param_image.comp_count;
+
+    if ( coder->param.precision > 8 || coder->data_raw_width != 0 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Host forward DCT supports only 8-bit images which are not resampled!\n");
+        return -1;
+    }
+    if ( (comp_count == 1) != (pixel_format == GPUJPEG_U8) || (comp_count == 4) != (pixel_format == GPUJPEG_4444_U8_P0123) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Pixel format %d can't be used for image with %d components!\n", pixel_format, comp_count);
+        return -1;
+    }
+
+    // Ratios of maximum and component sampling factors
+    int factor_h[GPUJPEG_MAX_COMPONENT_COUNT];
+    int factor_v[GPUJPEG_MAX_COMPONENT_COUNT];
+    int tile_total_width = 0;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        factor_h[comp] = coder->sampling_factor.horizontal / component->sampling_factor.horizontal;
+        factor_v[comp] = coder->sampling_factor.vertical / component->sampling_factor.vertical;
+        if ( factor_h[comp] > GPUJPEG_SAMPLING_MAX_FACTOR || factor_v[comp] > GPUJPEG_SAMPLING_MAX_FACTOR
+                || GPUJPEG_DCT_CPU_TILE_WIDTH % (GPUJPEG_BLOCK_SIZE * factor_h[comp]) != 0 ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Host forward DCT doesn't support sampling factor %dx%d!\n",
+                component->sampling_factor.horizontal, component->sampling_factor.vertical);
+            return -1;
+        }
+        if ( component->data_width * factor_h[comp] > tile_total_width )
+            tile_total_width = component->data_width * factor_h[comp];
     }
+
+    int image_height = coder->param_image.height;
+    int swap;
+    int image_width = gpujpeg_dct_cpu_image_width(coder, &swap);
+    int row_count = coder->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE;
+    int y0 = mcu_row * row_count;
+
+    if ( gpujpeg_dct_cpu_sampling_filtered(coder, comp_count) ) {
+        if ( buffer == NULL ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Host forward DCT needs buffer for sampling filter!\n");
+            return -1;
+        }
+
+        // Load and color transform rows of MCU row with halo needed by sampling filter (clamped to image)
+        int halo = gpujpeg_dct_cpu_sampling_halo(coder, comp_count);
+        int source_first = (y0 - halo > 0) ? y0 - halo : 0;
+        int source_count = ((y0 + row_count + halo < image_height) ? y0 + row_count + halo : image_height) - source_first;
+        size_t source_size = (size_t)(row_count + 2 * halo) * image_width;
+        uint8_t* source[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+        uint8_t* band = buffer + comp_count * source_size;
+        for ( int comp = 0; comp < comp_count; comp++ ) {
+            source[comp] = buffer + comp * source_size;
+        }
+        for ( int row = 0; row < source_count; row++ ) {
+            uint8_t* c[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+            for ( int comp = 0; comp < comp_count; comp++ ) {
+                c[comp] = source[comp] + (size_t)row * image_width;
+            }
+            gpujpeg_dct_cpu_load_row(planes, pixel_format, swap, source_first + row, 0, image_width, c);
+            if ( comp_count >= 3 && gpujpeg_color_transform_cpu(coder->param_image.color_space, coder->param.color_space_internal, c[0], c[1], c[2], image_width) != 0 )
+                return -1;
+        }
+
+        for ( int comp = 0; comp < comp_count; comp++ ) {
+            // Component rows of MCU row (padding is zero as in component planes zeroed by preprocessor)
+            struct gpujpeg_component* component = &coder->component[comp];
+            int band_first = mcu_row * component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE;
+            int band_count = component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE;
+            memset(band, 0, (size_t)band_count * component->data_width);
+            if ( band_first + band_count > component->height )
+                band_count = component->height - band_first;
+            if ( factor_h[comp] == 1 && factor_v[comp] == 1 ) {
+                // Component height is rounded up to sampling factor, rows beyond image stay zero
+                for ( int row = 0; row < band_count && y0 + row < image_height; row++ ) {
+                    memcpy(band + (size_t)row * component->data_width, source[comp] + (size_t)(y0 + row - source_first) * image_width, image_width);
+                }
+            }
+            else if ( 0 != gpujpeg_sampling_cpu_downsample_rows(coder->sampling_filter, factor_h[comp], factor_v[comp],
+                                                                source[comp], coder->param_image.width, image_height, image_width,
+                                                                source_first, source_count,
+                                                                band, component->width, component->height, component->data_width,
+                                                                band_first, band_count) ) {
+                return -1;
+            }
+
+            // Transform blocks of the component rows
+            const float* table = encoder->table_quantization[component->type].table_forward;
+            int block_count_x = component->data_width / GPUJPEG_BLOCK_SIZE;
+            int block_count_y = component->data_height / GPUJPEG_BLOCK_SIZE;
+            for ( int block_row = 0; block_row < component->sampling_factor.vertical; block_row++ ) {
+                int block_y = mcu_row * component->sampling_factor.vertical + block_row;
+                if ( block_y >= block_count_y )
+                    break;
+                for ( int block_x = 0; block_x < block_count_x; block_x++ ) {
+                    float samples[64];
+                    for ( int i = 0; i < 8; i++ ) {
+                        const uint8_t* row = band + (size_t)(block_row * GPUJPEG_BLOCK_SIZE + i) * component->data_width + block_x * GPUJPEG_BLOCK_SIZE;
+                        for ( int j = 0; j < 8; j++ )
+                            samples[i * 8 + j] = row[j];
+                    }
+                    gpujpeg_dct_cpu_forward_perform(samples, table, output[comp] + (block_row * block_count_x + block_x) * 64);
+                }
+            }
+        }
+        return 0;
+    }
+
+    // Tile of converted samples of each component at full resolution
+    uint8_t tile[GPUJPEG_MAX_COMPONENT_COUNT][GPUJPEG_SAMPLING_MAX_FACTOR * GPUJPEG_BLOCK_SIZE][GPUJPEG_DCT_CPU_TILE_WIDTH];
+    for ( int x0 = 0; x0 < tile_total_width; x0 += GPUJPEG_DCT_CPU_TILE_WIDTH ) {
+        // Load and color transform the tile, samples beyond image are zero (as in component planes zeroed by preprocessor)
+        int count = image_width - x0;
+        if ( count > GPUJPEG_DCT_CPU_TILE_WIDTH )
+            count = GPUJPEG_DCT_CPU_TILE_WIDTH;
+        for ( int row = 0; row < row_count; row++ ) {
+            uint8_t* c[GPUJPEG_MAX_COMPONENT_COUNT] = { tile[0][row], tile[1][row], tile[2][row], tile[3][row] };
+            int loaded = 0;
+            if ( count > 0 && y0 + row < image_height ) {
+                gpujpeg_dct_cpu_load_row(planes, pixel_format, swap, y0 + row, x0, count, c);
+                if ( comp_count >= 3 && gpujpeg_color_transform_cpu(coder->param_image.color_space, coder->param.color_space_internal, c[0], c[1], c[2], count) != 0 )
+                    return -1;
+                loaded = count;
+            }
+            for ( int comp = 0; comp < comp_count; comp++ )
+                memset(c[comp] + loaded, 0, GPUJPEG_DCT_CPU_TILE_WIDTH - loaded);
+        }
+
+        // Transform blocks of all components covered by the tile
+        for ( int comp = 0; comp < comp_count; comp++ ) {
+            struct gpujpeg_component* component = &coder->component[comp];
+            const float* table = encoder->table_quantization[component->type].table_forward;
+            int block_count_x = component->data_width / GPUJPEG_BLOCK_SIZE;
+            int block_count_y = component->data_height / GPUJPEG_BLOCK_SIZE;
+            int tile_block_x = x0 / (GPUJPEG_BLOCK_SIZE * factor_h[comp]);
+            int tile_block_count = GPUJPEG_DCT_CPU_TILE_WIDTH / (GPUJPEG_BLOCK_SIZE * factor_h[comp]);
+            for ( int block_row = 0; block_row < component->sampling_factor.vertical; block_row++ ) {
+                int block_y = mcu_row * component->sampling_factor.vertical + block_row;
+                if ( block_y >= block_count_y )
+                    break;
+                for ( int block = 0; block < tile_block_count && tile_block_x + block < block_count_x; block++ ) {
+                    float samples[64];
+                    for ( int i = 0; i < 8; i++ ) {
+                        const uint8_t* row = tile[comp][(block_row * GPUJPEG_BLOCK_SIZE + i) * factor_v[comp]];
+                        for ( int j = 0; j < 8; j++ )
+                            samples[i * 8 + j] = row[(block * GPUJPEG_BLOCK_SIZE + j) * factor_h[comp]];
+                    }
+                    int16_t* block_output = output[comp] + (block_row * block_count_x + tile_block_x + block) * 64;
+                    gpujpeg_dct_cpu_forward_perform(samples, table, block_output);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/** Documented at declaration */
+size_t
+gpujpeg_dct_cpu_encode_buffer_size(struct gpujpeg_encoder* encoder)
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
+    int comp_count = coder->param_image.comp_count;
+    if ( !gpujpeg_dct_cpu_sampling_filtered(coder, comp_count) ) {
+        return 0;
+    }
+
+    // Full resolution rows of MCU row with halo for each component followed by
+    // component rows of MCU row (reused by components)
+    int swap;
+    int image_width = gpujpeg_dct_cpu_image_width(coder, &swap);
+    int halo = gpujpeg_dct_cpu_sampling_halo(coder, comp_count);
+    size_t size = (size_t)comp_count * (coder->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE + 2 * halo) * image_width;
+    size_t band_size = 0;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        size_t component_size = (size_t)component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE * component->data_width;
+        if ( component_size > band_size )
+            band_size = component_size;
+    }
+    return size + band_size;
+}
+
+/**
+ * Perform dequantization and inverse DCT of 8x8 block on CPU, columns are transformed
+ * first and rows then, in the same way as by gpujpeg_idct_gpu_kernel
+ *
+ * @param block  Quantized coefficients of block
+ * @param table  Quantization table (natural order)
+ * @param output  Output samples
+ * @param output_stride  Output row stride
+ */
+static void
+gpujpeg_idct_cpu_inverse_perform(const int16_t* block, const uint16_t* table, uint8_t* output, int output_stride)
+{
+    // Coefficients of each column and row are reordered for the transform
+    static const int order[8] = { 0, 4, 6, 2, 7, 5, 3, 1 };
+    float columns[8][8];
+    for ( int u = 0; u < 8; u++ ) {
+        float x[8];
+        for ( int i = 0; i < 8; i++ )
+            x[i] = (float)(block[order[i] * 8 + u] * table[order[i] * 8 + u]);
+        gpujpeg_idct_inverse_1d(x);
+        for ( int i = 0; i < 8; i++ )
+            columns[i][u] = x[i];
+    }
+    for ( int y = 0; y < 8; y++ ) {
+        float x[8];
+        for ( int i = 0; i < 8; i++ )
+            x[i] = columns[y][order[i]];
+        gpujpeg_idct_inverse_1d(x);
+        for ( int i = 0; i < 8; i++ )
+            output[y * output_stride + i] = gpujpeg_idct_sample(x[i]);
+    }
+}
+
+/**
+ * Store part of raw image row from component samples (in the same way as by postprocessor
+ * planes kernels, chroma of subsampled formats is taken from the first pixel it covers)
+ *
+ * @param planes  Raw image planes
+ * @param pixel_format  Pixel format of raw image
+ * @param swap  First two components of packed formats are swapped
+ * @param y  Row index
+ * @param x0  First pixel (even)
+ * @param count  Number of pixels
+ * @param c  Samples of each component
+ * @param alpha  Fourth byte of 4-byte pixels without K component
+ */
+static void
+gpujpeg_idct_cpu_store_row(const struct gpujpeg_image_planes* planes, enum gpujpeg_pixel_format pixel_format, int swap,
+                           int y, int x0, int count, uint8_t* c[GPUJPEG_MAX_COMPONENT_COUNT], uint8_t alpha)
+{
+    uint8_t* row = planes->data[0] + y * planes->pitch[0];
+    const uint8_t* c1 = swap ? c[1] : c[0];
+    const uint8_t* c2 = swap ? c[0] : c[1];
+    const uint8_t* c3 = c[2];
+    switch ( pixel_format ) {
+    case GPUJPEG_U8:
+        memcpy(row + x0, c[0], count);
+        break;
+    case GPUJPEG_444_U8_P012:
+        for ( int i = 0; i < count; i++ ) {
+            uint8_t* pixel = row + (x0 + i) * 3;
+            pixel[0] = c1[i];
+            pixel[1] = c2[i];
+            pixel[2] = c3[i];
+        }
+        break;
+    case GPUJPEG_444_U8_P012X:
+    case GPUJPEG_444_U8_P210X:
+    case GPUJPEG_4444_U8_P0123:
+    {
+        const int first = (pixel_format == GPUJPEG_444_U8_P210X) ? 2 : 0;
+        for ( int i = 0; i < count; i++ ) {
+            uint8_t* pixel = row + (x0 + i) * 4;
+            pixel[first] = c1[i];
+            pixel[1] = c2[i];
+            pixel[2 - first] = c3[i];
+            // Fourth byte is K component (not color transformed) or alpha
+            pixel[3] = (pixel_format == GPUJPEG_4444_U8_P0123) ? c[3][i] : alpha;
+        }
+        break;
+    }
+    case GPUJPEG_422_U8_P1020:
+    case GPUJPEG_422_U8_P0102:
+    {
+        // First component of even pixel and third component of odd pixel are stored as chroma
+        const int luma = (pixel_format == GPUJPEG_422_U8_P1020) ? 1 : 0;
+        const int chroma = 1 - luma;
+        for ( int i = 0; i < count; i++ ) {
+            const int x = x0 + i;
+            uint8_t* pixel = row + x * 2;
+            pixel[chroma] = (x % 2 == 0) ? c1[i] : c3[i];
+            pixel[luma] = c2[i];
+        }
+        break;
+    }
+    case GPUJPEG_420_U8_P0P12:
+        memcpy(row + x0, c[0], count);
+        if ( (y & 1) == 0 ) {
+            uint8_t* chroma = planes->data[1] + (y >> 1) * planes->pitch[1];
+            for ( int i = 0; i < count; i += 2 ) {
+                chroma[x0 + i] = c[1][i];
+                chroma[x0 + i + 1] = c[2][i];
+            }
+        }
+        break;
+    default:
+    {
+        const int shift_x = (pixel_format == GPUJPEG_444_U8_P0P1P2) ? 0 : 1;
+        const int shift_y = (pixel_format == GPUJPEG_420_U8_P0P1P2) ? 1 : 0;
+        memcpy(row + x0, c[0], count);
+        if ( (y & shift_y) == 0 ) {
+            uint8_t* row1 = planes->data[1] + (y >> shift_y) * planes->pitch[1];
+            uint8_t* row2 = planes->data[2] + (y >> shift_y) * planes->pitch[2];
+            for ( int i = 0; i < count; i += (1 << shift_x) ) {
+                row1[(x0 + i) >> shift_x] = c[1][i];
+                row2[(x0 + i) >> shift_x] = c[2][i];
+            }
+        }
+        break;
+    }
+    }
+}
+
+/** Documented at declaration */
+int
+gpujpeg_idct_cpu_decode_available(struct gpujpeg_decoder* decoder)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+
+    if ( coder->param.precision > 8 || coder->data_raw_width != 0 || coder->data_scale != 1 ) {
+        return 0;
+    }
+    if ( (comp_count == 1) != (pixel_format == GPUJPEG_U8) || (comp_count == 4) != (pixel_format == GPUJPEG_4444_U8_P0123) ) {
+        return 0;
+    }
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        int factor_h = coder->sampling_factor.horizontal / component->sampling_factor.horizontal;
+        int factor_v = coder->sampling_factor.vertical / component->sampling_factor.vertical;
+        if ( coder->sampling_factor.horizontal % component->sampling_factor.horizontal != 0
+                || coder->sampling_factor.vertical % component->sampling_factor.vertical != 0
+                || factor_h > GPUJPEG_SAMPLING_MAX_FACTOR || factor_v > GPUJPEG_SAMPLING_MAX_FACTOR
+                || GPUJPEG_DCT_CPU_TILE_WIDTH % (GPUJPEG_BLOCK_SIZE * factor_h) != 0 ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_idct_cpu_decode_prepare(struct gpujpeg_decoder* decoder)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+    int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+    if ( !gpujpeg_dct_cpu_sampling_filtered(coder, comp_count) ) {
+        return 0;
+    }
+    int swap;
+    uint8_t* full[GPUJPEG_MAX_COMPONENT_COUNT];
+    return gpujpeg_dct_cpu_sampling_init(coder, comp_count, gpujpeg_dct_cpu_image_width(coder, &swap), coder->param_image.height, full);
+}
+
+/** Documented at declaration */
+int
+gpujpeg_idct_cpu_decode_finish(struct gpujpeg_decoder* decoder, const struct gpujpeg_image_planes* planes)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+    int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+    if ( !gpujpeg_dct_cpu_sampling_filtered(coder, comp_count) ) {
+        return 0;
+    }
+
+    int image_height = coder->param_image.height;
+    int swap;
+    int image_width = gpujpeg_dct_cpu_image_width(coder, &swap);
+    uint8_t* full[GPUJPEG_MAX_COMPONENT_COUNT];
+    if ( 0 != gpujpeg_dct_cpu_sampling_init(coder, comp_count, image_width, image_height, full) ) {
+        return -1;
+    }
+
+    // Upsample by sampling filter in the same way as by postprocessor
+    uint8_t* plane[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        plane[comp] = gpujpeg_dct_cpu_sampling_plane(coder, comp);
+        if ( full[comp] == NULL ) {
+            continue;
+        }
+        int factor_h = coder->sampling_factor.horizontal / component->sampling_factor.horizontal;
+        int factor_v = coder->sampling_factor.vertical / component->sampling_factor.vertical;
+        if ( 0 != gpujpeg_sampling_cpu_upsample(coder->sampling_filter, factor_h, factor_v,
+                                                plane[comp], component->width, component->height, component->data_width,
+                                                full[comp], image_width, image_height, image_width) ) {
+            return -1;
+        }
+    }
+
+    // Color transform (in place, each row is used once) and store whole image
+    for ( int y = 0; y < image_height; y++ ) {
+        uint8_t* c[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+        for ( int comp = 0; comp < comp_count; comp++ ) {
+            c[comp] = (full[comp] != NULL) ? full[comp] + (size_t)y * image_width : plane[comp] + (size_t)y * coder->component[comp].data_width;
+        }
+        if ( comp_count >= 3 && gpujpeg_color_transform_cpu(coder->param.color_space_internal, coder->param_image.color_space, c[0], c[1], c[2], image_width) != 0 )
+            return -1;
+        gpujpeg_idct_cpu_store_row(planes, coder->param_image.pixel_format, swap, y, 0, image_width, c, coder->data_raw_alpha);
+    }
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_idct_cpu_decode_mcu_row(struct gpujpeg_decoder* decoder, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT], int mcu_row, const struct gpujpeg_image_planes* planes)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    // Only luminance component is output when chroma was not decoded
+    int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+
+    if ( coder->param.precision > 8 || coder->data_raw_width != 0 || coder->data_scale != 1 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Host inverse DCT supports only 8-bit images which are not resampled!\n");
+        return -1;
+    }
+    if ( (comp_count == 1) != (pixel_format == GPUJPEG_U8) || (comp_count == 4) != (pixel_format == GPUJPEG_4444_U8_P0123) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Pixel format %d can't be used for image with %d components!\n", pixel_format, comp_count);
+        return -1;
+    }
+
+    // Ratios of maximum and component sampling factors
+    int factor_h[GPUJPEG_MAX_COMPONENT_COUNT];
+    int factor_v[GPUJPEG_MAX_COMPONENT_COUNT];
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        factor_h[comp] = coder->sampling_factor.horizontal / component->sampling_factor.horizontal;
+        factor_v[comp] = coder->sampling_factor.vertical / component->sampling_factor.vertical;
+        if ( factor_h[comp] > GPUJPEG_SAMPLING_MAX_FACTOR || factor_v[comp] > GPUJPEG_SAMPLING_MAX_FACTOR
+                || GPUJPEG_DCT_CPU_TILE_WIDTH % (GPUJPEG_BLOCK_SIZE * factor_h[comp]) != 0 ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Host inverse DCT doesn't support sampling factor %dx%d!\n",
+                component->sampling_factor.horizontal, component->sampling_factor.vertical);
+            return -1;
+        }
+    }
+
+    if ( gpujpeg_dct_cpu_sampling_filtered(coder, comp_count) ) {
+        // Blocks are transformed to component planes which are upsampled by gpujpeg_idct_cpu_decode_finish
+        for ( int comp = 0; comp < comp_count; comp++ ) {
+            struct gpujpeg_component* component = &coder->component[comp];
+            const uint16_t* table = decoder->table_quantization[component->type].table;
+            uint8_t* plane = gpujpeg_dct_cpu_sampling_plane(coder, comp);
+            int block_count_x = component->data_width / GPUJPEG_BLOCK_SIZE;
+            int block_count_y = component->data_height / GPUJPEG_BLOCK_SIZE;
+            for ( int block_row = 0; block_row < component->sampling_factor.vertical; block_row++ ) {
+                int block_y = mcu_row * component->sampling_factor.vertical + block_row;
+                if ( block_y >= block_count_y )
+                    break;
+                for ( int block_x = 0; block_x < block_count_x; block_x++ ) {
+                    const int16_t* block_input = coefficients[comp] + (block_row * block_count_x + block_x) * 64;
+                    uint8_t* block_output = plane + (size_t)block_y * GPUJPEG_BLOCK_SIZE * component->data_width + block_x * GPUJPEG_BLOCK_SIZE;
+                    gpujpeg_idct_cpu_inverse_perform(block_input, table, block_output, component->data_width);
+                }
+            }
+        }
+        return 0;
+    }
+
+    int image_height = coder->param_image.height;
+    int swap;
+    int image_width = gpujpeg_dct_cpu_image_width(coder, &swap);
+
+    // Tile of reconstructed samples of each component (at component resolution) and
+    // of one raw image row of components upsampled to full resolution
+    uint8_t tile[GPUJPEG_MAX_COMPONENT_COUNT][GPUJPEG_SAMPLING_MAX_FACTOR * GPUJPEG_BLOCK_SIZE][GPUJPEG_DCT_CPU_TILE_WIDTH];
+    uint8_t row_samples[GPUJPEG_MAX_COMPONENT_COUNT][GPUJPEG_DCT_CPU_TILE_WIDTH];
+    int row_count = coder->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE;
+    int y0 = mcu_row * row_count;
+    if ( y0 + row_count > image_height )
+        row_count = image_height - y0;
+    for ( int x0 = 0; x0 < image_width; x0 += GPUJPEG_DCT_CPU_TILE_WIDTH ) {
+        // Transform blocks of all components covering the tile
+        for ( int comp = 0; comp < comp_count; comp++ ) {
+            struct gpujpeg_component* component = &coder->component[comp];
+            const uint16_t* table = decoder->table_quantization[component->type].table;
+            int block_count_x = component->data_width / GPUJPEG_BLOCK_SIZE;
+            int block_count_y = component->data_height / GPUJPEG_BLOCK_SIZE;
+            int tile_block_x = x0 / (GPUJPEG_BLOCK_SIZE * factor_h[comp]);
+            int tile_block_count = GPUJPEG_DCT_CPU_TILE_WIDTH / (GPUJPEG_BLOCK_SIZE * factor_h[comp]);
+            for ( int block_row = 0; block_row < component->sampling_factor.vertical; block_row++ ) {
+                int block_y = mcu_row * component->sampling_factor.vertical + block_row;
+                if ( block_y >= block_count_y )
+                    break;
+                for ( int block = 0; block < tile_block_count && tile_block_x + block < block_count_x; block++ ) {
+                    const int16_t* block_input = coefficients[comp] + (block_row * block_count_x + tile_block_x + block) * 64;
+                    gpujpeg_idct_cpu_inverse_perform(block_input, table, &tile[comp][block_row * GPUJPEG_BLOCK_SIZE][block * GPUJPEG_BLOCK_SIZE],
+                                                     GPUJPEG_DCT_CPU_TILE_WIDTH);
+                }
+            }
+        }
+
+        // Upsample (nearest), color transform and store rows of the tile
+        int count = image_width - x0;
+        if ( count > GPUJPEG_DCT_CPU_TILE_WIDTH )
+            count = GPUJPEG_DCT_CPU_TILE_WIDTH;
+        for ( int row = 0; row < row_count; row++ ) {
+            uint8_t* c[GPUJPEG_MAX_COMPONENT_COUNT] = { row_samples[0], row_samples[1], row_samples[2], row_samples[3] };
+            for ( int comp = 0; comp < comp_count; comp++ ) {
+                const uint8_t* source = tile[comp][row / factor_v[comp]];
+                if ( factor_h[comp] == 1 ) {
+                    c[comp] = (uint8_t*)source;
+                } else {
+                    for ( int i = 0; i < count; i++ )
+                        c[comp][i] = source[i / factor_h[comp]];
+                }
+            }
+            if ( comp_count >= 3 ) {
+                // Rows of the tile are converted in place only when they are not reused by other rows
+                for ( int comp = 0; comp < 3; comp++ ) {
+                    if ( c[comp] != row_samples[comp] && factor_v[comp] != 1 ) {
+                        memcpy(row_samples[comp], c[comp], count);
+                        c[comp] = row_samples[comp];
+                    }
+                }
+                if ( gpujpeg_color_transform_cpu(coder->param.color_space_internal, coder->param_image.color_space, c[0], c[1], c[2], count) != 0 )
+                    return -1;
+            }
+            gpujpeg_idct_cpu_store_row(planes, pixel_format, swap, y0 + row, x0, count, c, coder->data_raw_alpha);
+        }
+    }
+
+    return 0;
 }
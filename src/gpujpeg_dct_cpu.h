@@ -41,4 +41,98 @@
 void
 gpujpeg_idct_cpu(struct gpujpeg_decoder* decoder);
 
+/**
+ * Check whether image can be encoded by gpujpeg_dct_cpu_encode_mcu_row (8-bit
+ * image which is not resampled and pixel format matches component count)
+ *
+ * @param encoder  Encoder structure (coder is initialized for the image)
+ * @return 1 if host encoding is available, otherwise 0
+ */
+int
+gpujpeg_dct_cpu_encode_available(struct gpujpeg_encoder* encoder);
+
+/**
+ * Get size of buffer needed by gpujpeg_dct_cpu_encode_mcu_row when subsampled
+ * components are downsampled by other than nearest filter (which needs rows of
+ * neighbouring MCU rows), each thread needs its own buffer
+ *
+ * @param encoder  Encoder structure (coder is initialized for the image)
+ * @return buffer size in bytes, 0 when no buffer is needed
+ */
+size_t
+gpujpeg_dct_cpu_encode_buffer_size(struct gpujpeg_encoder* encoder);
+
+/**
+ * Perform color transformation, (nearest) sampling, forward DCT and quantization
+ * of one MCU row of 8-bit raw image on CPU. Raw image is converted by small tiles
+ * which stay in cache and blocks are transformed from them directly, so component
+ * planes are never materialized. Coefficients are computed in the same way as by
+ * gpujpeg_preprocessor_encode_dct (samples beyond image are zero). When sampling
+ * filter is used, rows of the MCU row and a halo of neighbouring rows are color
+ * transformed to buffer and component rows of the MCU row are downsampled from them
+ * in the same way as by preprocessor instead.
+ *
+ * @param encoder  Encoder structure (coder is initialized for the image)
+ * @param planes  Raw image planes in host memory
+ * @param mcu_row  Index of MCU row (strip of coder->sampling_factor.vertical * 8 pixel rows)
+ * @param buffer  Buffer of gpujpeg_dct_cpu_encode_buffer_size bytes (NULL when it is 0)
+ * @param output  Quantized coefficients of each component, blocks of the MCU row
+ *                are stored in the same layout as in component->data_quantized
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_dct_cpu_encode_mcu_row(struct gpujpeg_encoder* encoder, const struct gpujpeg_image_planes* planes, int mcu_row, uint8_t* buffer,
+                               int16_t* output[GPUJPEG_MAX_COMPONENT_COUNT]);
+
+/**
+ * Check whether image can be decoded by gpujpeg_idct_cpu_decode_mcu_row (8-bit
+ * image which is not resized or downscaled and pixel format matches component count)
+ *
+ * @param decoder  Decoder structure (coder is initialized for the image)
+ * @return 1 if host decoding is available, otherwise 0
+ */
+int
+gpujpeg_idct_cpu_decode_available(struct gpujpeg_decoder* decoder);
+
+/**
+ * Prepare host sampling buffer for gpujpeg_idct_cpu_decode_mcu_row when subsampled
+ * components are upsampled by other than nearest filter (must be called before
+ * MCU rows are decoded, nothing is done otherwise)
+ *
+ * @param decoder  Decoder structure (coder is initialized for the image)
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_idct_cpu_decode_prepare(struct gpujpeg_decoder* decoder);
+
+/**
+ * Perform dequantization, inverse DCT, (nearest) upsampling and color transformation
+ * of one MCU row of 8-bit image on CPU. Blocks are transformed into small tiles
+ * which stay in cache and raw image pixels are stored from them directly, so component
+ * planes are never materialized. Samples are computed in the same way as by
+ * gpujpeg_preprocessor_decode_idct. When sampling filter is used, blocks are only
+ * transformed to component planes and gpujpeg_idct_cpu_decode_finish stores the image.
+ *
+ * @param decoder  Decoder structure (coder is initialized for the image)
+ * @param coefficients  Quantized coefficients of each component, blocks of the MCU row
+ *                      are stored in the same layout as in component->data_quantized
+ * @param mcu_row  Index of MCU row (strip of coder->sampling_factor.vertical * 8 pixel rows)
+ * @param planes  Raw image planes in host memory
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_idct_cpu_decode_mcu_row(struct gpujpeg_decoder* decoder, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT], int mcu_row, const struct gpujpeg_image_planes* planes);
+
+/**
+ * Upsample component planes decoded by gpujpeg_idct_cpu_decode_mcu_row by sampling
+ * filter, color transform and store whole image in the same way as by postprocessor
+ * (must be called after all MCU rows are decoded, nothing is done without sampling filter)
+ *
+ * @param decoder  Decoder structure (coder is initialized for the image)
+ * @param planes  Raw image planes in host memory
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_idct_cpu_decode_finish(struct gpujpeg_decoder* decoder, const struct gpujpeg_image_planes* planes);
+
 #endif // GPUJPEG_DCT_CPU_H
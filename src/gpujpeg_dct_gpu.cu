@@ -28,6 +28,7 @@
  */
 
 #include "gpujpeg_dct_gpu.h"
+#include "gpujpeg_dct.h"
 #include <libgpujpeg/gpujpeg_util.h>
 
 /*
@@ -111,54 +112,6 @@ unfixo(int x)
     return (x + 0x1000) >> 13;
 }
 
-/**
- * 1D 8point DCT, with optional level shift (must be premultiplied).
- * Based on based on Arai, Agui, and Nakajima's DCT algorithm. (Trans. IEICE E-71(11):1095)
- * Implementation inspired by Independent JPEG Group JPEG implementation, file jfdctflt.c,
- * but optimized for CUDA (cheap floating point MAD instructions).
- */
-template <typename T>
-__device__ static inline void
-gpujpeg_dct_gpu(const T in0, const T in1, const T in2, const T in3, const T in4, const T in5, const T in6, const T in7,
-                T & out0, T & out1, T & out2, T & out3, T & out4, T & out5, T & out6, T & out7,
-                const float level_shift_8 = 0.0f)
-{
-    const float diff0 = in0 + in7;
-    const float diff1 = in1 + in6;
-    const float diff2 = in2 + in5;
-    const float diff3 = in3 + in4;
-    const float diff4 = in3 - in4;
-    const float diff5 = in2 - in5;
-    const float diff6 = in1 - in6;
-    const float diff7 = in0 - in7;
-
-    const float even0 = diff0 + diff3;
-    const float even1 = diff1 + diff2;
-    const float even2 = diff1 - diff2;
-    const float even3 = diff0 - diff3;
-
-    const float even_diff = even2 + even3;
-
-    const float odd0 = diff4 + diff5;
-    const float odd1 = diff5 + diff6;
-    const float odd2 = diff6 + diff7;
-
-    const float odd_diff5 = (odd0 - odd2) * 0.382683433f;
-    const float odd_diff4 = 1.306562965f * odd2 + odd_diff5;
-    const float odd_diff3 = diff7 - odd1 * 0.707106781f;
-    const float odd_diff2 = 0.541196100f * odd0 + odd_diff5;
-    const float odd_diff1 = diff7 + odd1 * 0.707106781f;
-
-    out0 = even0 + even1 + level_shift_8;
-    out1 = odd_diff1 + odd_diff4;
-    out2 = even3 + even_diff * 0.707106781f;
-    out3 = odd_diff3 - odd_diff2;
-    out4 = even0 - even1;
-    out5 = odd_diff3 + odd_diff2;
-    out6 = even3 - even_diff * 0.707106781f;
-    out7 = odd_diff1 - odd_diff4;
-}
-
 /** Constant memory copy of transposed quantization table pre-divided with DCT output weights. */
 __constant__ float gpujpeg_dct_gpu_quantization_table_const[64];
 
@@ -174,11 +127,12 @@ __constant__ float gpujpeg_dct_gpu_quantization_table_const[64];
  * @param output        [OUT] - Source coefficients
  * @param output_stride [OUT] - Stride of source
  * @param quant_table   [IN]  - Quantization table, pre-divided with DCT output scales
+ * @tparam sample_t            - Type of source samples (uint8_t for 8-bit, uint16_t for 12-bit precision)
  * @return None
  */
-template <int WARP_COUNT>
+template <int WARP_COUNT, typename sample_t>
 __global__ void
-gpujpeg_dct_gpu_kernel(int block_count_x, int block_count_y, uint8_t* source, const unsigned int source_stride,
+gpujpeg_dct_gpu_kernel(int block_count_x, int block_count_y, const sample_t* source, const unsigned int source_stride,
                        int16_t* output, int output_stride, const float * const quant_table)
 {
     // each warp processes 4 8x8 blocks (horizontally neighboring)
@@ -224,7 +178,7 @@ gpujpeg_dct_gpu_kernel(int block_count_x, int block_count_y, uint8_t* source, co
     const int in_x = (block_offset_x + block_idx_x) * 8 + dct_idx;
     const int in_y = (block_offset_y + block_idx_y) * 8;
     const int in_offset = in_x + in_y * source_stride;
-    const uint8_t * in = source + in_offset;
+    const sample_t * in = source + in_offset;
 
     // load all 8 coefficients of thread's column, but do NOT apply level shift now - will be applied as part of DCT
     dct_t src0 = *in;
@@ -247,7 +201,7 @@ gpujpeg_dct_gpu_kernel(int block_count_x, int block_count_y, uint8_t* source, co
     dct_t * const s_dest = s_transposition + dct_idx;
 
     // transform the column (vertically) and save it into the transpose buffer
-    gpujpeg_dct_gpu(src0, src1, src2, src3, src4, src5, src6, src7,
+    gpujpeg_dct_forward_1d(src0, src1, src2, src3, src4, src5, src6, src7,
                     s_dest[SHARED_STRIDE * 0],
                     s_dest[SHARED_STRIDE * 1],
                     s_dest[SHARED_STRIDE * 2],
@@ -256,14 +210,14 @@ gpujpeg_dct_gpu_kernel(int block_count_x, int block_count_y, uint8_t* source, co
                     s_dest[SHARED_STRIDE * 5],
                     s_dest[SHARED_STRIDE * 6],
                     s_dest[SHARED_STRIDE * 7],
-                    -1024.0f  // = 8 * -128 ... level shift sum for all 8 coefficients
+                    sizeof(sample_t) == 1 ? -1024.0f : -16384.0f  // = 8 * -128 (or 8 * -2048 for 12 bits) ... level shift sum for all 8 coefficients
     );
 
     // read coefficients back - each thread reads one row (no need to sync - only threads within same warp work on each block)
     // ... and transform the row horizontally
     volatile dct_t * s_src = s_transposition + SHARED_STRIDE * dct_idx;
     dct_t dct0, dct1, dct2, dct3, dct4, dct5, dct6, dct7;
-    gpujpeg_dct_gpu(s_src[0], s_src[1], s_src[2], s_src[3], s_src[4], s_src[5], s_src[6], s_src[7],
+    gpujpeg_dct_forward_1d(s_src[0], s_src[1], s_src[2], s_src[3], s_src[4], s_src[5], s_src[6], s_src[7],
                     dct0, dct1, dct2, dct3, dct4, dct5, dct6, dct7);
 
     // apply quantization to the row of coefficients (quantization table is actually transposed in global memory for coalesced memory acceses)
@@ -296,71 +250,7 @@ gpujpeg_dct_gpu_kernel(int block_count_x, int block_count_y, uint8_t* source, co
 //TODO zmenit na float
 __constant__ uint16_t gpujpeg_idct_gpu_quantization_table[64];
 
-#if !GPUJPEG_IDCT_USE_ASM
-
-/**
- * Performs in-place IDCT of vector of 8 elements (used to access rows 
- * or columns in a vector).
- * With a use of a scheme presented in Jie Liang - Approximating the DCT 
- * with the lifting scheme: systematic design and applications; online:
- * http://ieeexplore.ieee.org/stamp/stamp.jsp?tp=&arnumber=910943
- *
- * @param V8 [IN/OUT] - Pointer to the first element of vector
- * @return None
- */
-__device__ void
-gpujpeg_idct_gpu_kernel_inplace(float* V8)
-{
-	//costants which are used more than once
-	const float koeficient[6] = {0.4142135623f, 0.3535533905f, 0.4619397662f, 0.1989123673f, 0.7071067811f, -2.0f};
-	
-	V8[2] *= 0.5411961f;
-	V8[4] *= 0.509795579f;
-	V8[5] *= 0.601344887f;
-	
-	V8[1] = (V8[0] - V8[1]) * koeficient[1];
-	V8[0] = V8[0] * koeficient[4] - V8[1];
-
-	V8[3] = V8[2] * koeficient[1] + V8[3] * koeficient[2];
-	V8[2] = V8[3] * koeficient[0] - V8[2];
-
-	V8[6] = V8[5] * koeficient[2] + V8[6] * koeficient[0];
-	V8[5] = -0.6681786379f * V8[6] + V8[5];
-
-	V8[7] = V8[4] * koeficient[3] + V8[7] * 0.49039264f;
-	V8[4] = V8[7] * koeficient[3] - V8[4];
-
-	//instead of float tmp = V8[1]; V8[1] = V8[2] + V8[1]; V8[2] = tmp - V8[2];
-	//we use this two operations (with a use of a multiply-add instruction)
-	V8[1] = V8[2] + V8[1];
-	V8[2] = koeficient[5] * V8[2] + V8[1];
-
-	V8[4] = V8[5] + V8[4];
-	V8[5] = 2.0f * V8[5] - V8[4];
-
-	V8[7] = V8[6] + V8[7];
-	V8[6] = koeficient[5] * V8[6] + V8[7];
-
-	V8[0] = V8[3] + V8[0];
-	V8[3] = koeficient[5] * V8[3] + V8[0];
-
-	V8[5] = V8[6] * koeficient[0] + V8[5];
-	V8[6] = V8[5] * -koeficient[4] + V8[6];
-	V8[5] = V8[6] * koeficient[0] + V8[5];
-
-	V8[3] = V8[3] + V8[4];
-	V8[4] = koeficient[5] * V8[4] + V8[3];
-
-	V8[2] = V8[2] + V8[5];
-	V8[5] = koeficient[5] * V8[5] + V8[2];
-
-	V8[1] = V8[6] + V8[1];
-	V8[6] = koeficient[5] * V8[6] + V8[1];
-
-	V8[0] = V8[0] + V8[7];
-	V8[7] = koeficient[5] * V8[7] + V8[0];
-}
-#else
+#if GPUJPEG_IDCT_USE_ASM
 
 #if __CUDA_ARCH__ >= 200
 #define MULTIPLY_ADD "fma.rn.f32	"
@@ -456,6 +346,58 @@ gpujpeg_idct_gpu_kernel_inplace(float* V8)
 
 #endif
 
+/**
+ * Stores one row of 8 reconstructed 8-bit samples (level shifted and saturated)
+ *
+ * @param resultPtr [OUT] - Output row (8 bytes aligned)
+ * @param x         [IN]  - Reconstructed row
+ * @return None
+ */
+__device__ static inline void
+gpujpeg_idct_gpu_store_row(uint8_t* resultPtr, const float* x)
+{
+	//output will be written by 8B (one row) which is the most effective way
+	uint64_t tempResult;
+	uint64_t* tempResultP = &tempResult;
+
+#pragma unroll
+	for (int i = 0; i < 8; i++) {
+		//this would be faster but will work only for 100% quality otherwise some values overflow 255
+		//((uint8_t*) tempResultP)[i] = __float2uint_rz(x[i] + ((float) 128.0));
+
+		//cast float to uint8_t with saturation (.sat) which cuts values higher than 
+		//255 to 255 and smaller than 0 to 0; cuda can't use a reg smaller than 32b 
+		//(though it can convert to 8b for the saturation purposes and save to 32b reg)
+		uint32_t save;
+		asm("cvt.rni.u8.f32.sat	%0, %1;" : "=r"(save) : "f"(x[i] + ((float) 128.0)));
+		((uint8_t*) tempResultP)[i] = save;
+	}
+
+	//writing result - one row of a picture block by a thread
+	*((uint64_t*) resultPtr) = tempResult;
+}
+
+/**
+ * Stores one row of 8 reconstructed 12-bit samples (level shifted and clamped to 0-4095)
+ *
+ * @param resultPtr [OUT] - Output row (16 bytes aligned)
+ * @param x         [IN]  - Reconstructed row
+ * @return None
+ */
+__device__ static inline void
+gpujpeg_idct_gpu_store_row(uint16_t* resultPtr, const float* x)
+{
+	__align__(16) uint16_t tempResult[8];
+
+#pragma unroll
+	for (int i = 0; i < 8; i++) {
+		tempResult[i] = (uint16_t) fminf(fmaxf(rintf(x[i] + 2048.0f), 0.0f), 4095.0f);
+	}
+
+	//writing result - one row of a picture block by a thread (16B)
+	*((uint4*) resultPtr) = *((uint4*) tempResult);
+}
+
 /**
  * Performs 8x8 block-wise Inverse Discrete Cosine Transform of the given
  * image plane and outputs result to the array of coefficients. Float implementation.
@@ -466,10 +408,12 @@ gpujpeg_idct_gpu_kernel_inplace(float* V8)
  * @param output             [OUT] - Result coefficients
  * @param output_stride      [OUT] - Stride of result (image width)
  * @param quantization_table [IN]  - Quantization table
+ * @tparam sample_t                - Type of result samples (uint8_t for 8-bit, uint16_t for 12-bit precision)
  * @return None
  */
+template <typename sample_t>
 __global__ void
-gpujpeg_idct_gpu_kernel(int16_t* source, uint8_t* result, int output_stride, uint16_t* quantization_table)
+gpujpeg_idct_gpu_kernel(int16_t* source, sample_t* result, int output_stride, uint16_t* quantization_table)
 {
 	//here the grid is assumed to be only in x - it saves a few operations; if a larger
 	//block count is used (e. g. GPUJPEG_IDCT_BLOCK_Z == 1), it would need to be adjusted,
@@ -537,7 +481,7 @@ gpujpeg_idct_gpu_kernel(int16_t* source, uint8_t* result, int output_stride, uin
 	x[6] = data[threadIdx.z][threadIdx.x][3][threadIdx.y];
 	x[7] = data[threadIdx.z][threadIdx.x][1][threadIdx.y];
 	
-	gpujpeg_idct_gpu_kernel_inplace(x);
+	gpujpeg_idct_inverse_1d(x);
 
 	data[threadIdx.z][threadIdx.x][0][threadIdx.y] = x[0];
 	data[threadIdx.z][threadIdx.x][1][threadIdx.y] = x[1];
@@ -558,7 +502,7 @@ gpujpeg_idct_gpu_kernel(int16_t* source, uint8_t* result, int output_stride, uin
 	//output block (8B), threads [0 - 7] in threadIdx.x write blocks next to each other,
 	//threads [1 - 7] in threadIdx.y write next rows of a block; threads [0 - 1] in 
 	//threadIdx.z write next 8 blocks
-	uint8_t* resultPtr = ((uint8_t*) result) + firstByteOfActualBlock
+	sample_t* resultPtr = result + firstByteOfActualBlock
 			+ (threadIdx.y + ((firstByteOfActualBlock / output_stride) * 7))
 					* output_stride;
 
@@ -586,28 +530,10 @@ gpujpeg_idct_gpu_kernel(int16_t* source, uint8_t* result, int output_stride, uin
 	x[6] = data[threadIdx.z][threadIdx.x][threadIdx.y][3];
 	x[7] = data[threadIdx.z][threadIdx.x][threadIdx.y][1];
 
-	gpujpeg_idct_gpu_kernel_inplace(x);
+	gpujpeg_idct_inverse_1d(x);
 #endif
 
-	//output will be written by 8B (one row) which is the most effective way
-	uint64_t tempResult;
-	uint64_t* tempResultP = &tempResult;
-
-#pragma unroll
-	for (int i = 0; i < 8; i++) {
-		//this would be faster but will work only for 100% quality otherwise some values overflow 255
-		//((uint8_t*) tempResultP)[i] = __float2uint_rz(x[i] + ((float) 128.0));
-
-		//cast float to uint8_t with saturation (.sat) which cuts values higher than 
-		//255 to 255 and smaller than 0 to 0; cuda can't use a reg smaller than 32b 
-		//(though it can convert to 8b for the saturation purposes and save to 32b reg)
-		uint32_t save;
-		asm("cvt.rni.u8.f32.sat	%0, %1;" : "=r"(save) : "f"(x[i] + ((float) 128.0)));
-		((uint8_t*) tempResultP)[i] = save;
-	}
-
-	//writing result - one row of a picture block by a thread
-	*((uint64_t*) resultPtr) = tempResult;
+	gpujpeg_idct_gpu_store_row(resultPtr, x);
 }
 
 /** Documented at declaration */
@@ -623,7 +549,7 @@ gpujpeg_dct_gpu(struct gpujpeg_encoder* encoder)
         struct gpujpeg_component* component = &coder->component[comp];
 
         // Get quantization table
-        enum gpujpeg_component_type type = (comp == 0) ? GPUJPEG_COMPONENT_LUMINANCE : GPUJPEG_COMPONENT_CHROMINANCE;
+        enum gpujpeg_component_type type = component->type;
         const float* const d_quantization_table = encoder->table_quantization[type].d_table_forward;
 
         // copy the quantization table into constant memory for devices of CC < 2.0
@@ -655,16 +581,126 @@ gpujpeg_dct_gpu(struct gpujpeg_encoder* encoder)
             1
         );
         dim3 dct_block(4 * 8, WARP_COUNT);
-        gpujpeg_dct_gpu_kernel<WARP_COUNT><<<dct_grid, dct_block, 0, *(encoder->stream)>>>(
-            block_count_x,
-            block_count_y,
+        if ( coder->param.precision > 8 ) {
+            gpujpeg_dct_gpu_kernel<WARP_COUNT, uint16_t><<<dct_grid, dct_block, 0, *(encoder->stream)>>>(
+                block_count_x,
+                block_count_y,
+                (const uint16_t*)component->d_data,
+                component->data_width,
+                component->d_data_quantized,
+                component->data_width * GPUJPEG_BLOCK_SIZE,
+                d_quantization_table
+            );
+        } else {
+            gpujpeg_dct_gpu_kernel<WARP_COUNT, uint8_t><<<dct_grid, dct_block, 0, *(encoder->stream)>>>(
+                block_count_x,
+                block_count_y,
+                component->d_data,
+                component->data_width,
+                component->d_data_quantized,
+                component->data_width * GPUJPEG_BLOCK_SIZE,
+                d_quantization_table
+            );
+        }
+        gpujpeg_cuda_check_error("Quantization table memcpy failed", return -1);
+    }
+
+    return 0;
+}
+
+/**
+ * Inverse DCT with reduced output size (downscaling in DCT domain). Each 8x8 block
+ * is reconstructed as N x N block (N = 8 / scale) from its top-left N x N
+ * dequantized coefficients by N-point IDCT, which is equivalent to sampling
+ * the low-pass filtered block in centers of the reduced samples.
+ * One thread computes one output sample.
+ *
+ * @param source             [IN]  - Source coefficients (64 per block, block rows of source_stride * 8)
+ * @param result             [OUT] - Result samples
+ * @param source_stride      [IN]  - Component data width
+ * @param output_stride      [IN]  - Stride of result (component data width / scale)
+ * @param block_count_x      [IN]  - Number of blocks in row
+ * @param block_count        [IN]  - Number of blocks
+ * @param size               [IN]  - Output block size N
+ * @return None
+ */
+__global__ void
+gpujpeg_idct_gpu_kernel_scaled(const int16_t* source, uint8_t* result, int source_stride, int output_stride, int block_count_x, int block_count, int size)
+{
+    const int sample_index = blockIdx.x * blockDim.x + threadIdx.x;
+    const int block_index = sample_index / (size * size);
+    if ( block_index >= block_count )
+        return;
+    const int x = (sample_index % (size * size)) % size;
+    const int y = (sample_index % (size * size)) / size;
+    const int block_x = block_index % block_count_x;
+    const int block_y = block_index / block_count_x;
+
+    const int16_t* block = &source[block_y * source_stride * 8 + block_x * 64];
+    const float pi_2n = 3.14159265f / (2 * size);
+    float sum = 0.0f;
+    for ( int v = 0; v < size; v++ ) {
+        const float cos_v = (v == 0 ? 0.70710678f : 1.0f) * __cosf((2 * y + 1) * v * pi_2n);
+        for ( int u = 0; u < size; u++ ) {
+            const float cos_u = (u == 0 ? 0.70710678f : 1.0f) * __cosf((2 * x + 1) * u * pi_2n);
+            sum += cos_v * cos_u * block[v * 8 + u] * gpujpeg_idct_gpu_quantization_table[v * 8 + u];
+        }
+    }
+    // 2/N normalization of N-point IDCT applied to coefficients of 8-point DCT (scaled by N/8)
+    const float value = sum * 0.25f + 128.0f;
+    result[(block_y * size + y) * output_stride + block_x * size + x] = (uint8_t)fminf(fmaxf(value + 0.5f, 0.0f), 255.0f);
+}
+
+/**
+ * Peform inverse DCT with reduced output size on GPU
+ *
+ * @param decoder
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_idct_gpu_scaled(struct gpujpeg_decoder* decoder)
+{
+    // Get coder
+    struct gpujpeg_coder* coder = &decoder->coder;
+    assert(coder->data_scale == 2 || coder->data_scale == 4 || coder->data_scale == 8);
+    const int size = GPUJPEG_BLOCK_SIZE / coder->data_scale;
+
+    // Chroma components are skipped when only luminance is decoded
+    const int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        // Get component
+        struct gpujpeg_component* component = &coder->component[comp];
+
+        // Determine table type
+        enum gpujpeg_component_type type = component->type;
+
+        int block_count_x = component->data_width / GPUJPEG_BLOCK_SIZE;
+        int block_count_y = component->data_height / GPUJPEG_BLOCK_SIZE;
+
+        // Copy quantization table to constant memory
+        cudaMemcpyToSymbolAsync(
+            gpujpeg_idct_gpu_quantization_table,
+            decoder->table_quantization[type].d_table,
+            64 * sizeof(uint16_t),
+            0,
+            cudaMemcpyDeviceToDevice,
+            *(decoder->stream)
+        );
+        gpujpeg_cuda_check_error("Copy IDCT quantization table to constant memory", return -1);
+
+        const int sample_count = block_count_x * block_count_y * size * size;
+        dim3 dct_block(256);
+        dim3 dct_grid(gpujpeg_div_and_round_up(sample_count, dct_block.x));
+        gpujpeg_idct_gpu_kernel_scaled<<<dct_grid, dct_block, 0, *(decoder->stream)>>>(
+            component->d_data_quantized,
             component->d_data,
             component->data_width,
-            component->d_data_quantized,
-            component->data_width * GPUJPEG_BLOCK_SIZE,
-            d_quantization_table
+            component->data_width / coder->data_scale,
+            block_count_x,
+            block_count_x * block_count_y,
+            size
         );
-        gpujpeg_cuda_check_error("Quantization table memcpy failed", return -1);
+        gpujpeg_cuda_check_error("Scaled inverse DCT failed", return -1);
     }
 
     return 0;
@@ -677,13 +713,19 @@ gpujpeg_idct_gpu(struct gpujpeg_decoder* decoder)
     // Get coder
     struct gpujpeg_coder* coder = &decoder->coder;
 
-    // Encode each component
-    for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+    // Component planes are reconstructed in reduced size
+    if ( coder->data_scale > 1 ) {
+        return gpujpeg_idct_gpu_scaled(decoder);
+    }
+
+    // Decode each component (chroma components are skipped when only luminance is decoded)
+    const int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
         // Get component
         struct gpujpeg_component* component = &coder->component[comp];
 
         // Determine table type
-        enum gpujpeg_component_type type = (comp == 0) ? GPUJPEG_COMPONENT_LUMINANCE : GPUJPEG_COMPONENT_CHROMINANCE;
+        enum gpujpeg_component_type type = component->type;
 
         int roi_width = component->data_width;
         int roi_height = component->data_height;
@@ -710,12 +752,21 @@ gpujpeg_idct_gpu(struct gpujpeg_decoder* decoder)
 				(GPUJPEG_IDCT_BLOCK_X * GPUJPEG_IDCT_BLOCK_Y * GPUJPEG_IDCT_BLOCK_Z) / GPUJPEG_BLOCK_SIZE), 1);
         dim3 dct_block(GPUJPEG_IDCT_BLOCK_X, GPUJPEG_IDCT_BLOCK_Y, GPUJPEG_IDCT_BLOCK_Z);
  
-        gpujpeg_idct_gpu_kernel<<<dct_grid, dct_block, 0, *(decoder->stream)>>>(
-            component->d_data_quantized,
-            component->d_data,
-            component->data_width,
-            d_quantization_table
-        );
+        if ( coder->param.precision > 8 ) {
+            gpujpeg_idct_gpu_kernel<uint16_t><<<dct_grid, dct_block, 0, *(decoder->stream)>>>(
+                component->d_data_quantized,
+                (uint16_t*)component->d_data,
+                component->data_width,
+                d_quantization_table
+            );
+        } else {
+            gpujpeg_idct_gpu_kernel<uint8_t><<<dct_grid, dct_block, 0, *(decoder->stream)>>>(
+                component->d_data_quantized,
+                component->d_data,
+                component->data_width,
+                d_quantization_table
+            );
+        }
         gpujpeg_cuda_check_error("Inverse Integer DCT failed", return -1);
     }
 
@@ -48,6 +48,10 @@ gpujpeg_dct_gpu(struct gpujpeg_encoder* encoder);
 /**
  * Peform inverse DCT on GPU in integers
  *
+ * When coder->data_scale is greater than 1, component planes are reconstructed
+ * downscaled by that factor directly in DCT domain (only low frequency
+ * coefficients are used).
+ *
  * @param decoder
  */
 int
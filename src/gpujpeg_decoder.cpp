@@ -32,8 +32,12 @@
 #include "gpujpeg_preprocessor.h"
 #include "gpujpeg_dct_cpu.h"
 #include "gpujpeg_dct_gpu.h"
+#include "gpujpeg_device.h"
 #include "gpujpeg_huffman_cpu_decoder.h"
 #include "gpujpeg_huffman_gpu_decoder.h"
+#include "gpujpeg_sparse.h"
+#include "gpujpeg_thread.h"
+#include <libgpujpeg/gpujpeg_stats_internal.h>
 #include <libgpujpeg/gpujpeg_util.h>
 
 /** Documented at declaration */
@@ -44,6 +48,8 @@ gpujpeg_decoder_output_set_default(struct gpujpeg_decoder_output* output)
     output->data = NULL;
     output->data_size = 0;
     output->texture = NULL;
+    output->width = 0;
+    output->height = 0;
 }
 
 /** Documented at declaration */
@@ -54,6 +60,8 @@ gpujpeg_decoder_output_set_custom(struct gpujpeg_decoder_output* output, uint8_t
     output->data = custom_buffer;
     output->data_size = 0;
     output->texture = NULL;
+    output->width = 0;
+    output->height = 0;
 }
 
 /** Documented at declaration */
@@ -64,6 +72,8 @@ gpujpeg_decoder_output_set_texture(struct gpujpeg_decoder_output* output, struct
     output->data = NULL;
     output->data_size = 0;
     output->texture = texture;
+    output->width = 0;
+    output->height = 0;
 }
 
 /** Documented at declaration */
@@ -74,6 +84,8 @@ gpujpeg_decoder_output_set_cuda_buffer(struct gpujpeg_decoder_output* output)
     output->data = NULL;
     output->data_size = 0;
     output->texture = NULL;
+    output->width = 0;
+    output->height = 0;
 }
 
 /** Documented at declaration */
@@ -84,6 +96,153 @@ gpujpeg_decoder_output_set_custom_cuda(struct gpujpeg_decoder_output* output, ui
     output->data = d_custom_buffer;
     output->data_size = 0;
     output->texture = NULL;
+    output->width = 0;
+    output->height = 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_output_set_custom_planes(struct gpujpeg_decoder_output* output, const struct gpujpeg_image_planes* planes)
+{
+    output->type = GPUJPEG_DECODER_OUTPUT_CUSTOM_PLANES;
+    output->data = NULL;
+    output->data_size = 0;
+    output->texture = NULL;
+    output->width = 0;
+    output->height = 0;
+    output->planes = *planes;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_output_set_custom_cuda_planes(struct gpujpeg_decoder_output* output, const struct gpujpeg_image_planes* planes)
+{
+    output->type = GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_PLANES;
+    output->data = NULL;
+    output->data_size = 0;
+    output->texture = NULL;
+    output->width = 0;
+    output->height = 0;
+    output->planes = *planes;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_output_set_cuda_tensor(struct gpujpeg_decoder_output* output, void* d_tensor, enum gpujpeg_tensor_type type,
+                                       enum gpujpeg_tensor_layout layout, const float* scale, const float* bias)
+{
+    output->type = GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR;
+    output->data = (uint8_t*)d_tensor;
+    output->data_size = 0;
+    output->texture = NULL;
+    output->width = 0;
+    output->height = 0;
+    output->tensor.type = type;
+    output->tensor.layout = layout;
+    // Tensor has at most 3 channels (image with 4 components can't be decoded to tensor)
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ ) {
+        output->tensor.scale[comp] = (scale != NULL && comp < 3) ? scale[comp] : 1.0f;
+        output->tensor.bias[comp] = (bias != NULL && comp < 3) ? bias[comp] : 0.0f;
+    }
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_output_set_coefficients(struct gpujpeg_decoder_output* output)
+{
+    output->type = GPUJPEG_DECODER_OUTPUT_COEFFICIENTS;
+    output->data = NULL;
+    output->data_size = 0;
+    output->texture = NULL;
+    output->width = 0;
+    output->height = 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_output_set_resize(struct gpujpeg_decoder_output* output, int width, int height, enum gpujpeg_resize_filter filter)
+{
+    output->width = width;
+    output->height = height;
+    output->filter = filter;
+}
+
+/**
+ * Prepare decoder for decoding into output size (select IDCT downscale factor,
+ * postprocessor resampling and raw image size)
+ *
+ * @param decoder  Decoder structure
+ * @param output  Decoder output structure
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_decoder_init_output_size(struct gpujpeg_decoder* decoder, struct gpujpeg_decoder_output* output)
+{
+    // Get coder
+    struct gpujpeg_coder* coder = &decoder->coder;
+
+    struct gpujpeg_image_parameters param_image_raw = coder->param_image;
+    int data_raw_width = 0;
+    int data_raw_height = 0;
+    int data_scale = 1;
+    if ( output->width != 0 && output->height != 0 && (output->width != coder->param_image.width || output->height != coder->param_image.height) ) {
+        data_raw_width = output->width;
+        data_raw_height = output->height;
+        param_image_raw.width = output->width;
+        param_image_raw.height = output->height;
+
+        // Largest power of two reduction in DCT domain that doesn't go below requested size
+        while ( data_scale < GPUJPEG_BLOCK_SIZE
+                && gpujpeg_div_and_round_up(coder->param_image.width, data_scale * 2) >= output->width
+                && gpujpeg_div_and_round_up(coder->param_image.height, data_scale * 2) >= output->height ) {
+            data_scale *= 2;
+        }
+    }
+    coder->data_scale = data_scale;
+    coder->data_raw_size = gpujpeg_image_calculate_size(&param_image_raw);
+
+    // Tensor output has channel for every decoded component of float elements
+    int data_raw_tensor = (output->type == GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR);
+    if ( data_raw_tensor ) {
+        int element_size = (output->tensor.type == GPUJPEG_TENSOR_FLOAT16) ? 2 : 4;
+        int channel_count = coder->luminance_only ? 1 : param_image_raw.comp_count;
+        coder->data_raw_size = param_image_raw.width * param_image_raw.height * channel_count * element_size;
+        coder->data_raw_tensor_format = output->tensor;
+    }
+
+    // Reselect postprocessor when resampling or tensor output changed
+    if ( data_raw_width != coder->data_raw_width || data_raw_height != coder->data_raw_height || (data_raw_width != 0 && output->filter != coder->data_raw_filter)
+            || data_raw_tensor != coder->data_raw_tensor ) {
+        coder->data_raw_width = data_raw_width;
+        coder->data_raw_height = data_raw_height;
+        coder->data_raw_filter = output->filter;
+        coder->data_raw_tensor = data_raw_tensor;
+        if ( gpujpeg_preprocessor_decoder_init(coder) != 0 ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Failed to init postprocessor for %dx%d output!\n", output->width, output->height);
+            return -1;
+        }
+    }
+
+    // Reallocate raw buffers when they are too small (tensor is decoded only to custom buffer)
+    if ( !data_raw_tensor && (size_t)coder->data_raw_size > coder->data_raw_allocated_size ) {
+        if ( coder->data_raw != NULL ) {
+            gpujpeg_device_free_host(coder->data_raw);
+            coder->data_raw = NULL;
+        }
+        if ( coder->d_data_raw_allocated != NULL ) {
+            gpujpeg_device_free(coder->d_data_raw_allocated);
+            coder->d_data_raw_allocated = NULL;
+        }
+        if ( cudaSuccess != gpujpeg_device_malloc_host((void**)&coder->data_raw, coder->data_raw_size * sizeof(uint8_t)) ) {
+            return -1;
+        }
+        if ( cudaSuccess != gpujpeg_device_malloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size * sizeof(uint8_t)) ) {
+            return -1;
+        }
+        coder->data_raw_allocated_size = coder->data_raw_size;
+    }
+
+    return 0;
 }
 
 /** Documented at declaration */
@@ -113,22 +272,40 @@ gpujpeg_decoder_create(cudaStream_t * stream)
     if ( decoder->reader == NULL )
         result = 0;
 
-    // Allocate quantization tables in device memory
+    // Allocate quantization tables in device memory (default tables are set, so that
+    // DQT equal to the current table can be skipped by reader)
     for ( int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++ ) {
-        if ( cudaSuccess != cudaMalloc((void**)&decoder->table_quantization[comp_type].d_table, 64 * sizeof(uint16_t)) )
+        if ( cudaSuccess != gpujpeg_device_malloc((void**)&decoder->table_quantization[comp_type].d_table, 64 * sizeof(uint16_t)) )
+            result = 0;
+        else if ( gpujpeg_table_quantization_decoder_init(&decoder->table_quantization[comp_type], (enum gpujpeg_component_type)comp_type, 75) != 0 )
             result = 0;
     }
-    // Allocate huffman tables in device memory
-    for ( int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++ ) {
-        for ( int huff_type = 0; huff_type < GPUJPEG_HUFFMAN_TYPE_COUNT; huff_type++ ) {
-            if ( cudaSuccess != cudaMalloc((void**)&decoder->d_table_huffman[comp_type][huff_type], sizeof(struct gpujpeg_table_huffman_decoder)) )
-                result = 0;
+    // Init huffman table cache, tables are set to standard ones (used when DHT is omitted)
+    if ( gpujpeg_table_huffman_decoder_cache_init(&decoder->table_huffman_cache) != 0 ) {
+        result = 0;
+    }
+    else {
+        for ( int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++ ) {
+            for ( int huff_type = 0; huff_type < GPUJPEG_HUFFMAN_TYPE_COUNT; huff_type++ ) {
+                struct gpujpeg_table_huffman_decoder_cache_entry* entry = &decoder->table_huffman_cache.entry[comp_type * GPUJPEG_HUFFMAN_TYPE_COUNT + huff_type];
+                if ( gpujpeg_table_huffman_decoder_cache_set(&decoder->table_huffman_cache, &decoder->table_huffman_entry[comp_type][huff_type], entry->table.bits, entry->table.huffval) < 0 ) {
+                    result = 0;
+                    continue;
+                }
+                decoder->table_huffman[comp_type][huff_type] = entry->table;
+                decoder->d_table_huffman[comp_type][huff_type] = entry->d_table;
+            }
         }
     }
-    gpujpeg_cuda_check_error("Decoder table allocation", return NULL);
+    gpujpeg_device_check_error("Decoder table allocation", return NULL);
+
+    // Huffman decoding costs are initialized from default cost model
+    gpujpeg_route_model_set_default(&decoder->route_model);
+    decoder->huffman_host_cost = decoder->route_model.host_huffman;
+    decoder->huffman_device_cost = decoder->route_model.device_huffman / decoder->route_model.device_huffman_parallelism;
 
-    // Init huffman encoder
-    if (gpujpeg_huffman_gpu_decoder_init() != 0) {
+    // Init huffman decoder (host runtime performs huffman decoding on CPU)
+    if (!gpujpeg_device_get_runtime()->host && gpujpeg_huffman_gpu_decoder_init() != 0) {
         result = 0;
     }
 
@@ -136,7 +313,7 @@ gpujpeg_decoder_create(cudaStream_t * stream)
     decoder->stream = stream;
     if (decoder->stream == NULL) {
         decoder->allocatedStream = (cudaStream_t *) malloc(sizeof(cudaStream_t));
-        if (cudaSuccess != cudaStreamCreate(decoder->allocatedStream)) {
+        if (cudaSuccess != gpujpeg_device_stream_create(decoder->allocatedStream)) {
             result = 0;
         }
         decoder->stream = decoder->allocatedStream;
@@ -154,7 +331,7 @@ gpujpeg_decoder_create(cudaStream_t * stream)
 int
 gpujpeg_decoder_init(struct gpujpeg_decoder* decoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image)
 {
-    assert(param_image->comp_count == 1 || param_image->comp_count == 3);
+    assert(param_image->comp_count == 1 || param_image->comp_count == 3 || param_image->comp_count == 4);
 
     // Get coder
     struct gpujpeg_coder* coder = &decoder->coder;
@@ -167,6 +344,7 @@ gpujpeg_decoder_init(struct gpujpeg_decoder* decoder, struct gpujpeg_parameters*
     change |= coder->param.restart_interval != param->restart_interval;
     change |= coder->param.interleaved != param->interleaved;
     change |= coder->param.color_space_internal != param->color_space_internal;
+    change |= coder->param.precision != param->precision;
     for ( int comp = 0; comp < param_image->comp_count; comp++ ) {
         change |= coder->param.sampling_factor[comp].horizontal != param->sampling_factor[comp].horizontal;
         change |= coder->param.sampling_factor[comp].vertical != param->sampling_factor[comp].vertical;
@@ -180,10 +358,14 @@ gpujpeg_decoder_init(struct gpujpeg_decoder* decoder, struct gpujpeg_parameters*
         return -1;
     }
 
-    // Initialize coder
+    // Initialize coder (statistics of decoding in progress are kept)
+    struct gpujpeg_stats stats = coder->stats;
+    struct gpujpeg_stats_recorder* stats_recorder = coder->stats_recorder;
     if ( gpujpeg_coder_init(coder) != 0 ) {
         return -1;
     }
+    coder->stats = stats;
+    coder->stats_recorder = stats_recorder;
     if (0 == gpujpeg_coder_init_image(coder, param, param_image, decoder->stream)) {
         return -1;
     }
@@ -197,6 +379,442 @@ gpujpeg_decoder_init(struct gpujpeg_decoder* decoder, struct gpujpeg_parameters*
     return 0;
 }
 
+/**
+ * Check whether image can be decoded on CPU (see gpujpeg_decoder_set_host_threads
+ * and gpujpeg_decoder_set_route_model)
+ *
+ * @param decoder  Decoder structure
+ * @param output  Decoder output structure
+ * @return 1 if image is decoded on CPU, otherwise 0
+ */
+static int
+gpujpeg_decoder_host_available(struct gpujpeg_decoder* decoder, struct gpujpeg_decoder_output* output)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+
+    if ( decoder->host_thread_count == 0 && !decoder->route_enabled ) {
+        return 0;
+    }
+    if ( output->type != GPUJPEG_DECODER_OUTPUT_INTERNAL_BUFFER && output->type != GPUJPEG_DECODER_OUTPUT_CUSTOM_BUFFER
+            && output->type != GPUJPEG_DECODER_OUTPUT_CUSTOM_PLANES ) {
+        return 0;
+    }
+    // Resized output is produced only by device postprocessor (IDCT downscale and resampling)
+    if ( output->width != 0 && output->height != 0 && (output->width != coder->param_image.width || output->height != coder->param_image.height) ) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Check whether image can be transformed by MCU rows on CPU (see gpujpeg_idct_cpu_decode_mcu_row)
+ *
+ * @param decoder  Decoder structure (image data are already read and output size is initialized)
+ * @return 1 if MCU rows can be transformed on CPU, otherwise 0
+ */
+static int
+gpujpeg_decoder_mcu_rows_available(struct gpujpeg_decoder* decoder)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+
+    // MCU rows are decoded from single scan (MCU of one component image is one block)
+    if ( coder->param.interleaved != 1 && coder->param_image.comp_count != 1 ) {
+        return 0;
+    }
+    if ( coder->param_image.comp_count == 1
+            && (coder->component[0].sampling_factor.horizontal != 1 || coder->component[0].sampling_factor.vertical != 1) ) {
+        return 0;
+    }
+    return gpujpeg_idct_cpu_decode_available(decoder);
+}
+
+/** Parameters of decoder kernels (see gpujpeg_device_launch) */
+struct gpujpeg_decoder_kernel_param
+{
+    // Decoder structure
+    struct gpujpeg_decoder* decoder;
+    // Range of decoded segments (gpujpeg_decoder_kernel_huffman)
+    int segment_begin;
+    int segment_end;
+};
+
+static int
+gpujpeg_decoder_kernel_huffman(void* param)
+{
+    struct gpujpeg_decoder_kernel_param* kernel_param = (struct gpujpeg_decoder_kernel_param*)param;
+    return gpujpeg_huffman_gpu_decoder_decode_segments(kernel_param->decoder, kernel_param->segment_begin, kernel_param->segment_end);
+}
+
+static int
+gpujpeg_decoder_kernel_idct(void* param)
+{
+    return gpujpeg_idct_gpu(((struct gpujpeg_decoder_kernel_param*)param)->decoder);
+}
+
+static int
+gpujpeg_decoder_kernel_postprocess(void* param)
+{
+    struct gpujpeg_decoder* decoder = ((struct gpujpeg_decoder_kernel_param*)param)->decoder;
+    return gpujpeg_preprocessor_decode(&decoder->coder, *(decoder->stream));
+}
+
+static int
+gpujpeg_decoder_kernel_postprocess_idct(void* param)
+{
+    return gpujpeg_preprocessor_decode_idct(((struct gpujpeg_decoder_kernel_param*)param)->decoder);
+}
+
+/**
+ * Perform IDCT fused with postprocessing on CPU by MCU rows to raw image in
+ * device memory emulated by host runtime
+ */
+static int
+gpujpeg_decoder_kernel_postprocess_idct_host(void* param)
+{
+    struct gpujpeg_decoder* decoder = ((struct gpujpeg_decoder_kernel_param*)param)->decoder;
+    struct gpujpeg_coder* coder = &decoder->coder;
+
+    struct gpujpeg_image_planes planes = coder->data_raw_planes;
+    if ( planes.data[0] == NULL && 0 != gpujpeg_image_planes_init(&coder->param_image, coder->d_data_raw, &planes) ) {
+        return -1;
+    }
+    if ( 0 != gpujpeg_idct_cpu_decode_prepare(decoder) ) {
+        return -1;
+    }
+    int mcu_row_count = coder->component[0].mcu_count / coder->component[0].mcu_count_x;
+    for ( int mcu_row = 0; mcu_row < mcu_row_count; mcu_row++ ) {
+        int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+        for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+            struct gpujpeg_component* component = &coder->component[comp];
+            coefficients[comp] = component->d_data_quantized + (size_t)mcu_row * component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE * component->data_width;
+        }
+        if ( 0 != gpujpeg_idct_cpu_decode_mcu_row(decoder, coefficients, mcu_row, &planes) ) {
+            return -1;
+        }
+    }
+    return gpujpeg_idct_cpu_decode_finish(decoder, &planes);
+}
+
+/** Kernels of decoder pipeline stages */
+static const struct gpujpeg_device_kernel gpujpeg_decoder_huffman = {
+    "gpujpeg_huffman_gpu_decoder_decode", &gpujpeg_decoder_kernel_huffman, NULL
+};
+static const struct gpujpeg_device_kernel gpujpeg_decoder_idct = {
+    "gpujpeg_idct_gpu", &gpujpeg_decoder_kernel_idct, NULL
+};
+static const struct gpujpeg_device_kernel gpujpeg_decoder_postprocess = {
+    "gpujpeg_preprocessor_decode", &gpujpeg_decoder_kernel_postprocess, NULL
+};
+static const struct gpujpeg_device_kernel gpujpeg_decoder_postprocess_idct = {
+    "gpujpeg_preprocessor_decode_idct", &gpujpeg_decoder_kernel_postprocess_idct, &gpujpeg_decoder_kernel_postprocess_idct_host
+};
+
+/**
+ * Launch kernel of decoder pipeline stage to decoder stream
+ *
+ * @param decoder  Decoder structure
+ * @param kernel  Kernel of pipeline stage
+ * @param segment_begin  Index of the first decoded segment (huffman decoder only)
+ * @param segment_end  Index after the last decoded segment (huffman decoder only)
+ * @param stage  Stage the kernel is accounted to (see gpujpeg_stats)
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_decoder_launch(struct gpujpeg_decoder* decoder, const struct gpujpeg_device_kernel* kernel, int segment_begin, int segment_end,
+                       enum gpujpeg_stats_stage stage)
+{
+    struct gpujpeg_decoder_kernel_param param;
+    param.decoder = decoder;
+    param.segment_begin = segment_begin;
+    param.segment_end = segment_end;
+    gpujpeg_stats_device_start(&decoder->coder, stage, *(decoder->stream));
+    if ( gpujpeg_device_launch(kernel, &param, sizeof(param), *(decoder->stream)) != cudaSuccess ) {
+        return -1;
+    }
+    gpujpeg_stats_device_stop(&decoder->coder, stage, *(decoder->stream));
+    return 0;
+}
+
+/** Host decoding pipeline */
+struct gpujpeg_decoder_host
+{
+    // Decoder structure
+    struct gpujpeg_decoder* decoder;
+    // Raw image planes in host memory
+    struct gpujpeg_image_planes planes;
+    // Number of worker threads
+    int thread_count;
+    // Number of MCU rows
+    int mcu_row_count;
+};
+
+/**
+ * Perform IDCT, upsampling and color conversion of MCU row decoded by huffman decoder
+ * (see gpujpeg_huffman_cpu_decoder_mcu_row_callback_t)
+ */
+static int
+gpujpeg_decoder_host_mcu_row(struct gpujpeg_decoder* decoder, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT], int mcu_row, void* param)
+{
+    struct gpujpeg_decoder_host* host = (struct gpujpeg_decoder_host*)param;
+    return gpujpeg_idct_cpu_decode_mcu_row(decoder, coefficients, mcu_row, &host->planes);
+}
+
+/**
+ * Decode range of MCU rows in worker thread (see gpujpeg_thread_function_t)
+ */
+static int
+gpujpeg_decoder_host_thread(int thread_index, void* param)
+{
+    struct gpujpeg_decoder_host* host = (struct gpujpeg_decoder_host*)param;
+    struct gpujpeg_coder* coder = &host->decoder->coder;
+    int mcu_row_begin = (int)((long long)host->mcu_row_count * thread_index / host->thread_count);
+    int mcu_row_end = (int)((long long)host->mcu_row_count * (thread_index + 1) / host->thread_count);
+    if ( mcu_row_begin == mcu_row_end ) {
+        return 0;
+    }
+    double time_begin = gpujpeg_get_time();
+
+    // Coefficients of one MCU row for each component
+    int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+    int result = 0;
+    for ( int comp = 0; comp < coder->param_image.comp_count && result == 0; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        coefficients[comp] = (int16_t*)malloc(component->data_width * component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE * sizeof(int16_t));
+        if ( coefficients[comp] == NULL ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate coefficients of MCU row!\n");
+            result = -1;
+        }
+    }
+    if ( result == 0 ) {
+        result = gpujpeg_huffman_cpu_decoder_decode_mcu_rows(host->decoder, mcu_row_begin, mcu_row_end, coefficients,
+                                                             &gpujpeg_decoder_host_mcu_row, host);
+    }
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ ) {
+        free(coefficients[comp]);
+    }
+    gpujpeg_stats_trace_worker(coder, thread_index, time_begin, gpujpeg_get_time());
+    return result;
+}
+
+/**
+ * Decode image on CPU by MCU rows directly to host output
+ *
+ * @param decoder  Decoder structure (image data are already read and output size is initialized)
+ * @param output  Decoder output structure
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_decoder_decode_host(struct gpujpeg_decoder* decoder, struct gpujpeg_decoder_output* output)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+
+    struct gpujpeg_decoder_host host;
+    host.decoder = decoder;
+    if ( output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_PLANES ) {
+        host.planes = output->planes;
+        if ( 0 != gpujpeg_image_planes_init(&coder->param_image, NULL, &host.planes) ) {
+            return -1;
+        }
+    }
+    else {
+        assert(output->type != GPUJPEG_DECODER_OUTPUT_CUSTOM_BUFFER || output->data != NULL);
+        uint8_t* data = (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_BUFFER) ? output->data : coder->data_raw;
+        if ( 0 != gpujpeg_image_planes_init(&coder->param_image, data, &host.planes) ) {
+            return -1;
+        }
+    }
+
+    // Threads get contiguous ranges of MCU rows, ranges starting inside of restart
+    // interval first skip its preceding MCUs, so there is no more threads than segments
+    host.mcu_row_count = coder->component[0].mcu_count / coder->component[0].mcu_count_x;
+    host.thread_count = gpujpeg_thread_get_count(decoder->host_thread_count);
+    if ( host.thread_count > decoder->segment_count )
+        host.thread_count = decoder->segment_count;
+    if ( host.thread_count > host.mcu_row_count )
+        host.thread_count = host.mcu_row_count;
+
+    if ( 0 != gpujpeg_idct_cpu_decode_prepare(decoder) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Host decoder failed!\n");
+        return -1;
+    }
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_HUFFMAN);
+    if ( 0 != gpujpeg_thread_run(host.thread_count, &gpujpeg_decoder_host_thread, &host) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Host decoder failed!\n");
+        return -1;
+    }
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_HUFFMAN);
+
+    // Component planes are upsampled and stored after all MCU rows when sampling filter is used
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_PREPROCESS);
+    if ( 0 != gpujpeg_idct_cpu_decode_finish(decoder, &host.planes) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Host decoder failed!\n");
+        return -1;
+    }
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_PREPROCESS);
+    coder->stats.huffman = GPUJPEG_ROUTE_HOST;
+    coder->stats.huffman_host_segment_count = decoder->segment_count;
+
+    output->data_size = coder->data_raw_size * sizeof(uint8_t);
+    if ( output->type == GPUJPEG_DECODER_OUTPUT_INTERNAL_BUFFER ) {
+        output->data = coder->data_raw;
+    }
+    return 0;
+}
+
+/**
+ * Decide backends of decoding pipeline stages for current image, by cost model
+ * when it is set (see gpujpeg_decoder_set_route_model), otherwise huffman
+ * decoding is performed on CPU when there are not enough segments to saturate GPU
+ *
+ * @param decoder  Decoder structure (image data are already read)
+ * @param output  Decoder output structure
+ * @param host_image  Flag if image can be decoded on CPU by MCU rows
+ * @return void
+ */
+static void
+gpujpeg_decoder_route(struct gpujpeg_decoder* decoder, struct gpujpeg_decoder_output* output, int host_image)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+
+    if ( !decoder->route_enabled ) {
+        coder->route.image = host_image ? GPUJPEG_ROUTE_HOST : GPUJPEG_ROUTE_DEVICE;
+        coder->route.huffman = (coder->segment_count < 256 || gpujpeg_device_get_runtime()->host) ? GPUJPEG_ROUTE_HOST : GPUJPEG_ROUTE_DEVICE;
+        coder->route.huffman_host_segment_count = 0;
+        coder->route.duration_host = 0.0;
+        coder->route.duration_device = 0.0;
+        return;
+    }
+
+    struct gpujpeg_route_image image;
+    image.raw_size = gpujpeg_image_calculate_size(&coder->param_image);
+    image.sample_count = coder->luminance_only ? coder->component[0].data_size : coder->data_size;
+    image.segment_count = decoder->segment_count;
+    image.host_thread_count = gpujpeg_thread_get_count(decoder->host_thread_count);
+    image.host_image_supported = host_image;
+    image.device_huffman_supported = !gpujpeg_device_get_runtime()->host;
+    image.raw_on_device = (output->type != GPUJPEG_DECODER_OUTPUT_INTERNAL_BUFFER && output->type != GPUJPEG_DECODER_OUTPUT_CUSTOM_BUFFER
+            && output->type != GPUJPEG_DECODER_OUTPUT_CUSTOM_PLANES);
+    gpujpeg_route_decide(&decoder->route_model, &image, &coder->route);
+}
+
+/**
+ * Split segments of image between huffman decoding on CPU and on GPU, so that
+ * by measured costs both finish at the same time (GPU has fixed overhead).
+ * Costs start from the cost model, so segments are split only when the model
+ * is set (see gpujpeg_decoder_set_route_model), not by the default guesses.
+ *
+ * @param decoder  Decoder structure (image data are already read)
+ * @param output  Decoder output structure
+ * @return number of leading segments decoded on CPU (0 when huffman decoding isn't split)
+ */
+static int
+gpujpeg_decoder_huffman_split(struct gpujpeg_decoder* decoder, struct gpujpeg_decoder_output* output)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+
+    if ( !decoder->route_enabled ) {
+        return 0;
+    }
+    if ( output->type == GPUJPEG_DECODER_OUTPUT_COEFFICIENTS || coder->param.restart_interval == 0 || decoder->segment_count < 2 ) {
+        return 0;
+    }
+    // Coefficients of CPU segments are uploaded by MCU rows of single scan (MCU of one component image is one block)
+    if ( coder->param.interleaved != 1 && coder->param_image.comp_count != 1 ) {
+        return 0;
+    }
+    if ( coder->param_image.comp_count == 1
+            && (coder->component[0].sampling_factor.horizontal != 1 || coder->component[0].sampling_factor.vertical != 1) ) {
+        return 0;
+    }
+
+    const double sample_count = (double)coder->data_size / decoder->segment_count;
+    const double duration_host = decoder->huffman_host_cost * sample_count;
+    const double duration_device = decoder->huffman_device_cost * sample_count;
+    const double overhead = decoder->route_model.device_huffman_overhead * 1000.0;
+    int segment_count = (int)((overhead + decoder->segment_count * duration_device) / (duration_host + duration_device));
+    if ( segment_count > decoder->segment_count - 1 ) {
+        segment_count = decoder->segment_count - 1;
+    }
+    return segment_count;
+}
+
+/**
+ * Perform huffman decoding of leading segments on CPU while the rest is decoded
+ * on GPU, update measured costs of both and upload the decoded coefficients
+ *
+ * @param decoder  Decoder structure (huffman decoding of the rest of segments is already launched)
+ * @param segment_count  Number of leading segments decoded on CPU
+ * @param time_device  Time when GPU decoding was launched
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_decoder_huffman_hybrid(struct gpujpeg_decoder* decoder, int segment_count, double time_device)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+
+    double time_host = gpujpeg_get_time();
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_HUFFMAN);
+    if (0 != gpujpeg_huffman_cpu_decoder_decode_segments(decoder, 0, segment_count)) {
+        fprintf(stderr, "[GPUJPEG] [Error] Huffman decoder failed!\n");
+        return -1;
+    }
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_HUFFMAN);
+    double time_end = gpujpeg_get_time();
+
+    // GPU duration is known only when GPU is still busy, otherwise it is bounded
+    // by CPU duration (cost can then only decrease, so the split can't drift to CPU)
+    int device_busy = (gpujpeg_device_stream_query(*(decoder->stream)) == cudaErrorNotReady);
+    if (device_busy) {
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_WAIT);
+        gpujpeg_device_stream_synchronize(*(decoder->stream));
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_WAIT);
+    }
+    double time_device_end = gpujpeg_get_time();
+
+    const double sample_count = (double)coder->data_size / decoder->segment_count;
+    const double host_cost = (time_end - time_host) * 1e9 / (segment_count * sample_count);
+    double duration_device = (time_device_end - time_device) * 1e9 - decoder->route_model.device_huffman_overhead * 1000.0;
+    if (duration_device < 0.0) {
+        duration_device = 0.0;
+    }
+    const double device_cost = duration_device / ((decoder->segment_count - segment_count) * sample_count);
+    decoder->huffman_host_cost = 0.5 * (decoder->huffman_host_cost + host_cost);
+    if (device_busy) {
+        decoder->huffman_device_cost = 0.5 * (decoder->huffman_device_cost + device_cost);
+    } else if (device_cost < decoder->huffman_device_cost) {
+        decoder->huffman_device_cost = device_cost;
+    }
+
+    // Upload coefficients of CPU segments, which are complete MCU rows (contiguous
+    // in each component) followed by the beginning of one MCU row
+    int mcu_count = 0;
+    for (int segment_index = 0; segment_index < segment_count; segment_index++) {
+        mcu_count += coder->segment[segment_index].mcu_count;
+    }
+    const int mcu_row_count = mcu_count / coder->component[0].mcu_count_x;
+    const int mcu_rest = mcu_count % coder->component[0].mcu_count_x;
+    const int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+    gpujpeg_stats_device_start(coder, GPUJPEG_STATS_UPLOAD, *(decoder->stream));
+    for (int comp = 0; comp < comp_count; comp++) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        const int block_begin = (int)((component->data_quantized - coder->data_quantized) / GPUJPEG_BLOCK_SQUARED_SIZE);
+        const int block_count_x = component->data_width / GPUJPEG_BLOCK_SIZE;
+        const int mcu_width = coder->param_image.comp_count == 1 ? 1 : component->sampling_factor.horizontal;
+        const int mcu_height = coder->param_image.comp_count == 1 ? 1 : component->sampling_factor.vertical;
+        if (0 != gpujpeg_sparse_upload(coder, block_begin, mcu_row_count * mcu_height * block_count_x, *(decoder->stream))) {
+            return -1;
+        }
+        for (int row = 0; row < mcu_height && mcu_rest > 0; row++) {
+            const int row_begin = block_begin + (mcu_row_count * mcu_height + row) * block_count_x;
+            if (0 != gpujpeg_sparse_upload(coder, row_begin, mcu_rest * mcu_width, *(decoder->stream))) {
+                return -1;
+            }
+        }
+    }
+    gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_UPLOAD, *(decoder->stream));
+    return 0;
+}
+
 /** Documented at declaration */
 int
 gpujpeg_decoder_decode(struct gpujpeg_decoder* decoder, uint8_t* image, int image_size, struct gpujpeg_decoder_output* output)
@@ -204,85 +822,205 @@ gpujpeg_decoder_decode(struct gpujpeg_decoder* decoder, uint8_t* image, int imag
     // Get coder
     struct gpujpeg_coder* coder = &decoder->coder;
 
-    // Reset durations
-    coder->duration_memory_map = 0.0;
-    coder->duration_memory_unmap = 0.0;
-    coder->duration_stream = 0.0;
-    coder->duration_in_gpu = 0.0;
-    coder->duration_waiting = 0.0;
-
-    GPUJPEG_CUSTOM_TIMER_START(decoder->def);
+    gpujpeg_stats_begin(coder);
+    decoder->coefficients_decoded = 0;
 
-    // Read JPEG image data
+    // Read JPEG image data (table preparation is accounted separately)
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_READER);
     if (0 != gpujpeg_reader_read_image(decoder, image, image_size)) {
         fprintf(stderr, "[GPUJPEG] [Error] Decoder failed when decoding image data!\n");
         return -1;
     }
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_READER);
+    coder->stats.duration[GPUJPEG_STATS_READER] -= coder->stats.duration[GPUJPEG_STATS_TABLES];
+    coder->stats.compressed_size = image_size;
+    coder->sampling_filter = decoder->sampling_filter;
+
+    // 12-bit images are decoded only to 16-bit pixel formats of the same component count without resampling
+    if (output->type != GPUJPEG_DECODER_OUTPUT_COEFFICIENTS
+            && (coder->param.precision > 8 || gpujpeg_pixel_format_get_precision(coder->param_image.pixel_format) > 8)) {
+        if (gpujpeg_pixel_format_get_precision(coder->param_image.pixel_format) != coder->param.precision) {
+            fprintf(stderr, "[GPUJPEG] [Error] Image with %d-bit precision can't be decoded to %d-bit pixel format!\n",
+                    coder->param.precision, gpujpeg_pixel_format_get_precision(coder->param_image.pixel_format));
+            return -1;
+        }
+        if ((coder->param_image.pixel_format == GPUJPEG_U16) != (coder->param_image.comp_count == 1)) {
+            fprintf(stderr, "[GPUJPEG] [Error] Image with %d components can't be decoded to %s pixel format!\n",
+                    coder->param_image.comp_count, coder->param_image.pixel_format == GPUJPEG_U16 ? "u16" : "444-u16-p012");
+            return -1;
+        }
+        if (output->type == GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR || (output->width != 0 && output->height != 0
+                && (output->width != coder->param_image.width || output->height != coder->param_image.height))) {
+            fprintf(stderr, "[GPUJPEG] [Error] Image with 12-bit precision can't be decoded to tensor or resampled!\n");
+            return -1;
+        }
+    }
+
+    // One component output of color image decodes only luminance (coefficients are output for all components)
+    coder->luminance_only = (coder->param_image.comp_count > 1 && coder->param_image.pixel_format == GPUJPEG_U8
+                             && output->type != GPUJPEG_DECODER_OUTPUT_COEFFICIENTS);
+    if (coder->luminance_only) {
+        if (coder->param.color_space_internal == GPUJPEG_RGB || coder->param.color_space_internal == GPUJPEG_NONE
+                || coder->param.color_space_internal == GPUJPEG_CMYK || coder->param.color_space_internal == GPUJPEG_YCCK) {
+            fprintf(stderr, "[GPUJPEG] [Error] Luminance only decoding requires image in YCbCr color space!\n");
+            return -1;
+        }
+        // Chroma scans are not decoded at all (luminance scan is the first one)
+        if (coder->param.interleaved == 0) {
+            struct gpujpeg_segment* last_segment = &coder->segment[decoder->reader->scan[0].segment_count - 1];
+            decoder->segment_count = decoder->reader->scan[0].segment_count;
+            decoder->data_compressed_size = last_segment->data_compressed_index + last_segment->data_compressed_size;
+        }
+    }
+    // Quantized data of components that are decoded
+    size_t data_quantized_size = coder->luminance_only ? coder->component[0].data_size : coder->data_size;
+
+    // Host runtime decodes only by MCU rows on CPU, which don't resize output (it has
+    // no standalone IDCT and postprocessing)
+    if (gpujpeg_device_get_runtime()->host && output->type != GPUJPEG_DECODER_OUTPUT_COEFFICIENTS) {
+        if (output->width != 0 && output->height != 0
+                && (output->width != coder->param_image.width || output->height != coder->param_image.height)) {
+            fprintf(stderr, "[GPUJPEG] [Error] Image can't be decoded to %dx%d output on CPU (resizing requires GPU)!\n", output->width, output->height);
+            return -1;
+        }
+        if (0 != gpujpeg_decoder_init_output_size(decoder, output)) {
+            return -1;
+        }
+        if (coder->data_raw_tensor || !gpujpeg_decoder_mcu_rows_available(decoder)) {
+            fprintf(stderr, "[GPUJPEG] [Error] Image can't be decoded by host runtime (only 8-bit image of one scan to pixel format "
+                            "matching component count is supported)!\n");
+            return -1;
+        }
+    }
 
-    GPUJPEG_CUSTOM_TIMER_STOP(decoder->def);
-    coder->duration_stream = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->def);
+    // Decide whether image is decoded on CPU by MCU rows and where huffman decoding is performed
+    int host_image = 0;
+    if (gpujpeg_decoder_host_available(decoder, output)) {
+        if (0 != gpujpeg_decoder_init_output_size(decoder, output)) {
+            return -1;
+        }
+        host_image = gpujpeg_decoder_mcu_rows_available(decoder);
+    }
+    gpujpeg_decoder_route(decoder, output, host_image);
+    coder->stats.image = coder->route.image;
+    coder->stats.huffman = coder->route.huffman;
+    coder->stats.segment_count = decoder->segment_count;
+    if (coder->route.image == GPUJPEG_ROUTE_HOST) {
+        if (0 != gpujpeg_decoder_decode_host(decoder, output)) {
+            return -1;
+        }
+        coder->stats.raw_size = coder->data_raw_size;
+        gpujpeg_stats_end(coder);
+        return 0;
+    }
 
     // Perform huffman decoding on CPU (when there are not enough segments to saturate GPU)
-    if (coder->segment_count < 256) {
+    if (coder->route.huffman == GPUJPEG_ROUTE_HOST) {
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_HUFFMAN);
         if (0 != gpujpeg_huffman_cpu_decoder_decode(decoder)) {
             fprintf(stderr, "[GPUJPEG] [Error] Huffman decoder failed!\n");
             return -1;
         }
-
-        // Copy quantized data to device memory from cpu memory
-        cudaMemcpyAsync(coder->d_data_quantized, coder->data_quantized, coder->data_size * sizeof(int16_t), cudaMemcpyHostToDevice, *(decoder->stream));
-
-        GPUJPEG_CUSTOM_TIMER_START(decoder->in_gpu);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_HUFFMAN);
+        coder->stats.huffman_host_segment_count = decoder->segment_count;
+
+        // Copy quantized data to device memory from cpu memory as sparse coefficients (not needed when only coefficients are requested)
+        if (output->type != GPUJPEG_DECODER_OUTPUT_COEFFICIENTS) {
+            gpujpeg_stats_device_start(coder, GPUJPEG_STATS_UPLOAD, *(decoder->stream));
+            if (0 != gpujpeg_sparse_upload(coder, 0, data_quantized_size / GPUJPEG_BLOCK_SQUARED_SIZE, *(decoder->stream))) {
+                return -1;
+            }
+            gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_UPLOAD, *(decoder->stream));
+        }
     }
-    // Perform huffman decoding on GPU (when there are enough segments to saturate GPU)
+    // Perform huffman decoding on GPU (when there are enough segments to saturate GPU),
+    // leading segments are decoded on CPU concurrently when cost model is set and it shortens decoding
     else {
-        GPUJPEG_CUSTOM_TIMER_START(decoder->in_gpu);
+        int host_segment_count = gpujpeg_decoder_huffman_split(decoder, output);
+        coder->route.huffman_host_segment_count = host_segment_count;
+        coder->stats.huffman_host_segment_count = host_segment_count;
+        double time_device = gpujpeg_get_time();
 
         // Reset huffman output
-        cudaMemsetAsync(coder->d_data_quantized, 0, coder->data_size * sizeof(int16_t), *(decoder->stream));
-
-        // Copy scan data to device memory
-        cudaMemcpyAsync(coder->d_data_compressed, coder->data_compressed, decoder->data_compressed_size * sizeof(uint8_t), cudaMemcpyHostToDevice, *(decoder->stream));
-        gpujpeg_cuda_check_error("Decoder copy compressed data", return -1);
-
-        // Copy segments to device memory
-        cudaMemcpyAsync(coder->d_segment, coder->segment, decoder->segment_count * sizeof(struct gpujpeg_segment), cudaMemcpyHostToDevice, *(decoder->stream));
-        gpujpeg_cuda_check_error("Decoder copy compressed data", return -1);
-
-        // Zero output memory
-        cudaMemsetAsync(coder->d_data_quantized, 0, coder->data_size * sizeof(int16_t), *(decoder->stream));
+        gpujpeg_device_memset_async(coder->d_data_quantized, 0, data_quantized_size * sizeof(int16_t), *(decoder->stream));
+
+        // Copy scan data of GPU segments to device memory (from 16-byte aligned index where decoder starts loading)
+        size_t data_compressed_begin = coder->segment[host_segment_count].data_compressed_index & ~15u;
+        gpujpeg_stats_device_start(coder, GPUJPEG_STATS_UPLOAD, *(decoder->stream));
+        gpujpeg_device_memcpy_async(coder->d_data_compressed + data_compressed_begin, coder->data_compressed + data_compressed_begin,
+                        (decoder->data_compressed_size - data_compressed_begin) * sizeof(uint8_t), cudaMemcpyHostToDevice, *(decoder->stream));
+        gpujpeg_device_check_error("Decoder copy compressed data", return -1);
+
+        // Copy GPU segments to device memory
+        gpujpeg_device_memcpy_async(coder->d_segment + host_segment_count, coder->segment + host_segment_count,
+                        (decoder->segment_count - host_segment_count) * sizeof(struct gpujpeg_segment), cudaMemcpyHostToDevice, *(decoder->stream));
+        gpujpeg_device_check_error("Decoder copy compressed data", return -1);
+        gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_UPLOAD, *(decoder->stream));
+        coder->stats.upload_size += decoder->data_compressed_size - data_compressed_begin
+                                  + (decoder->segment_count - host_segment_count) * sizeof(struct gpujpeg_segment);
 
         // Perform huffman decoding
-        if (0 != gpujpeg_huffman_gpu_decoder_decode(decoder)) {
+        if (0 != gpujpeg_decoder_launch(decoder, &gpujpeg_decoder_huffman, host_segment_count, decoder->segment_count, GPUJPEG_STATS_HUFFMAN)) {
             fprintf(stderr, "[GPUJPEG] [Error] Huffman decoder on GPU failed!\n");
             return -1;
         }
+        if (host_segment_count > 0 && 0 != gpujpeg_decoder_huffman_hybrid(decoder, host_segment_count, time_device)) {
+            return -1;
+        }
+
+        // Copy quantized data from device memory when only coefficients are requested
+        if (output->type == GPUJPEG_DECODER_OUTPUT_COEFFICIENTS) {
+            gpujpeg_stats_device_start(coder, GPUJPEG_STATS_DOWNLOAD, *(decoder->stream));
+            if (0 != gpujpeg_sparse_download(coder, 0, coder->data_size / GPUJPEG_BLOCK_SQUARED_SIZE, *(decoder->stream))) {
+                return -1;
+            }
+            gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_DOWNLOAD, *(decoder->stream));
+        }
+    }
+
+    // Output quantized coefficients (IDCT and postprocessing are skipped)
+    if (output->type == GPUJPEG_DECODER_OUTPUT_COEFFICIENTS) {
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_WAIT);
+        gpujpeg_device_stream_synchronize(*(decoder->stream));
+        gpujpeg_device_check_error("Decoder coefficients copy", return -1);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_WAIT);
+
+        output->data = (uint8_t*)coder->data_quantized;
+        output->data_size = coder->data_size * sizeof(int16_t);
+        decoder->coefficients_decoded = 1;
+        gpujpeg_stats_end(coder);
+        return 0;
     }
 
-    // Perform IDCT and dequantization (own CUDA implementation)
-    if (0 != gpujpeg_idct_gpu(decoder)) {
+    // Select output size (IDCT downscale and postprocessor resampling) and create buffers
+    if (0 != gpujpeg_decoder_init_output_size(decoder, output)) {
         return -1;
     }
 
-    // Create buffers if not already created
-    if (coder->data_raw == NULL) {
-        if (cudaSuccess != cudaMallocHost((void**)&coder->data_raw, coder->data_raw_size * sizeof(uint8_t))) {
+    // IDCT is fused with postprocessing when components don't need to be resampled
+    // as whole planes (component planes are then skipped entirely), host runtime
+    // performs it by MCU rows
+    int idct_fused = gpujpeg_device_get_runtime()->host ? gpujpeg_decoder_mcu_rows_available(decoder)
+                                                        : gpujpeg_preprocessor_decode_idct_available(decoder);
+
+    // Perform IDCT and dequantization (own CUDA implementation), component planes
+    // are needed only then
+    if (!idct_fused) {
+        if (0 != gpujpeg_coder_init_data(coder)) {
             return -1;
         }
-    }
-    if (coder->d_data_raw_allocated == NULL) {
-        if (cudaSuccess != cudaMalloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size * sizeof(uint8_t))) {
+        if (0 != gpujpeg_decoder_launch(decoder, &gpujpeg_decoder_idct, 0, 0, GPUJPEG_STATS_DCT)) {
             return -1;
         }
     }
 
     // Select CUDA output buffer
-    if (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_BUFFER) {
+    if (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_BUFFER || output->type == GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR) {
         // Image should be directly decoded into custom CUDA buffer
         coder->d_data_raw = output->data;
     }
     else if (output->type == GPUJPEG_DECODER_OUTPUT_OPENGL_TEXTURE && output->texture->texture_callback_attach_opengl == NULL) {
-        GPUJPEG_CUSTOM_TIMER_START(decoder->def);
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_OPENGL);
 
         // Use OpenGL texture as decoding destination
         int data_size = 0;
@@ -290,90 +1028,118 @@ gpujpeg_decoder_decode(struct gpujpeg_decoder* decoder, uint8_t* image, int imag
         assert(data_size == coder->data_raw_size);
         coder->d_data_raw = d_data;
 
-        GPUJPEG_CUSTOM_TIMER_STOP(decoder->def);
-        coder->duration_memory_map = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->def);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_OPENGL);
     }
     else {
         // Use internal CUDA buffer as decoding destination
         coder->d_data_raw = coder->d_data_raw_allocated;
     }
 
+    // Image should be directly decoded into custom CUDA planes
+    memset(&coder->data_raw_planes, 0, sizeof(struct gpujpeg_image_planes));
+    if (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_PLANES) {
+        coder->data_raw_planes = output->planes;
+        if (0 != gpujpeg_image_planes_init(&coder->param_image, NULL, &coder->data_raw_planes)) {
+            return -1;
+        }
+    }
+
     // Preprocessing
-    if (0 != gpujpeg_preprocessor_decode(&decoder->coder, *(decoder->stream))) {
+    if (idct_fused) {
+        if (0 != gpujpeg_decoder_launch(decoder, &gpujpeg_decoder_postprocess_idct, 0, 0, GPUJPEG_STATS_DCT)) {
+            return -1;
+        }
+    }
+    else if (0 != gpujpeg_decoder_launch(decoder, &gpujpeg_decoder_postprocess, 0, 0, GPUJPEG_STATS_PREPROCESS)) {
         return -1;
     }
 
     // Wait for async operations before copying from the device
-    GPUJPEG_CUSTOM_TIMER_START(decoder->def);
-    cudaStreamSynchronize(*(decoder->stream));
-    GPUJPEG_CUSTOM_TIMER_STOP(decoder->def);
-    coder->duration_waiting = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->def);
-
-    GPUJPEG_CUSTOM_TIMER_STOP(decoder->in_gpu);
-    coder->duration_in_gpu = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->in_gpu);
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_WAIT);
+    gpujpeg_device_stream_synchronize(*(decoder->stream));
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_WAIT);
 
     // Set decompressed image size
     output->data_size = coder->data_raw_size * sizeof(uint8_t);
 
     // Set decompressed image
     if (output->type == GPUJPEG_DECODER_OUTPUT_INTERNAL_BUFFER) {
-        GPUJPEG_CUSTOM_TIMER_START(decoder->def);
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_DOWNLOAD);
 
         // Copy decompressed image to host memory
-        cudaMemcpy(coder->data_raw, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToHost);
+        gpujpeg_device_memcpy(coder->data_raw, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToHost);
 
-        GPUJPEG_CUSTOM_TIMER_STOP(decoder->def);
-        coder->duration_memory_from = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->def);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_DOWNLOAD);
+        coder->stats.download_size += coder->data_raw_size;
 
         // Set output to internal buffer
         output->data = coder->data_raw;
     }
     else if (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_BUFFER) {
-        GPUJPEG_CUSTOM_TIMER_START(decoder->def);
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_DOWNLOAD);
 
         assert(output->data != NULL);
 
         // Copy decompressed image to host memory
-        cudaMemcpy(output->data, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToHost);
+        gpujpeg_device_memcpy(output->data, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToHost);
 
-        GPUJPEG_CUSTOM_TIMER_STOP(decoder->def);
-        coder->duration_memory_from = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->def);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_DOWNLOAD);
+        coder->stats.download_size += coder->data_raw_size;
+    }
+    else if (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_PLANES) {
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_DOWNLOAD);
+
+        // Copy decompressed image planes to host memory with requested row pitches
+        struct gpujpeg_image_planes d_planes;
+        if (0 != gpujpeg_image_planes_init(&coder->param_image, NULL, &output->planes)
+                || 0 != gpujpeg_image_planes_init(&coder->param_image, coder->d_data_raw, &d_planes)) {
+            return -1;
+        }
+        for (int plane = 0; plane < GPUJPEG_MAX_COMPONENT_COUNT && d_planes.data[plane] != NULL; plane++) {
+            int width;
+            int height;
+            gpujpeg_image_get_plane_size(&coder->param_image, plane, &width, &height);
+            gpujpeg_device_memcpy_2d_async(output->planes.data[plane], output->planes.pitch[plane], d_planes.data[plane], d_planes.pitch[plane],
+                                           width, height, cudaMemcpyDeviceToHost, *(decoder->stream));
+            coder->stats.download_size += (size_t)width * height;
+        }
+        gpujpeg_device_stream_synchronize(*(decoder->stream));
+        gpujpeg_device_check_error("Decoder raw data planes copy", return -1);
+
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_DOWNLOAD);
+    }
+    else if (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_PLANES) {
+        // Image was already directly decoded into custom CUDA planes
+        output->data = NULL;
     }
     else if (output->type == GPUJPEG_DECODER_OUTPUT_OPENGL_TEXTURE) {
         // If OpenGL texture wasn't mapped and used directly for decoding into it
         if (output->texture->texture_callback_attach_opengl != NULL) {
-            GPUJPEG_CUSTOM_TIMER_START(decoder->def);
+            gpujpeg_stats_host_start(coder, GPUJPEG_STATS_OPENGL);
 
             // Map OpenGL texture
             int data_size = 0;
             uint8_t* d_data = gpujpeg_opengl_texture_map(output->texture, &data_size);
             assert(data_size == coder->data_raw_size);
 
-            GPUJPEG_CUSTOM_TIMER_STOP(decoder->def);
-            coder->duration_memory_map = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->def);
-
-            GPUJPEG_CUSTOM_TIMER_START(decoder->def);
-
             // Copy decompressed image to texture pixel buffer object device data
-            cudaMemcpy(d_data, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToDevice);
+            gpujpeg_device_memcpy(d_data, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToDevice);
 
-            GPUJPEG_CUSTOM_TIMER_STOP(decoder->def);
-            coder->duration_memory_from = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->def);
+            gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_OPENGL);
         }
 
-        GPUJPEG_CUSTOM_TIMER_START(decoder->def);
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_OPENGL);
 
         // Unmap OpenGL texture
         gpujpeg_opengl_texture_unmap(output->texture);
 
-        GPUJPEG_CUSTOM_TIMER_STOP(decoder->def);
-        coder->duration_memory_unmap = GPUJPEG_CUSTOM_TIMER_DURATION(decoder->def);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_OPENGL);
     }
     else if (output->type == GPUJPEG_DECODER_OUTPUT_CUDA_BUFFER) {
         // Copy decompressed image to texture pixel buffer object device data
         output->data = coder->d_data_raw;
     }
-    else if (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_BUFFER) {
+    else if (output->type == GPUJPEG_DECODER_OUTPUT_CUSTOM_CUDA_BUFFER || output->type == GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR) {
         // Image was already directly decoded into custom CUDA buffer
         output->data = coder->d_data_raw;
     }
@@ -382,6 +1148,65 @@ gpujpeg_decoder_decode(struct gpujpeg_decoder* decoder, uint8_t* image, int imag
         assert(0);
     }
 
+    coder->stats.raw_size = coder->data_raw_size;
+    gpujpeg_stats_end(coder);
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_decoder_decode_batch(struct gpujpeg_decoder* decoder, uint8_t** image, int* image_size, int image_count, struct gpujpeg_decoder_output* output)
+{
+    if (output->type != GPUJPEG_DECODER_OUTPUT_CUDA_TENSOR) {
+        fprintf(stderr, "[GPUJPEG] [Error] Batch decoding requires tensor output!\n");
+        return -1;
+    }
+
+    // Decode every image into its slice of batch tensor
+    size_t offset = 0;
+    int image_tensor_size = 0;
+    for (int index = 0; index < image_count; index++) {
+        struct gpujpeg_decoder_output image_output = *output;
+        image_output.data = output->data + offset;
+        if (0 != gpujpeg_decoder_decode(decoder, image[index], image_size[index], &image_output)) {
+            fprintf(stderr, "[GPUJPEG] [Error] Failed to decode image %d of batch!\n", index);
+            return -1;
+        }
+        if (index == 0) {
+            image_tensor_size = image_output.data_size;
+        }
+        else if (image_output.data_size != image_tensor_size) {
+            fprintf(stderr, "[GPUJPEG] [Error] Image %d of batch has different size!\n", index);
+            return -1;
+        }
+        offset += image_tensor_size;
+    }
+    output->data_size = (int)offset;
+
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_decoder_get_coefficients(struct gpujpeg_decoder* decoder, struct gpujpeg_coefficients* coefficients)
+{
+    // Get coder
+    struct gpujpeg_coder* coder = &decoder->coder;
+    if (!decoder->coefficients_decoded) {
+        fprintf(stderr, "[GPUJPEG] [Error] Last image wasn't decoded to coefficients output!\n");
+        return -1;
+    }
+
+    coefficients->comp_count = coder->param_image.comp_count;
+    for (int comp = 0; comp < coder->param_image.comp_count; comp++) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        enum gpujpeg_component_type type = component->type;
+        coefficients->data[comp] = component->data_quantized;
+        coefficients->block_count_x[comp] = component->data_width / GPUJPEG_BLOCK_SIZE;
+        coefficients->block_count_y[comp] = component->data_height / GPUJPEG_BLOCK_SIZE;
+        memcpy(coefficients->quantization_table[comp], decoder->table_quantization[type].table, 64 * sizeof(uint16_t));
+    }
+
     return 0;
 }
 
@@ -394,6 +1219,62 @@ gpujpeg_decoder_set_output_format(struct gpujpeg_decoder* decoder,
         decoder->coder.param_image.pixel_format = sampling_factor;
 }
 
+/** Documented at declaration */
+void
+gpujpeg_decoder_set_output_alpha(struct gpujpeg_decoder* decoder, uint8_t alpha)
+{
+    decoder->coder.data_raw_alpha = alpha;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_set_sampling_filter(struct gpujpeg_decoder* decoder, enum gpujpeg_sampling_filter filter)
+{
+    decoder->sampling_filter = filter;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_set_host_threads(struct gpujpeg_decoder* decoder, int thread_count)
+{
+    decoder->host_thread_count = thread_count;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_set_route_model(struct gpujpeg_decoder* decoder, const struct gpujpeg_route_model* model)
+{
+    decoder->route_enabled = (model != NULL);
+    if (model != NULL) {
+        decoder->route_model = *model;
+    } else {
+        gpujpeg_route_model_set_default(&decoder->route_model);
+    }
+    decoder->huffman_host_cost = decoder->route_model.host_huffman;
+    decoder->huffman_device_cost = decoder->route_model.device_huffman / decoder->route_model.device_huffman_parallelism;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_decoder_set_stats(struct gpujpeg_decoder* decoder, int enabled)
+{
+    return gpujpeg_stats_set_enabled(&decoder->coder, enabled);
+}
+
+/** Documented at declaration */
+int
+gpujpeg_decoder_set_trace(struct gpujpeg_decoder* decoder, struct gpujpeg_trace* trace)
+{
+    return gpujpeg_stats_set_trace(&decoder->coder, trace, "decoder");
+}
+
+/** Documented at declaration */
+void
+gpujpeg_decoder_get_stats(struct gpujpeg_decoder* decoder, struct gpujpeg_stats* stats)
+{
+    *stats = decoder->coder.stats;
+}
+
 /** Documented at declaration */
 int
 gpujpeg_decoder_destroy(struct gpujpeg_decoder* decoder)
@@ -406,16 +1287,17 @@ gpujpeg_decoder_destroy(struct gpujpeg_decoder* decoder)
 
     for (int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++) {
         if (decoder->table_quantization[comp_type].d_table != NULL) {
-            cudaFree(decoder->table_quantization[comp_type].d_table);
+            gpujpeg_device_free(decoder->table_quantization[comp_type].d_table);
         }
     }
+    gpujpeg_table_huffman_decoder_cache_destroy(&decoder->table_huffman_cache);
 
     if (decoder->reader != NULL) {
         gpujpeg_reader_destroy(decoder->reader);
     }
 
     if (decoder->allocatedStream != NULL) {
-        cudaStreamDestroy(*(decoder->allocatedStream));
+        gpujpeg_device_stream_destroy(*(decoder->allocatedStream));
         free(decoder->allocatedStream);
         decoder->allocatedStream = NULL;
         decoder->stream = NULL;
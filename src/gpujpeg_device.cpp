@@ -0,0 +1,341 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gpujpeg_device.h"
+
+/** CUDA runtime launches kernel directly, stream is used by the kernel function */
+static cudaError_t
+gpujpeg_device_cuda_launch(const struct gpujpeg_device_kernel* kernel, const void* param, size_t param_size, cudaStream_t stream)
+{
+    (void)param_size;
+    (void)stream;
+    if ( kernel->device((void*)param) != 0 ) {
+        return cudaErrorLaunchFailure;
+    }
+    return cudaSuccess;
+}
+
+static cudaError_t
+gpujpeg_device_cuda_memcpy_async(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind, cudaStream_t stream)
+{
+    return cudaMemcpyAsync(dst, src, count, kind, stream);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_memcpy_2d_async(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width, size_t height,
+                                    enum cudaMemcpyKind kind, cudaStream_t stream)
+{
+    return cudaMemcpy2DAsync(dst, dpitch, src, spitch, width, height, kind, stream);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_memset_async(void* ptr, int value, size_t count, cudaStream_t stream)
+{
+    return cudaMemsetAsync(ptr, value, count, stream);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_malloc(void** ptr, size_t size)
+{
+    return cudaMalloc(ptr, size);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_malloc_host(void** ptr, size_t size)
+{
+    return cudaMallocHost(ptr, size);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_free(void* ptr)
+{
+    return cudaFree(ptr);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_free_host(void* ptr)
+{
+    return cudaFreeHost(ptr);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_memcpy(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind)
+{
+    return cudaMemcpy(dst, src, count, kind);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_stream_create(cudaStream_t* stream)
+{
+    return cudaStreamCreate(stream);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_stream_destroy(cudaStream_t stream)
+{
+    return cudaStreamDestroy(stream);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_stream_synchronize(cudaStream_t stream)
+{
+    return cudaStreamSynchronize(stream);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_stream_query(cudaStream_t stream)
+{
+    return cudaStreamQuery(stream);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_event_create(cudaEvent_t* event)
+{
+    return cudaEventCreate(event);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_event_destroy(cudaEvent_t event)
+{
+    return cudaEventDestroy(event);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_event_record(cudaEvent_t event, cudaStream_t stream)
+{
+    return cudaEventRecord(event, stream);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_event_synchronize(cudaEvent_t event)
+{
+    return cudaEventSynchronize(event);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_event_elapsed_time(float* ms, cudaEvent_t start, cudaEvent_t end)
+{
+    return cudaEventElapsedTime(ms, start, end);
+}
+
+static cudaError_t
+gpujpeg_device_cuda_get_last_error(void)
+{
+    return cudaGetLastError();
+}
+
+static const char*
+gpujpeg_device_cuda_get_error_string(cudaError_t error)
+{
+    return cudaGetErrorString(error);
+}
+
+/** Documented at declaration */
+const struct gpujpeg_device_runtime gpujpeg_device_runtime_cuda = {
+    "CUDA",
+    0,
+    &gpujpeg_device_cuda_malloc,
+    &gpujpeg_device_cuda_free,
+    &gpujpeg_device_cuda_malloc_host,
+    &gpujpeg_device_cuda_free_host,
+    &gpujpeg_device_cuda_memcpy,
+    &gpujpeg_device_cuda_memcpy_async,
+    &gpujpeg_device_cuda_memcpy_2d_async,
+    &gpujpeg_device_cuda_memset_async,
+    &gpujpeg_device_cuda_stream_create,
+    &gpujpeg_device_cuda_stream_destroy,
+    &gpujpeg_device_cuda_stream_synchronize,
+    &gpujpeg_device_cuda_stream_query,
+    &gpujpeg_device_cuda_event_create,
+    &gpujpeg_device_cuda_event_destroy,
+    &gpujpeg_device_cuda_event_record,
+    &gpujpeg_device_cuda_event_synchronize,
+    &gpujpeg_device_cuda_event_elapsed_time,
+    &gpujpeg_device_cuda_launch,
+    &gpujpeg_device_cuda_get_last_error,
+    &gpujpeg_device_cuda_get_error_string
+};
+
+/** Current device runtime */
+static const struct gpujpeg_device_runtime* gpujpeg_device_runtime = &gpujpeg_device_runtime_cuda;
+
+/** Documented at declaration */
+const struct gpujpeg_device_runtime*
+gpujpeg_device_get_runtime(void)
+{
+    return gpujpeg_device_runtime;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_device_set_runtime(const struct gpujpeg_device_runtime* runtime)
+{
+    gpujpeg_device_runtime = runtime;
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_launch(const struct gpujpeg_device_kernel* kernel, const void* param, size_t param_size, cudaStream_t stream)
+{
+    return gpujpeg_device_runtime->launch(kernel, param, param_size, stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_malloc(void** ptr, size_t size)
+{
+    return gpujpeg_device_runtime->malloc(ptr, size);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_free(void* ptr)
+{
+    return gpujpeg_device_runtime->free(ptr);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_malloc_host(void** ptr, size_t size)
+{
+    return gpujpeg_device_runtime->malloc_host(ptr, size);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_free_host(void* ptr)
+{
+    return gpujpeg_device_runtime->free_host(ptr);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_memcpy(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind)
+{
+    return gpujpeg_device_runtime->memcpy(dst, src, count, kind);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_memcpy_async(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind, cudaStream_t stream)
+{
+    return gpujpeg_device_runtime->memcpy_async(dst, src, count, kind, stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_memcpy_2d_async(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width, size_t height,
+                               enum cudaMemcpyKind kind, cudaStream_t stream)
+{
+    return gpujpeg_device_runtime->memcpy_2d_async(dst, dpitch, src, spitch, width, height, kind, stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_memset_async(void* ptr, int value, size_t count, cudaStream_t stream)
+{
+    return gpujpeg_device_runtime->memset_async(ptr, value, count, stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_stream_create(cudaStream_t* stream)
+{
+    return gpujpeg_device_runtime->stream_create(stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_stream_destroy(cudaStream_t stream)
+{
+    return gpujpeg_device_runtime->stream_destroy(stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_stream_synchronize(cudaStream_t stream)
+{
+    return gpujpeg_device_runtime->stream_synchronize(stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_stream_query(cudaStream_t stream)
+{
+    return gpujpeg_device_runtime->stream_query(stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_event_create(cudaEvent_t* event)
+{
+    return gpujpeg_device_runtime->event_create(event);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_event_destroy(cudaEvent_t event)
+{
+    return gpujpeg_device_runtime->event_destroy(event);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_event_record(cudaEvent_t event, cudaStream_t stream)
+{
+    return gpujpeg_device_runtime->event_record(event, stream);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_event_synchronize(cudaEvent_t event)
+{
+    return gpujpeg_device_runtime->event_synchronize(event);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_event_elapsed_time(float* ms, cudaEvent_t start, cudaEvent_t end)
+{
+    return gpujpeg_device_runtime->event_elapsed_time(ms, start, end);
+}
+
+/** Documented at declaration */
+cudaError_t
+gpujpeg_device_get_last_error(void)
+{
+    return gpujpeg_device_runtime->get_last_error();
+}
+
+/** Documented at declaration */
+const char*
+gpujpeg_device_get_error_string(cudaError_t error)
+{
+    return gpujpeg_device_runtime->get_error_string(error);
+}
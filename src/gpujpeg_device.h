@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_DEVICE_H
+#define GPUJPEG_DEVICE_H
+
+#include <libgpujpeg/gpujpeg_common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Device runtime executes memory operations, stream synchronization and kernels
+ * of encoder and decoder pipelines. CUDA runtime forwards them to CUDA, host
+ * runtime emulates device memory by host memory and runs kernels as CPU functions
+ * (see gpujpeg_device_runtime_host). Runtime is selected for whole process by
+ * gpujpeg_init_device (GPUJPEG_HOST_RUNTIME flag).
+ */
+
+/**
+ * Kernel function, it gets copy of parameters passed to gpujpeg_device_launch
+ *
+ * @param param  Kernel parameters
+ * @return 0 if succeeds, otherwise nonzero
+ */
+typedef int (*gpujpeg_device_kernel_function_t)(void* param);
+
+/** Kernel of pipeline stage */
+struct gpujpeg_device_kernel
+{
+    // Kernel name (for error reporting)
+    const char* name;
+    // Function launching CUDA kernels to the stream
+    gpujpeg_device_kernel_function_t device;
+    // Function performing the stage on CPU with device memory emulated by host memory (NULL when not available)
+    gpujpeg_device_kernel_function_t host;
+};
+
+/** Device runtime, functions follow semantics of CUDA runtime functions of the same name */
+struct gpujpeg_device_runtime
+{
+    // Runtime name
+    const char* name;
+    // Flag if device memory is host memory and kernels are run by their host function
+    int host;
+
+    cudaError_t (*malloc)(void** ptr, size_t size);
+    cudaError_t (*free)(void* ptr);
+    cudaError_t (*malloc_host)(void** ptr, size_t size);
+    cudaError_t (*free_host)(void* ptr);
+    cudaError_t (*memcpy)(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind);
+    cudaError_t (*memcpy_async)(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind, cudaStream_t stream);
+    cudaError_t (*memcpy_2d_async)(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width, size_t height,
+                                   enum cudaMemcpyKind kind, cudaStream_t stream);
+    cudaError_t (*memset_async)(void* ptr, int value, size_t count, cudaStream_t stream);
+    cudaError_t (*stream_create)(cudaStream_t* stream);
+    cudaError_t (*stream_destroy)(cudaStream_t stream);
+    cudaError_t (*stream_synchronize)(cudaStream_t stream);
+    cudaError_t (*stream_query)(cudaStream_t stream);
+    cudaError_t (*event_create)(cudaEvent_t* event);
+    cudaError_t (*event_destroy)(cudaEvent_t event);
+    cudaError_t (*event_record)(cudaEvent_t event, cudaStream_t stream);
+    cudaError_t (*event_synchronize)(cudaEvent_t event);
+    cudaError_t (*event_elapsed_time)(float* ms, cudaEvent_t start, cudaEvent_t end);
+    cudaError_t (*launch)(const struct gpujpeg_device_kernel* kernel, const void* param, size_t param_size, cudaStream_t stream);
+    cudaError_t (*get_last_error)(void);
+    const char* (*get_error_string)(cudaError_t error);
+};
+
+/** Runtime forwarding to CUDA (default) */
+extern const struct gpujpeg_device_runtime gpujpeg_device_runtime_cuda;
+
+/**
+ * Runtime emulating device by host memory and CPU functions. Operations of each
+ * stream are deferred until the stream is synchronized (or queried), synchronous
+ * operations and freeing memory first complete all streams, so missing sync points
+ * show up as stale data. Device memory is filled by garbage when allocated and
+ * device side of each copy must lie inside of live allocation. Events get CPU
+ * time when their stream reaches them.
+ */
+extern const struct gpujpeg_device_runtime gpujpeg_device_runtime_host;
+
+/**
+ * Get current device runtime
+ *
+ * @return device runtime
+ */
+const struct gpujpeg_device_runtime*
+gpujpeg_device_get_runtime(void);
+
+/**
+ * Set current device runtime (it must be set before any encoder or decoder is created)
+ *
+ * @param runtime  Device runtime
+ */
+void
+gpujpeg_device_set_runtime(const struct gpujpeg_device_runtime* runtime);
+
+/**
+ * Get number of live allocations of host runtime and print them out when requested
+ *
+ * @param verbose  Print out live allocations
+ * @return number of allocations which aren't freed
+ */
+int
+gpujpeg_device_host_allocation_count(int verbose);
+
+/**
+ * Launch kernel to stream by current runtime, parameters are copied, so they
+ * don't have to outlive the call
+ *
+ * @param kernel  Kernel of pipeline stage
+ * @param param  Kernel parameters
+ * @param param_size  Size of kernel parameters
+ * @param stream  CUDA stream
+ * @return cudaSuccess if succeeds, otherwise error
+ */
+cudaError_t
+gpujpeg_device_launch(const struct gpujpeg_device_kernel* kernel, const void* param, size_t param_size, cudaStream_t stream);
+
+/** Functions calling current runtime (see gpujpeg_device_runtime) */
+cudaError_t gpujpeg_device_malloc(void** ptr, size_t size);
+cudaError_t gpujpeg_device_free(void* ptr);
+cudaError_t gpujpeg_device_malloc_host(void** ptr, size_t size);
+cudaError_t gpujpeg_device_free_host(void* ptr);
+cudaError_t gpujpeg_device_memcpy(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind);
+cudaError_t gpujpeg_device_memcpy_async(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind, cudaStream_t stream);
+cudaError_t gpujpeg_device_memcpy_2d_async(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width, size_t height,
+                                           enum cudaMemcpyKind kind, cudaStream_t stream);
+cudaError_t gpujpeg_device_memset_async(void* ptr, int value, size_t count, cudaStream_t stream);
+cudaError_t gpujpeg_device_stream_create(cudaStream_t* stream);
+cudaError_t gpujpeg_device_stream_destroy(cudaStream_t stream);
+cudaError_t gpujpeg_device_stream_synchronize(cudaStream_t stream);
+cudaError_t gpujpeg_device_stream_query(cudaStream_t stream);
+cudaError_t gpujpeg_device_event_create(cudaEvent_t* event);
+cudaError_t gpujpeg_device_event_destroy(cudaEvent_t event);
+cudaError_t gpujpeg_device_event_record(cudaEvent_t event, cudaStream_t stream);
+cudaError_t gpujpeg_device_event_synchronize(cudaEvent_t event);
+cudaError_t gpujpeg_device_event_elapsed_time(float* ms, cudaEvent_t start, cudaEvent_t end);
+cudaError_t gpujpeg_device_get_last_error(void);
+const char* gpujpeg_device_get_error_string(cudaError_t error);
+
+/** Check last error of current runtime (see gpujpeg_cuda_check_error) */
+#define gpujpeg_device_check_error(msg, action) \
+    { \
+        cudaError_t err = gpujpeg_device_get_last_error(); \
+        if( cudaSuccess != err) { \
+            fprintf(stderr, "[GPUJPEG] [Error] %s (line %i): %s: %s.\n", \
+                __FILE__, __LINE__, msg, gpujpeg_device_get_error_string(err)); \
+            action; \
+        } \
+    } \
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_DEVICE_H
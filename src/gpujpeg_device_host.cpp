@@ -0,0 +1,613 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gpujpeg_device.h"
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/** Memory allocated by host runtime */
+struct gpujpeg_device_host_allocation
+{
+    // Allocated memory
+    uint8_t* data;
+    // Allocation size
+    size_t size;
+    // Flag if memory is (pinned) host memory, otherwise it emulates device memory
+    int host;
+};
+
+/** Event of host runtime */
+struct gpujpeg_device_host_event
+{
+    // Flag if event was recorded
+    int recorded;
+    // Flag if stream reached the event
+    int completed;
+    // Time when stream reached the event [s]
+    double time;
+};
+
+/** Operation deferred in stream of host runtime */
+struct gpujpeg_device_host_operation
+{
+    // Destination of copy or memset
+    uint8_t* dst;
+    // Source of copy (NULL for memset)
+    const uint8_t* src;
+    // Copied or set bytes of each row
+    size_t width;
+    // Number of rows
+    size_t height;
+    // Pitch of destination and source rows
+    size_t dpitch;
+    size_t spitch;
+    // Memset value
+    int value;
+    // Launched kernel (NULL for copy and memset)
+    const struct gpujpeg_device_kernel* kernel;
+    // Recorded event (NULL for other operations)
+    struct gpujpeg_device_host_event* event;
+    // Copy of kernel parameters
+    std::vector<uint8_t> param;
+};
+
+/** Stream of host runtime */
+struct gpujpeg_device_host_stream
+{
+    // Operations which aren't executed yet
+    std::vector<struct gpujpeg_device_host_operation> operations;
+};
+
+/** Lock of host runtime state */
+static std::mutex gpujpeg_device_host_mutex;
+/** Live allocations */
+static std::vector<struct gpujpeg_device_host_allocation> gpujpeg_device_host_allocations;
+/** Created streams */
+static std::vector<struct gpujpeg_device_host_stream*> gpujpeg_device_host_streams;
+/** Last error */
+static cudaError_t gpujpeg_device_host_error = cudaSuccess;
+
+/**
+ * Record error as the last error
+ *
+ * @return error
+ */
+static cudaError_t
+gpujpeg_device_host_set_error(cudaError_t error)
+{
+    if ( error != cudaSuccess ) {
+        std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+        gpujpeg_device_host_error = error;
+    }
+    return error;
+}
+
+/**
+ * Check that memory range lies inside of live allocation (the lock must be held)
+ *
+ * @return 1 if range is allocated, otherwise 0
+ */
+static int
+gpujpeg_device_host_allocated(const void* ptr, size_t size, int host)
+{
+    const uint8_t* begin = (const uint8_t*)ptr;
+    for ( size_t index = 0; index < gpujpeg_device_host_allocations.size(); index++ ) {
+        const struct gpujpeg_device_host_allocation* allocation = &gpujpeg_device_host_allocations[index];
+        if ( allocation->host == host && begin >= allocation->data && begin + size <= allocation->data + allocation->size ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Check that device side of copy or memset lies inside of live device allocation
+ *
+ * @return cudaSuccess if succeeds, otherwise cudaErrorInvalidValue
+ */
+static cudaError_t
+gpujpeg_device_host_check(const struct gpujpeg_device_host_operation* operation, enum cudaMemcpyKind kind)
+{
+    if ( operation->height == 0 || operation->width == 0 ) {
+        return cudaSuccess;
+    }
+    size_t dst_size = (operation->height - 1) * operation->dpitch + operation->width;
+    size_t src_size = (operation->height - 1) * operation->spitch + operation->width;
+    int dst_device = (operation->src == NULL || kind == cudaMemcpyHostToDevice || kind == cudaMemcpyDeviceToDevice);
+    int src_device = (operation->src != NULL && (kind == cudaMemcpyDeviceToHost || kind == cudaMemcpyDeviceToDevice));
+
+    std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+    if ( dst_device && !gpujpeg_device_host_allocated(operation->dst, dst_size, 0) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Host runtime accesses %zu bytes at %p outside of device allocations!\n", dst_size, (void*)operation->dst);
+        gpujpeg_device_host_error = cudaErrorInvalidValue;
+        return cudaErrorInvalidValue;
+    }
+    if ( src_device && !gpujpeg_device_host_allocated(operation->src, src_size, 0) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Host runtime accesses %zu bytes at %p outside of device allocations!\n", src_size, (const void*)operation->src);
+        gpujpeg_device_host_error = cudaErrorInvalidValue;
+        return cudaErrorInvalidValue;
+    }
+    return cudaSuccess;
+}
+
+/**
+ * Execute operation
+ *
+ * @return cudaSuccess if succeeds, otherwise error
+ */
+static cudaError_t
+gpujpeg_device_host_execute(struct gpujpeg_device_host_operation* operation)
+{
+    if ( operation->event != NULL ) {
+        operation->event->time = gpujpeg_get_time();
+        operation->event->completed = 1;
+    }
+    else if ( operation->kernel != NULL ) {
+        if ( operation->kernel->host(operation->param.data()) != 0 ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Kernel %s failed on host runtime!\n", operation->kernel->name);
+            return cudaErrorLaunchFailure;
+        }
+    }
+    else if ( operation->src != NULL ) {
+        for ( size_t row = 0; row < operation->height; row++ ) {
+            memmove(operation->dst + row * operation->dpitch, operation->src + row * operation->spitch, operation->width);
+        }
+    }
+    else {
+        memset(operation->dst, operation->value, operation->width);
+    }
+    return cudaSuccess;
+}
+
+/**
+ * Find stream (the lock must be held)
+ *
+ * @return index of stream or -1
+ */
+static int
+gpujpeg_device_host_find_stream(cudaStream_t stream)
+{
+    for ( size_t index = 0; index < gpujpeg_device_host_streams.size(); index++ ) {
+        if ( (cudaStream_t)gpujpeg_device_host_streams[index] == stream ) {
+            return (int)index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Execute deferred operations of stream in order (operations after failed one are dropped)
+ *
+ * @return cudaSuccess if succeeds, otherwise error
+ */
+static cudaError_t
+gpujpeg_device_host_flush(cudaStream_t stream)
+{
+    std::vector<struct gpujpeg_device_host_operation> operations;
+    {
+        std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+        int index = gpujpeg_device_host_find_stream(stream);
+        if ( index < 0 ) {
+            gpujpeg_device_host_error = cudaErrorInvalidResourceHandle;
+            return cudaErrorInvalidResourceHandle;
+        }
+        operations.swap(gpujpeg_device_host_streams[index]->operations);
+    }
+    for ( size_t index = 0; index < operations.size(); index++ ) {
+        cudaError_t error = gpujpeg_device_host_execute(&operations[index]);
+        if ( error != cudaSuccess ) {
+            return gpujpeg_device_host_set_error(error);
+        }
+    }
+    return cudaSuccess;
+}
+
+/**
+ * Execute deferred operations of all streams (synchronous operations and freeing wait for whole device)
+ *
+ * @return cudaSuccess if succeeds, otherwise error
+ */
+static cudaError_t
+gpujpeg_device_host_flush_all()
+{
+    std::vector<struct gpujpeg_device_host_stream*> streams;
+    {
+        std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+        streams = gpujpeg_device_host_streams;
+    }
+    cudaError_t result = cudaSuccess;
+    for ( size_t index = 0; index < streams.size(); index++ ) {
+        cudaError_t error = gpujpeg_device_host_flush((cudaStream_t)streams[index]);
+        if ( result == cudaSuccess ) {
+            result = error;
+        }
+    }
+    return result;
+}
+
+/**
+ * Defer operation to stream, operations of default stream are executed immediately
+ * after all streams are completed
+ *
+ * @return cudaSuccess if succeeds, otherwise error
+ */
+static cudaError_t
+gpujpeg_device_host_enqueue(struct gpujpeg_device_host_operation* operation, cudaStream_t stream)
+{
+    if ( stream == NULL ) {
+        cudaError_t error = gpujpeg_device_host_flush_all();
+        if ( error != cudaSuccess ) {
+            return error;
+        }
+        return gpujpeg_device_host_set_error(gpujpeg_device_host_execute(operation));
+    }
+
+    std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+    int index = gpujpeg_device_host_find_stream(stream);
+    if ( index < 0 ) {
+        gpujpeg_device_host_error = cudaErrorInvalidResourceHandle;
+        return cudaErrorInvalidResourceHandle;
+    }
+    gpujpeg_device_host_streams[index]->operations.push_back(*operation);
+    return cudaSuccess;
+}
+
+/**
+ * Allocate memory filled by garbage
+ *
+ * @return cudaSuccess if succeeds, otherwise error
+ */
+static cudaError_t
+gpujpeg_device_host_allocate(void** ptr, size_t size, int host)
+{
+    struct gpujpeg_device_host_allocation allocation;
+    allocation.data = (uint8_t*)malloc(size > 0 ? size : 1);
+    allocation.size = size;
+    allocation.host = host;
+    if ( allocation.data == NULL ) {
+        *ptr = NULL;
+        return gpujpeg_device_host_set_error(cudaErrorMemoryAllocation);
+    }
+    memset(allocation.data, 0xCD, size);
+
+    std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+    gpujpeg_device_host_allocations.push_back(allocation);
+    *ptr = allocation.data;
+    return cudaSuccess;
+}
+
+/**
+ * Free memory after all streams are completed
+ *
+ * @return cudaSuccess if succeeds, otherwise error
+ */
+static cudaError_t
+gpujpeg_device_host_release(void* ptr, int host)
+{
+    if ( ptr == NULL ) {
+        return cudaSuccess;
+    }
+    cudaError_t error = gpujpeg_device_host_flush_all();
+
+    std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+    for ( size_t index = 0; index < gpujpeg_device_host_allocations.size(); index++ ) {
+        if ( gpujpeg_device_host_allocations[index].data == ptr && gpujpeg_device_host_allocations[index].host == host ) {
+            free(ptr);
+            gpujpeg_device_host_allocations.erase(gpujpeg_device_host_allocations.begin() + index);
+            return error;
+        }
+    }
+    fprintf(stderr, "[GPUJPEG] [Error] Host runtime frees %s memory at %p which isn't allocated!\n", host ? "host" : "device", ptr);
+    gpujpeg_device_host_error = cudaErrorInvalidValue;
+    return cudaErrorInvalidValue;
+}
+
+static cudaError_t
+gpujpeg_device_host_malloc(void** ptr, size_t size)
+{
+    return gpujpeg_device_host_allocate(ptr, size, 0);
+}
+
+static cudaError_t
+gpujpeg_device_host_free(void* ptr)
+{
+    return gpujpeg_device_host_release(ptr, 0);
+}
+
+static cudaError_t
+gpujpeg_device_host_malloc_host(void** ptr, size_t size)
+{
+    return gpujpeg_device_host_allocate(ptr, size, 1);
+}
+
+static cudaError_t
+gpujpeg_device_host_free_host(void* ptr)
+{
+    return gpujpeg_device_host_release(ptr, 1);
+}
+
+static cudaError_t
+gpujpeg_device_host_memcpy_2d_async(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width, size_t height,
+                                    enum cudaMemcpyKind kind, cudaStream_t stream)
+{
+    struct gpujpeg_device_host_operation operation;
+    operation.dst = (uint8_t*)dst;
+    operation.src = (const uint8_t*)src;
+    operation.width = width;
+    operation.height = height;
+    operation.dpitch = dpitch;
+    operation.spitch = spitch;
+    operation.value = 0;
+    operation.kernel = NULL;
+    operation.event = NULL;
+    cudaError_t error = gpujpeg_device_host_check(&operation, kind);
+    if ( error != cudaSuccess ) {
+        return error;
+    }
+    return gpujpeg_device_host_enqueue(&operation, stream);
+}
+
+static cudaError_t
+gpujpeg_device_host_memcpy_async(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind, cudaStream_t stream)
+{
+    return gpujpeg_device_host_memcpy_2d_async(dst, count, src, count, count, 1, kind, stream);
+}
+
+static cudaError_t
+gpujpeg_device_host_memcpy(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind)
+{
+    return gpujpeg_device_host_memcpy_2d_async(dst, count, src, count, count, 1, kind, NULL);
+}
+
+static cudaError_t
+gpujpeg_device_host_memset_async(void* ptr, int value, size_t count, cudaStream_t stream)
+{
+    struct gpujpeg_device_host_operation operation;
+    operation.dst = (uint8_t*)ptr;
+    operation.src = NULL;
+    operation.width = count;
+    operation.height = 1;
+    operation.dpitch = count;
+    operation.spitch = count;
+    operation.value = value;
+    operation.kernel = NULL;
+    operation.event = NULL;
+    cudaError_t error = gpujpeg_device_host_check(&operation, cudaMemcpyHostToDevice);
+    if ( error != cudaSuccess ) {
+        return error;
+    }
+    return gpujpeg_device_host_enqueue(&operation, stream);
+}
+
+static cudaError_t
+gpujpeg_device_host_launch(const struct gpujpeg_device_kernel* kernel, const void* param, size_t param_size, cudaStream_t stream)
+{
+    if ( kernel->host == NULL ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Kernel %s isn't available on host runtime!\n", kernel->name);
+        return gpujpeg_device_host_set_error(cudaErrorInvalidDeviceFunction);
+    }
+    struct gpujpeg_device_host_operation operation;
+    operation.dst = NULL;
+    operation.src = NULL;
+    operation.width = 0;
+    operation.height = 0;
+    operation.dpitch = 0;
+    operation.spitch = 0;
+    operation.value = 0;
+    operation.kernel = kernel;
+    operation.event = NULL;
+    operation.param.assign((const uint8_t*)param, (const uint8_t*)param + param_size);
+    return gpujpeg_device_host_enqueue(&operation, stream);
+}
+
+static cudaError_t
+gpujpeg_device_host_stream_create(cudaStream_t* stream)
+{
+    struct gpujpeg_device_host_stream* host_stream = new gpujpeg_device_host_stream;
+    std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+    gpujpeg_device_host_streams.push_back(host_stream);
+    *stream = (cudaStream_t)host_stream;
+    return cudaSuccess;
+}
+
+static cudaError_t
+gpujpeg_device_host_stream_destroy(cudaStream_t stream)
+{
+    cudaError_t error = gpujpeg_device_host_flush(stream);
+    if ( error == cudaErrorInvalidResourceHandle ) {
+        return error;
+    }
+
+    std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+    int index = gpujpeg_device_host_find_stream(stream);
+    delete gpujpeg_device_host_streams[index];
+    gpujpeg_device_host_streams.erase(gpujpeg_device_host_streams.begin() + index);
+    return error;
+}
+
+static cudaError_t
+gpujpeg_device_host_stream_synchronize(cudaStream_t stream)
+{
+    if ( stream == NULL ) {
+        return gpujpeg_device_host_flush_all();
+    }
+    return gpujpeg_device_host_flush(stream);
+}
+
+/** Pending operations are reported as running and then executed, so polling makes progress */
+static cudaError_t
+gpujpeg_device_host_stream_query(cudaStream_t stream)
+{
+    int pending = 0;
+    {
+        std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+        for ( size_t index = 0; index < gpujpeg_device_host_streams.size(); index++ ) {
+            if ( stream == NULL || (cudaStream_t)gpujpeg_device_host_streams[index] == stream ) {
+                pending += (int)gpujpeg_device_host_streams[index]->operations.size();
+            }
+        }
+    }
+    cudaError_t error = gpujpeg_device_host_stream_synchronize(stream);
+    if ( error != cudaSuccess ) {
+        return error;
+    }
+    return pending > 0 ? cudaErrorNotReady : cudaSuccess;
+}
+
+static cudaError_t
+gpujpeg_device_host_event_create(cudaEvent_t* event)
+{
+    struct gpujpeg_device_host_event* host_event = new gpujpeg_device_host_event;
+    host_event->recorded = 0;
+    host_event->completed = 0;
+    host_event->time = 0.0;
+    *event = (cudaEvent_t)host_event;
+    return cudaSuccess;
+}
+
+static cudaError_t
+gpujpeg_device_host_event_destroy(cudaEvent_t event)
+{
+    // Streams can still reference the event
+    cudaError_t error = gpujpeg_device_host_flush_all();
+    delete (struct gpujpeg_device_host_event*)event;
+    return error;
+}
+
+static cudaError_t
+gpujpeg_device_host_event_record(cudaEvent_t event, cudaStream_t stream)
+{
+    struct gpujpeg_device_host_event* host_event = (struct gpujpeg_device_host_event*)event;
+    host_event->recorded = 1;
+    host_event->completed = 0;
+
+    struct gpujpeg_device_host_operation operation;
+    operation.dst = NULL;
+    operation.src = NULL;
+    operation.width = 0;
+    operation.height = 0;
+    operation.dpitch = 0;
+    operation.spitch = 0;
+    operation.value = 0;
+    operation.kernel = NULL;
+    operation.event = host_event;
+    return gpujpeg_device_host_enqueue(&operation, stream);
+}
+
+static cudaError_t
+gpujpeg_device_host_event_synchronize(cudaEvent_t event)
+{
+    if ( ((struct gpujpeg_device_host_event*)event)->completed ) {
+        return cudaSuccess;
+    }
+    return gpujpeg_device_host_flush_all();
+}
+
+static cudaError_t
+gpujpeg_device_host_event_elapsed_time(float* ms, cudaEvent_t start, cudaEvent_t end)
+{
+    const struct gpujpeg_device_host_event* start_event = (const struct gpujpeg_device_host_event*)start;
+    const struct gpujpeg_device_host_event* end_event = (const struct gpujpeg_device_host_event*)end;
+    if ( !start_event->recorded || !end_event->recorded ) {
+        return gpujpeg_device_host_set_error(cudaErrorInvalidResourceHandle);
+    }
+    if ( !start_event->completed || !end_event->completed ) {
+        return gpujpeg_device_host_set_error(cudaErrorNotReady);
+    }
+    *ms = (float)((end_event->time - start_event->time) * 1000.0);
+    return cudaSuccess;
+}
+
+static cudaError_t
+gpujpeg_device_host_get_last_error(void)
+{
+    std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+    cudaError_t error = gpujpeg_device_host_error;
+    gpujpeg_device_host_error = cudaSuccess;
+    return error;
+}
+
+static const char*
+gpujpeg_device_host_get_error_string(cudaError_t error)
+{
+    switch ( error ) {
+    case cudaSuccess: return "no error";
+    case cudaErrorMemoryAllocation: return "out of memory";
+    case cudaErrorInvalidValue: return "invalid argument";
+    case cudaErrorInvalidResourceHandle: return "invalid resource handle";
+    case cudaErrorInvalidDeviceFunction: return "invalid device function";
+    case cudaErrorLaunchFailure: return "unspecified launch failure";
+    case cudaErrorNotReady: return "device not ready";
+    default: return "unknown error";
+    }
+}
+
+/** Documented at declaration */
+const struct gpujpeg_device_runtime gpujpeg_device_runtime_host = {
+    "host",
+    1,
+    &gpujpeg_device_host_malloc,
+    &gpujpeg_device_host_free,
+    &gpujpeg_device_host_malloc_host,
+    &gpujpeg_device_host_free_host,
+    &gpujpeg_device_host_memcpy,
+    &gpujpeg_device_host_memcpy_async,
+    &gpujpeg_device_host_memcpy_2d_async,
+    &gpujpeg_device_host_memset_async,
+    &gpujpeg_device_host_stream_create,
+    &gpujpeg_device_host_stream_destroy,
+    &gpujpeg_device_host_stream_synchronize,
+    &gpujpeg_device_host_stream_query,
+    &gpujpeg_device_host_event_create,
+    &gpujpeg_device_host_event_destroy,
+    &gpujpeg_device_host_event_record,
+    &gpujpeg_device_host_event_synchronize,
+    &gpujpeg_device_host_event_elapsed_time,
+    &gpujpeg_device_host_launch,
+    &gpujpeg_device_host_get_last_error,
+    &gpujpeg_device_host_get_error_string
+};
+
+/** Documented at declaration */
+int
+gpujpeg_device_host_allocation_count(int verbose)
+{
+    std::lock_guard<std::mutex> lock(gpujpeg_device_host_mutex);
+    if ( verbose ) {
+        for ( size_t index = 0; index < gpujpeg_device_host_allocations.size(); index++ ) {
+            const struct gpujpeg_device_host_allocation* allocation = &gpujpeg_device_host_allocations[index];
+            printf("[GPUJPEG] [Info] Host runtime %s allocation of %zu bytes at %p is live\n",
+                   allocation->host ? "host" : "device", allocation->size, (void*)allocation->data);
+        }
+    }
+    return (int)gpujpeg_device_host_allocations.size();
+}
@@ -32,9 +32,13 @@
 #include "gpujpeg_preprocessor.h"
 #include "gpujpeg_dct_cpu.h"
 #include "gpujpeg_dct_gpu.h"
+#include "gpujpeg_device.h"
 #include "gpujpeg_huffman_cpu_encoder.h"
+#include "gpujpeg_sparse.h"
 #include "gpujpeg_huffman_gpu_encoder.h"
+#include "gpujpeg_thread.h"
 #include <math.h>
+#include <libgpujpeg/gpujpeg_stats_internal.h>
 #include <libgpujpeg/gpujpeg_util.h>
 
 /** Documented at declaration */
@@ -44,6 +48,9 @@ gpujpeg_encoder_input_set_image(struct gpujpeg_encoder_input* input, uint8_t* im
     input->type = GPUJPEG_ENCODER_INPUT_IMAGE;
     input->image = image;
     input->texture = NULL;
+    input->coefficients = NULL;
+    input->width = 0;
+    input->height = 0;
 }
 
 /** Documented at declaration */
@@ -53,6 +60,9 @@ gpujpeg_encoder_input_set_gpu_image(struct gpujpeg_encoder_input* input, uint8_t
     input->type = GPUJPEG_ENCODER_INPUT_GPU_IMAGE;
     input->image = image;
     input->texture = NULL;
+    input->coefficients = NULL;
+    input->width = 0;
+    input->height = 0;
 }
 
 /** Documented at declaration */
@@ -62,6 +72,56 @@ gpujpeg_encoder_input_set_texture(struct gpujpeg_encoder_input* input, struct gp
     input->type = GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE;
     input->image = NULL;
     input->texture = texture;
+    input->coefficients = NULL;
+    input->width = 0;
+    input->height = 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_encoder_input_set_coefficients(struct gpujpeg_encoder_input* input, const struct gpujpeg_coefficients* coefficients)
+{
+    input->type = GPUJPEG_ENCODER_INPUT_COEFFICIENTS;
+    input->image = NULL;
+    input->texture = NULL;
+    input->coefficients = coefficients;
+    input->width = 0;
+    input->height = 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_encoder_input_set_image_planes(struct gpujpeg_encoder_input* input, const struct gpujpeg_image_planes* planes)
+{
+    input->type = GPUJPEG_ENCODER_INPUT_IMAGE_PLANES;
+    input->image = NULL;
+    input->texture = NULL;
+    input->coefficients = NULL;
+    input->planes = *planes;
+    input->width = 0;
+    input->height = 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_encoder_input_set_gpu_image_planes(struct gpujpeg_encoder_input* input, const struct gpujpeg_image_planes* planes)
+{
+    input->type = GPUJPEG_ENCODER_INPUT_GPU_IMAGE_PLANES;
+    input->image = NULL;
+    input->texture = NULL;
+    input->coefficients = NULL;
+    input->planes = *planes;
+    input->width = 0;
+    input->height = 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_encoder_input_set_resize(struct gpujpeg_encoder_input* input, int width, int height, enum gpujpeg_resize_filter filter)
+{
+    input->width = width;
+    input->height = height;
+    input->filter = filter;
 }
 
 /** Documented at declaration */
@@ -73,6 +133,7 @@ gpujpeg_encoder_create(cudaStream_t * stream)
         return NULL;
     }
     memset(encoder, 0, sizeof(struct gpujpeg_encoder));
+    gpujpeg_route_model_set_default(&encoder->route_model);
 
     // Get coder
     struct gpujpeg_coder* coder = &encoder->coder;
@@ -90,35 +151,37 @@ gpujpeg_encoder_create(cudaStream_t * stream)
 
     // Allocate quantization tables in device memory
     for ( int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++ ) {
-        if ( cudaSuccess != cudaMalloc((void**)&encoder->table_quantization[comp_type].d_table, 64 * sizeof(uint16_t)) ) {
+        if ( cudaSuccess != gpujpeg_device_malloc((void**)&encoder->table_quantization[comp_type].d_table, 64 * sizeof(uint16_t)) ) {
             result = 0;
         }
-        if ( cudaSuccess != cudaMalloc((void**)&encoder->table_quantization[comp_type].d_table_forward, 64 * sizeof(float)) ) {
+        if ( cudaSuccess != gpujpeg_device_malloc((void**)&encoder->table_quantization[comp_type].d_table_forward, 64 * sizeof(float)) ) {
             result = 0;
         }
     }
-    gpujpeg_cuda_check_error("Encoder table allocation", return NULL);
+    gpujpeg_device_check_error("Encoder table allocation", return NULL);
 
     // Init huffman tables for encoder
     for ( int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++ ) {
         for ( int huff_type = 0; huff_type < GPUJPEG_HUFFMAN_TYPE_COUNT; huff_type++ ) {
-            if ( gpujpeg_table_huffman_encoder_init(&encoder->table_huffman[comp_type][huff_type], (enum gpujpeg_component_type)comp_type, (enum gpujpeg_huffman_type)huff_type) != 0 )
+            if ( gpujpeg_table_huffman_encoder_init(&encoder->table_huffman[comp_type][huff_type], (enum gpujpeg_component_type)comp_type, (enum gpujpeg_huffman_type)huff_type, 8) != 0 )
                 result = 0;
         }
     }
-    gpujpeg_cuda_check_error("Encoder table init", return NULL);
+    gpujpeg_device_check_error("Encoder table init", return NULL);
 
-    // Init huffman encoder
-    encoder->huffman_gpu_encoder = gpujpeg_huffman_gpu_encoder_create(encoder);
-    if (encoder->huffman_gpu_encoder == NULL) {
-        result = 0;
+    // Init huffman encoder (host runtime performs huffman coding on CPU)
+    if (!gpujpeg_device_get_runtime()->host) {
+        encoder->huffman_gpu_encoder = gpujpeg_huffman_gpu_encoder_create(encoder);
+        if (encoder->huffman_gpu_encoder == NULL) {
+            result = 0;
+        }
     }
 
     // Stream
     encoder->stream = stream;
     if (encoder->stream == NULL) {
         encoder->allocatedStream = (cudaStream_t *) malloc(sizeof(cudaStream_t));
-        if (cudaSuccess != cudaStreamCreate(encoder->allocatedStream)) {
+        if (cudaSuccess != gpujpeg_device_stream_create(encoder->allocatedStream)) {
             result = 0;
         }
         encoder->stream = encoder->allocatedStream;
@@ -160,7 +223,7 @@ size_t gpujpeg_encoder_max_pixels(struct gpujpeg_parameters * param, struct gpuj
         size_t allocated_memory_size = 0;
         allocated_memory_size += encoder_memory_size;
         allocated_memory_size += image_memory_size;
-        if (image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE || image_input_type == GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE) {
+        if (image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE || image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE_PLANES || image_input_type == GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE) {
             allocated_memory_size += coder.data_raw_size;
         }
         if (allocated_memory_size > 0 && allocated_memory_size <= memory_size) {
@@ -218,7 +281,7 @@ size_t gpujpeg_encoder_max_memory(struct gpujpeg_parameters * param, struct gpuj
     size_t allocated_memory_size = 0;
     allocated_memory_size += encoder_memory_size;
     allocated_memory_size += image_memory_size;
-    if (image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE || image_input_type == GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE) {
+    if (image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE || image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE_PLANES || image_input_type == GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE) {
         allocated_memory_size += coder.data_raw_size;
     }
 
@@ -253,18 +316,18 @@ int gpujpeg_encoder_allocate(struct gpujpeg_encoder * encoder, struct gpujpeg_pa
     }
 
     // Allocate input raw buffer
-    if (image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE || image_input_type == GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE) {
+    if (image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE || image_input_type == GPUJPEG_ENCODER_INPUT_IMAGE_PLANES || image_input_type == GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE) {
         // Allocate raw data internal buffer
         if (coder->data_raw_size > coder->data_raw_allocated_size) {
             coder->data_raw_allocated_size = 0;
 
             // (Re)allocate raw data in device memory
             if (coder->d_data_raw_allocated != NULL) {
-                cudaFree(coder->d_data_raw_allocated);
+                gpujpeg_device_free(coder->d_data_raw_allocated);
                 coder->d_data_raw_allocated = NULL;
             }
-            cudaMalloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size);
-            gpujpeg_cuda_check_error("Encoder raw data allocation", return -1);
+            gpujpeg_device_malloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size);
+            gpujpeg_device_check_error("Encoder raw data allocation", return -1);
 
             coder->data_raw_allocated_size = coder->data_raw_size;
         }
@@ -273,11 +336,83 @@ int gpujpeg_encoder_allocate(struct gpujpeg_encoder * encoder, struct gpujpeg_pa
     return 0;
 }
 
-/** Documented at declaration */
-int
-gpujpeg_encoder_encode(struct gpujpeg_encoder* encoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image, struct gpujpeg_encoder_input* input, uint8_t** image_compressed, int* image_compressed_size)
+/**
+ * Set encoder quantization tables from coefficient input and check that
+ * coefficient planes match the coder components
+ *
+ * @param encoder  Encoder structure
+ * @param coefficients  Quantized DCT coefficients
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_encoder_init_coefficients(struct gpujpeg_encoder* encoder, const struct gpujpeg_coefficients* coefficients)
+{
+    // Get coder
+    struct gpujpeg_coder* coder = &encoder->coder;
+
+    if (coefficients->comp_count != coder->param_image.comp_count) {
+        fprintf(stderr, "[GPUJPEG] [Error] Coefficients have %d components but image has %d!\n", coefficients->comp_count, coder->param_image.comp_count);
+        return -1;
+    }
+    for (int comp = 0; comp < coder->param_image.comp_count; comp++) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        if (coefficients->block_count_x[comp] != component->data_width / GPUJPEG_BLOCK_SIZE || coefficients->block_count_y[comp] != component->data_height / GPUJPEG_BLOCK_SIZE) {
+            fprintf(stderr, "[GPUJPEG] [Error] Coefficients of component %d don't match image size and sampling factor!\n", comp);
+            return -1;
+        }
+    }
+
+    // Components of the same type must use the same quantization table
+    int table_comp[GPUJPEG_COMPONENT_TYPE_COUNT];
+    for (int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++) {
+        table_comp[comp_type] = -1;
+    }
+    for (int comp = 0; comp < coefficients->comp_count; comp++) {
+        int comp_type = coder->component[comp].type;
+        if (table_comp[comp_type] == -1) {
+            table_comp[comp_type] = comp;
+        }
+        else if (memcmp(coefficients->quantization_table[table_comp[comp_type]], coefficients->quantization_table[comp], 64 * sizeof(uint16_t)) != 0) {
+            fprintf(stderr, "[GPUJPEG] [Error] Coefficients of %s components must use the same quantization table!\n",
+                    comp_type == GPUJPEG_COMPONENT_LUMINANCE ? "luminance" : "chrominance");
+            return -1;
+        }
+    }
+
+    // Quantization tables (in zig-zag order as written to DQT)
+    for (int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++) {
+        if (table_comp[comp_type] == -1) {
+            continue;
+        }
+        struct gpujpeg_table_quantization* table = &encoder->table_quantization[comp_type];
+        for (int i = 0; i < 64; i++) {
+            uint16_t value = coefficients->quantization_table[table_comp[comp_type]][gpujpeg_order_natural[i]];
+            if (value == 0 || (coder->param.precision <= 8 && value > 255)) {
+                fprintf(stderr, "[GPUJPEG] [Error] Only 8-bit quantization tables are supported for 8-bit precision!\n");
+                return -1;
+            }
+            table->table_raw[i] = value;
+            table->table[gpujpeg_order_natural[i]] = value;
+        }
+    }
+    encoder->table_quantization_custom = 1;
+
+    return 0;
+}
+
+/**
+ * (Re)initialize encoder tables, coder, writer and preprocessor for image
+ *
+ * @param encoder  Encoder structure
+ * @param param  Parameters for coder
+ * @param param_image  Parameters for image data
+ * @param input  Source image data
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_encoder_init_image(struct gpujpeg_encoder* encoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image, struct gpujpeg_encoder_input* input)
 {
-    assert(param_image->comp_count == 1 || param_image->comp_count == 3);
+    assert(param_image->comp_count == 1 || param_image->comp_count == 3 || param_image->comp_count == 4);
     assert(param_image->comp_count <= GPUJPEG_MAX_COMPONENT_COUNT);
     assert(param->quality >= 0 && param->quality <= 100);
     assert(param->restart_interval >= 0);
@@ -286,20 +421,65 @@ gpujpeg_encoder_encode(struct gpujpeg_encoder* encoder, struct gpujpeg_parameter
     // Get coder
     struct gpujpeg_coder* coder = &encoder->coder;
 
-    // (Re)initialize encoder
-    if (coder->param.quality != param->quality) {
+    // Four components are stored only in CMYK or YCCK color space (signaled by APP14 marker)
+    int cmyk = (param->color_space_internal == GPUJPEG_CMYK || param->color_space_internal == GPUJPEG_YCCK);
+    if ((param_image->comp_count == 4) != cmyk) {
+        fprintf(stderr, "[GPUJPEG] [Error] Only image with 4 components can be encoded in %s color space and vice versa!\n",
+                gpujpeg_color_space_get_name(param->color_space_internal));
+        return -1;
+    }
+
+    // 12-bit samples are supported only for 16-bit pixel formats without subsampling and resampling
+    if (param->precision != 8 && param->precision != 12) {
+        fprintf(stderr, "[GPUJPEG] [Error] Precision %d is not supported (only 8 or 12 bits)!\n", param->precision);
+        return -1;
+    }
+    if (gpujpeg_pixel_format_get_precision(param_image->pixel_format) != param->precision) {
+        fprintf(stderr, "[GPUJPEG] [Error] Pixel format doesn't match %d-bit precision!\n", param->precision);
+        return -1;
+    }
+    if (param->precision > 8) {
+        for (int comp = 0; comp < param_image->comp_count; comp++) {
+            if (param->sampling_factor[comp].horizontal != 1 || param->sampling_factor[comp].vertical != 1) {
+                fprintf(stderr, "[GPUJPEG] [Error] Only 4:4:4 sampling is supported for 12-bit precision!\n");
+                return -1;
+            }
+        }
+        if (input->width != 0 && input->height != 0 && (input->width != param_image->width || input->height != param_image->height)) {
+            fprintf(stderr, "[GPUJPEG] [Error] Input resampling is not supported for 12-bit precision!\n");
+            return -1;
+        }
+    }
+
+    // (Re)initialize huffman tables when precision changes (12-bit tables contain additional categories)
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_TABLES);
+    if (coder->param.precision != param->precision) {
+        for (int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++) {
+            for (int huff_type = 0; huff_type < GPUJPEG_HUFFMAN_TYPE_COUNT; huff_type++) {
+                if (gpujpeg_table_huffman_encoder_init(&encoder->table_huffman[comp_type][huff_type], (enum gpujpeg_component_type)comp_type, (enum gpujpeg_huffman_type)huff_type, param->precision) != 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // (Re)initialize encoder (tables are also reinitialized after coefficient input replaced them)
+    if (coder->param.quality != param->quality || encoder->table_quantization_custom) {
         // Init quantization tables for encoder
         for (int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++) {
             if (gpujpeg_table_quantization_encoder_init(&encoder->table_quantization[comp_type], (enum gpujpeg_component_type)comp_type, param->quality) != 0) {
                 return -1;
             }
         }
-        gpujpeg_cuda_check_error("Quantization init", return -1);
+        gpujpeg_device_check_error("Quantization init", return -1);
+        encoder->table_quantization_custom = 0;
     }
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_TABLES);
     if (0 == gpujpeg_coder_init_image(coder, param, param_image, encoder->stream)) {
         fprintf(stderr, "[GPUJPEG] [Error] Failed to init image encoding!\n");
         return -1;
     }
+    coder->sampling_filter = param->sampling_filter;
 
     // (Re)initialize writer
     if (gpujpeg_writer_init(encoder->writer, &encoder->coder.param_image) != 0) {
@@ -307,18 +487,62 @@ gpujpeg_encoder_encode(struct gpujpeg_encoder* encoder, struct gpujpeg_parameter
         return -1;
     }
 
+    // Quantization tables are given by coefficients
+    if (input->type == GPUJPEG_ENCODER_INPUT_COEFFICIENTS) {
+        if (gpujpeg_encoder_init_coefficients(encoder, input->coefficients) != 0) {
+            return -1;
+        }
+    }
+
+    // Input image is resampled to image size by preprocessor
+    if (input->width != 0 && input->height != 0 && (input->width != param_image->width || input->height != param_image->height)) {
+        if (input->type == GPUJPEG_ENCODER_INPUT_COEFFICIENTS) {
+            fprintf(stderr, "[GPUJPEG] [Error] Coefficient input can't be resampled!\n");
+            return -1;
+        }
+        if (input->type == GPUJPEG_ENCODER_INPUT_IMAGE_PLANES || input->type == GPUJPEG_ENCODER_INPUT_GPU_IMAGE_PLANES) {
+            fprintf(stderr, "[GPUJPEG] [Error] Image planes input can't be resampled!\n");
+            return -1;
+        }
+        if (param_image->pixel_format != GPUJPEG_U8 && param_image->pixel_format != GPUJPEG_444_U8_P012) {
+            fprintf(stderr, "[GPUJPEG] [Error] Input resampling is supported only for u8 and 444-u8-p012 pixel formats!\n");
+            return -1;
+        }
+        struct gpujpeg_image_parameters param_image_raw = *param_image;
+        param_image_raw.width = input->width;
+        param_image_raw.height = input->height;
+        coder->data_raw_size = gpujpeg_image_calculate_size(&param_image_raw);
+        coder->data_raw_width = input->width;
+        coder->data_raw_height = input->height;
+        coder->data_raw_filter = input->filter;
+    }
+
     // (Re)initialize preprocessor
     if (gpujpeg_preprocessor_encoder_init(&encoder->coder) != 0) {
         fprintf(stderr, "[GPUJPEG] [Error] Failed to init preprocessor!\n");
         return -1;
     }
 
-    // Reset durations
-    coder->duration_memory_map = 0.0;
-    coder->duration_memory_unmap = 0.0;
-    coder->duration_stream = 0.0;
-    coder->duration_in_gpu = 0.0;
-    coder->duration_waiting = 0.0;
+    coder->stats.raw_size = coder->data_raw_size;
+
+    return 0;
+}
+
+/**
+ * Load encoder input to raw data buffer in device memory
+ *
+ * @param encoder  Encoder structure
+ * @param input  Source image data
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_encoder_load_input(struct gpujpeg_encoder* encoder, struct gpujpeg_encoder_input* input)
+{
+    // Get coder
+    struct gpujpeg_coder* coder = &encoder->coder;
+
+    // Raw image planes are used only for GPU planes input
+    memset(&coder->data_raw_planes, 0, sizeof(struct gpujpeg_image_planes));
 
     // Load input image
     if ( input->type == GPUJPEG_ENCODER_INPUT_IMAGE ) {
@@ -328,11 +552,11 @@ gpujpeg_encoder_encode(struct gpujpeg_encoder* encoder, struct gpujpeg_parameter
 
             // (Re)allocate raw data in device memory
             if (coder->d_data_raw_allocated != NULL) {
-                cudaFree(coder->d_data_raw_allocated);
+                gpujpeg_device_free(coder->d_data_raw_allocated);
                 coder->d_data_raw_allocated = NULL;
             }
-            cudaMalloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size);
-            gpujpeg_cuda_check_error("Encoder raw data allocation", return -1);
+            gpujpeg_device_malloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size);
+            gpujpeg_device_check_error("Encoder raw data allocation", return -1);
 
             coder->data_raw_allocated_size = coder->data_raw_size;
         }
@@ -340,183 +564,648 @@ gpujpeg_encoder_encode(struct gpujpeg_encoder* encoder, struct gpujpeg_parameter
         coder->d_data_raw = coder->d_data_raw_allocated;
 
         // Copy image to device memory
-        cudaMemcpyAsync(coder->d_data_raw, input->image, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyHostToDevice, *(encoder->stream));
-        gpujpeg_cuda_check_error("Encoder raw data copy", return -1);
+        gpujpeg_stats_device_start(coder, GPUJPEG_STATS_UPLOAD, *(encoder->stream));
+        gpujpeg_device_memcpy_async(coder->d_data_raw, input->image, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyHostToDevice, *(encoder->stream));
+        gpujpeg_device_check_error("Encoder raw data copy", return -1);
+        gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_UPLOAD, *(encoder->stream));
+        coder->stats.upload_size += coder->data_raw_size;
     }
     else if (input->type == GPUJPEG_ENCODER_INPUT_GPU_IMAGE) {
         coder->d_data_raw = input->image;
     }
+    else if (input->type == GPUJPEG_ENCODER_INPUT_IMAGE_PLANES) {
+        // Allocate raw data internal buffer
+        if (coder->data_raw_size > coder->data_raw_allocated_size) {
+            coder->data_raw_allocated_size = 0;
+
+            // (Re)allocate raw data in device memory
+            if (coder->d_data_raw_allocated != NULL) {
+                gpujpeg_device_free(coder->d_data_raw_allocated);
+                coder->d_data_raw_allocated = NULL;
+            }
+            gpujpeg_device_malloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size);
+            gpujpeg_device_check_error("Encoder raw data allocation", return -1);
+
+            coder->data_raw_allocated_size = coder->data_raw_size;
+        }
+        coder->d_data_raw = coder->d_data_raw_allocated;
+
+        // Copy image planes to contiguous raw image in device memory (row padding is dropped)
+        struct gpujpeg_image_planes planes = input->planes;
+        struct gpujpeg_image_planes d_planes;
+        if (gpujpeg_image_planes_init(&coder->param_image, NULL, &planes) != 0
+                || gpujpeg_image_planes_init(&coder->param_image, coder->d_data_raw, &d_planes) != 0) {
+            return -1;
+        }
+        gpujpeg_stats_device_start(coder, GPUJPEG_STATS_UPLOAD, *(encoder->stream));
+        for (int plane = 0; plane < GPUJPEG_MAX_COMPONENT_COUNT && planes.data[plane] != NULL; plane++) {
+            int width;
+            int height;
+            gpujpeg_image_get_plane_size(&coder->param_image, plane, &width, &height);
+            gpujpeg_device_memcpy_2d_async(d_planes.data[plane], d_planes.pitch[plane], planes.data[plane], planes.pitch[plane], width, height, cudaMemcpyHostToDevice, *(encoder->stream));
+        }
+        gpujpeg_device_check_error("Encoder raw data planes copy", return -1);
+        gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_UPLOAD, *(encoder->stream));
+        coder->stats.upload_size += coder->data_raw_size;
+    }
+    else if (input->type == GPUJPEG_ENCODER_INPUT_GPU_IMAGE_PLANES) {
+        // Preprocessor reads planes directly
+        coder->data_raw_planes = input->planes;
+        if (gpujpeg_image_planes_init(&coder->param_image, NULL, &coder->data_raw_planes) != 0) {
+            return -1;
+        }
+    }
+    else if (input->type == GPUJPEG_ENCODER_INPUT_COEFFICIENTS) {
+        // Gather component planes to quantized data buffer and copy it to device memory
+        for (int comp = 0; comp < coder->param_image.comp_count; comp++) {
+            struct gpujpeg_component* component = &coder->component[comp];
+            memcpy(component->data_quantized, input->coefficients->data[comp], component->data_width * component->data_height * sizeof(int16_t));
+        }
+        gpujpeg_stats_device_start(coder, GPUJPEG_STATS_UPLOAD, *(encoder->stream));
+        gpujpeg_device_memcpy_async(coder->d_data_quantized, coder->data_quantized, coder->data_size * sizeof(int16_t), cudaMemcpyHostToDevice, *(encoder->stream));
+        gpujpeg_device_check_error("Encoder coefficients copy", return -1);
+        gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_UPLOAD, *(encoder->stream));
+        coder->stats.upload_size += coder->data_size * sizeof(int16_t);
+    }
     else if ( input->type == GPUJPEG_ENCODER_INPUT_OPENGL_TEXTURE ) {
         assert(input->texture != NULL);
 
-        GPUJPEG_CUSTOM_TIMER_START(encoder->def);
-
         // Create buffers if not already created
         if (coder->data_raw_size > coder->data_raw_allocated_size) {
             coder->data_raw_allocated_size = 0;
 
             // (Re)allocate raw data in device memory
             if (coder->d_data_raw_allocated != NULL) {
-                cudaFree(coder->d_data_raw_allocated);
+                gpujpeg_device_free(coder->d_data_raw_allocated);
                 coder->d_data_raw_allocated = NULL;
             }
-            cudaMalloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size);
-            gpujpeg_cuda_check_error("Encoder raw data allocation", return -1);
+            gpujpeg_device_malloc((void**)&coder->d_data_raw_allocated, coder->data_raw_size);
+            gpujpeg_device_check_error("Encoder raw data allocation", return -1);
 
             coder->data_raw_allocated_size = coder->data_raw_size;
         }
         coder->d_data_raw = coder->d_data_raw_allocated;
 
         // Map texture to CUDA
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_OPENGL);
         int data_size = 0;
         uint8_t* d_data = gpujpeg_opengl_texture_map(input->texture, &data_size);
         assert(data_size == (coder->data_raw_size));
-
-        GPUJPEG_CUSTOM_TIMER_STOP(encoder->def);
-        coder->duration_memory_map = GPUJPEG_CUSTOM_TIMER_DURATION(encoder->def);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_OPENGL);
 
         // Copy image data from texture pixel buffer object to device data
-        cudaMemcpyAsync(coder->d_data_raw, d_data, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToDevice, *(encoder->stream));
-
-        GPUJPEG_CUSTOM_TIMER_START(encoder->def);
+        gpujpeg_device_memcpy_async(coder->d_data_raw, d_data, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToDevice, *(encoder->stream));
 
         // Unmap texture from CUDA
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_OPENGL);
         gpujpeg_opengl_texture_unmap(input->texture);
-
-        GPUJPEG_CUSTOM_TIMER_STOP(encoder->def);
-        coder->duration_memory_unmap = GPUJPEG_CUSTOM_TIMER_DURATION(encoder->def);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_OPENGL);
     }
     else {
         // Unknown output type
         assert(0);
     }
 
-    //gpujpeg_table_print(encoder->table[JPEG_COMPONENT_LUMINANCE]);
-    //gpujpeg_table_print(encoder->table[JPEG_COMPONENT_CHROMINANCE]);
+    return 0;
+}
+
+/** Parameters of encoder kernels (see gpujpeg_device_launch) */
+struct gpujpeg_encoder_kernel_param
+{
+    // Encoder structure
+    struct gpujpeg_encoder* encoder;
+    // Components of previous level and filter (gpujpeg_encoder_kernel_downsample)
+    const struct gpujpeg_component* component;
+    enum gpujpeg_resize_filter filter;
+    // Size of compressed data (gpujpeg_encoder_kernel_huffman)
+    unsigned int* output_size;
+};
 
-    GPUJPEG_CUSTOM_TIMER_START(encoder->in_gpu);
+/**
+ * Check whether image can be transformed by MCU rows on CPU (see gpujpeg_dct_cpu_encode_mcu_row)
+ *
+ * @param encoder  Encoder structure (coder is initialized for the image)
+ * @return 1 if MCU rows can be transformed on CPU, otherwise 0
+ */
+static int
+gpujpeg_encoder_mcu_rows_available(struct gpujpeg_encoder* encoder)
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
 
-    // Preprocessing
-    if (0 != gpujpeg_preprocessor_encode(encoder)) {
+    // MCU rows are encoded to single scan (MCU of one component image is one block)
+    if ( coder->param.interleaved != 1 && coder->param_image.comp_count != 1 ) {
+        return 0;
+    }
+    if ( coder->param_image.comp_count == 1
+            && (coder->component[0].sampling_factor.horizontal != 1 || coder->component[0].sampling_factor.vertical != 1) ) {
+        return 0;
+    }
+    return gpujpeg_dct_cpu_encode_available(encoder);
+}
+
+static int
+gpujpeg_encoder_kernel_preprocess(void* param)
+{
+    return gpujpeg_preprocessor_encode(((struct gpujpeg_encoder_kernel_param*)param)->encoder);
+}
+
+static int
+gpujpeg_encoder_kernel_preprocess_dct(void* param)
+{
+    return gpujpeg_preprocessor_encode_dct(((struct gpujpeg_encoder_kernel_param*)param)->encoder);
+}
+
+/**
+ * Perform preprocessing fused with DCT on CPU by MCU rows from raw image in
+ * device memory emulated by host runtime
+ */
+static int
+gpujpeg_encoder_kernel_preprocess_dct_host(void* param)
+{
+    struct gpujpeg_encoder* encoder = ((struct gpujpeg_encoder_kernel_param*)param)->encoder;
+    struct gpujpeg_coder* coder = &encoder->coder;
+
+    struct gpujpeg_image_planes planes = coder->data_raw_planes;
+    if ( planes.data[0] == NULL && 0 != gpujpeg_image_planes_init(&coder->param_image, coder->d_data_raw, &planes) ) {
+        return -1;
+    }
+    size_t buffer_size = gpujpeg_dct_cpu_encode_buffer_size(encoder);
+    uint8_t* buffer = NULL;
+    if ( buffer_size > 0 && (buffer = (uint8_t*)malloc(buffer_size)) == NULL ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate sampling buffer of MCU row!\n");
         return -1;
     }
+    int result = 0;
+    int mcu_row_count = coder->component[0].mcu_count / coder->component[0].mcu_count_x;
+    for ( int mcu_row = 0; mcu_row < mcu_row_count && result == 0; mcu_row++ ) {
+        int16_t* output[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+        for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+            struct gpujpeg_component* component = &coder->component[comp];
+            output[comp] = component->d_data_quantized + (size_t)mcu_row * component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE * component->data_width;
+        }
+        result = gpujpeg_dct_cpu_encode_mcu_row(encoder, &planes, mcu_row, buffer, output);
+    }
+    free(buffer);
+    return result;
+}
+
+static int
+gpujpeg_encoder_kernel_dct(void* param)
+{
+    return gpujpeg_dct_gpu(((struct gpujpeg_encoder_kernel_param*)param)->encoder);
+}
+
+static int
+gpujpeg_encoder_kernel_huffman(void* param)
+{
+    struct gpujpeg_encoder_kernel_param* kernel_param = (struct gpujpeg_encoder_kernel_param*)param;
+    struct gpujpeg_encoder* encoder = kernel_param->encoder;
+    return gpujpeg_huffman_gpu_encoder_encode(encoder, encoder->huffman_gpu_encoder, kernel_param->output_size);
+}
+
+static int
+gpujpeg_encoder_kernel_downsample(void* param)
+{
+    struct gpujpeg_encoder_kernel_param* kernel_param = (struct gpujpeg_encoder_kernel_param*)param;
+    struct gpujpeg_encoder* encoder = kernel_param->encoder;
+    return gpujpeg_preprocessor_downsample(&encoder->coder, kernel_param->component, kernel_param->filter, *(encoder->stream));
+}
+
+/** Kernels of encoder pipeline stages */
+static const struct gpujpeg_device_kernel gpujpeg_encoder_preprocess = {
+    "gpujpeg_preprocessor_encode", &gpujpeg_encoder_kernel_preprocess, NULL
+};
+static const struct gpujpeg_device_kernel gpujpeg_encoder_preprocess_dct = {
+    "gpujpeg_preprocessor_encode_dct", &gpujpeg_encoder_kernel_preprocess_dct, &gpujpeg_encoder_kernel_preprocess_dct_host
+};
+static const struct gpujpeg_device_kernel gpujpeg_encoder_dct = {
+    "gpujpeg_dct_gpu", &gpujpeg_encoder_kernel_dct, NULL
+};
+static const struct gpujpeg_device_kernel gpujpeg_encoder_huffman = {
+    "gpujpeg_huffman_gpu_encoder_encode", &gpujpeg_encoder_kernel_huffman, NULL
+};
+static const struct gpujpeg_device_kernel gpujpeg_encoder_downsample = {
+    "gpujpeg_preprocessor_downsample", &gpujpeg_encoder_kernel_downsample, NULL
+};
+
+/**
+ * Launch kernel of encoder pipeline stage to encoder stream
+ *
+ * @param encoder  Encoder structure
+ * @param kernel  Kernel of pipeline stage
+ * @param param  Additional kernel parameters or NULL
+ * @param stage  Stage the kernel is accounted to (see gpujpeg_stats)
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_encoder_launch(struct gpujpeg_encoder* encoder, const struct gpujpeg_device_kernel* kernel, const struct gpujpeg_encoder_kernel_param* param,
+                       enum gpujpeg_stats_stage stage)
+{
+    struct gpujpeg_encoder_kernel_param kernel_param;
+    memset(&kernel_param, 0, sizeof(kernel_param));
+    if ( param != NULL ) {
+        kernel_param = *param;
+    }
+    kernel_param.encoder = encoder;
+    gpujpeg_stats_device_start(&encoder->coder, stage, *(encoder->stream));
+    if ( gpujpeg_device_launch(kernel, &kernel_param, sizeof(kernel_param), *(encoder->stream)) != cudaSuccess ) {
+        return -1;
+    }
+    gpujpeg_stats_device_stop(&encoder->coder, stage, *(encoder->stream));
+    return 0;
+}
+
+/**
+ * Decide backends of encoding pipeline stages for current coder image, by cost
+ * model when it is set (see gpujpeg_encoder_set_route_model), otherwise huffman
+ * coding is performed on CPU only when GPU huffman coder can't be used
+ *
+ * @param encoder  Encoder structure (coder is initialized for the image)
+ * @param host_image  Flag if image can be encoded on CPU by MCU rows
+ * @param raw_on_device  Flag if raw image already resides in device memory
+ * @param route  Routing decision
+ * @return void
+ */
+static void
+gpujpeg_encoder_route(struct gpujpeg_encoder* encoder, int host_image, int raw_on_device, struct gpujpeg_route_decision* route)
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
+
+    // GPU huffman coder supports only 8-bit precision with restart interval,
+    // 12-bit images are always coded on CPU (as all images by host runtime)
+    int device_huffman = (coder->param.restart_interval != 0 && coder->param.precision <= 8 && !gpujpeg_device_get_runtime()->host);
+
+    if ( !encoder->route_enabled ) {
+        route->image = host_image ? GPUJPEG_ROUTE_HOST : GPUJPEG_ROUTE_DEVICE;
+        route->huffman = device_huffman ? GPUJPEG_ROUTE_DEVICE : GPUJPEG_ROUTE_HOST;
+        route->huffman_host_segment_count = 0;
+        route->duration_host = 0.0;
+        route->duration_device = 0.0;
+        return;
+    }
+
+    struct gpujpeg_route_image image;
+    image.raw_size = gpujpeg_image_calculate_size(&coder->param_image);
+    image.sample_count = coder->data_size;
+    image.segment_count = coder->segment_count;
+    image.host_thread_count = gpujpeg_thread_get_count(encoder->host_thread_count);
+    image.host_image_supported = host_image;
+    image.device_huffman_supported = device_huffman;
+    image.raw_on_device = raw_on_device;
+    gpujpeg_route_decide(&encoder->route_model, &image, route);
+}
+
+/**
+ * Encode preprocessed component planes (DCT, quantization, huffman coding and stream formatting)
+ * to writer buffer.
+ *
+ * @param encoder  Encoder structure
+ * @param transform  Perform DCT and quantization (otherwise quantized coefficients are already loaded)
+ * @param header  Header template to be used instead of writing the header or NULL
+ * @param header_size  Header template size, when header is NULL the size of written header
+ *                     is stored to it (can be NULL)
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_encoder_encode_planes(struct gpujpeg_encoder* encoder, int transform, const uint8_t* header, int* header_size)
+{
+    // Get coder
+    struct gpujpeg_coder* coder = &encoder->coder;
 
     // Perform DCT and quantization
-    if (0 != gpujpeg_dct_gpu(encoder)) {
+    if (transform && 0 != gpujpeg_encoder_launch(encoder, &gpujpeg_encoder_dct, NULL, GPUJPEG_STATS_DCT)) {
         return -1;
     }
 
-    // If restart interval is 0 then the GPU processing is in the end (even huffman coder will be performed on CPU)
-    if (coder->param.restart_interval == 0) {
-        GPUJPEG_CUSTOM_TIMER_STOP(encoder->in_gpu);
-        coder->duration_in_gpu = GPUJPEG_CUSTOM_TIMER_DURATION(encoder->in_gpu);
+    // Decide huffman backend for current coder image
+    struct gpujpeg_route_decision route;
+    gpujpeg_encoder_route(encoder, 0, 1, &route);
+    coder->route.huffman = route.huffman;
+    int huffman_cpu = (route.huffman == GPUJPEG_ROUTE_HOST);
+    coder->stats.huffman = route.huffman;
+    coder->stats.segment_count += coder->segment_count;
+    if (huffman_cpu) {
+        coder->stats.huffman_host_segment_count += coder->segment_count;
     }
 
     // Initialize writer output buffer current position
     encoder->writer->buffer_current = encoder->writer->buffer;
 
     // Write header
-    gpujpeg_writer_write_header(encoder);
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_FORMATTER);
+    if ( header != NULL ) {
+        if ( gpujpeg_writer_write_header_template(encoder, header, *header_size) != 0 ) {
+            return -1;
+        }
+    } else {
+        gpujpeg_writer_write_header(encoder);
+        if ( header_size != NULL ) {
+            *header_size = encoder->writer->buffer_current - encoder->writer->buffer;
+        }
+    }
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_FORMATTER);
 
     // Perform huffman coding on CPU (when restart interval is not set)
-    if ( coder->param.restart_interval == 0 ) {
-        // Copy quantized data from device memory to cpu memory
-        cudaMemcpyAsync(coder->data_quantized, coder->d_data_quantized, coder->data_size * sizeof(int16_t), cudaMemcpyDeviceToHost, *(encoder->stream));
-
-        // Wait for async operations before the coding
-        cudaStreamSynchronize(*(encoder->stream));
+    if ( huffman_cpu ) {
+        // Copy quantized data from device memory to cpu memory (as sparse coefficients),
+        // async operations are finished before the coding
+        gpujpeg_stats_device_start(coder, GPUJPEG_STATS_DOWNLOAD, *(encoder->stream));
+        if ( gpujpeg_sparse_download(coder, 0, coder->data_size / GPUJPEG_BLOCK_SQUARED_SIZE, *(encoder->stream)) != 0 ) {
+            return -1;
+        }
+        gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_DOWNLOAD, *(encoder->stream));
 
         // Perform huffman coding
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_HUFFMAN);
         if ( gpujpeg_huffman_cpu_encoder_encode(encoder) != 0 ) {
             fprintf(stderr, "[GPUJPEG] [Error] Huffman encoder on CPU failed!\n");
             return -1;
         }
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_HUFFMAN);
     }
     // Perform huffman coding on GPU (when restart interval is set)
     else {
         // Perform huffman coding
         unsigned int output_size;
-        if ( gpujpeg_huffman_gpu_encoder_encode(encoder, encoder->huffman_gpu_encoder, &output_size) != 0 ) {
+        struct gpujpeg_encoder_kernel_param param;
+        memset(&param, 0, sizeof(param));
+        param.output_size = &output_size;
+        if ( gpujpeg_encoder_launch(encoder, &gpujpeg_encoder_huffman, &param, GPUJPEG_STATS_HUFFMAN) != 0 ) {
             fprintf(stderr, "[GPUJPEG] [Error] Huffman encoder on GPU failed!\n");
             return -1;
         }
 
         // Copy compressed data from device memory to cpu memory
-        if ( cudaSuccess != cudaMemcpyAsync(coder->data_compressed, coder->d_data_compressed, output_size, cudaMemcpyDeviceToHost, *(encoder->stream)) != 0 ) {
+        gpujpeg_stats_device_start(coder, GPUJPEG_STATS_DOWNLOAD, *(encoder->stream));
+        if ( cudaSuccess != gpujpeg_device_memcpy_async(coder->data_compressed, coder->d_data_compressed, output_size, cudaMemcpyDeviceToHost, *(encoder->stream)) != 0 ) {
             return -1;
         }
         // Copy segments from device memory
-        if ( cudaSuccess != cudaMemcpyAsync(coder->segment, coder->d_segment, coder->segment_count * sizeof(struct gpujpeg_segment), cudaMemcpyDeviceToHost, *(encoder->stream)) ) {
+        if ( cudaSuccess != gpujpeg_device_memcpy_async(coder->segment, coder->d_segment, coder->segment_count * sizeof(struct gpujpeg_segment), cudaMemcpyDeviceToHost, *(encoder->stream)) ) {
             return -1;
         }
+        gpujpeg_stats_device_stop(coder, GPUJPEG_STATS_DOWNLOAD, *(encoder->stream));
+        coder->stats.download_size += output_size + coder->segment_count * sizeof(struct gpujpeg_segment);
 
         // Wait for async operations before formatting
-        GPUJPEG_CUSTOM_TIMER_START(encoder->def);
-        cudaStreamSynchronize(*(encoder->stream));
-        GPUJPEG_CUSTOM_TIMER_STOP(encoder->def);
-        coder->duration_waiting = GPUJPEG_CUSTOM_TIMER_DURATION(encoder->def);
-
-        GPUJPEG_CUSTOM_TIMER_STOP(encoder->in_gpu);
-        coder->duration_in_gpu = GPUJPEG_CUSTOM_TIMER_DURATION(encoder->in_gpu);
-
-        GPUJPEG_CUSTOM_TIMER_START(encoder->in_gpu);
-        if ( coder->param.interleaved == 1 ) {
-            // Write scan header (only one scan is written, that contains all color components data)
-            gpujpeg_writer_write_scan_header(encoder, 0);
-
-            // Write scan data
-            for ( int segment_index = 0; segment_index < coder->segment_count; segment_index++ ) {
-                struct gpujpeg_segment* segment = &coder->segment[segment_index];
-
-                gpujpeg_writer_write_segment_info(encoder);
-
-                // Copy compressed data to writer
-                memcpy(
-                    encoder->writer->buffer_current,
-                    &coder->data_compressed[segment->data_compressed_index],
-                    segment->data_compressed_size
-                );
-                encoder->writer->buffer_current += segment->data_compressed_size;
-                //printf("Compressed data %d bytes\n", segment->data_compressed_size);
-            }
-            // Remove last restart marker in scan (is not needed)
-            encoder->writer->buffer_current -= 2;
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_WAIT);
+        gpujpeg_device_stream_synchronize(*(encoder->stream));
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_WAIT);
+
+        gpujpeg_stats_host_start(coder, GPUJPEG_STATS_FORMATTER);
+        gpujpeg_writer_write_segments(encoder);
+        gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_FORMATTER);
+    }
+    gpujpeg_writer_emit_marker(encoder->writer, GPUJPEG_MARKER_EOI);
+    coder->stats.compressed_size += encoder->writer->buffer_current - encoder->writer->buffer;
+
+    return 0;
+}
+
+/**
+ * Check whether image can be encoded on CPU (see gpujpeg_encoder_set_host_threads
+ * and gpujpeg_encoder_set_route_model)
+ *
+ * @param encoder  Encoder structure (coder is initialized for the image)
+ * @param input  Encoder input structure
+ * @return 1 if image is encoded on CPU, otherwise 0
+ */
+static int
+gpujpeg_encoder_host_available(struct gpujpeg_encoder* encoder, struct gpujpeg_encoder_input* input)
+{
+    if ( encoder->host_thread_count == 0 && !encoder->route_enabled ) {
+        return 0;
+    }
+    if ( input->type != GPUJPEG_ENCODER_INPUT_IMAGE && input->type != GPUJPEG_ENCODER_INPUT_IMAGE_PLANES ) {
+        return 0;
+    }
+    return gpujpeg_encoder_mcu_rows_available(encoder);
+}
+
+/** Host encoding pipeline */
+struct gpujpeg_encoder_host
+{
+    // Encoder structure
+    struct gpujpeg_encoder* encoder;
+    // Raw image planes in host memory
+    struct gpujpeg_image_planes planes;
+    // Number of worker threads
+    int thread_count;
+};
 
-            gpujpeg_writer_write_segment_info(encoder);
+/**
+ * Worker thread state of host encoder
+ */
+struct gpujpeg_encoder_host_worker
+{
+    // Host encoder state
+    struct gpujpeg_encoder_host* host;
+    // Sampling buffer of MCU row (see gpujpeg_dct_cpu_encode_buffer_size)
+    uint8_t* buffer;
+};
+
+/**
+ * Perform color conversion, sampling, DCT and quantization of MCU row requested
+ * by huffman encoder (see gpujpeg_huffman_cpu_encoder_mcu_row_callback_t)
+ */
+static int
+gpujpeg_encoder_host_mcu_row(struct gpujpeg_encoder* encoder, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT], int mcu_row, void* param)
+{
+    struct gpujpeg_encoder_host_worker* worker = (struct gpujpeg_encoder_host_worker*)param;
+    return gpujpeg_dct_cpu_encode_mcu_row(encoder, &worker->host->planes, mcu_row, worker->buffer, coefficients);
+}
+
+/**
+ * Get first segment of thread range, ranges are split on MCU row boundaries so that
+ * no MCU row is transformed by two threads (split of evenly distributed segments is
+ * moved to the next segment which begins MCU row)
+ *
+ * @param coder  Coder structure
+ * @param thread_index  Index of thread (thread count gives end of the last range)
+ * @param thread_count  Number of threads
+ * @return index of segment
+ */
+static int
+gpujpeg_encoder_host_segment_begin(struct gpujpeg_coder* coder, int thread_index, int thread_count)
+{
+    int segment_index = (int)((long long)coder->segment_count * thread_index / thread_count);
+    struct gpujpeg_component* component = &coder->component[0];
+    while ( segment_index < coder->segment_count
+            && (long long)segment_index * component->segment_mcu_count % component->mcu_count_x != 0 ) {
+        segment_index++;
+    }
+    return segment_index;
+}
+
+/**
+ * Encode range of segments in worker thread (see gpujpeg_thread_function_t)
+ */
+static int
+gpujpeg_encoder_host_thread(int thread_index, void* param)
+{
+    struct gpujpeg_encoder_host* host = (struct gpujpeg_encoder_host*)param;
+    struct gpujpeg_coder* coder = &host->encoder->coder;
+    int segment_begin = gpujpeg_encoder_host_segment_begin(coder, thread_index, host->thread_count);
+    int segment_end = gpujpeg_encoder_host_segment_begin(coder, thread_index + 1, host->thread_count);
+    if ( segment_begin == segment_end ) {
+        return 0;
+    }
+    double time_begin = gpujpeg_get_time();
+
+    // Coefficients of one MCU row for each component and sampling buffer
+    int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT] = { NULL };
+    struct gpujpeg_encoder_host_worker worker;
+    worker.host = host;
+    worker.buffer = NULL;
+    int result = 0;
+    size_t buffer_size = gpujpeg_dct_cpu_encode_buffer_size(host->encoder);
+    if ( buffer_size > 0 && (worker.buffer = (uint8_t*)malloc(buffer_size)) == NULL ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate sampling buffer of MCU row!\n");
+        result = -1;
+    }
+    for ( int comp = 0; comp < coder->param_image.comp_count && result == 0; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        coefficients[comp] = (int16_t*)malloc(component->data_width * component->sampling_factor.vertical * GPUJPEG_BLOCK_SIZE * sizeof(int16_t));
+        if ( coefficients[comp] == NULL ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate coefficients of MCU row!\n");
+            result = -1;
         }
-        else {
-            // Write huffman coder results as one scan for each color component
-            int segment_index = 0;
-            for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
-                // Write scan header
-                gpujpeg_writer_write_scan_header(encoder, comp);
-                // Write scan data
-                for ( int index = 0; index < coder->component[comp].segment_count; index++ ) {
-                    struct gpujpeg_segment* segment = &coder->segment[segment_index];
-
-                    gpujpeg_writer_write_segment_info(encoder);
-
-                    // Copy compressed data to writer
-                    memcpy(
-                        encoder->writer->buffer_current,
-                        &coder->data_compressed[segment->data_compressed_index],
-                        segment->data_compressed_size
-                    );
-                    encoder->writer->buffer_current += segment->data_compressed_size;
-                    //printf("Compressed data %d bytes\n", segment->data_compressed_size);
-
-                    segment_index++;
-                }
-                // Remove last restart marker in scan (is not needed)
-                encoder->writer->buffer_current -= 2;
+    }
+    if ( result == 0 ) {
+        result = gpujpeg_huffman_cpu_encoder_encode_segments(host->encoder, segment_begin, segment_end, coefficients,
+                                                             &gpujpeg_encoder_host_mcu_row, &worker);
+    }
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ ) {
+        free(coefficients[comp]);
+    }
+    free(worker.buffer);
+    gpujpeg_stats_trace_worker(coder, thread_index, time_begin, gpujpeg_get_time());
+    return result;
+}
 
-                gpujpeg_writer_write_segment_info(encoder);
-            }
+/**
+ * Encode image on CPU by MCU rows directly from host input
+ *
+ * @param encoder  Encoder structure (coder is initialized for the image)
+ * @param input  Encoder input structure
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_encoder_encode_host(struct gpujpeg_encoder* encoder, struct gpujpeg_encoder_input* input)
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
+
+    struct gpujpeg_encoder_host host;
+    host.encoder = encoder;
+    if ( input->type == GPUJPEG_ENCODER_INPUT_IMAGE_PLANES ) {
+        host.planes = input->planes;
+        if ( 0 != gpujpeg_image_planes_init(&coder->param_image, NULL, &host.planes) ) {
+            return -1;
         }
-        GPUJPEG_CUSTOM_TIMER_STOP(encoder->def);
-        coder->duration_stream = GPUJPEG_CUSTOM_TIMER_DURATION(encoder->def);
     }
+    else {
+        if ( 0 != gpujpeg_image_planes_init(&coder->param_image, input->image, &host.planes) ) {
+            return -1;
+        }
+    }
+
+    // Threads get contiguous ranges of segments split on MCU row boundaries, each
+    // thread transforms its own MCU rows (an image without restart interval is one
+    // segment, sampling filter is applied by MCU rows too)
+    host.thread_count = gpujpeg_thread_get_count(encoder->host_thread_count);
+    if ( host.thread_count > coder->segment_count )
+        host.thread_count = coder->segment_count;
+
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_HUFFMAN);
+    if ( 0 != gpujpeg_thread_run(host.thread_count, &gpujpeg_encoder_host_thread, &host) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Host encoder failed!\n");
+        return -1;
+    }
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_HUFFMAN);
+
+    // Stitch segments in order
+    gpujpeg_stats_host_start(coder, GPUJPEG_STATS_FORMATTER);
+    encoder->writer->buffer_current = encoder->writer->buffer;
+    gpujpeg_writer_write_header(encoder);
+    gpujpeg_writer_write_segments(encoder);
     gpujpeg_writer_emit_marker(encoder->writer, GPUJPEG_MARKER_EOI);
+    gpujpeg_stats_host_stop(coder, GPUJPEG_STATS_FORMATTER);
+
+    coder->stats.huffman = GPUJPEG_ROUTE_HOST;
+    coder->stats.segment_count = coder->segment_count;
+    coder->stats.huffman_host_segment_count = coder->segment_count;
+    coder->stats.compressed_size = encoder->writer->buffer_current - encoder->writer->buffer;
+
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_encoder_encode(struct gpujpeg_encoder* encoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image, struct gpujpeg_encoder_input* input, uint8_t** image_compressed, int* image_compressed_size)
+{
+    // Get coder
+    struct gpujpeg_coder* coder = &encoder->coder;
+    gpujpeg_stats_begin(coder);
+
+    // (Re)initialize encoder
+    if (0 != gpujpeg_encoder_init_image(encoder, param, param_image, input)) {
+        return -1;
+    }
+
+    // Encode image on CPU by MCU rows when requested, supported and (by cost model) faster
+    int raw_on_device = (input->type != GPUJPEG_ENCODER_INPUT_IMAGE && input->type != GPUJPEG_ENCODER_INPUT_IMAGE_PLANES);
+    gpujpeg_encoder_route(encoder, gpujpeg_encoder_host_available(encoder, input), raw_on_device, &coder->route);
+    coder->stats.image = coder->route.image;
+    if (coder->route.image == GPUJPEG_ROUTE_HOST) {
+        if (0 != gpujpeg_encoder_encode_host(encoder, input)) {
+            return -1;
+        }
+        *image_compressed = encoder->writer->buffer;
+        *image_compressed_size = encoder->writer->buffer_current - encoder->writer->buffer;
+        gpujpeg_stats_end(coder);
+        return 0;
+    }
+
+    // Preprocessing (coefficient input is already transformed and quantized)
+    int transform = (input->type != GPUJPEG_ENCODER_INPUT_COEFFICIENTS);
+
+    // Preprocessing fused with DCT doesn't store component planes (DCT is then already performed),
+    // host runtime performs it by MCU rows and it has no standalone preprocessing and DCT
+    int fused = gpujpeg_device_get_runtime()->host ? gpujpeg_encoder_mcu_rows_available(encoder)
+                                                   : gpujpeg_preprocessor_encode_dct_available(encoder);
+    if (transform && !fused && gpujpeg_device_get_runtime()->host) {
+        fprintf(stderr, "[GPUJPEG] [Error] Image can't be encoded by host runtime (only 8-bit image of one scan from pixel format "
+                        "matching component count without resampling is supported)!\n");
+        return -1;
+    }
+
+    // Load input image
+    if (0 != gpujpeg_encoder_load_input(encoder, input)) {
+        return -1;
+    }
+
+    //gpujpeg_table_print(encoder->table[JPEG_COMPONENT_LUMINANCE]);
+    //gpujpeg_table_print(encoder->table[JPEG_COMPONENT_CHROMINANCE]);
+    if (transform && fused) {
+        if (0 != gpujpeg_encoder_launch(encoder, &gpujpeg_encoder_preprocess_dct, NULL, GPUJPEG_STATS_DCT)) {
+            return -1;
+        }
+        transform = 0;
+    }
+    if (transform) {
+        // Component planes are needed only when preprocessing and DCT aren't fused
+        if (0 != gpujpeg_coder_init_data(coder)) {
+            return -1;
+        }
+        if (0 != gpujpeg_encoder_launch(encoder, &gpujpeg_encoder_preprocess, NULL, GPUJPEG_STATS_PREPROCESS)) {
+            return -1;
+        }
+    }
+
+    // Encode preprocessed data
+    if (0 != gpujpeg_encoder_encode_planes(encoder, transform, NULL, NULL)) {
+        return -1;
+    }
 
     // Set compressed image
     *image_compressed = encoder->writer->buffer;
@@ -524,9 +1213,333 @@ gpujpeg_encoder_encode(struct gpujpeg_encoder* encoder, struct gpujpeg_parameter
 
     coder->d_data_raw = NULL;
 
+    gpujpeg_stats_end(coder);
+    return 0;
+}
+
+/**
+ * Ensure that buffer for compressed images of one encoding has at least given size
+ *
+ * @param encoder  Encoder structure
+ * @param buffer_size  Required size of the buffer
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_encoder_allocate_pyramid_buffer(struct gpujpeg_encoder* encoder, size_t buffer_size)
+{
+    if ( buffer_size > encoder->pyramid_buffer_allocated_size ) {
+        encoder->pyramid_buffer_allocated_size = 0;
+        free(encoder->pyramid_buffer);
+        encoder->pyramid_buffer = (uint8_t*) malloc(buffer_size);
+        if ( encoder->pyramid_buffer == NULL ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate pyramid buffer!\n");
+            return -1;
+        }
+        encoder->pyramid_buffer_allocated_size = buffer_size;
+    }
+    return 0;
+}
+
+/**
+ * Ensure that device buffer for planes kept between encoding passes has at least given size
+ *
+ * @param encoder  Encoder structure
+ * @param data_size  Required size of the buffer
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_encoder_allocate_pyramid_data(struct gpujpeg_encoder* encoder, size_t data_size)
+{
+    if ( data_size > encoder->pyramid_data_allocated_size ) {
+        encoder->pyramid_data_allocated_size = 0;
+        if ( encoder->d_pyramid_data != NULL ) {
+            gpujpeg_device_free(encoder->d_pyramid_data);
+            encoder->d_pyramid_data = NULL;
+        }
+        gpujpeg_device_malloc((void**)&encoder->d_pyramid_data, data_size * sizeof(uint8_t));
+        gpujpeg_device_check_error("Encoder pyramid data allocation", return -1);
+        encoder->pyramid_data_allocated_size = data_size;
+    }
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_encoder_encode_pyramid(struct gpujpeg_encoder* encoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image, struct gpujpeg_encoder_input* input,
+                               enum gpujpeg_resize_filter filter, int level_count, uint8_t** image_compressed, int* image_compressed_size)
+{
+    assert(level_count >= 1);
+    if ( input->type == GPUJPEG_ENCODER_INPUT_COEFFICIENTS ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Resolution pyramid can't be encoded from coefficients!\n");
+        return -1;
+    }
+    if ( param->precision > 8 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Resolution pyramid can't be encoded with 12-bit precision!\n");
+        return -1;
+    }
+    if ( gpujpeg_device_get_runtime()->host ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Resolution pyramid can't be encoded by host runtime!\n");
+        return -1;
+    }
+
+    // Get coder
+    struct gpujpeg_coder* coder = &encoder->coder;
+    gpujpeg_stats_begin(coder);
+
+    // Compute size of compressed pyramid buffer (writer buffer size for each level)
+    size_t buffer_size = 0;
+    struct gpujpeg_image_parameters level_param_image = *param_image;
+    for ( int level = 0; level < level_count; level++ ) {
+        buffer_size += 1000 + (size_t)level_param_image.width * level_param_image.height * level_param_image.comp_count * 2;
+        level_param_image.width = (level_param_image.width + 1) / 2;
+        level_param_image.height = (level_param_image.height + 1) / 2;
+    }
+    if ( gpujpeg_encoder_allocate_pyramid_buffer(encoder, buffer_size) != 0 ) {
+        return -1;
+    }
+
+    // (Re)initialize encoder for full resolution
+    if (0 != gpujpeg_encoder_init_image(encoder, param, param_image, input)) {
+        return -1;
+    }
+
+    // Allocate second buffer for planes of levels (levels alternate between it and coder buffer)
+    if ( level_count > 1 && gpujpeg_encoder_allocate_pyramid_data(encoder, coder->data_size) != 0 ) {
+        return -1;
+    }
+
+    // Load input image
+    if (0 != gpujpeg_encoder_load_input(encoder, input)) {
+        return -1;
+    }
+
+    // Preprocessing (only for full resolution), levels are downsampled from component planes
+    if (0 != gpujpeg_coder_init_data(coder)) {
+        return -1;
+    }
+    if (0 != gpujpeg_encoder_launch(encoder, &gpujpeg_encoder_preprocess, NULL, GPUJPEG_STATS_PREPROCESS)) {
+        return -1;
+    }
+
+    uint8_t* buffer_current = encoder->pyramid_buffer;
+    const uint8_t* header = NULL;
+    int header_size = 0;
+    uint8_t* d_data_coder = coder->d_data;
+    int result = 0;
+    level_param_image = *param_image;
+    for ( int level = 0; level < level_count; level++ ) {
+        if ( level > 0 ) {
+            // Planes of previous level stay in place, level is downsampled into the other buffer
+            struct gpujpeg_component component[GPUJPEG_MAX_COMPONENT_COUNT];
+            for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+                component[comp] = coder->component[comp];
+            }
+            uint8_t* d_data = coder->d_data;
+            coder->d_data = encoder->d_pyramid_data;
+            encoder->d_pyramid_data = d_data;
+
+            // Reinitialize coder for level resolution (buffers are large enough already)
+            level_param_image.width = (level_param_image.width + 1) / 2;
+            level_param_image.height = (level_param_image.height + 1) / 2;
+            if (0 == gpujpeg_coder_init_image(coder, param, &level_param_image, encoder->stream)) {
+                fprintf(stderr, "[GPUJPEG] [Error] Failed to init pyramid level %d encoding!\n", level);
+                result = -1;
+                break;
+            }
+            if (gpujpeg_writer_init(encoder->writer, &coder->param_image) != 0) {
+                fprintf(stderr, "[GPUJPEG] [Error] Failed to init writer!\n");
+                result = -1;
+                break;
+            }
+
+            // Filter planes of previous level
+            struct gpujpeg_encoder_kernel_param param;
+            memset(&param, 0, sizeof(param));
+            param.component = component;
+            param.filter = filter;
+            if (0 != gpujpeg_encoder_launch(encoder, &gpujpeg_encoder_downsample, &param, GPUJPEG_STATS_PREPROCESS)) {
+                result = -1;
+                break;
+            }
+        }
+
+        // Encode level (header of full resolution is reused)
+        if (0 != gpujpeg_encoder_encode_planes(encoder, 1, header, &header_size)) {
+            result = -1;
+            break;
+        }
+
+        // Move compressed level to pyramid buffer
+        int level_size = encoder->writer->buffer_current - encoder->writer->buffer;
+        memcpy(buffer_current, encoder->writer->buffer, level_size);
+        if ( level == 0 ) {
+            header = buffer_current;
+        }
+        image_compressed[level] = buffer_current;
+        image_compressed_size[level] = level_size;
+        buffer_current += level_size;
+    }
+
+    // Give planes buffers back to their owners (allocated sizes are accounted separately)
+    if ( coder->d_data != d_data_coder ) {
+        encoder->d_pyramid_data = coder->d_data;
+        coder->d_data = d_data_coder;
+    }
+    if ( result != 0 ) {
+        return result;
+    }
+
+    coder->d_data_raw = NULL;
+
+    gpujpeg_stats_end(coder);
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_encoder_encode_alpha(struct gpujpeg_encoder* encoder, struct gpujpeg_parameters* param, struct gpujpeg_image_parameters* param_image, struct gpujpeg_encoder_input* input,
+                             uint8_t** image_compressed, int* image_compressed_size, uint8_t** alpha_compressed, int* alpha_compressed_size)
+{
+    if ( param_image->pixel_format != GPUJPEG_444_U8_P012X && param_image->pixel_format != GPUJPEG_444_U8_P210X ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Alpha channel can be encoded only from 444-u8-p012x or 444-u8-p210x pixel format!\n");
+        return -1;
+    }
+    if ( input->type == GPUJPEG_ENCODER_INPUT_COEFFICIENTS ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Alpha channel can't be encoded from coefficients!\n");
+        return -1;
+    }
+    if ( gpujpeg_device_get_runtime()->host ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Alpha channel can't be encoded by host runtime!\n");
+        return -1;
+    }
+
+    // Get coder
+    struct gpujpeg_coder* coder = &encoder->coder;
+    gpujpeg_stats_begin(coder);
+
+    // Allocate buffer for both compressed images (writer buffer size for each image)
+    size_t plane_size = (size_t)param_image->width * param_image->height;
+    if ( gpujpeg_encoder_allocate_pyramid_buffer(encoder, 2000 + plane_size * (param_image->comp_count + 1) * 2) != 0 ) {
+        return -1;
+    }
+
+    // (Re)initialize encoder for color image
+    if (0 != gpujpeg_encoder_init_image(encoder, param, param_image, input)) {
+        return -1;
+    }
+
+    // Allocate alpha plane
+    if ( gpujpeg_encoder_allocate_pyramid_data(encoder, plane_size) != 0 ) {
+        return -1;
+    }
+
+    // Load input image
+    if (0 != gpujpeg_encoder_load_input(encoder, input)) {
+        return -1;
+    }
+
+    // Preprocessing (alpha plane is extracted in the same pass)
+    if (0 != gpujpeg_coder_init_data(coder)) {
+        return -1;
+    }
+    coder->d_data_alpha = encoder->d_pyramid_data;
+    int result = gpujpeg_encoder_launch(encoder, &gpujpeg_encoder_preprocess, NULL, GPUJPEG_STATS_PREPROCESS);
+    coder->d_data_alpha = NULL;
+    if (0 != result) {
+        return -1;
+    }
+
+    // Encode color image
+    if (0 != gpujpeg_encoder_encode_planes(encoder, 1, NULL, NULL)) {
+        return -1;
+    }
+    uint8_t* buffer_current = encoder->pyramid_buffer;
+    *image_compressed = buffer_current;
+    *image_compressed_size = encoder->writer->buffer_current - encoder->writer->buffer;
+    memcpy(buffer_current, encoder->writer->buffer, *image_compressed_size);
+    buffer_current += *image_compressed_size;
+
+    // Reinitialize coder for grayscale alpha image (buffers are large enough already)
+    struct gpujpeg_parameters param_alpha = *param;
+    param_alpha.color_space_internal = GPUJPEG_YCBCR_BT601_256LVLS;
+    param_alpha.sampling_factor[0].horizontal = 1;
+    param_alpha.sampling_factor[0].vertical = 1;
+    struct gpujpeg_image_parameters param_image_alpha = *param_image;
+    param_image_alpha.comp_count = 1;
+    param_image_alpha.pixel_format = GPUJPEG_U8;
+    if (0 == gpujpeg_coder_init_image(coder, &param_alpha, &param_image_alpha, encoder->stream)) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to init alpha image encoding!\n");
+        return -1;
+    }
+    if (gpujpeg_writer_init(encoder->writer, &coder->param_image) != 0) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to init writer!\n");
+        return -1;
+    }
+
+    // Load alpha plane to component buffer
+    if (0 != gpujpeg_coder_init_data(coder)) {
+        return -1;
+    }
+    coder->data_raw_planes.data[0] = encoder->d_pyramid_data;
+    coder->data_raw_planes.pitch[0] = param_image->width;
+    if (0 != gpujpeg_encoder_launch(encoder, &gpujpeg_encoder_preprocess, NULL, GPUJPEG_STATS_PREPROCESS)) {
+        return -1;
+    }
+
+    // Encode alpha image
+    if (0 != gpujpeg_encoder_encode_planes(encoder, 1, NULL, NULL)) {
+        return -1;
+    }
+    *alpha_compressed = buffer_current;
+    *alpha_compressed_size = encoder->writer->buffer_current - encoder->writer->buffer;
+    memcpy(buffer_current, encoder->writer->buffer, *alpha_compressed_size);
+
+    coder->d_data_raw = NULL;
+
+    gpujpeg_stats_end(coder);
     return 0;
 }
 
+/** Documented at declaration */
+void
+gpujpeg_encoder_set_host_threads(struct gpujpeg_encoder* encoder, int thread_count)
+{
+    encoder->host_thread_count = thread_count;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_encoder_set_route_model(struct gpujpeg_encoder* encoder, const struct gpujpeg_route_model* model)
+{
+    encoder->route_enabled = (model != NULL);
+    if (model != NULL) {
+        encoder->route_model = *model;
+    } else {
+        gpujpeg_route_model_set_default(&encoder->route_model);
+    }
+}
+
+/** Documented at declaration */
+int
+gpujpeg_encoder_set_stats(struct gpujpeg_encoder* encoder, int enabled)
+{
+    return gpujpeg_stats_set_enabled(&encoder->coder, enabled);
+}
+
+/** Documented at declaration */
+int
+gpujpeg_encoder_set_trace(struct gpujpeg_encoder* encoder, struct gpujpeg_trace* trace)
+{
+    return gpujpeg_stats_set_trace(&encoder->coder, trace, "encoder");
+}
+
+/** Documented at declaration */
+void
+gpujpeg_encoder_get_stats(struct gpujpeg_encoder* encoder, struct gpujpeg_stats* stats)
+{
+    *stats = encoder->coder.stats;
+}
+
 /** Documented at declaration */
 int
 gpujpeg_encoder_destroy(struct gpujpeg_encoder* encoder)
@@ -541,14 +1554,21 @@ gpujpeg_encoder_destroy(struct gpujpeg_encoder* encoder)
     }
     for (int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++) {
         if (encoder->table_quantization[comp_type].d_table != NULL) {
-            cudaFree(encoder->table_quantization[comp_type].d_table);
+            gpujpeg_device_free(encoder->table_quantization[comp_type].d_table);
+        }
+        if (encoder->table_quantization[comp_type].d_table_forward != NULL) {
+            gpujpeg_device_free(encoder->table_quantization[comp_type].d_table_forward);
         }
     }
     if (encoder->writer != NULL) {
         gpujpeg_writer_destroy(encoder->writer);
     }
+    if (encoder->d_pyramid_data != NULL) {
+        gpujpeg_device_free(encoder->d_pyramid_data);
+    }
+    free(encoder->pyramid_buffer);
     if (encoder->allocatedStream != NULL) {
-        cudaStreamDestroy(*(encoder->allocatedStream));
+        gpujpeg_device_stream_destroy(*(encoder->allocatedStream));
         free(encoder->allocatedStream);
         encoder->allocatedStream = NULL;
         encoder->stream = NULL;
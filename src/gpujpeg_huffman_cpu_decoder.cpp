@@ -50,8 +50,17 @@ struct gpujpeg_huffman_cpu_decoder
     
     // Coding component count
     int comp_count;
+    // Only luminance blocks are stored (chroma blocks are decoded in skip mode)
+    int luminance_only;
     // Current scan index
     int scan_index;
+
+    // Output coefficients of components (component->data_quantized when whole image is decoded)
+    int16_t* data_quantized[GPUJPEG_MAX_COMPONENT_COUNT];
+    // First MCU row of image stored in output coefficients
+    int mcu_row_offset;
+    // MCUs are only decoded in skip mode (they precede decoded MCU rows)
+    int skip;
     
     // Compressed data
     uint8_t* data;
@@ -224,13 +233,15 @@ gpujpeg_huffman_cpu_decoder_get_category(struct gpujpeg_huffman_cpu_decoder* cod
 /**
  * Decode one 8x8 block
  *
+ * @param data  Block output or NULL when the block is only skipped
  * @return 0 if succeeds, otherwise nonzero
  */
 int
 gpujpeg_huffman_cpu_decoder_decode_block(struct gpujpeg_huffman_cpu_decoder* coder, int16_t* data, int* dc, struct gpujpeg_table_huffman_decoder* table_dc, struct gpujpeg_table_huffman_decoder* table_ac)
 {    
     // Zero block output
-    memset(data, 0, sizeof(int16_t) * GPUJPEG_BLOCK_SIZE * GPUJPEG_BLOCK_SIZE);
+    if ( data != NULL )
+        memset(data, 0, sizeof(int16_t) * GPUJPEG_BLOCK_SIZE * GPUJPEG_BLOCK_SIZE);
 
     // Section F.2.2.1: decode the DC coefficient difference
     // get dc category number, s
@@ -247,7 +258,8 @@ gpujpeg_huffman_cpu_decoder_decode_block(struct gpujpeg_huffman_cpu_decoder* cod
     *dc = s;
 
     // Output the DC coefficient (assumes gpujpeg_natural_order[0] = 0)
-    data[0] = s;
+    if ( data != NULL )
+        data[0] = s;
     
     // Section F.2.2.2: decode the AC coefficients
     // Since zeroes are skipped, output area must be cleared beforehand
@@ -266,7 +278,8 @@ gpujpeg_huffman_cpu_decoder_decode_block(struct gpujpeg_huffman_cpu_decoder* cod
             //    s: ac value
             s = gpujpeg_huffman_cpu_decoder_value_from_category(s, r);
 
-            data[gpujpeg_order_natural[k]] = s;
+            if ( data != NULL )
+                data[gpujpeg_order_natural[k]] = s;
         } else {
             // s = 0, means ac value is 0 ? Only if r = 15.  
             //means all the left ac are zero
@@ -301,7 +314,8 @@ gpujpeg_huffman_cpu_decoder_decode_mcu(struct gpujpeg_huffman_cpu_decoder* coder
         struct gpujpeg_component* component = &coder->component[coder->scan_index];
  
         // Get component data for MCU
-        int16_t* block = &component->data_quantized[(segment_index * component->segment_mcu_count + mcu_index) * component->mcu_size];
+        int mcu_index_image = segment_index * component->segment_mcu_count + mcu_index - coder->mcu_row_offset * component->mcu_count_x;
+        int16_t* block = coder->skip ? NULL : &coder->data_quantized[coder->scan_index][mcu_index_image * component->mcu_size];
         
         // Get coder parameters
         int* dc = &coder->dc[coder->scan_index];
@@ -320,7 +334,7 @@ gpujpeg_huffman_cpu_decoder_decode_mcu(struct gpujpeg_huffman_cpu_decoder* coder
 
             // Prepare mcu indexes
             int mcu_index_x = (segment_index * component->segment_mcu_count + mcu_index) % component->mcu_count_x;
-            int mcu_index_y = (segment_index * component->segment_mcu_count + mcu_index) / component->mcu_count_x;
+            int mcu_index_y = (segment_index * component->segment_mcu_count + mcu_index) / component->mcu_count_x - coder->mcu_row_offset;
             // Compute base data index
             int data_index_base = mcu_index_y * (component->mcu_size * component->mcu_count_x) + mcu_index_x * (component->mcu_size_x * GPUJPEG_BLOCK_SIZE);
             
@@ -334,8 +348,8 @@ gpujpeg_huffman_cpu_decoder_decode_mcu(struct gpujpeg_huffman_cpu_decoder* coder
                     // Compute 8x8 block data index
                     int data_index = data_index_row + x * GPUJPEG_BLOCK_SIZE * GPUJPEG_BLOCK_SIZE;
                     
-                    // Get component data for MCU
-                    int16_t* block = &component->data_quantized[data_index];
+                    // Get component data for MCU (chroma is not stored when only luminance is decoded)
+                    int16_t* block = (coder->skip || (coder->luminance_only && comp > 0)) ? NULL : &coder->data_quantized[comp][data_index];
                     
                     // Get coder parameters
                     int* dc = &coder->dc[comp];
@@ -352,48 +366,83 @@ gpujpeg_huffman_cpu_decoder_decode_mcu(struct gpujpeg_huffman_cpu_decoder* coder
     return 0;
 }
 
-/** Documented at declaration */
-int
-gpujpeg_huffman_cpu_decoder_decode(struct gpujpeg_decoder* decoder)
+/**
+ * Initialize huffman coder for decoder
+ *
+ * @param decoder  Decoder structure
+ * @param coder  Huffman coder to initialize
+ * @return void
+ */
+static void
+gpujpeg_huffman_cpu_decoder_init(struct gpujpeg_decoder* decoder, struct gpujpeg_huffman_cpu_decoder* coder)
 {
-    int block_cx = (decoder->coder.param_image.width + GPUJPEG_BLOCK_SIZE - 1) / GPUJPEG_BLOCK_SIZE;
-    int block_cy = (decoder->coder.param_image.height + GPUJPEG_BLOCK_SIZE - 1) / GPUJPEG_BLOCK_SIZE;
-    
-    // Initialize huffman coder
-    struct gpujpeg_huffman_cpu_decoder coder;
-    coder.component = decoder->coder.component;
-    coder.scan_index = -1;
+    coder->component = decoder->coder.component;
+    coder->scan_index = -1;
     
     // Set huffman tables
     for ( int type = 0; type < GPUJPEG_COMPONENT_TYPE_COUNT; type++ ) {
-        coder.table_dc[type] = &decoder->table_huffman[type][GPUJPEG_HUFFMAN_DC];
-        coder.table_ac[type] = &decoder->table_huffman[type][GPUJPEG_HUFFMAN_AC];
+        coder->table_dc[type] = &decoder->table_huffman[type][GPUJPEG_HUFFMAN_DC];
+        coder->table_ac[type] = &decoder->table_huffman[type][GPUJPEG_HUFFMAN_AC];
     }
     
     // Set mcu component count
     if ( decoder->coder.param.interleaved == 1 )
-        coder.comp_count = decoder->coder.param_image.comp_count;
+        coder->comp_count = decoder->coder.param_image.comp_count;
     else
-        coder.comp_count = 1;
-    assert(coder.comp_count >= 1 && coder.comp_count <= GPUJPEG_MAX_COMPONENT_COUNT);
+        coder->comp_count = 1;
+    assert(coder->comp_count >= 1 && coder->comp_count <= GPUJPEG_MAX_COMPONENT_COUNT);
+    coder->luminance_only = decoder->coder.luminance_only;
+
+    // Whole image is decoded to component buffers
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ )
+        coder->data_quantized[comp] = (comp < decoder->coder.param_image.comp_count) ? decoder->coder.component[comp].data_quantized : NULL;
+    coder->mcu_row_offset = 0;
+    coder->skip = 0;
+}
+
+/**
+ * Reset huffman coder at the beginning of segment
+ *
+ * @param decoder  Decoder structure
+ * @param coder  Huffman coder
+ * @param segment  Segment to decode
+ * @return void
+ */
+static void
+gpujpeg_huffman_cpu_decoder_begin_segment(struct gpujpeg_decoder* decoder, struct gpujpeg_huffman_cpu_decoder* coder, struct gpujpeg_segment* segment)
+{
+    // Change current scan index
+    coder->scan_index = segment->scan_index;
     
-    // Decode all segments
-    for ( int segment_index = 0; segment_index < decoder->segment_count; segment_index++ ) {
+    // Initialize huffman coder
+    coder->get_buff = 0;
+    coder->get_bits = 0;
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ )
+        coder->dc[comp] = 0;
+    coder->data = &decoder->coder.data_compressed[segment->data_compressed_index];
+    coder->data_size = segment->data_compressed_size;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_huffman_cpu_decoder_decode(struct gpujpeg_decoder* decoder)
+{
+    return gpujpeg_huffman_cpu_decoder_decode_segments(decoder, 0, decoder->segment_count);
+}
+
+/** Documented at declaration */
+int
+gpujpeg_huffman_cpu_decoder_decode_segments(struct gpujpeg_decoder* decoder, int segment_begin, int segment_end)
+{
+    // Initialize huffman coder
+    struct gpujpeg_huffman_cpu_decoder coder;
+    gpujpeg_huffman_cpu_decoder_init(decoder, &coder);
+    
+    // Decode segments
+    for ( int segment_index = segment_begin; segment_index < segment_end; segment_index++ ) {
         // Get segment structure
         struct gpujpeg_segment* segment = &decoder->coder.segment[segment_index];
-        
-        // Change current scan index
-        if ( coder.scan_index != segment->scan_index ) {
-            coder.scan_index = segment->scan_index;
-        }
-        
-        // Initialize huffman coder
-        coder.get_buff = 0;
-        coder.get_bits = 0;
-        for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ )
-            coder.dc[comp] = 0;
-        coder.data = &decoder->coder.data_compressed[segment->data_compressed_index];
-        coder.data_size = segment->data_compressed_size;
+        gpujpeg_huffman_cpu_decoder_begin_segment(decoder, &coder, segment);
         
         // Decode segment MCUs
         for ( int mcu_index = 0; mcu_index < segment->mcu_count; mcu_index++ ) {
@@ -406,3 +455,51 @@ gpujpeg_huffman_cpu_decoder_decode(struct gpujpeg_decoder* decoder)
     
     return 0;
 }
+
+/** Documented at declaration */
+int
+gpujpeg_huffman_cpu_decoder_decode_mcu_rows(struct gpujpeg_decoder* decoder, int mcu_row_begin, int mcu_row_end, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT],
+                                            gpujpeg_huffman_cpu_decoder_mcu_row_callback_t callback, void* param)
+{
+    // MCU rows can be decoded only from single scan
+    assert(decoder->coder.param.interleaved == 1 || decoder->coder.param_image.comp_count == 1);
+    struct gpujpeg_component* component = &decoder->coder.component[0];
+    int mcu_count_x = component->mcu_count_x;
+    int mcu_begin = mcu_row_begin * mcu_count_x;
+    int mcu_end = mcu_row_end * mcu_count_x;
+    if ( mcu_end > component->mcu_count )
+        mcu_end = component->mcu_count;
+
+    // Initialize huffman coder to output one MCU row of coefficients
+    struct gpujpeg_huffman_cpu_decoder coder;
+    gpujpeg_huffman_cpu_decoder_init(decoder, &coder);
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ )
+        coder.data_quantized[comp] = coefficients[comp];
+    coder.mcu_row_offset = mcu_row_begin;
+
+    // Decoding starts at the beginning of segment containing the first MCU (DC prediction
+    // is reset only by restart markers), preceding MCUs are decoded in skip mode
+    int segment_index = mcu_begin / component->segment_mcu_count;
+    int mcu = segment_index * component->segment_mcu_count;
+    for ( ; mcu < mcu_end && segment_index < decoder->segment_count; segment_index++ ) {
+        struct gpujpeg_segment* segment = &decoder->coder.segment[segment_index];
+        gpujpeg_huffman_cpu_decoder_begin_segment(decoder, &coder, segment);
+
+        for ( int mcu_index = 0; mcu_index < segment->mcu_count && mcu < mcu_end; mcu_index++, mcu++ ) {
+            coder.skip = (mcu < mcu_begin);
+            if ( gpujpeg_huffman_cpu_decoder_decode_mcu(&coder, segment->scan_segment_index, mcu_index) != 0 ) {
+                fprintf(stderr, "[GPUJPEG] [Error] Huffman decoder failed at block [%d, %d]!\n", segment_index, mcu_index);
+                return -1;
+            }
+
+            // Completed MCU row is passed on while its coefficients are still in cache
+            if ( !coder.skip && (mcu + 1) % mcu_count_x == 0 ) {
+                if ( callback(decoder, coefficients, coder.mcu_row_offset, param) != 0 )
+                    return -1;
+                coder.mcu_row_offset++;
+            }
+        }
+    }
+    
+    return 0;
+}
@@ -40,4 +40,46 @@
 int
 gpujpeg_huffman_cpu_decoder_decode(struct gpujpeg_decoder* decoder);
 
+/**
+ * Perform huffman decoding of range of segments (segments are independent,
+ * so the rest of segments can be decoded elsewhere)
+ *
+ * @param decoder  Decoder structure
+ * @param segment_begin  First decoded segment
+ * @param segment_end  Segment after the last decoded one
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_huffman_cpu_decoder_decode_segments(struct gpujpeg_decoder* decoder, int segment_begin, int segment_end);
+
+/**
+ * Callback for each MCU row decoded by gpujpeg_huffman_cpu_decoder_decode_mcu_rows
+ *
+ * @param decoder  Decoder structure
+ * @param coefficients  Quantized coefficients of MCU row for each component
+ * @param mcu_row  Index of MCU row
+ * @param param  Callback parameter
+ * @return 0 if succeeds, otherwise nonzero
+ */
+typedef int (*gpujpeg_huffman_cpu_decoder_mcu_row_callback_t)(struct gpujpeg_decoder* decoder, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT], int mcu_row, void* param);
+
+/**
+ * Perform huffman decoding of range of MCU rows (image must be coded in single
+ * scan). Each MCU row is decoded to the same coefficient buffers, which hold one
+ * MCU row in the same layout as component->data_quantized, and passed to callback.
+ * Decoding begins at restart marker preceding the first MCU row, so ranges can be
+ * decoded independently.
+ *
+ * @param decoder  Decoder structure
+ * @param mcu_row_begin  First decoded MCU row
+ * @param mcu_row_end  MCU row after the last decoded one
+ * @param coefficients  Coefficient buffers of one MCU row for each component
+ * @param callback  Callback called for each decoded MCU row
+ * @param param  Callback parameter
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_huffman_cpu_decoder_decode_mcu_rows(struct gpujpeg_decoder* decoder, int mcu_row_begin, int mcu_row_end, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT],
+                                            gpujpeg_huffman_cpu_decoder_mcu_row_callback_t callback, void* param);
+
 #endif // GPUJPEG_HUFFMAN_CPU_DECODER_H
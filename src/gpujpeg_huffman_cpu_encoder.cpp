@@ -54,6 +54,11 @@ struct gpujpeg_huffman_cpu_encoder
     int scan_index;
     // Component count (1 means non-interleaving, > 1 means interleaving)
     int comp_count;
+    
+    // Input coefficients of components (component->data_quantized when whole image is encoded)
+    int16_t* data_quantized[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Index of first MCU row stored in input coefficients
+    int mcu_row_offset;
 };
 
 /**
@@ -238,7 +243,8 @@ gpujpeg_huffman_cpu_encoder_encode_mcu(struct gpujpeg_huffman_cpu_encoder* coder
         struct gpujpeg_component* component = &coder->component[coder->scan_index];
  
         // Get component data for MCU
-        int16_t* block = &component->data_quantized[(segment_index * component->segment_mcu_count + mcu_index) * component->mcu_size];
+        int mcu_index_image = segment_index * component->segment_mcu_count + mcu_index - coder->mcu_row_offset * component->mcu_count_x;
+        int16_t* block = &coder->data_quantized[coder->scan_index][mcu_index_image * component->mcu_size];
         
         // Get coder parameters
         int* dc = &coder->dc[coder->scan_index];
@@ -257,7 +263,7 @@ gpujpeg_huffman_cpu_encoder_encode_mcu(struct gpujpeg_huffman_cpu_encoder* coder
 
             // Prepare mcu indexes
             int mcu_index_x = (segment_index * component->segment_mcu_count + mcu_index) % component->mcu_count_x;
-            int mcu_index_y = (segment_index * component->segment_mcu_count + mcu_index) / component->mcu_count_x;
+            int mcu_index_y = (segment_index * component->segment_mcu_count + mcu_index) / component->mcu_count_x - coder->mcu_row_offset;
             // Compute base data index
             int data_index_base = mcu_index_y * (component->mcu_size * component->mcu_count_x) + mcu_index_x * (component->mcu_size_x * GPUJPEG_BLOCK_SIZE);
             
@@ -272,7 +278,7 @@ gpujpeg_huffman_cpu_encoder_encode_mcu(struct gpujpeg_huffman_cpu_encoder* coder
                     int data_index = data_index_row + x * GPUJPEG_BLOCK_SIZE * GPUJPEG_BLOCK_SIZE;
                     
                     // Get component data for MCU
-                    int16_t* block = &component->data_quantized[data_index];
+                    int16_t* block = &coder->data_quantized[comp][data_index];
                     
                     // Get coder parameters
                     int* dc = &coder->dc[comp];
@@ -290,32 +296,50 @@ gpujpeg_huffman_cpu_encoder_encode_mcu(struct gpujpeg_huffman_cpu_encoder* coder
     return 0;
 }
 
-/** Documented at declaration */
-int
-gpujpeg_huffman_cpu_encoder_encode(struct gpujpeg_encoder* encoder)
+/**
+ * Initialize huffman coder for encoding of whole image from component->data_quantized
+ *
+ * @param encoder  Encoder structure
+ * @param coder  Huffman coder structure to initialize
+ * @return void
+ */
+static void
+gpujpeg_huffman_cpu_encoder_init(struct gpujpeg_encoder* encoder, struct gpujpeg_huffman_cpu_encoder* coder)
 {
-    // Init huffman ecoder
-    struct gpujpeg_huffman_cpu_encoder coder;
-    coder.writer = encoder->writer;
-    coder.component = encoder->coder.component;
+    coder->writer = encoder->writer;
+    coder->component = encoder->coder.component;
     
     // Set huffman tables
     for ( int type = 0; type < GPUJPEG_COMPONENT_TYPE_COUNT; type++ ) {
-        coder.table_dc[type] = &encoder->table_huffman[type][GPUJPEG_HUFFMAN_DC];
-        coder.table_ac[type] = &encoder->table_huffman[type][GPUJPEG_HUFFMAN_AC];
+        coder->table_dc[type] = &encoder->table_huffman[type][GPUJPEG_HUFFMAN_DC];
+        coder->table_ac[type] = &encoder->table_huffman[type][GPUJPEG_HUFFMAN_AC];
     }
     
     // Set mcu component count
     if ( encoder->coder.param.interleaved == 1 )
-        coder.comp_count = encoder->coder.param_image.comp_count;
+        coder->comp_count = encoder->coder.param_image.comp_count;
     else
-        coder.comp_count = 1;
-    assert(coder.comp_count >= 1 && coder.comp_count <= GPUJPEG_MAX_COMPONENT_COUNT);
+        coder->comp_count = 1;
+    assert(coder->comp_count >= 1 && coder->comp_count <= GPUJPEG_MAX_COMPONENT_COUNT);
+    
+    // Set input coefficients
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ )
+        coder->data_quantized[comp] = (comp < encoder->coder.param_image.comp_count) ? encoder->coder.component[comp].data_quantized : NULL;
+    coder->mcu_row_offset = 0;
     
     // Ensure that before first scan the emit_left_bits will not be invoked
-    coder.put_bits = 0;
+    coder->put_bits = 0;
     // Perform scan init also for first scan
-    coder.scan_index = -1; 
+    coder->scan_index = -1; 
+}
+
+/** Documented at declaration */
+int
+gpujpeg_huffman_cpu_encoder_encode(struct gpujpeg_encoder* encoder)
+{
+    // Init huffman ecoder
+    struct gpujpeg_huffman_cpu_encoder coder;
+    gpujpeg_huffman_cpu_encoder_init(encoder, &coder);
     
     // Encode all segments
     for ( int segment_index = 0; segment_index < encoder->coder.segment_count; segment_index++ ) {
@@ -372,3 +396,60 @@ gpujpeg_huffman_cpu_encoder_encode(struct gpujpeg_encoder* encoder)
     
     return 0;
 }
+
+/** Documented at declaration */
+int
+gpujpeg_huffman_cpu_encoder_encode_segments(struct gpujpeg_encoder* encoder, int segment_begin, int segment_end, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT],
+                                            gpujpeg_huffman_cpu_encoder_mcu_row_callback_t callback, void* param)
+{
+    // MCU rows can be encoded only to single scan
+    assert(encoder->coder.param.interleaved == 1 || encoder->coder.param_image.comp_count == 1);
+    struct gpujpeg_component* component = &encoder->coder.component[0];
+    int mcu_count_x = component->mcu_count_x;
+
+    // Initialize huffman coder to read one MCU row of coefficients, each segment is
+    // written to its own place in compressed data buffer (as by GPU huffman encoder)
+    struct gpujpeg_huffman_cpu_encoder coder;
+    struct gpujpeg_writer writer;
+    gpujpeg_huffman_cpu_encoder_init(encoder, &coder);
+    coder.writer = &writer;
+    coder.scan_index = 0;
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ )
+        coder.data_quantized[comp] = coefficients[comp];
+    coder.mcu_row_offset = -1;
+
+    for ( int segment_index = segment_begin; segment_index < segment_end; segment_index++ ) {
+        struct gpujpeg_segment* segment = &encoder->coder.segment[segment_index];
+        writer.buffer = &encoder->coder.data_compressed[segment->data_compressed_index];
+        writer.buffer_current = writer.buffer;
+
+        // Restart huffman coder
+        coder.put_value = 0;
+        coder.put_bits = 0;
+        for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ )
+            coder.dc[comp] = 0;
+
+        int mcu = segment->scan_segment_index * component->segment_mcu_count;
+        for ( int mcu_index = 0; mcu_index < segment->mcu_count; mcu_index++, mcu++ ) {
+            // Coefficients of MCU row are produced when its first MCU is needed, so they stay in cache
+            if ( mcu / mcu_count_x != coder.mcu_row_offset ) {
+                coder.mcu_row_offset = mcu / mcu_count_x;
+                if ( callback(encoder, coefficients, coder.mcu_row_offset, param) != 0 )
+                    return -1;
+            }
+            if ( gpujpeg_huffman_cpu_encoder_encode_mcu(&coder, segment->scan_segment_index, mcu_index) != 0 ) {
+                fprintf(stderr, "[GPUJPEG] [Error] Huffman encoder failed at block [%d, %d]!\n", segment_index, mcu_index);
+                return -1;
+            }
+        }
+
+        // Emit left bits and terminate segment with restart marker
+        if ( coder.put_bits > 0 )
+            gpujpeg_huffman_cpu_encoder_emit_left_bits(&coder);
+        int restart_marker = GPUJPEG_MARKER_RST0 + (segment->scan_segment_index & 0x7);
+        gpujpeg_writer_emit_marker(coder.writer, restart_marker);
+        segment->data_compressed_size = writer.buffer_current - writer.buffer;
+    }
+
+    return 0;
+}
@@ -43,4 +43,35 @@
 int
 gpujpeg_huffman_cpu_encoder_encode(struct gpujpeg_encoder* encoder);
 
+/**
+ * Callback for each MCU row needed by gpujpeg_huffman_cpu_encoder_encode_segments
+ *
+ * @param encoder  Encoder structure
+ * @param coefficients  Buffers to be filled with quantized coefficients of MCU row for each component
+ * @param mcu_row  Index of MCU row
+ * @param param  Callback parameter
+ * @return 0 if succeeds, otherwise nonzero
+ */
+typedef int (*gpujpeg_huffman_cpu_encoder_mcu_row_callback_t)(struct gpujpeg_encoder* encoder, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT], int mcu_row, void* param);
+
+/**
+ * Perform huffman encoding of range of segments (image must be coded in single
+ * scan). Coefficients of each MCU row are requested from callback into the same
+ * coefficient buffers, which hold one MCU row in the same layout as
+ * component->data_quantized. Each segment is terminated by restart marker and
+ * stored to coder->data_compressed at its data_compressed_index (its
+ * data_compressed_size is set), so ranges can be encoded independently.
+ *
+ * @param encoder  Encoder structure
+ * @param segment_begin  First encoded segment
+ * @param segment_end  Segment after the last encoded one
+ * @param coefficients  Coefficient buffers of one MCU row for each component
+ * @param callback  Callback called for each MCU row
+ * @param param  Callback parameter
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_huffman_cpu_encoder_encode_segments(struct gpujpeg_encoder* encoder, int segment_begin, int segment_end, int16_t* coefficients[GPUJPEG_MAX_COMPONENT_COUNT],
+                                            gpujpeg_huffman_cpu_encoder_mcu_row_callback_t callback, void* param);
+
 #endif // GPUJPEG_HUFFMAN_CPU_ENCODER_H
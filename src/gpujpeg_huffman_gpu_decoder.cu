@@ -305,11 +305,12 @@ gpujpeg_huffman_gpu_decoder_get_coefficient(
 /**
  * Decode one 8x8 block
  *
+ * @param store  Store decoded coefficients (otherwise the block is only skipped)
  * @return 0 if succeeds, otherwise nonzero
  */
 __device__ inline int
 gpujpeg_huffman_gpu_decoder_decode_block(
-    int & dc, int16_t* const data_output, const unsigned int table_offset,
+    int & dc, int16_t* const data_output, const bool store, const unsigned int table_offset,
     unsigned int & r_bit, unsigned int & r_bit_count, uint4* const s_byte,
     unsigned int & s_byte_idx, const uint4* & d_byte, unsigned int & d_byte_chunk_count)
 {
@@ -327,7 +328,9 @@ gpujpeg_huffman_gpu_decoder_decode_block(
 
     // Output the DC coefficient (assumes gpujpeg_natural_order[0] = 0)
     // TODO: try to skip saving of zero coefficients
-    data_output[0] = dc_coefficient_value;
+    if(store) {
+        data_output[0] = dc_coefficient_value;
+    }
     
     // TODO: error check: coefficient_idx must still be 0 in valid codestreams
     coefficient_idx = 1;
@@ -357,7 +360,9 @@ gpujpeg_huffman_gpu_decoder_decode_block(
         }
         
         // save the coefficient   TODO: try to ommit saving 0 coefficients
-        data_output[gpujpeg_huffman_gpu_decoder_order_natural[coefficient_idx - 1]] = coefficient_value;
+        if(store) {
+            data_output[gpujpeg_huffman_gpu_decoder_order_natural[coefficient_idx - 1]] = coefficient_value;
+        }
     } while(coefficient_idx < 64);
     
     return 0;
@@ -383,7 +388,8 @@ gpujpeg_huffman_decoder_decode_kernel(
     int segment_count, 
     uint8_t* d_data_compressed,
     const uint64_t* d_block_list,
-    int16_t* d_data_quantized
+    int16_t* d_data_quantized,
+    const int luminance_only
 ) {
     int segment_index = blockIdx.x * THREADS_PER_TBLOCK + threadIdx.x;
     if ( segment_index >= segment_count )
@@ -437,7 +443,7 @@ gpujpeg_huffman_decoder_decode_kernel(
         // Encode MCUs in segment
         for ( int mcu_index = 0; mcu_index < segment->mcu_count; mcu_index++ ) {
             // Encode 8x8 block
-            if ( gpujpeg_huffman_gpu_decoder_decode_block(dc[0], block, table_offset, r_bit, r_bit_count, s_byte, s_byte_idx, d_byte, d_byte_chunk_count) != 0 )
+            if ( gpujpeg_huffman_gpu_decoder_decode_block(dc[0], block, true, table_offset, r_bit, r_bit_count, s_byte, s_byte_idx, d_byte, d_byte_chunk_count) != 0 )
                 break;
             
             // advance to next block
@@ -463,8 +469,9 @@ gpujpeg_huffman_decoder_decode_kernel(
             // Source data pointer
             int16_t* block = d_data_quantized + (packed_block_info >> 8);
             
-            // Encode 8x8 block
-            gpujpeg_huffman_gpu_decoder_decode_block(dc[last_dc_idx], block, huffman_table_offset, r_bit, r_bit_count, s_byte, s_byte_idx, d_byte, d_byte_chunk_count);
+            // Encode 8x8 block (chroma blocks are only skipped when only luminance is decoded)
+            const bool store = !(luminance_only && (packed_block_info & 0x80));
+            gpujpeg_huffman_gpu_decoder_decode_block(dc[last_dc_idx], block, store, huffman_table_offset, r_bit, r_bit_count, s_byte, s_byte_idx, d_byte, d_byte_chunk_count);
         }
         
         
@@ -603,9 +610,23 @@ gpujpeg_huffman_gpu_decoder_init()
     return 0;
 }
 
+/**
+ * Identifiers of huffman tables (see gpujpeg_table_huffman_decoder_cache_entry) from which
+ * fast decoding tables were built and device where they were built (tables are global)
+ */
+static unsigned int gpujpeg_huffman_gpu_decoder_tables_id[4] = { 0 };
+static int gpujpeg_huffman_gpu_decoder_tables_device = -1;
+
 /** Documented at declaration */
 int
 gpujpeg_huffman_gpu_decoder_decode(struct gpujpeg_decoder* decoder)
+{
+    return gpujpeg_huffman_gpu_decoder_decode_segments(decoder, 0, decoder->segment_count);
+}
+
+/** Documented at declaration */
+int
+gpujpeg_huffman_gpu_decoder_decode_segments(struct gpujpeg_decoder* decoder, int segment_begin, int segment_end)
 {    
     // Get coder
     struct gpujpeg_coder* coder = &decoder->coder;
@@ -626,53 +647,70 @@ gpujpeg_huffman_gpu_decoder_decode(struct gpujpeg_decoder* decoder)
     cudaFuncSetCacheConfig(gpujpeg_huffman_decoder_decode_kernel<true, THREADS_PER_TBLOCK>, cudaFuncCachePreferShared);
     cudaFuncSetCacheConfig(gpujpeg_huffman_decoder_decode_kernel<false, THREADS_PER_TBLOCK>, cudaFuncCachePreferShared);
     
-    // Setup GPU tables (one thread for each of 65536 entries)
-    gpujpeg_huffman_decoder_table_kernel<<<256, 256, 0, *(decoder->stream)>>>(
-        decoder->d_table_huffman[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_DC],
-        decoder->d_table_huffman[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_AC],
-        decoder->d_table_huffman[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_DC],
-        decoder->d_table_huffman[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_AC]
-    );
-    gpujpeg_cuda_check_error("Huffman decoder table setup failed", return -1);
+    // Fast decoding tables are rebuilt only when huffman tables changed (streams usually repeat them)
+    const unsigned int tables_id[4] = {
+        decoder->table_huffman_entry[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_DC]->id,
+        decoder->table_huffman_entry[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_AC]->id,
+        decoder->table_huffman_entry[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_DC]->id,
+        decoder->table_huffman_entry[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_AC]->id
+    };
+    int device = -1;
+    cudaGetDevice(&device);
+    if ( device != gpujpeg_huffman_gpu_decoder_tables_device || memcmp(tables_id, gpujpeg_huffman_gpu_decoder_tables_id, sizeof(tables_id)) != 0 ) {
+        // Setup GPU tables (one thread for each of 65536 entries)
+        gpujpeg_huffman_decoder_table_kernel<<<256, 256, 0, *(decoder->stream)>>>(
+            decoder->d_table_huffman[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_DC],
+            decoder->d_table_huffman[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_AC],
+            decoder->d_table_huffman[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_DC],
+            decoder->d_table_huffman[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_AC]
+        );
+        gpujpeg_cuda_check_error("Huffman decoder table setup failed", return -1);
 
-    // Get pointer to quick decoding table in device memory
-    void * d_src_ptr = 0;
-    cudaGetSymbolAddress(&d_src_ptr, gpujpeg_huffman_gpu_decoder_tables_quick);
-    gpujpeg_cuda_check_error("Huffman decoder table address lookup failed", return -1);
-    
-    // Copy quick decoding table into constant memory
-    cudaMemcpyToSymbolAsync(
-        gpujpeg_huffman_gpu_decoder_tables_quick_const,
-        d_src_ptr,
-        sizeof(*gpujpeg_huffman_gpu_decoder_tables_quick) * QUICK_TABLE_ITEMS,
-        0,
-        cudaMemcpyDeviceToDevice,
-        *(decoder->stream)
-    );
-    gpujpeg_cuda_check_error("Huffman decoder table copy failed", return -1);
+        // Get pointer to quick decoding table in device memory
+        void * d_src_ptr = 0;
+        cudaGetSymbolAddress(&d_src_ptr, gpujpeg_huffman_gpu_decoder_tables_quick);
+        gpujpeg_cuda_check_error("Huffman decoder table address lookup failed", return -1);
+        
+        // Copy quick decoding table into constant memory
+        cudaMemcpyToSymbolAsync(
+            gpujpeg_huffman_gpu_decoder_tables_quick_const,
+            d_src_ptr,
+            sizeof(*gpujpeg_huffman_gpu_decoder_tables_quick) * QUICK_TABLE_ITEMS,
+            0,
+            cudaMemcpyDeviceToDevice,
+            *(decoder->stream)
+        );
+        gpujpeg_cuda_check_error("Huffman decoder table copy failed", return -1);
+
+        memcpy(gpujpeg_huffman_gpu_decoder_tables_id, tables_id, sizeof(tables_id));
+        gpujpeg_huffman_gpu_decoder_tables_device = device;
+    }
     
     // Run decoding kernel
+    const int segment_count = segment_end - segment_begin;
     dim3 thread(THREADS_PER_TBLOCK);
-    dim3 grid(gpujpeg_div_and_round_up(decoder->segment_count, THREADS_PER_TBLOCK));
+    dim3 grid(gpujpeg_div_and_round_up(segment_count, THREADS_PER_TBLOCK));
     if(comp_count == 1) {
         gpujpeg_huffman_decoder_decode_kernel<true, THREADS_PER_TBLOCK><<<grid, thread, 0, *(decoder->stream)>>>(
             coder->d_component, 
-            coder->d_segment, 
+            coder->d_segment + segment_begin, 
             comp_count,
-            decoder->segment_count,
+            segment_count,
             coder->d_data_compressed,
             coder->d_block_list,
-            coder->d_data_quantized
+            coder->d_data_quantized,
+            coder->luminance_only
         );
     } else {
         gpujpeg_huffman_decoder_decode_kernel<false, THREADS_PER_TBLOCK><<<grid, thread, 0, *(decoder->stream)>>>(
             coder->d_component, 
-            coder->d_segment, 
+            coder->d_segment + segment_begin, 
             comp_count,
-            decoder->segment_count,
+            segment_count,
             coder->d_data_compressed,
             coder->d_block_list,
-            coder->d_data_quantized
+            coder->d_data_quantized,
+            coder->luminance_only
         );
     }
     gpujpeg_cuda_check_error("Huffman decoding failed", return -1);
@@ -53,6 +53,18 @@ gpujpeg_huffman_gpu_decoder_init();
 int
 gpujpeg_huffman_gpu_decoder_decode(struct gpujpeg_decoder* decoder);
 
+/**
+ * Perform huffman decoding of range of segments (segment structures and
+ * compressed data of the range must be already in device memory)
+ *
+ * @param decoder  Decoder structure
+ * @param segment_begin  First decoded segment
+ * @param segment_end  Segment after the last decoded one
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_huffman_gpu_decoder_decode_segments(struct gpujpeg_decoder* decoder, int segment_begin, int segment_end);
+
 #ifdef __cplusplus
 }
 #endif
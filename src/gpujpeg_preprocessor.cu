@@ -30,6 +30,9 @@
 #include "gpujpeg_preprocessor.h"
 #include <libgpujpeg/gpujpeg_util.h>
 #include "gpujpeg_colorspace.h"
+#include "gpujpeg_sampling.h"
+#include "gpujpeg_dct.h"
+#include <cuda_fp16.h>
 
 #define RGB_8BIT_THREADS 256
 
@@ -40,6 +43,9 @@ struct gpujpeg_preprocessor_data_component
 {
     uint8_t* d_data;
     int data_width;
+    // Real component plane size (used when component is resampled)
+    int width;
+    int height;
     struct gpujpeg_component_sampling_factor sampling_factor;
 };
 
@@ -48,7 +54,18 @@ struct gpujpeg_preprocessor_data_component
  */
 struct gpujpeg_preprocessor_data
 {
-    struct gpujpeg_preprocessor_data_component comp[3];
+    struct gpujpeg_preprocessor_data_component comp[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Raw image size when raw image is resampled (zero otherwise)
+    int raw_width;
+    int raw_height;
+    // Resampling filter
+    enum gpujpeg_resize_filter filter;
+    // Tensor format (decoder tensor output)
+    struct gpujpeg_tensor_format tensor;
+    // Fourth byte of 4-byte pixels (decoder output)
+    uint8_t alpha;
+    // Plane where fourth byte of 4-byte pixels is extracted or NULL (encoder input)
+    uint8_t* d_alpha;
 };
 
 /** Value that means that sampling factor has dynamic value */
@@ -258,6 +275,336 @@ gpujpeg_preprocessor_raw_to_comp_kernel_4_2_2(struct gpujpeg_preprocessor_data d
     }
 }
 
+/**
+ * Lanczos (2 lobes) kernel
+ *
+ * @param d  Distance from filtered position in target sample units
+ * @return weight
+ */
+static __device__ float
+gpujpeg_preprocessor_lanczos2(float d)
+{
+    if ( d == 0.0f ) {
+        return 1.0f;
+    }
+    if ( fabsf(d) >= 2.0f ) {
+        return 0.0f;
+    }
+    const float pd = 3.14159265f * d;
+    return (2.0f * __sinf(pd) * __sinf(pd * 0.5f)) / (pd * pd);
+}
+
+/**
+ * Resample source samples for one target image position
+ *
+ * Box filter averages all source samples covered by the target sample (nearest
+ * sample when upscaling), Lanczos filter is widened by the scale when downscaling.
+ *
+ * @param d_source  Source samples (interleaved channels)
+ * @param source_width  Source width
+ * @param source_height  Source height
+ * @param source_stride  Source row stride in pixels
+ * @param filter  Resampling filter
+ * @param image_width  Target image width
+ * @param image_height  Target image height
+ * @param x  Target position x
+ * @param y  Target position y
+ * @param value  Resampled channel values
+ */
+template<int channel_count>
+static __device__ void
+gpujpeg_preprocessor_resample(const uint8_t* d_source, int source_width, int source_height, int source_stride, enum gpujpeg_resize_filter filter,
+                              int image_width, int image_height, int x, int y, float* value)
+{
+    const float scale_x = (float)source_width / image_width;
+    const float scale_y = (float)source_height / image_height;
+    for ( int c = 0; c < channel_count; c++ ) {
+        value[c] = 0.0f;
+    }
+    float weight_sum = 0.0f;
+    if ( filter == GPUJPEG_RESIZE_FILTER_BOX ) {
+        int x0 = min((int)(x * scale_x), source_width - 1);
+        int y0 = min((int)(y * scale_y), source_height - 1);
+        int x1 = min(max(x0 + 1, (int)ceilf((x + 1) * scale_x)), source_width);
+        int y1 = min(max(y0 + 1, (int)ceilf((y + 1) * scale_y)), source_height);
+        for ( int sy = y0; sy < y1; sy++ ) {
+            for ( int sx = x0; sx < x1; sx++ ) {
+                const uint8_t* sample = &d_source[(sy * source_stride + sx) * channel_count];
+                for ( int c = 0; c < channel_count; c++ ) {
+                    value[c] += sample[c];
+                }
+            }
+        }
+        weight_sum = (float)((x1 - x0) * (y1 - y0));
+    } else {
+        const float filter_scale_x = fmaxf(scale_x, 1.0f);
+        const float filter_scale_y = fmaxf(scale_y, 1.0f);
+        const float center_x = (x + 0.5f) * scale_x - 0.5f;
+        const float center_y = (y + 0.5f) * scale_y - 0.5f;
+        const int x0 = (int)ceilf(center_x - 2.0f * filter_scale_x);
+        const int x1 = (int)floorf(center_x + 2.0f * filter_scale_x);
+        const int y0 = (int)ceilf(center_y - 2.0f * filter_scale_y);
+        const int y1 = (int)floorf(center_y + 2.0f * filter_scale_y);
+        for ( int sy = y0; sy <= y1; sy++ ) {
+            const float weight_y = gpujpeg_preprocessor_lanczos2((sy - center_y) / filter_scale_y);
+            const int row = min(max(sy, 0), source_height - 1) * source_stride;
+            for ( int sx = x0; sx <= x1; sx++ ) {
+                const float weight = weight_y * gpujpeg_preprocessor_lanczos2((sx - center_x) / filter_scale_x);
+                const uint8_t* sample = &d_source[(row + min(max(sx, 0), source_width - 1)) * channel_count];
+                for ( int c = 0; c < channel_count; c++ ) {
+                    value[c] += weight * sample[c];
+                }
+                weight_sum += weight;
+            }
+        }
+    }
+    for ( int c = 0; c < channel_count; c++ ) {
+        value[c] = fminf(fmaxf(value[c] / weight_sum + 0.5f, 0.0f), 255.0f);
+    }
+}
+
+/** Specialization [raw image 4:4:4 resampled to image size] */
+template<
+    enum gpujpeg_color_space color_space_internal,
+    enum gpujpeg_color_space color_space,
+    uint8_t s_comp1_samp_factor_h, uint8_t s_comp1_samp_factor_v,
+    uint8_t s_comp2_samp_factor_h, uint8_t s_comp2_samp_factor_v,
+    uint8_t s_comp3_samp_factor_h, uint8_t s_comp3_samp_factor_v
+>
+__global__ void
+gpujpeg_preprocessor_raw_to_comp_kernel_resize_4_4_4(struct gpujpeg_preprocessor_data data, const uint8_t* d_data_raw, const uint8_t* d_data_raw_end, int image_width, int image_height, uint32_t width_div_mul, uint32_t width_div_shift)
+{
+    // Position
+    int image_position = (blockIdx.y * gridDim.x + blockIdx.x) * blockDim.x + threadIdx.x;
+    if ( image_position >= (image_width * image_height) )
+        return;
+    int image_position_y = gpujpeg_const_div_divide(image_position, width_div_mul, width_div_shift);
+    int image_position_x = image_position - (image_position_y * image_width);
+
+    // Load and resample
+    float value[3];
+    gpujpeg_preprocessor_resample<3>(d_data_raw, data.raw_width, data.raw_height, data.raw_width, data.filter, image_width, image_height, image_position_x, image_position_y, value);
+    uint8_t r1 = (uint8_t)value[0];
+    uint8_t r2 = (uint8_t)value[1];
+    uint8_t r3 = (uint8_t)value[2];
+
+    // Load Order
+    gpujpeg_color_order<color_space>::perform_load(r1, r2, r3);
+
+    // Color transform
+    gpujpeg_color_transform<color_space, color_space_internal>::perform(r1, r2, r3);
+
+    // Store
+    gpujpeg_preprocessor_raw_to_comp_store<s_comp1_samp_factor_h, s_comp1_samp_factor_v>(r1, image_position_x, image_position_y, data.comp[0]);
+    gpujpeg_preprocessor_raw_to_comp_store<s_comp2_samp_factor_h, s_comp2_samp_factor_v>(r2, image_position_x, image_position_y, data.comp[1]);
+    gpujpeg_preprocessor_raw_to_comp_store<s_comp3_samp_factor_h, s_comp3_samp_factor_v>(r3, image_position_x, image_position_y, data.comp[2]);
+}
+
+/**
+ * Kernel - Resample one component raw image into component buffer
+ */
+__global__ void
+gpujpeg_preprocessor_raw_to_comp_kernel_resize_u8(struct gpujpeg_preprocessor_data data, const uint8_t* d_data_raw, int image_width, int image_height)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if ( x >= image_width || y >= image_height )
+        return;
+
+    float value[1];
+    gpujpeg_preprocessor_resample<1>(d_data_raw, data.raw_width, data.raw_height, data.raw_width, data.filter, image_width, image_height, x, y, value);
+    data.comp[0].d_data[y * data.comp[0].data_width + x] = (uint8_t)value[0];
+}
+
+/**
+ * Kernel - Copy raw image given by planes with row pitches into component buffers
+ * (encoder) or component buffers into raw image planes (decoder)
+ */
+typedef void (*gpujpeg_preprocessor_planes_kernel)(struct gpujpeg_preprocessor_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height);
+
+/**
+ * Check whether pixel format is processed only by planes kernels (there are no
+ * specialized kernels for contiguous raw image of the format, which also holds
+ * for all 16-bit formats)
+ */
+static bool
+gpujpeg_preprocessor_planes_only(enum gpujpeg_pixel_format pixel_format)
+{
+    return pixel_format != GPUJPEG_U8 && pixel_format != GPUJPEG_444_U8_P012 && pixel_format != GPUJPEG_422_U8_P1020;
+}
+
+/**
+ * Load pixel from raw image planes, components of packed formats are reordered
+ * by color space, planar formats have components in plane order. Chroma of
+ * subsampled formats is replicated to all pixels it covers.
+ */
+template<enum gpujpeg_color_space color_space>
+static __device__ void
+gpujpeg_preprocessor_planes_load(const struct gpujpeg_image_planes & planes, enum gpujpeg_pixel_format pixel_format, int x, int y, uint8_t & r1, uint8_t & r2, uint8_t & r3)
+{
+    if ( pixel_format == GPUJPEG_444_U8_P012 ) {
+        const uint8_t* pixel = &planes.data[0][y * planes.pitch[0] + x * 3];
+        r1 = pixel[0];
+        r2 = pixel[1];
+        r3 = pixel[2];
+        gpujpeg_color_order<color_space>::perform_load(r1, r2, r3);
+    } else if ( pixel_format == GPUJPEG_444_U8_P012X || pixel_format == GPUJPEG_444_U8_P210X || pixel_format == GPUJPEG_4444_U8_P0123 ) {
+        // Whole pixel is loaded at once (rows are at least 4-byte aligned)
+        const uchar4 pixel = *(const uchar4*)&planes.data[0][y * planes.pitch[0] + x * 4];
+        r1 = (pixel_format != GPUJPEG_444_U8_P210X) ? pixel.x : pixel.z;
+        r2 = pixel.y;
+        r3 = (pixel_format != GPUJPEG_444_U8_P210X) ? pixel.z : pixel.x;
+        gpujpeg_color_order<color_space>::perform_load(r1, r2, r3);
+    } else if ( pixel_format == GPUJPEG_422_U8_P1020 ) {
+        const uint8_t* pixel = &planes.data[0][y * planes.pitch[0] + (x & ~1) * 2];
+        r1 = pixel[0];
+        r2 = pixel[1 + (x & 1) * 2];
+        r3 = pixel[2];
+        gpujpeg_color_order<color_space>::perform_load(r1, r2, r3);
+    } else if ( pixel_format == GPUJPEG_422_U8_P0102 ) {
+        // Samples are loaded in the same order as for GPUJPEG_422_U8_P1020
+        const uint8_t* pixel = &planes.data[0][y * planes.pitch[0] + (x & ~1) * 2];
+        r1 = pixel[1];
+        r2 = pixel[(x & 1) * 2];
+        r3 = pixel[3];
+        gpujpeg_color_order<color_space>::perform_load(r1, r2, r3);
+    } else if ( pixel_format == GPUJPEG_420_U8_P0P12 ) {
+        const uint8_t* chroma = &planes.data[1][(y >> 1) * planes.pitch[1] + (x >> 1) * 2];
+        r1 = planes.data[0][y * planes.pitch[0] + x];
+        r2 = chroma[0];
+        r3 = chroma[1];
+    } else {
+        const int shift_x = (pixel_format == GPUJPEG_444_U8_P0P1P2) ? 0 : 1;
+        const int shift_y = (pixel_format == GPUJPEG_420_U8_P0P1P2) ? 1 : 0;
+        r1 = planes.data[0][y * planes.pitch[0] + x];
+        r2 = planes.data[1][(y >> shift_y) * planes.pitch[1] + (x >> shift_x)];
+        r3 = planes.data[2][(y >> shift_y) * planes.pitch[2] + (x >> shift_x)];
+    }
+}
+
+/** Specialization [raw image planes, sampling factors are handled dynamically] */
+template<
+    enum gpujpeg_color_space color_space_internal,
+    enum gpujpeg_color_space color_space
+>
+__global__ void
+gpujpeg_preprocessor_raw_to_comp_kernel_planes(struct gpujpeg_preprocessor_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if ( x >= image_width || y >= image_height )
+        return;
+
+    if ( pixel_format == GPUJPEG_U8 ) {
+        data.comp[0].d_data[y * data.comp[0].data_width + x] = planes.data[0][y * planes.pitch[0] + x];
+        return;
+    }
+
+    // Load
+    uint8_t r1;
+    uint8_t r2;
+    uint8_t r3;
+    gpujpeg_preprocessor_planes_load<color_space>(planes, pixel_format, x, y, r1, r2, r3);
+
+    // Color transform
+    gpujpeg_color_transform<color_space, color_space_internal>::perform(r1, r2, r3);
+
+    // Store
+    gpujpeg_preprocessor_raw_to_comp_store<GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC>(r1, x, y, data.comp[0]);
+    gpujpeg_preprocessor_raw_to_comp_store<GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC>(r2, x, y, data.comp[1]);
+    gpujpeg_preprocessor_raw_to_comp_store<GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC>(r3, x, y, data.comp[2]);
+
+    // Fourth byte of 4-byte pixels is K component (not color transformed) or alpha extracted to its plane
+    if ( pixel_format == GPUJPEG_4444_U8_P0123 ) {
+        uint8_t r4 = planes.data[0][y * planes.pitch[0] + x * 4 + 3];
+        gpujpeg_preprocessor_raw_to_comp_store<GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC>(r4, x, y, data.comp[3]);
+    } else if ( data.d_alpha != NULL ) {
+        data.d_alpha[y * image_width + x] = planes.data[0][y * planes.pitch[0] + x * 4 + 3];
+    }
+}
+
+/**
+ * Select preprocessor encode kernel for raw image planes
+ *
+ * @param color_space  Color space of raw image
+ * @return kernel
+ */
+template<enum gpujpeg_color_space color_space_internal>
+static gpujpeg_preprocessor_planes_kernel
+gpujpeg_preprocessor_select_encode_planes_kernel(enum gpujpeg_color_space color_space)
+{
+    switch ( color_space ) {
+    case GPUJPEG_NONE: return &gpujpeg_preprocessor_raw_to_comp_kernel_planes<color_space_internal, GPUJPEG_NONE>;
+    case GPUJPEG_RGB: return &gpujpeg_preprocessor_raw_to_comp_kernel_planes<color_space_internal, GPUJPEG_RGB>;
+    case GPUJPEG_YCBCR_BT601: return &gpujpeg_preprocessor_raw_to_comp_kernel_planes<color_space_internal, GPUJPEG_YCBCR_BT601>;
+    case GPUJPEG_YCBCR_BT601_256LVLS: return &gpujpeg_preprocessor_raw_to_comp_kernel_planes<color_space_internal, GPUJPEG_YCBCR_BT601_256LVLS>;
+    case GPUJPEG_YCBCR_BT709: return &gpujpeg_preprocessor_raw_to_comp_kernel_planes<color_space_internal, GPUJPEG_YCBCR_BT709>;
+    case GPUJPEG_YUV: return &gpujpeg_preprocessor_raw_to_comp_kernel_planes<color_space_internal, GPUJPEG_YUV>;
+    case GPUJPEG_CMYK: return &gpujpeg_preprocessor_raw_to_comp_kernel_planes<color_space_internal, GPUJPEG_CMYK>;
+    case GPUJPEG_YCCK: return &gpujpeg_preprocessor_raw_to_comp_kernel_planes<color_space_internal, GPUJPEG_YCCK>;
+    default: assert(false); return NULL;
+    }
+}
+
+/**
+ * Kernel - Copy 16-bit raw image (12-bit samples) into 16-bit component buffers, RGB
+ * is optionally transformed to YCbCr (BT.601 full range scaled to 4096 levels).
+ * Components are never subsampled for 12-bit precision.
+ */
+template<bool rgb_to_ycbcr>
+__global__ void
+gpujpeg_preprocessor_raw_to_comp_kernel_u16(struct gpujpeg_preprocessor_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if ( x >= image_width || y >= image_height )
+        return;
+
+    const uint16_t* row = (const uint16_t*)(planes.data[0] + y * planes.pitch[0]);
+    if ( pixel_format == GPUJPEG_U16 ) {
+        ((uint16_t*)data.comp[0].d_data)[y * data.comp[0].data_width + x] = min((int)row[x], 4095);
+        return;
+    }
+
+    float r1 = row[x * 3 + 0];
+    float r2 = row[x * 3 + 1];
+    float r3 = row[x * 3 + 2];
+    if ( rgb_to_ycbcr ) {
+        const float y_value = 0.299f * r1 + 0.587f * r2 + 0.114f * r3;
+        const float cb_value = -0.168736f * r1 - 0.331264f * r2 + 0.5f * r3 + 2048.0f;
+        const float cr_value = 0.5f * r1 - 0.418688f * r2 - 0.081312f * r3 + 2048.0f;
+        r1 = y_value;
+        r2 = cb_value;
+        r3 = cr_value;
+    }
+    ((uint16_t*)data.comp[0].d_data)[y * data.comp[0].data_width + x] = (uint16_t)fminf(fmaxf(rintf(r1), 0.0f), 4095.0f);
+    ((uint16_t*)data.comp[1].d_data)[y * data.comp[1].data_width + x] = (uint16_t)fminf(fmaxf(rintf(r2), 0.0f), 4095.0f);
+    ((uint16_t*)data.comp[2].d_data)[y * data.comp[2].data_width + x] = (uint16_t)fminf(fmaxf(rintf(r3), 0.0f), 4095.0f);
+}
+
+/**
+ * Select preprocessor encode kernel for 16-bit raw image (only identity and
+ * RGB to YCbCr color transforms are supported for 12-bit precision)
+ *
+ * @param coder
+ * @return kernel
+ */
+static gpujpeg_preprocessor_planes_kernel
+gpujpeg_preprocessor_select_encode_u16_kernel(struct gpujpeg_coder* coder)
+{
+    enum gpujpeg_color_space color_space = coder->param_image.color_space;
+    enum gpujpeg_color_space color_space_internal = coder->param.color_space_internal;
+    if ( coder->param_image.pixel_format == GPUJPEG_U16 || color_space == color_space_internal || color_space_internal == GPUJPEG_NONE ) {
+        return &gpujpeg_preprocessor_raw_to_comp_kernel_u16<false>;
+    }
+    if ( color_space == GPUJPEG_RGB && color_space_internal == GPUJPEG_YCBCR_BT601_256LVLS ) {
+        return &gpujpeg_preprocessor_raw_to_comp_kernel_u16<true>;
+    }
+    fprintf(stderr, "[GPUJPEG] [Error] Color transformation from %s to %s is not supported for 12-bit precision!\n",
+            gpujpeg_color_space_get_name(color_space), gpujpeg_color_space_get_name(color_space_internal));
+    return NULL;
+}
+
 /**
  * Select preprocessor encode kernel
  *
@@ -299,8 +646,27 @@ gpujpeg_preprocessor_select_encode_kernel(struct gpujpeg_coder* coder)
         return &KERNEL<color_space_internal, COLOR, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC>; \
     } \
 
+    // Raw image is resampled
+    if ( coder->data_raw_width != 0 ) {
+        assert(coder->param_image.pixel_format == GPUJPEG_444_U8_P012);
+        if ( coder->param_image.color_space == GPUJPEG_NONE ) {
+            RETURN_KERNEL(gpujpeg_preprocessor_raw_to_comp_kernel_resize_4_4_4, GPUJPEG_NONE);
+        } else if ( coder->param_image.color_space == GPUJPEG_RGB ) {
+            RETURN_KERNEL(gpujpeg_preprocessor_raw_to_comp_kernel_resize_4_4_4, GPUJPEG_RGB);
+        } else if ( coder->param_image.color_space == GPUJPEG_YCBCR_BT601 ) {
+            RETURN_KERNEL(gpujpeg_preprocessor_raw_to_comp_kernel_resize_4_4_4, GPUJPEG_YCBCR_BT601);
+        } else if ( coder->param_image.color_space == GPUJPEG_YCBCR_BT601_256LVLS ) {
+            RETURN_KERNEL(gpujpeg_preprocessor_raw_to_comp_kernel_resize_4_4_4, GPUJPEG_YCBCR_BT601_256LVLS);
+        } else if ( coder->param_image.color_space == GPUJPEG_YCBCR_BT709 ) {
+            RETURN_KERNEL(gpujpeg_preprocessor_raw_to_comp_kernel_resize_4_4_4, GPUJPEG_YCBCR_BT709);
+        } else if ( coder->param_image.color_space == GPUJPEG_YUV ) {
+            RETURN_KERNEL(gpujpeg_preprocessor_raw_to_comp_kernel_resize_4_4_4, GPUJPEG_YUV);
+        } else {
+            assert(false);
+        }
+    }
     // None color space
-    if ( coder->param_image.color_space == GPUJPEG_NONE ) {
+    else if ( coder->param_image.color_space == GPUJPEG_NONE ) {
         if ( coder->param_image.pixel_format == GPUJPEG_444_U8_P012 ) {
             RETURN_KERNEL(gpujpeg_preprocessor_raw_to_comp_kernel_4_4_4, GPUJPEG_NONE);
         } else if ( coder->param_image.pixel_format == GPUJPEG_422_U8_P1020 ) {
@@ -378,12 +744,14 @@ gpujpeg_preprocessor_encoder_init(struct gpujpeg_coder* coder)
         return 0;
     }
 
-    assert(coder->param_image.comp_count == 3);
-
     switch (coder->param_image.pixel_format) {
         case GPUJPEG_444_U8_P012:
         case GPUJPEG_422_U8_P1020:
         {
+            if ( coder->param_image.comp_count != 3 ) {
+                fprintf(stderr, "[GPUJPEG] [Error] Pixel format %d can be used only for image with 3 components!\n", coder->param_image.pixel_format);
+                return -1;
+            }
             coder->preprocessor = NULL;
             if (coder->param.color_space_internal == GPUJPEG_NONE) {
                 coder->preprocessor = (void*)gpujpeg_preprocessor_select_encode_kernel<GPUJPEG_NONE>(coder);
@@ -460,6 +828,9 @@ gpujpeg_preprocessor_encode_interlaced(struct gpujpeg_encoder * encoder)
         data.comp[comp].sampling_factor.vertical = coder->sampling_factor.vertical / coder->component[comp].sampling_factor.vertical;
         data.comp[comp].data_width = coder->component[comp].data_width;
     }
+    data.raw_width = coder->data_raw_width;
+    data.raw_height = coder->data_raw_height;
+    data.filter = coder->data_raw_filter;
     kernel<<<grid, threads, 0, *(encoder->stream)>>>(
         data,
         coder->d_data_raw,
@@ -474,15 +845,290 @@ gpujpeg_preprocessor_encode_interlaced(struct gpujpeg_encoder * encoder)
     return 0;
 }
 
+/**
+ * Kernel - Resample component plane between subsampled and full resolution by sampling filter
+ *
+ * @param d_source  Source plane
+ * @param source_width  Source plane width
+ * @param source_height  Source plane height
+ * @param source_pitch  Source plane row pitch
+ * @param d_target  Target plane
+ * @param target_width  Target plane width
+ * @param target_height  Target plane height
+ * @param target_pitch  Target plane row pitch
+ * @param filter  Sampling filter
+ * @param factor_h  Horizontal ratio of sampling factors
+ * @param factor_v  Vertical ratio of sampling factors
+ */
+template<bool upsample>
+__global__ void
+gpujpeg_preprocessor_sampling_kernel(const uint8_t* d_source, int source_width, int source_height, int source_pitch,
+                                     uint8_t* d_target, int target_width, int target_height, int target_pitch,
+                                     enum gpujpeg_sampling_filter filter, int factor_h, int factor_v)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if ( x >= target_width || y >= target_height )
+        return;
+
+    struct gpujpeg_sampling_taps taps_h;
+    struct gpujpeg_sampling_taps taps_v;
+    if ( upsample ) {
+        gpujpeg_sampling_upsample_taps(filter, factor_h, x, taps_h);
+        gpujpeg_sampling_upsample_taps(filter, factor_v, y, taps_v);
+    } else {
+        gpujpeg_sampling_downsample_taps(filter, factor_h, x, taps_h);
+        gpujpeg_sampling_downsample_taps(filter, factor_v, y, taps_v);
+    }
+    d_target[y * target_pitch + x] = gpujpeg_sampling_filter_sample(d_source, source_width, source_height, source_pitch, taps_h, taps_v);
+}
+
+/**
+ * Check whether subsampled components are resampled by sampling filter through
+ * full resolution planes (otherwise they are sampled by nearest neighbor directly
+ * in preprocessor/postprocessor kernels)
+ *
+ * @param coder  Coder structure
+ * @param comp_count  Number of processed components
+ * @return true if sampling filter is used
+ */
+static bool
+gpujpeg_preprocessor_sampling_filtered(struct gpujpeg_coder* coder, int comp_count)
+{
+    if ( coder->sampling_filter == GPUJPEG_SAMPLING_FILTER_NEAREST || coder->param.precision > 8
+            || coder->data_raw_width != 0 || coder->data_scale != 1 ) {
+        return false;
+    }
+    bool subsampled = false;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        int factor_h = coder->sampling_factor.horizontal / coder->component[comp].sampling_factor.horizontal;
+        int factor_v = coder->sampling_factor.vertical / coder->component[comp].sampling_factor.vertical;
+        if ( factor_h > GPUJPEG_SAMPLING_MAX_FACTOR || factor_v > GPUJPEG_SAMPLING_MAX_FACTOR ) {
+            return false;
+        }
+        subsampled |= (factor_h != 1 || factor_v != 1);
+    }
+    return subsampled;
+}
+
+/**
+ * Redirect subsampled components of preprocessor data to full resolution planes
+ * (allocated on demand)
+ *
+ * @param coder  Coder structure
+ * @param comp_count  Number of processed components
+ * @param image_width  Full resolution plane width
+ * @param image_height  Full resolution plane height
+ * @param data  Preprocessor data
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_preprocessor_sampling_init(struct gpujpeg_coder* coder, int comp_count, int image_width, int image_height, struct gpujpeg_preprocessor_data & data)
+{
+    size_t plane_size = (size_t)image_width * image_height;
+    size_t size = 0;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        if ( data.comp[comp].sampling_factor.horizontal != 1 || data.comp[comp].sampling_factor.vertical != 1 ) {
+            size += plane_size;
+        }
+    }
+    if ( size > coder->data_sampling_allocated_size ) {
+        if ( coder->d_data_sampling != NULL ) {
+            cudaFree(coder->d_data_sampling);
+            coder->d_data_sampling = NULL;
+        }
+        coder->data_sampling_allocated_size = 0;
+        cudaMalloc((void**)&coder->d_data_sampling, size * sizeof(uint8_t));
+        gpujpeg_cuda_check_error("Preprocessor sampling buffer allocation", return -1);
+        coder->data_sampling_allocated_size = size;
+    }
+
+    uint8_t* plane = coder->d_data_sampling;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        if ( data.comp[comp].sampling_factor.horizontal != 1 || data.comp[comp].sampling_factor.vertical != 1 ) {
+            data.comp[comp].d_data = plane;
+            data.comp[comp].data_width = image_width;
+            data.comp[comp].sampling_factor.horizontal = 1;
+            data.comp[comp].sampling_factor.vertical = 1;
+            plane += plane_size;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Resample subsampled components between full resolution planes and component data
+ *
+ * @param coder  Coder structure
+ * @param comp_count  Number of processed components
+ * @param upsample  Upsample component data to full resolution planes, otherwise downsample
+ * @param image_width  Full resolution plane width
+ * @param image_height  Full resolution plane height
+ * @param stream  CUDA stream
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_preprocessor_sampling_perform(struct gpujpeg_coder* coder, int comp_count, bool upsample, int image_width, int image_height, cudaStream_t stream)
+{
+    size_t plane_size = (size_t)image_width * image_height;
+    uint8_t* plane = coder->d_data_sampling;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        int factor_h = coder->sampling_factor.horizontal / component->sampling_factor.horizontal;
+        int factor_v = coder->sampling_factor.vertical / component->sampling_factor.vertical;
+        if ( factor_h == 1 && factor_v == 1 ) {
+            continue;
+        }
+        dim3 threads(16, 16);
+        if ( upsample ) {
+            dim3 grid(gpujpeg_div_and_round_up(image_width, 16), gpujpeg_div_and_round_up(image_height, 16));
+            gpujpeg_preprocessor_sampling_kernel<true><<<grid, threads, 0, stream>>>(
+                component->d_data, component->width, component->height, component->data_width,
+                plane, image_width, image_height, image_width,
+                coder->sampling_filter, factor_h, factor_v
+            );
+        } else {
+            dim3 grid(gpujpeg_div_and_round_up(component->width, 16), gpujpeg_div_and_round_up(component->height, 16));
+            gpujpeg_preprocessor_sampling_kernel<false><<<grid, threads, 0, stream>>>(
+                plane, coder->param_image.width, coder->param_image.height, image_width,
+                component->d_data, component->width, component->height, component->data_width,
+                coder->sampling_filter, factor_h, factor_v
+            );
+        }
+        gpujpeg_cuda_check_error("Preprocessor sampling failed", return -1);
+        plane += plane_size;
+    }
+    return 0;
+}
+
+/**
+ * Preprocessor encode from raw image planes with row pitches
+ *
+ * @param encoder  Encoder structure
+ * @param planes  Raw image planes in device memory
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_preprocessor_encode_planes(struct gpujpeg_encoder * encoder, const struct gpujpeg_image_planes & planes)
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+
+    if ( coder->data_raw_width != 0 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Raw image planes can't be resampled by preprocessor!\n");
+        return -1;
+    }
+    if ( (coder->param_image.comp_count == 4) != (pixel_format == GPUJPEG_4444_U8_P0123) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Only 4444-u8-p0123 pixel format can be used for image with 4 components and vice versa!\n");
+        return -1;
+    }
+
+    // Select kernel
+    gpujpeg_preprocessor_planes_kernel kernel = NULL;
+    if ( coder->param.precision > 8 ) {
+        kernel = gpujpeg_preprocessor_select_encode_u16_kernel(coder);
+    } else if ( pixel_format == GPUJPEG_U8 ) {
+        kernel = &gpujpeg_preprocessor_raw_to_comp_kernel_planes<GPUJPEG_NONE, GPUJPEG_NONE>;
+    } else if ( coder->param.color_space_internal == GPUJPEG_NONE ) {
+        kernel = gpujpeg_preprocessor_select_encode_planes_kernel<GPUJPEG_NONE>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_RGB ) {
+        kernel = gpujpeg_preprocessor_select_encode_planes_kernel<GPUJPEG_RGB>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_YCBCR_BT601_256LVLS ) {
+        kernel = gpujpeg_preprocessor_select_encode_planes_kernel<GPUJPEG_YCBCR_BT601_256LVLS>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_CMYK ) {
+        kernel = gpujpeg_preprocessor_select_encode_planes_kernel<GPUJPEG_CMYK>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_YCCK ) {
+        kernel = gpujpeg_preprocessor_select_encode_planes_kernel<GPUJPEG_YCCK>(coder->param_image.color_space);
+    } else {
+        assert(false);
+    }
+    if ( kernel == NULL ) {
+        return -1;
+    }
+
+    // Component samples of 12-bit image are 16-bit
+    int sample_size = (coder->param.precision > 8) ? 2 : 1;
+    cudaMemsetAsync(coder->d_data, 0, coder->data_size * sample_size * sizeof(uint8_t), *(encoder->stream));
+    gpujpeg_cuda_check_error("Preprocessor memset failed", return -1);
+
+    int image_width = coder->param_image.width;
+    int image_height = coder->param_image.height;
+    if ( pixel_format == GPUJPEG_422_U8_P1020 || pixel_format == GPUJPEG_422_U8_P0102 ) {
+        image_width = gpujpeg_div_and_round_up(image_width, 2) * 2;
+    }
+
+    struct gpujpeg_preprocessor_data data;
+    for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+        data.comp[comp].d_data = coder->component[comp].d_data;
+        data.comp[comp].sampling_factor.horizontal = coder->sampling_factor.horizontal / coder->component[comp].sampling_factor.horizontal;
+        data.comp[comp].sampling_factor.vertical = coder->sampling_factor.vertical / coder->component[comp].sampling_factor.vertical;
+        data.comp[comp].data_width = coder->component[comp].data_width;
+    }
+    data.d_alpha = coder->d_data_alpha;
+
+    // Subsampled components are stored at full resolution and downsampled by sampling filter
+    bool sampling = gpujpeg_preprocessor_sampling_filtered(coder, coder->param_image.comp_count);
+    if ( sampling && gpujpeg_preprocessor_sampling_init(coder, coder->param_image.comp_count, image_width, image_height, data) != 0 ) {
+        return -1;
+    }
+
+    dim3 threads(16, 16);
+    dim3 grid(gpujpeg_div_and_round_up(image_width, 16), gpujpeg_div_and_round_up(image_height, 16));
+    kernel<<<grid, threads, 0, *(encoder->stream)>>>(
+        data,
+        planes,
+        pixel_format,
+        image_width,
+        image_height
+    );
+    gpujpeg_cuda_check_error("Preprocessor encoding from planes failed", return -1);
+
+    if ( sampling && gpujpeg_preprocessor_sampling_perform(coder, coder->param_image.comp_count, false, image_width, image_height, *(encoder->stream)) != 0 ) {
+        return -1;
+    }
+
+    return 0;
+}
+
 /** Documented at declaration */
 int
 gpujpeg_preprocessor_encode(struct gpujpeg_encoder * encoder)
 {
     struct gpujpeg_coder * coder = &encoder->coder;
+
+    // Raw image is given by planes with row pitches (contiguous raw image buffer
+    // of formats without specialized kernels or with filtered subsampling is split to planes)
+    struct gpujpeg_image_planes planes = coder->data_raw_planes;
+    if ( planes.data[0] == NULL && (gpujpeg_preprocessor_planes_only(coder->param_image.pixel_format)
+            || gpujpeg_preprocessor_sampling_filtered(coder, coder->param_image.comp_count)) ) {
+        gpujpeg_image_planes_init(&coder->param_image, coder->d_data_raw, &planes);
+    }
+    if ( planes.data[0] != NULL ) {
+        return gpujpeg_preprocessor_encode_planes(encoder, planes);
+    }
+
     switch (coder->param_image.pixel_format) {
         case GPUJPEG_U8:
         {
             assert(coder->param_image.comp_count == 1);
+            if ( coder->data_raw_width != 0 ) {
+                struct gpujpeg_preprocessor_data data;
+                data.comp[0].d_data = coder->component[0].d_data;
+                data.comp[0].data_width = coder->component[0].data_width;
+                data.raw_width = coder->data_raw_width;
+                data.raw_height = coder->data_raw_height;
+                data.filter = coder->data_raw_filter;
+                dim3 threads(16, 16);
+                dim3 grid(gpujpeg_div_and_round_up(coder->param_image.width, 16), gpujpeg_div_and_round_up(coder->param_image.height, 16));
+                gpujpeg_preprocessor_raw_to_comp_kernel_resize_u8<<<grid, threads, 0, *(encoder->stream)>>>(
+                    data,
+                    coder->d_data_raw,
+                    coder->param_image.width,
+                    coder->param_image.height
+                );
+                gpujpeg_cuda_check_error("Preprocessor resampling failed", return -1);
+                return 0;
+            }
             cudaMemcpyAsync(coder->d_data, coder->d_data_raw, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToDevice, *(encoder->stream));
             return 0;
         }
@@ -492,78 +1138,6 @@ gpujpeg_preprocessor_encode(struct gpujpeg_encoder * encoder)
             assert(coder->param_image.comp_count == 3);
             return gpujpeg_preprocessor_encode_interlaced(encoder);
         }
-        case GPUJPEG_444_U8_P0P1P2:
-        {
-            if (coder->component[0].sampling_factor.horizontal != 1 || coder->component[0].sampling_factor.vertical != 1
-                || coder->component[1].sampling_factor.horizontal != 1 || coder->component[1].sampling_factor.vertical != 1
-                || coder->component[2].sampling_factor.horizontal != 1 || coder->component[2].sampling_factor.vertical != 1) {
-                fprintf(stderr, "Encoding JPEG from pixel format 444-u8-p0p1p2 is supported only when 4:4:4 subsampling inside JPEG is used.");
-                return -1;
-            }
-            if (coder->param_image.color_space != GPUJPEG_NONE) {
-                fprintf(stderr, "Encoding JPEG from pixel format 444-u8-p0p1p2 is supported only when no color transformation is required.");
-                return -1;
-            }
-            size_t data_raw_offset = 0;
-            size_t component_size = coder->param_image.width * coder->param_image.height;
-            cudaMemcpyAsync(coder->component[0].d_data, coder->d_data_raw + data_raw_offset, component_size, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            data_raw_offset += component_size;
-            cudaMemcpyAsync(coder->component[1].d_data, coder->d_data_raw + data_raw_offset, component_size, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            data_raw_offset += component_size;
-            cudaMemcpyAsync(coder->component[2].d_data, coder->d_data_raw + data_raw_offset, component_size, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            gpujpeg_cuda_check_error("Preprocessor copy failed", return -1);
-            return 0;
-        }
-        case GPUJPEG_422_U8_P0P1P2:
-        {
-            if (coder->component[0].sampling_factor.horizontal != 2 || coder->component[0].sampling_factor.vertical != 1
-                || coder->component[1].sampling_factor.horizontal != 1 || coder->component[1].sampling_factor.vertical != 1
-                || coder->component[2].sampling_factor.horizontal != 1 || coder->component[2].sampling_factor.vertical != 1) {
-                fprintf(stderr, "Encoding JPEG from pixel format 422-u8-p0p1p2 is supported only to 4:2:2 subsampling inside JPEG is used.");
-                return -1;
-            }
-            if (coder->param_image.color_space != GPUJPEG_NONE) {
-                fprintf(stderr, "Encoding JPEG from pixel format 420-u8-p0p1p2 is supported only when no color transformation is required.");
-                return -1;
-            }
-            size_t data_raw_offset = 0;
-            size_t component_size_y = coder->component[0].data_width * coder->component[0].data_height;
-            size_t component_size_uv = coder->component[1].data_width * coder->component[1].data_height;
-            assert(coder->component[1].data_width == coder->component[2].data_width);
-            assert(coder->component[1].data_height == coder->component[2].data_height);
-            cudaMemcpyAsync(coder->component[0].d_data, coder->d_data_raw + data_raw_offset, component_size_y, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            data_raw_offset += component_size_y;
-            cudaMemcpyAsync(coder->component[1].d_data, coder->d_data_raw + data_raw_offset, component_size_uv, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            data_raw_offset += component_size_uv;
-            cudaMemcpyAsync(coder->component[2].d_data, coder->d_data_raw + data_raw_offset, component_size_uv, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            gpujpeg_cuda_check_error("Preprocessor copy failed", return -1);
-            return 0;
-        }
-        case GPUJPEG_420_U8_P0P1P2:
-        {
-            if (coder->component[0].sampling_factor.horizontal != 2 || coder->component[0].sampling_factor.vertical != 2
-                || coder->component[1].sampling_factor.horizontal != 1 || coder->component[1].sampling_factor.vertical != 1
-                || coder->component[2].sampling_factor.horizontal != 1 || coder->component[2].sampling_factor.vertical != 1) {
-                fprintf(stderr, "Encoding JPEG from pixel format 420-u8-p0p1p2 is supported only to 4:2:0 subsampling inside JPEG is used.");
-                return -1;
-            }
-            if (coder->param_image.color_space != GPUJPEG_NONE) {
-                fprintf(stderr, "Encoding JPEG from pixel format 420-u8-p0p1p2 is supported only when no color transformation is required.");
-                return -1;
-            }
-            size_t data_raw_offset = 0;
-            size_t component_size_y = coder->component[0].data_width * coder->component[0].data_height;
-            size_t component_size_uv = coder->component[1].data_width * coder->component[1].data_height;
-            assert(coder->component[1].data_width == coder->component[2].data_width);
-            assert(coder->component[1].data_height == coder->component[2].data_height);
-            cudaMemcpyAsync(coder->component[0].d_data, coder->d_data_raw + data_raw_offset, component_size_y, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            data_raw_offset += component_size_y;
-            cudaMemcpyAsync(coder->component[1].d_data, coder->d_data_raw + data_raw_offset, component_size_uv, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            data_raw_offset += component_size_uv;
-            cudaMemcpyAsync(coder->component[2].d_data, coder->d_data_raw + data_raw_offset, component_size_uv, cudaMemcpyDeviceToDevice, *(encoder->stream));
-            gpujpeg_cuda_check_error("Preprocessor copy failed", return -1);
-            return 0;
-        }
         default:
         {
             fprintf(stderr, "Unknown pixel format %d to be preprocessed.", coder->param_image.pixel_format);
@@ -572,11 +1146,399 @@ gpujpeg_preprocessor_encode(struct gpujpeg_encoder * encoder)
     }
 }
 
+/** Number of horizontally neighboring 8x8 blocks processed by one warp of fused preprocessor and DCT kernel */
+#define GPUJPEG_PREPROCESSOR_DCT_BLOCK_COUNT_X 4
+/** Number of warps in thread block of fused preprocessor and DCT kernel */
+#define GPUJPEG_PREPROCESSOR_DCT_WARP_COUNT 4
+
 /**
- * Store value to component data buffer in specified position by buffer size and subsampling
- *
- * @param value
- * @param position_x
+ * Components transformed by one launch of fused preprocessor and DCT kernel
+ * (all of them have the same sampling factor)
+ */
+struct gpujpeg_preprocessor_dct_data
+{
+    // Indices of components in transformed pixel (first comp_count are valid)
+    int comp[GPUJPEG_MAX_COMPONENT_COUNT];
+    int comp_count;
+    // Quantized coefficients of components
+    int16_t* d_data_quantized[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Forward quantization tables of components (pre-divided with DCT output weights and transposed)
+    const float* d_quantization_table[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Ratio of maximum and component sampling factors
+    int sampling_h;
+    int sampling_v;
+    // Number of 8x8 blocks of components
+    int block_count_x;
+    int block_count_y;
+};
+
+/**
+ * Select sample of component from transformed pixel
+ */
+static __device__ inline float
+gpujpeg_preprocessor_dct_select(int comp, uint8_t r1, uint8_t r2, uint8_t r3, uint8_t r4)
+{
+    return comp == 0 ? r1 : (comp == 1 ? r2 : (comp == 2 ? r3 : r4));
+}
+
+/**
+ * Kernel - Load 8x8 blocks of raw image planes, perform color transformation and
+ * (nearest) sampling and immediately forward DCT and quantization of them. Each
+ * thread loads one column of a block of each component and the block is transformed
+ * as by gpujpeg_dct_gpu_kernel, so no component planes are written and read back.
+ * Samples beyond image are zero as in component planes zeroed by preprocessor.
+ */
+template<
+    enum gpujpeg_color_space color_space_internal,
+    enum gpujpeg_color_space color_space
+>
+__global__ void
+gpujpeg_preprocessor_dct_kernel(struct gpujpeg_preprocessor_dct_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height)
+{
+    // each warp processes 4 horizontally neighboring 8x8 blocks
+    const int block_idx_x = threadIdx.x >> 3;
+    const int block_idx_y = threadIdx.y;
+    const int block_x = blockIdx.x * GPUJPEG_PREPROCESSOR_DCT_BLOCK_COUNT_X + block_idx_x;
+    const int block_y = blockIdx.y * GPUJPEG_PREPROCESSOR_DCT_WARP_COUNT + block_idx_y;
+
+    // all 8 threads of the block stop together, so only threads of the same block synchronize below
+    if ( block_x >= data.block_count_x || block_y >= data.block_count_y ) {
+        return;
+    }
+
+    // index of row/column processed by this thread within its 8x8 block
+    const int dct_idx = threadIdx.x & 7;
+
+    // load and color transform column of the block for all components
+    float src[GPUJPEG_MAX_COMPONENT_COUNT][8];
+    const int x = (block_x * GPUJPEG_BLOCK_SIZE + dct_idx) * data.sampling_h;
+    #pragma unroll
+    for ( int row = 0; row < 8; row++ ) {
+        const int y = (block_y * GPUJPEG_BLOCK_SIZE + row) * data.sampling_v;
+        uint8_t r1 = 0;
+        uint8_t r2 = 0;
+        uint8_t r3 = 0;
+        uint8_t r4 = 0;
+        if ( x < image_width && y < image_height ) {
+            if ( pixel_format == GPUJPEG_U8 ) {
+                r1 = planes.data[0][y * planes.pitch[0] + x];
+            } else {
+                gpujpeg_preprocessor_planes_load<color_space>(planes, pixel_format, x, y, r1, r2, r3);
+                gpujpeg_color_transform<color_space, color_space_internal>::perform(r1, r2, r3);
+                if ( pixel_format == GPUJPEG_4444_U8_P0123 ) {
+                    r4 = planes.data[0][y * planes.pitch[0] + x * 4 + 3];
+                }
+            }
+        }
+        #pragma unroll
+        for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ ) {
+            src[comp][row] = gpujpeg_preprocessor_dct_select(data.comp[comp], r1, r2, r3, r4);
+        }
+    }
+
+    // dimensions of shared buffer, 4 8x8 blocks padded to odd number of 4byte banks
+    enum {
+        SHARED_STRIDE = ((32 * sizeof(float)) | 4) / sizeof(float),
+        SHARED_SIZE_WARP = SHARED_STRIDE * 8,
+        SHARED_SIZE_TOTAL = SHARED_SIZE_WARP * GPUJPEG_PREPROCESSOR_DCT_WARP_COUNT
+    };
+
+    // buffers for transpositions of all blocks (separate for each component)
+    __shared__ float s_transposition_all[GPUJPEG_MAX_COMPONENT_COUNT][SHARED_SIZE_TOTAL];
+
+    #pragma unroll
+    for ( int comp = 0; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ ) {
+        if ( comp >= data.comp_count ) {
+            break;
+        }
+        float * const s_transposition = s_transposition_all[comp] + block_idx_y * SHARED_SIZE_WARP + block_idx_x * 8;
+
+        // transform the column (vertically) with level shift and save it into the transpose buffer
+        float * const s_dest = s_transposition + dct_idx;
+        gpujpeg_dct_forward_1d(src[comp][0], src[comp][1], src[comp][2], src[comp][3], src[comp][4], src[comp][5], src[comp][6], src[comp][7],
+                               s_dest[SHARED_STRIDE * 0],
+                               s_dest[SHARED_STRIDE * 1],
+                               s_dest[SHARED_STRIDE * 2],
+                               s_dest[SHARED_STRIDE * 3],
+                               s_dest[SHARED_STRIDE * 4],
+                               s_dest[SHARED_STRIDE * 5],
+                               s_dest[SHARED_STRIDE * 6],
+                               s_dest[SHARED_STRIDE * 7],
+                               -1024.0f);
+#if __CUDACC_VER_MAJOR__ >= 9
+        __syncwarp(0xFFu << (block_idx_x * 8));
+#endif
+
+        // read the row back and transform it horizontally
+        volatile float * s_src = s_transposition + SHARED_STRIDE * dct_idx;
+        float dct0, dct1, dct2, dct3, dct4, dct5, dct6, dct7;
+        gpujpeg_dct_forward_1d(s_src[0], s_src[1], s_src[2], s_src[3], s_src[4], s_src[5], s_src[6], s_src[7],
+                               dct0, dct1, dct2, dct3, dct4, dct5, dct6, dct7);
+
+        // quantize the row (table is transposed) and save it packed into 16 bytes
+        const float * const quantization_row = data.d_quantization_table[comp] + dct_idx;
+        const int out0 = rintf(dct0 * quantization_row[0 * 8]);
+        const int out1 = rintf(dct1 * quantization_row[1 * 8]);
+        const int out2 = rintf(dct2 * quantization_row[2 * 8]);
+        const int out3 = rintf(dct3 * quantization_row[3 * 8]);
+        const int out4 = rintf(dct4 * quantization_row[4 * 8]);
+        const int out5 = rintf(dct5 * quantization_row[5 * 8]);
+        const int out6 = rintf(dct6 * quantization_row[6 * 8]);
+        const int out7 = rintf(dct7 * quantization_row[7 * 8]);
+        int16_t* output = data.d_data_quantized[comp] + (block_y * data.block_count_x + block_x) * 64;
+        ((uint4*)output)[dct_idx] = make_uint4(
+            (out0 & 0xFFFF) + (out1 << 16),
+            (out2 & 0xFFFF) + (out3 << 16),
+            (out4 & 0xFFFF) + (out5 << 16),
+            (out6 & 0xFFFF) + (out7 << 16)
+        );
+    }
+}
+
+/** Fused preprocessor and DCT kernel type */
+typedef void (*gpujpeg_preprocessor_dct_kernel_t)(struct gpujpeg_preprocessor_dct_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height);
+
+/**
+ * Select fused preprocessor and DCT kernel
+ *
+ * @param color_space  Color space of raw image
+ * @return kernel
+ */
+template<enum gpujpeg_color_space color_space_internal>
+static gpujpeg_preprocessor_dct_kernel_t
+gpujpeg_preprocessor_select_dct_kernel(enum gpujpeg_color_space color_space)
+{
+    switch ( color_space ) {
+    case GPUJPEG_NONE: return &gpujpeg_preprocessor_dct_kernel<color_space_internal, GPUJPEG_NONE>;
+    case GPUJPEG_RGB: return &gpujpeg_preprocessor_dct_kernel<color_space_internal, GPUJPEG_RGB>;
+    case GPUJPEG_YCBCR_BT601: return &gpujpeg_preprocessor_dct_kernel<color_space_internal, GPUJPEG_YCBCR_BT601>;
+    case GPUJPEG_YCBCR_BT601_256LVLS: return &gpujpeg_preprocessor_dct_kernel<color_space_internal, GPUJPEG_YCBCR_BT601_256LVLS>;
+    case GPUJPEG_YCBCR_BT709: return &gpujpeg_preprocessor_dct_kernel<color_space_internal, GPUJPEG_YCBCR_BT709>;
+    case GPUJPEG_YUV: return &gpujpeg_preprocessor_dct_kernel<color_space_internal, GPUJPEG_YUV>;
+    case GPUJPEG_CMYK: return &gpujpeg_preprocessor_dct_kernel<color_space_internal, GPUJPEG_CMYK>;
+    case GPUJPEG_YCCK: return &gpujpeg_preprocessor_dct_kernel<color_space_internal, GPUJPEG_YCCK>;
+    default: assert(false); return NULL;
+    }
+}
+
+/** Documented at declaration */
+int
+gpujpeg_preprocessor_encode_dct_available(struct gpujpeg_encoder* encoder)
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    int comp_count = coder->param_image.comp_count;
+
+    // Resampled raw image, 12-bit precision, extracted alpha and filtered sampling use component planes
+    if ( coder->param.precision > 8 || coder->data_raw_width != 0 || coder->d_data_alpha != NULL
+            || gpujpeg_preprocessor_sampling_filtered(coder, comp_count) ) {
+        return 0;
+    }
+    // Quantization table is read from constant memory by DCT for CCs < 2.0
+    if ( coder->cuda_cc_major < 2 ) {
+        return 0;
+    }
+    if ( (comp_count == 1) != (pixel_format == GPUJPEG_U8) || (comp_count == 4) != (pixel_format == GPUJPEG_4444_U8_P0123) ) {
+        return 0;
+    }
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        if ( coder->sampling_factor.horizontal % coder->component[comp].sampling_factor.horizontal != 0
+                || coder->sampling_factor.vertical % coder->component[comp].sampling_factor.vertical != 0 ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_preprocessor_encode_dct(struct gpujpeg_encoder* encoder)
+{
+    struct gpujpeg_coder* coder = &encoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    assert(gpujpeg_preprocessor_encode_dct_available(encoder));
+
+    // Select kernel
+    gpujpeg_preprocessor_dct_kernel_t kernel = NULL;
+    if ( pixel_format == GPUJPEG_U8 ) {
+        kernel = &gpujpeg_preprocessor_dct_kernel<GPUJPEG_NONE, GPUJPEG_NONE>;
+    } else if ( coder->param.color_space_internal == GPUJPEG_NONE ) {
+        kernel = gpujpeg_preprocessor_select_dct_kernel<GPUJPEG_NONE>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_RGB ) {
+        kernel = gpujpeg_preprocessor_select_dct_kernel<GPUJPEG_RGB>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_YCBCR_BT601_256LVLS ) {
+        kernel = gpujpeg_preprocessor_select_dct_kernel<GPUJPEG_YCBCR_BT601_256LVLS>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_CMYK ) {
+        kernel = gpujpeg_preprocessor_select_dct_kernel<GPUJPEG_CMYK>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_YCCK ) {
+        kernel = gpujpeg_preprocessor_select_dct_kernel<GPUJPEG_YCCK>(coder->param_image.color_space);
+    } else {
+        assert(false);
+    }
+    if ( kernel == NULL ) {
+        return -1;
+    }
+
+    // Raw image is given by planes with row pitches
+    struct gpujpeg_image_planes planes = coder->data_raw_planes;
+    if ( planes.data[0] == NULL ) {
+        gpujpeg_image_planes_init(&coder->param_image, coder->d_data_raw, &planes);
+    }
+
+    int image_width = coder->param_image.width;
+    int image_height = coder->param_image.height;
+    if ( pixel_format == GPUJPEG_422_U8_P1020 || pixel_format == GPUJPEG_422_U8_P0102 ) {
+        image_width = gpujpeg_div_and_round_up(image_width, 2) * 2;
+    }
+
+    // Components with the same sampling factor are transformed by one launch (pixels are loaded once)
+    bool launched[GPUJPEG_MAX_COMPONENT_COUNT] = { false };
+    for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+        if ( launched[comp] ) {
+            continue;
+        }
+        struct gpujpeg_component* component = &coder->component[comp];
+
+        struct gpujpeg_preprocessor_dct_data data;
+        data.comp_count = 0;
+        for ( int other = comp; other < coder->param_image.comp_count; other++ ) {
+            if ( coder->component[other].sampling_factor.horizontal != component->sampling_factor.horizontal
+                    || coder->component[other].sampling_factor.vertical != component->sampling_factor.vertical ) {
+                continue;
+            }
+            data.comp[data.comp_count] = other;
+            data.d_data_quantized[data.comp_count] = coder->component[other].d_data_quantized;
+            data.d_quantization_table[data.comp_count] = encoder->table_quantization[coder->component[other].type].d_table_forward;
+            data.comp_count++;
+            launched[other] = true;
+        }
+        for ( int index = data.comp_count; index < GPUJPEG_MAX_COMPONENT_COUNT; index++ ) {
+            data.comp[index] = data.comp[0];
+        }
+        data.sampling_h = coder->sampling_factor.horizontal / component->sampling_factor.horizontal;
+        data.sampling_v = coder->sampling_factor.vertical / component->sampling_factor.vertical;
+        data.block_count_x = component->data_width / GPUJPEG_BLOCK_SIZE;
+        data.block_count_y = component->data_height / GPUJPEG_BLOCK_SIZE;
+
+        dim3 threads(GPUJPEG_PREPROCESSOR_DCT_BLOCK_COUNT_X * 8, GPUJPEG_PREPROCESSOR_DCT_WARP_COUNT);
+        dim3 grid(
+            gpujpeg_div_and_round_up(data.block_count_x, GPUJPEG_PREPROCESSOR_DCT_BLOCK_COUNT_X),
+            gpujpeg_div_and_round_up(data.block_count_y, GPUJPEG_PREPROCESSOR_DCT_WARP_COUNT)
+        );
+        kernel<<<grid, threads, 0, *(encoder->stream)>>>(
+            data,
+            planes,
+            pixel_format,
+            image_width,
+            image_height
+        );
+        gpujpeg_cuda_check_error("Preprocessor encoding with DCT failed", return -1);
+    }
+
+    return 0;
+}
+
+/** Thread block size for pyramid downsampling */
+#define GPUJPEG_PYRAMID_THREADS_X 16
+#define GPUJPEG_PYRAMID_THREADS_Y 16
+
+/** Number of Lanczos taps in one dimension for 2x downsampling (2 lobes) */
+#define GPUJPEG_PYRAMID_LANCZOS_TAPS 8
+
+/**
+ * Normalized Lanczos (2 lobes) weights for 2x downsampling, tap i is at distance
+ * (i - GPUJPEG_PYRAMID_LANCZOS_TAPS / 2 + 0.5) / 2 from target sample center
+ */
+__constant__ float gpujpeg_preprocessor_lanczos_weights[GPUJPEG_PYRAMID_LANCZOS_TAPS] = {
+    -0.00886333175f, -0.0419400334f, 0.116500095f, 0.434303284f, 0.434303284f, 0.116500095f, -0.0419400334f, -0.00886333175f
+};
+
+/**
+ * Kernel - Downsample one component plane to half resolution
+ *
+ * Target samples beyond target component size (up to data size aligned to MCU)
+ * are filled by replicating the edge, source samples are clamped to source size.
+ *
+ * @param d_source  Source plane
+ * @param source_width  Source component width
+ * @param source_height  Source component height
+ * @param source_stride  Source plane data width
+ * @param d_target  Target plane
+ * @param target_width  Target component width
+ * @param target_height  Target component height
+ * @param target_data_width  Target plane data width
+ * @param target_data_height  Target plane data height
+ */
+template<enum gpujpeg_resize_filter filter>
+__global__ void
+gpujpeg_preprocessor_downsample_kernel(const uint8_t* d_source, int source_width, int source_height, int source_stride,
+                                       uint8_t* d_target, int target_width, int target_height, int target_data_width, int target_data_height)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if ( x >= target_data_width || y >= target_data_height )
+        return;
+
+    // Replicate edge into padding
+    int tx = min(x, target_width - 1);
+    int ty = min(y, target_height - 1);
+
+    int value;
+    if ( filter == GPUJPEG_RESIZE_FILTER_BOX ) {
+        int x0 = min(2 * tx, source_width - 1);
+        int x1 = min(2 * tx + 1, source_width - 1);
+        int y0 = min(2 * ty, source_height - 1) * source_stride;
+        int y1 = min(2 * ty + 1, source_height - 1) * source_stride;
+        value = (d_source[y0 + x0] + d_source[y0 + x1] + d_source[y1 + x0] + d_source[y1 + x1] + 2) >> 2;
+    } else {
+        float sum = 0.0f;
+        for ( int j = 0; j < GPUJPEG_PYRAMID_LANCZOS_TAPS; j++ ) {
+            int sy = min(max(2 * ty - GPUJPEG_PYRAMID_LANCZOS_TAPS / 2 + 1 + j, 0), source_height - 1) * source_stride;
+            float row = 0.0f;
+            for ( int i = 0; i < GPUJPEG_PYRAMID_LANCZOS_TAPS; i++ ) {
+                int sx = min(max(2 * tx - GPUJPEG_PYRAMID_LANCZOS_TAPS / 2 + 1 + i, 0), source_width - 1);
+                row += gpujpeg_preprocessor_lanczos_weights[i] * d_source[sy + sx];
+            }
+            sum += gpujpeg_preprocessor_lanczos_weights[j] * row;
+        }
+        value = min(max(__float2int_rn(sum), 0), 255);
+    }
+    d_target[y * target_data_width + x] = (uint8_t)value;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_preprocessor_downsample(struct gpujpeg_coder* coder, const struct gpujpeg_component* component, enum gpujpeg_resize_filter filter, cudaStream_t stream)
+{
+    for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+        const struct gpujpeg_component* source = &component[comp];
+        struct gpujpeg_component* target = &coder->component[comp];
+
+        dim3 threads(GPUJPEG_PYRAMID_THREADS_X, GPUJPEG_PYRAMID_THREADS_Y);
+        dim3 grid(gpujpeg_div_and_round_up(target->data_width, GPUJPEG_PYRAMID_THREADS_X),
+                  gpujpeg_div_and_round_up(target->data_height, GPUJPEG_PYRAMID_THREADS_Y));
+        if ( filter == GPUJPEG_RESIZE_FILTER_LANCZOS ) {
+            gpujpeg_preprocessor_downsample_kernel<GPUJPEG_RESIZE_FILTER_LANCZOS><<<grid, threads, 0, stream>>>(
+                source->d_data, source->width, source->height, source->data_width,
+                target->d_data, target->width, target->height, target->data_width, target->data_height
+            );
+        } else {
+            gpujpeg_preprocessor_downsample_kernel<GPUJPEG_RESIZE_FILTER_BOX><<<grid, threads, 0, stream>>>(
+                source->d_data, source->width, source->height, source->data_width,
+                target->d_data, target->width, target->height, target->data_width, target->data_height
+            );
+        }
+        gpujpeg_cuda_check_error("Preprocessor downsampling failed", return -1);
+    }
+
+    return 0;
+}
+
+/**
+ * Store value to component data buffer in specified position by buffer size and subsampling
+ *
+ * @param value
+ * @param position_x
  * @param position_y
  * @param comp
  */
@@ -710,6 +1672,295 @@ gpujpeg_preprocessor_comp_to_raw_kernel_4_2_2(struct gpujpeg_preprocessor_data d
         d_data_raw[image_position + 0] = r3;
 }
 
+/**
+ * Kernel - Resample component buffers (of any sampling factors and downscaled
+ * by scaled IDCT) to raw image size and store them as 4:4:4 raw image
+ */
+template<
+    enum gpujpeg_color_space color_space_internal,
+    enum gpujpeg_color_space color_space
+>
+__global__ void
+gpujpeg_preprocessor_comp_to_raw_kernel_resize_4_4_4(struct gpujpeg_preprocessor_data data, uint8_t* d_data_raw, int image_width, int image_height)
+{
+    int image_position = (blockIdx.y * gridDim.x + blockIdx.x) * blockDim.x + threadIdx.x;
+    if ( image_position >= (image_width * image_height) )
+        return;
+    int image_position_x = image_position % image_width;
+    int image_position_y = image_position / image_width;
+
+    // Load and resample (every component plane separately, which also upsamples chroma)
+    float value[3];
+    for ( int comp = 0; comp < 3; comp++ ) {
+        gpujpeg_preprocessor_resample<1>(data.comp[comp].d_data, data.comp[comp].width, data.comp[comp].height, data.comp[comp].data_width,
+                                         data.filter, image_width, image_height, image_position_x, image_position_y, &value[comp]);
+    }
+    uint8_t r1 = (uint8_t)value[0];
+    uint8_t r2 = (uint8_t)value[1];
+    uint8_t r3 = (uint8_t)value[2];
+
+    // Color transform
+    gpujpeg_color_transform<color_space_internal, color_space>::perform(r1, r2, r3);
+
+    // Store Order
+    gpujpeg_color_order<color_space>::perform_store(r1, r2, r3);
+
+    // Save
+    image_position = image_position * 3;
+    d_data_raw[image_position + 0] = r1;
+    d_data_raw[image_position + 1] = r2;
+    d_data_raw[image_position + 2] = r3;
+}
+
+/**
+ * Kernel - Resample one component buffer to raw image size
+ */
+__global__ void
+gpujpeg_preprocessor_comp_to_raw_kernel_resize_u8(struct gpujpeg_preprocessor_data data, uint8_t* d_data_raw, int image_width, int image_height)
+{
+    int image_position = (blockIdx.y * gridDim.x + blockIdx.x) * blockDim.x + threadIdx.x;
+    if ( image_position >= (image_width * image_height) )
+        return;
+    int image_position_x = image_position % image_width;
+    int image_position_y = image_position / image_width;
+
+    float value;
+    gpujpeg_preprocessor_resample<1>(data.comp[0].d_data, data.comp[0].width, data.comp[0].height, data.comp[0].data_width,
+                                     data.filter, image_width, image_height, image_position_x, image_position_y, &value);
+    d_data_raw[image_position] = (uint8_t)value;
+}
+
+/**
+ * Load one component sample for raw image position (resampled when raw image size differs)
+ */
+static __device__ uint8_t
+gpujpeg_preprocessor_comp_to_raw_sample(struct gpujpeg_preprocessor_data & data, int comp, int image_position_x, int image_position_y, int image_width, int image_height)
+{
+    if ( data.raw_width != 0 ) {
+        float value;
+        gpujpeg_preprocessor_resample<1>(data.comp[comp].d_data, data.comp[comp].width, data.comp[comp].height, data.comp[comp].data_width,
+                                         data.filter, image_width, image_height, image_position_x, image_position_y, &value);
+        return (uint8_t)value;
+    }
+    uint8_t value;
+    gpujpeg_preprocessor_comp_to_raw_load<>::perform(value, image_position_x, image_position_y, data.comp[comp]);
+    return value;
+}
+
+/**
+ * Kernel - Store component buffers as normalized float tensor (value * scale + bias)
+ * in planar (NCHW) or interleaved (NHWC) layout
+ */
+template<
+    enum gpujpeg_color_space color_space_internal,
+    enum gpujpeg_color_space color_space,
+    int comp_count
+>
+__global__ void
+gpujpeg_preprocessor_comp_to_raw_kernel_tensor(struct gpujpeg_preprocessor_data data, uint8_t* d_data_raw, int image_width, int image_height)
+{
+    int image_position = (blockIdx.y * gridDim.x + blockIdx.x) * blockDim.x + threadIdx.x;
+    if ( image_position >= (image_width * image_height) )
+        return;
+    int image_position_x = image_position % image_width;
+    int image_position_y = image_position / image_width;
+
+    // Load
+    uint8_t r[3];
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        r[comp] = gpujpeg_preprocessor_comp_to_raw_sample(data, comp, image_position_x, image_position_y, image_width, image_height);
+    }
+
+    if ( comp_count == 3 ) {
+        // Color transform
+        gpujpeg_color_transform<color_space_internal, color_space>::perform(r[0], r[1], r[2]);
+
+        // Store Order
+        gpujpeg_color_order<color_space>::perform_store(r[0], r[1], r[2]);
+    }
+
+    // Normalize and save
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        float value = r[comp] * data.tensor.scale[comp] + data.tensor.bias[comp];
+        int index = (data.tensor.layout == GPUJPEG_TENSOR_NCHW) ? comp * image_width * image_height + image_position : image_position * comp_count + comp;
+        if ( data.tensor.type == GPUJPEG_TENSOR_FLOAT16 ) {
+            ((__half*)d_data_raw)[index] = __float2half_rn(value);
+        } else {
+            ((float*)d_data_raw)[index] = value;
+        }
+    }
+}
+
+/**
+ * Store pixel to raw image planes, components of packed formats are reordered
+ * by color space, planar formats have components in plane order (chroma of
+ * subsampled planes is taken from the top-left pixel)
+ */
+template<enum gpujpeg_color_space color_space>
+static __device__ void
+gpujpeg_preprocessor_planes_store(struct gpujpeg_image_planes & planes, enum gpujpeg_pixel_format pixel_format, int x, int y, uint8_t r1, uint8_t r2, uint8_t r3, uint8_t r4)
+{
+    if ( pixel_format == GPUJPEG_444_U8_P012 ) {
+        gpujpeg_color_order<color_space>::perform_store(r1, r2, r3);
+        uint8_t* pixel = &planes.data[0][y * planes.pitch[0] + x * 3];
+        pixel[0] = r1;
+        pixel[1] = r2;
+        pixel[2] = r3;
+    } else if ( pixel_format == GPUJPEG_444_U8_P012X || pixel_format == GPUJPEG_444_U8_P210X || pixel_format == GPUJPEG_4444_U8_P0123 ) {
+        // Whole pixel is stored at once (rows are at least 4-byte aligned)
+        gpujpeg_color_order<color_space>::perform_store(r1, r2, r3);
+        if ( pixel_format != GPUJPEG_444_U8_P210X ) {
+            *(uchar4*)&planes.data[0][y * planes.pitch[0] + x * 4] = make_uchar4(r1, r2, r3, r4);
+        } else {
+            *(uchar4*)&planes.data[0][y * planes.pitch[0] + x * 4] = make_uchar4(r3, r2, r1, r4);
+        }
+    } else if ( pixel_format == GPUJPEG_422_U8_P1020 ) {
+        gpujpeg_color_order<color_space>::perform_store(r1, r2, r3);
+        uint8_t* pixel = &planes.data[0][y * planes.pitch[0] + x * 2];
+        pixel[0] = (x % 2 == 0) ? r1 : r3;
+        pixel[1] = r2;
+    } else if ( pixel_format == GPUJPEG_422_U8_P0102 ) {
+        gpujpeg_color_order<color_space>::perform_store(r1, r2, r3);
+        uint8_t* pixel = &planes.data[0][y * planes.pitch[0] + x * 2];
+        pixel[0] = r2;
+        pixel[1] = (x % 2 == 0) ? r1 : r3;
+    } else if ( pixel_format == GPUJPEG_420_U8_P0P12 ) {
+        planes.data[0][y * planes.pitch[0] + x] = r1;
+        if ( (x & 1) == 0 && (y & 1) == 0 ) {
+            uint8_t* chroma = &planes.data[1][(y >> 1) * planes.pitch[1] + x];
+            chroma[0] = r2;
+            chroma[1] = r3;
+        }
+    } else {
+        const int shift_x = (pixel_format == GPUJPEG_444_U8_P0P1P2) ? 0 : 1;
+        const int shift_y = (pixel_format == GPUJPEG_420_U8_P0P1P2) ? 1 : 0;
+        planes.data[0][y * planes.pitch[0] + x] = r1;
+        if ( (x & shift_x) == 0 && (y & shift_y) == 0 ) {
+            planes.data[1][(y >> shift_y) * planes.pitch[1] + (x >> shift_x)] = r2;
+            planes.data[2][(y >> shift_y) * planes.pitch[2] + (x >> shift_x)] = r3;
+        }
+    }
+}
+
+/** Specialization [raw image planes, sampling factors are handled dynamically] */
+template<
+    enum gpujpeg_color_space color_space_internal,
+    enum gpujpeg_color_space color_space
+>
+__global__ void
+gpujpeg_preprocessor_comp_to_raw_kernel_planes(struct gpujpeg_preprocessor_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if ( x >= image_width || y >= image_height )
+        return;
+
+    if ( pixel_format == GPUJPEG_U8 ) {
+        gpujpeg_preprocessor_comp_to_raw_load<1, 1>::perform(planes.data[0][y * planes.pitch[0] + x], x, y, data.comp[0]);
+        return;
+    }
+
+    // Load
+    uint8_t r1;
+    uint8_t r2;
+    uint8_t r3;
+    gpujpeg_preprocessor_comp_to_raw_load<>::perform(r1, x, y, data.comp[0]);
+    gpujpeg_preprocessor_comp_to_raw_load<>::perform(r2, x, y, data.comp[1]);
+    gpujpeg_preprocessor_comp_to_raw_load<>::perform(r3, x, y, data.comp[2]);
+
+    // Fourth byte of 4-byte pixels is K component (not color transformed) or alpha
+    uint8_t r4 = data.alpha;
+    if ( pixel_format == GPUJPEG_4444_U8_P0123 ) {
+        gpujpeg_preprocessor_comp_to_raw_load<>::perform(r4, x, y, data.comp[3]);
+    }
+
+    // Color transform
+    gpujpeg_color_transform<color_space_internal, color_space>::perform(r1, r2, r3);
+
+    // Save
+    gpujpeg_preprocessor_planes_store<color_space>(planes, pixel_format, x, y, r1, r2, r3, r4);
+}
+
+/**
+ * Select preprocessor decode kernel for raw image planes
+ *
+ * @param color_space  Color space of raw image
+ * @return kernel
+ */
+template<enum gpujpeg_color_space color_space_internal>
+static gpujpeg_preprocessor_planes_kernel
+gpujpeg_preprocessor_select_decode_planes_kernel(enum gpujpeg_color_space color_space)
+{
+    switch ( color_space ) {
+    case GPUJPEG_NONE: return &gpujpeg_preprocessor_comp_to_raw_kernel_planes<color_space_internal, GPUJPEG_NONE>;
+    case GPUJPEG_RGB: return &gpujpeg_preprocessor_comp_to_raw_kernel_planes<color_space_internal, GPUJPEG_RGB>;
+    case GPUJPEG_YCBCR_BT601: return &gpujpeg_preprocessor_comp_to_raw_kernel_planes<color_space_internal, GPUJPEG_YCBCR_BT601>;
+    case GPUJPEG_YCBCR_BT601_256LVLS: return &gpujpeg_preprocessor_comp_to_raw_kernel_planes<color_space_internal, GPUJPEG_YCBCR_BT601_256LVLS>;
+    case GPUJPEG_YCBCR_BT709: return &gpujpeg_preprocessor_comp_to_raw_kernel_planes<color_space_internal, GPUJPEG_YCBCR_BT709>;
+    case GPUJPEG_YUV: return &gpujpeg_preprocessor_comp_to_raw_kernel_planes<color_space_internal, GPUJPEG_YUV>;
+    case GPUJPEG_CMYK: return &gpujpeg_preprocessor_comp_to_raw_kernel_planes<color_space_internal, GPUJPEG_CMYK>;
+    case GPUJPEG_YCCK: return &gpujpeg_preprocessor_comp_to_raw_kernel_planes<color_space_internal, GPUJPEG_YCCK>;
+    default: assert(false); return NULL;
+    }
+}
+
+/**
+ * Kernel - Copy 16-bit component buffers (12-bit samples) into 16-bit raw image,
+ * YCbCr (BT.601 full range scaled to 4096 levels) is optionally transformed to RGB
+ */
+template<bool ycbcr_to_rgb>
+__global__ void
+gpujpeg_preprocessor_comp_to_raw_kernel_u16(struct gpujpeg_preprocessor_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if ( x >= image_width || y >= image_height )
+        return;
+
+    uint16_t* row = (uint16_t*)(planes.data[0] + y * planes.pitch[0]);
+    if ( pixel_format == GPUJPEG_U16 ) {
+        row[x] = ((const uint16_t*)data.comp[0].d_data)[y * data.comp[0].data_width + x];
+        return;
+    }
+
+    float r1 = ((const uint16_t*)data.comp[0].d_data)[y * data.comp[0].data_width + x];
+    float r2 = ((const uint16_t*)data.comp[1].d_data)[y * data.comp[1].data_width + x];
+    float r3 = ((const uint16_t*)data.comp[2].d_data)[y * data.comp[2].data_width + x];
+    if ( ycbcr_to_rgb ) {
+        const float cb = r2 - 2048.0f;
+        const float cr = r3 - 2048.0f;
+        r2 = r1 - 0.344136f * cb - 0.714136f * cr;
+        r3 = r1 + 1.772f * cb;
+        r1 = r1 + 1.402f * cr;
+    }
+    row[x * 3 + 0] = (uint16_t)fminf(fmaxf(rintf(r1), 0.0f), 4095.0f);
+    row[x * 3 + 1] = (uint16_t)fminf(fmaxf(rintf(r2), 0.0f), 4095.0f);
+    row[x * 3 + 2] = (uint16_t)fminf(fmaxf(rintf(r3), 0.0f), 4095.0f);
+}
+
+/**
+ * Select preprocessor decode kernel for 16-bit raw image (only identity and
+ * YCbCr to RGB color transforms are supported for 12-bit precision)
+ *
+ * @param coder
+ * @return kernel
+ */
+static gpujpeg_preprocessor_planes_kernel
+gpujpeg_preprocessor_select_decode_u16_kernel(struct gpujpeg_coder* coder)
+{
+    enum gpujpeg_color_space color_space = coder->param_image.color_space;
+    enum gpujpeg_color_space color_space_internal = coder->param.color_space_internal;
+    if ( coder->param_image.pixel_format == GPUJPEG_U16 || color_space == color_space_internal || color_space_internal == GPUJPEG_NONE ) {
+        return &gpujpeg_preprocessor_comp_to_raw_kernel_u16<false>;
+    }
+    if ( color_space == GPUJPEG_RGB && color_space_internal == GPUJPEG_YCBCR_BT601_256LVLS ) {
+        return &gpujpeg_preprocessor_comp_to_raw_kernel_u16<true>;
+    }
+    fprintf(stderr, "[GPUJPEG] [Error] Color transformation from %s to %s is not supported for 12-bit precision!\n",
+            gpujpeg_color_space_get_name(color_space_internal), gpujpeg_color_space_get_name(color_space));
+    return NULL;
+}
+
 /**
  * Select preprocessor decode kernel
  *
@@ -751,6 +2002,42 @@ gpujpeg_preprocessor_select_decode_kernel(struct gpujpeg_coder* coder)
         return &KERNEL<color_space_internal, COLOR, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC, GPUJPEG_DYNAMIC>; \
     } \
 
+    // Raw image is tensor (samples are resampled when raw image size differs)
+    if ( coder->data_raw_tensor ) {
+        if ( coder->param.verbose ) {
+            printf("Using tensor kernel for postprocessor.\n");
+        }
+        switch ( coder->param_image.color_space ) {
+        case GPUJPEG_NONE: return &gpujpeg_preprocessor_comp_to_raw_kernel_tensor<color_space_internal, GPUJPEG_NONE, 3>;
+        case GPUJPEG_RGB: return &gpujpeg_preprocessor_comp_to_raw_kernel_tensor<color_space_internal, GPUJPEG_RGB, 3>;
+        case GPUJPEG_YCBCR_BT601: return &gpujpeg_preprocessor_comp_to_raw_kernel_tensor<color_space_internal, GPUJPEG_YCBCR_BT601, 3>;
+        case GPUJPEG_YCBCR_BT601_256LVLS: return &gpujpeg_preprocessor_comp_to_raw_kernel_tensor<color_space_internal, GPUJPEG_YCBCR_BT601_256LVLS, 3>;
+        case GPUJPEG_YCBCR_BT709: return &gpujpeg_preprocessor_comp_to_raw_kernel_tensor<color_space_internal, GPUJPEG_YCBCR_BT709, 3>;
+        case GPUJPEG_YUV: return &gpujpeg_preprocessor_comp_to_raw_kernel_tensor<color_space_internal, GPUJPEG_YUV, 3>;
+        default: assert(false); return NULL;
+        }
+    }
+
+    // Raw image is resampled (only 4:4:4 output, sampling factors are handled dynamically)
+    if ( coder->data_raw_width != 0 ) {
+        if ( coder->param_image.pixel_format != GPUJPEG_444_U8_P012 ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Resized decoding supports only 4:4:4 output pixel format!\n");
+            return NULL;
+        }
+        if ( coder->param.verbose ) {
+            printf("Using resampling kernel for postprocessor (%dx%d -> %dx%d).\n", coder->param_image.width, coder->param_image.height, coder->data_raw_width, coder->data_raw_height);
+        }
+        switch ( coder->param_image.color_space ) {
+        case GPUJPEG_NONE: return &gpujpeg_preprocessor_comp_to_raw_kernel_resize_4_4_4<color_space_internal, GPUJPEG_NONE>;
+        case GPUJPEG_RGB: return &gpujpeg_preprocessor_comp_to_raw_kernel_resize_4_4_4<color_space_internal, GPUJPEG_RGB>;
+        case GPUJPEG_YCBCR_BT601: return &gpujpeg_preprocessor_comp_to_raw_kernel_resize_4_4_4<color_space_internal, GPUJPEG_YCBCR_BT601>;
+        case GPUJPEG_YCBCR_BT601_256LVLS: return &gpujpeg_preprocessor_comp_to_raw_kernel_resize_4_4_4<color_space_internal, GPUJPEG_YCBCR_BT601_256LVLS>;
+        case GPUJPEG_YCBCR_BT709: return &gpujpeg_preprocessor_comp_to_raw_kernel_resize_4_4_4<color_space_internal, GPUJPEG_YCBCR_BT709>;
+        case GPUJPEG_YUV: return &gpujpeg_preprocessor_comp_to_raw_kernel_resize_4_4_4<color_space_internal, GPUJPEG_YUV>;
+        default: assert(false); return NULL;
+        }
+    }
+
     // None color space
     if ( coder->param_image.color_space == GPUJPEG_NONE ) {
         if ( coder->param_image.pixel_format == GPUJPEG_444_U8_P012 ) {
@@ -826,11 +2113,20 @@ gpujpeg_preprocessor_select_decode_kernel(struct gpujpeg_coder* coder)
 int
 gpujpeg_preprocessor_decoder_init(struct gpujpeg_coder* coder)
 {
-    if (coder->param_image.comp_count == 1) {
+    // One component output (also luminance only output of color image) doesn't need kernel selection
+    if (coder->param_image.comp_count == 1 || coder->param_image.pixel_format == GPUJPEG_U8) {
+        return 0;
+    }
+    // Output without specialized kernels is written by planes kernel selected when decoding
+    if (gpujpeg_preprocessor_planes_only(coder->param_image.pixel_format) && coder->data_raw_width == 0 && !coder->data_raw_tensor) {
         return 0;
     }
 
-    assert(coder->param_image.comp_count == 3);
+    // Image with 4 components is output only by planes kernel
+    if (coder->param_image.comp_count != 3) {
+        fprintf(stderr, "[GPUJPEG] [Error] Image with %d components can be decoded only to 4444-u8-p0123 pixel format without resizing!\n", coder->param_image.comp_count);
+        return -1;
+    }
 
     if (coder->param.color_space_internal == GPUJPEG_NONE) {
         coder->preprocessor = (void*)gpujpeg_preprocessor_select_decode_kernel<GPUJPEG_NONE>(coder);
@@ -850,32 +2146,152 @@ gpujpeg_preprocessor_decoder_init(struct gpujpeg_coder* coder)
     return 0;
 }
 
+/**
+ * Postprocessor decode to raw image planes with row pitches
+ *
+ * @param coder  Coder structure
+ * @param planes  Raw image planes in device memory
+ * @param stream  CUDA stream
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_preprocessor_decode_planes(struct gpujpeg_coder* coder, const struct gpujpeg_image_planes & planes, cudaStream_t stream)
+{
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+
+    if ( coder->data_raw_width != 0 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Resized decoding to raw image planes is not supported!\n");
+        return -1;
+    }
+    if ( pixel_format != GPUJPEG_U8 && (coder->param_image.comp_count == 4) != (pixel_format == GPUJPEG_4444_U8_P0123) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Only 4444-u8-p0123 pixel format can be used for image with 4 components and vice versa!\n");
+        return -1;
+    }
+
+    // Select kernel
+    gpujpeg_preprocessor_planes_kernel kernel = NULL;
+    if ( coder->param.precision > 8 ) {
+        kernel = gpujpeg_preprocessor_select_decode_u16_kernel(coder);
+    } else if ( pixel_format == GPUJPEG_U8 ) {
+        kernel = &gpujpeg_preprocessor_comp_to_raw_kernel_planes<GPUJPEG_NONE, GPUJPEG_NONE>;
+    } else if ( coder->param.color_space_internal == GPUJPEG_NONE ) {
+        kernel = gpujpeg_preprocessor_select_decode_planes_kernel<GPUJPEG_NONE>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_RGB ) {
+        kernel = gpujpeg_preprocessor_select_decode_planes_kernel<GPUJPEG_RGB>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_YCBCR_BT601_256LVLS ) {
+        kernel = gpujpeg_preprocessor_select_decode_planes_kernel<GPUJPEG_YCBCR_BT601_256LVLS>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_CMYK ) {
+        kernel = gpujpeg_preprocessor_select_decode_planes_kernel<GPUJPEG_CMYK>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_YCCK ) {
+        kernel = gpujpeg_preprocessor_select_decode_planes_kernel<GPUJPEG_YCCK>(coder->param_image.color_space);
+    } else {
+        assert(false);
+    }
+    if ( kernel == NULL ) {
+        return -1;
+    }
+
+    int image_width = coder->param_image.width;
+    int image_height = coder->param_image.height;
+    if ( pixel_format == GPUJPEG_422_U8_P1020 || pixel_format == GPUJPEG_422_U8_P0102 ) {
+        image_width = gpujpeg_div_and_round_up(image_width, 2) * 2;
+    }
+
+    // Only luminance component is output when chroma was not decoded
+    int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+    struct gpujpeg_preprocessor_data data;
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        data.comp[comp].d_data = coder->component[comp].d_data;
+        data.comp[comp].sampling_factor.horizontal = coder->sampling_factor.horizontal / coder->component[comp].sampling_factor.horizontal;
+        data.comp[comp].sampling_factor.vertical = coder->sampling_factor.vertical / coder->component[comp].sampling_factor.vertical;
+        data.comp[comp].data_width = coder->component[comp].data_width;
+    }
+    data.alpha = coder->data_raw_alpha;
+
+    // Subsampled components are upsampled by sampling filter to full resolution
+    if ( gpujpeg_preprocessor_sampling_filtered(coder, comp_count) ) {
+        if ( gpujpeg_preprocessor_sampling_init(coder, comp_count, image_width, image_height, data) != 0 ) {
+            return -1;
+        }
+        if ( gpujpeg_preprocessor_sampling_perform(coder, comp_count, true, image_width, image_height, stream) != 0 ) {
+            return -1;
+        }
+    }
+
+    dim3 threads(16, 16);
+    dim3 grid(gpujpeg_div_and_round_up(image_width, 16), gpujpeg_div_and_round_up(image_height, 16));
+    kernel<<<grid, threads, 0, stream>>>(
+        data,
+        planes,
+        pixel_format,
+        image_width,
+        image_height
+    );
+    gpujpeg_cuda_check_error("Postprocessor decoding to planes failed", return -1);
+
+    return 0;
+}
+
 /** Documented at declaration */
 int
 gpujpeg_preprocessor_decode(struct gpujpeg_coder* coder, cudaStream_t stream)
 {
-    if (coder->param_image.comp_count == 1) {
-        cudaMemcpyAsync(coder->d_data_raw, coder->d_data, coder->data_raw_size * sizeof(uint8_t), cudaMemcpyDeviceToDevice, stream);
+    // Raw image is written to planes with row pitches (contiguous raw image buffer
+    // of formats without specialized kernels or with filtered subsampling is split to planes)
+    if ( !coder->data_raw_tensor ) {
+        struct gpujpeg_image_planes planes = coder->data_raw_planes;
+        if ( planes.data[0] == NULL && (gpujpeg_preprocessor_planes_only(coder->param_image.pixel_format)
+                || gpujpeg_preprocessor_sampling_filtered(coder, coder->luminance_only ? 1 : coder->param_image.comp_count)) ) {
+            gpujpeg_image_planes_init(&coder->param_image, coder->d_data_raw, &planes);
+        }
+        if ( planes.data[0] != NULL ) {
+            return gpujpeg_preprocessor_decode_planes(coder, planes, stream);
+        }
+    }
+
+    // Only luminance component is output when chroma was not decoded
+    int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+
+    if (comp_count == 1 && coder->data_raw_width == 0 && !coder->data_raw_tensor) {
+        cudaMemcpy2DAsync(coder->d_data_raw, coder->param_image.width, coder->component[0].d_data, coder->component[0].data_width,
+                          coder->param_image.width, coder->param_image.height, cudaMemcpyDeviceToDevice, stream);
+        gpujpeg_cuda_check_error("Postprocessor copy failed", return -1);
         return 0;
     }
-    assert(coder->param_image.comp_count == 3);
+    assert(comp_count == 1 || comp_count == 3);
 
     cudaMemsetAsync(coder->d_data_raw, 0, coder->data_raw_size * sizeof(uint8_t), stream);
 
     // Select kernel
     gpujpeg_preprocessor_decode_kernel kernel = (gpujpeg_preprocessor_decode_kernel)coder->preprocessor;
+    if (comp_count == 1) {
+        if (coder->data_raw_tensor) {
+            kernel = &gpujpeg_preprocessor_comp_to_raw_kernel_tensor<GPUJPEG_NONE, GPUJPEG_NONE, 1>;
+        } else {
+            kernel = &gpujpeg_preprocessor_comp_to_raw_kernel_resize_u8;
+        }
+    }
     assert(kernel != NULL);
 
     int image_width = coder->param_image.width;
     int image_height = coder->param_image.height;
 
+    // Raw image is resampled to requested size
+    if (coder->data_raw_width != 0) {
+        image_width = coder->data_raw_width;
+        image_height = coder->data_raw_height;
+    }
+
     // When saving 4:2:2 data of odd width, the data should have even width, so round it
-    if (coder->param_image.pixel_format == GPUJPEG_422_U8_P1020) {
+    if (coder->param_image.pixel_format == GPUJPEG_422_U8_P1020 && coder->data_raw_width == 0 && !coder->data_raw_tensor) {
         image_width = gpujpeg_div_and_round_up(coder->param_image.width, 2) * 2;
     }
 
     // Prepare unit size
     int unitSize = (coder->param_image.pixel_format >= GPUJPEG_444_U8_P012 && coder->param_image.pixel_format <= GPUJPEG_444_U8_P0P1P2) ? 3 : 2;
+    if (comp_count == 1) {
+        unitSize = 1;
+    }
 
     // Prepare kernel
     int alignedSize = gpujpeg_div_and_round_up(image_width * image_height, RGB_8BIT_THREADS) * RGB_8BIT_THREADS * unitSize;
@@ -889,14 +2305,21 @@ gpujpeg_preprocessor_decode(struct gpujpeg_coder* coder, cudaStream_t stream)
 
     // Run kernel
     struct gpujpeg_preprocessor_data data;
-    for ( int comp = 0; comp < 3; comp++ ) {
+    for ( int comp = 0; comp < comp_count; comp++ ) {
         assert(coder->sampling_factor.horizontal % coder->component[comp].sampling_factor.horizontal == 0);
         assert(coder->sampling_factor.vertical % coder->component[comp].sampling_factor.vertical == 0);
         data.comp[comp].d_data = coder->component[comp].d_data;
         data.comp[comp].sampling_factor.horizontal = coder->sampling_factor.horizontal / coder->component[comp].sampling_factor.horizontal;
         data.comp[comp].sampling_factor.vertical = coder->sampling_factor.vertical / coder->component[comp].sampling_factor.vertical;
-        data.comp[comp].data_width = coder->component[comp].data_width;
+        // Component planes may be downscaled by scaled IDCT
+        data.comp[comp].data_width = coder->component[comp].data_width / coder->data_scale;
+        data.comp[comp].width = gpujpeg_div_and_round_up(coder->component[comp].width, coder->data_scale);
+        data.comp[comp].height = gpujpeg_div_and_round_up(coder->component[comp].height, coder->data_scale);
     }
+    data.raw_width = coder->data_raw_width;
+    data.raw_height = coder->data_raw_height;
+    data.filter = coder->data_raw_filter;
+    data.tensor = coder->data_raw_tensor_format;
     kernel<<<grid, threads, 0, stream>>>(
         data,
         coder->d_data_raw,
@@ -907,3 +2330,271 @@ gpujpeg_preprocessor_decode(struct gpujpeg_coder* coder, cudaStream_t stream)
 
     return 0;
 }
+
+/** Width and height of raw image tile processed by one thread block of fused IDCT and postprocessor kernel */
+#define GPUJPEG_PREPROCESSOR_IDCT_TILE_SIZE 32
+/** Number of 8x8 blocks transformed at once by one thread block of fused IDCT and postprocessor kernel */
+#define GPUJPEG_PREPROCESSOR_IDCT_BLOCK_COUNT 16
+
+/**
+ * Components reconstructed by fused IDCT and postprocessor kernel
+ */
+struct gpujpeg_preprocessor_idct_data
+{
+    int comp_count;
+    // Quantized coefficients of components
+    const int16_t* d_data_quantized[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Dequantization tables of components
+    const uint16_t* d_quantization_table[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Ratio of maximum and component sampling factors
+    int sampling_h[GPUJPEG_MAX_COMPONENT_COUNT];
+    int sampling_v[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Number of 8x8 blocks of components
+    int block_count_x[GPUJPEG_MAX_COMPONENT_COUNT];
+    int block_count_y[GPUJPEG_MAX_COMPONENT_COUNT];
+    // Fourth byte of 4-byte pixels
+    uint8_t alpha;
+};
+
+/**
+ * Kernel - Dequantize and inverse DCT all 8x8 blocks of components covering a tile
+ * of raw image into shared memory and immediately upsample (nearest), color transform
+ * and store pixels of the tile. Blocks are transformed in the same way as by
+ * gpujpeg_idct_gpu_kernel, so no component planes are written and read back.
+ */
+template<
+    enum gpujpeg_color_space color_space_internal,
+    enum gpujpeg_color_space color_space
+>
+__global__ void
+gpujpeg_preprocessor_idct_kernel(struct gpujpeg_preprocessor_idct_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height)
+{
+    enum { TILE = GPUJPEG_PREPROCESSOR_IDCT_TILE_SIZE };
+
+    // Reconstructed component samples of the tile (subsampled components use top-left part)
+    __shared__ uint8_t s_comp[GPUJPEG_MAX_COMPONENT_COUNT][TILE][TILE];
+    // Transposition buffers of transformed blocks
+    __shared__ float s_block[GPUJPEG_PREPROCESSOR_IDCT_BLOCK_COUNT][8][8 + 1];
+
+    const int thread = threadIdx.y * blockDim.x + threadIdx.x;
+    const int slot = thread >> 3;
+    const int lane = thread & 7;
+
+    // Blocks of all components covering the tile are enumerated component by component
+    int tile_block_count = 0;
+    for ( int comp = 0; comp < data.comp_count; comp++ ) {
+        tile_block_count += (TILE / (8 * data.sampling_h[comp])) * (TILE / (8 * data.sampling_v[comp]));
+    }
+    for ( int first = 0; first < tile_block_count; first += GPUJPEG_PREPROCESSOR_IDCT_BLOCK_COUNT ) {
+        // Find component and block of thread's slot
+        int index = first + slot;
+        int comp = 0;
+        int tile_block_count_x = 0;
+        for ( ; comp < data.comp_count; comp++ ) {
+            tile_block_count_x = TILE / (8 * data.sampling_h[comp]);
+            int count = tile_block_count_x * (TILE / (8 * data.sampling_v[comp]));
+            if ( index < count ) {
+                break;
+            }
+            index -= count;
+        }
+        const int tile_block_x = index % tile_block_count_x;
+        const int tile_block_y = index / tile_block_count_x;
+        const int block_x = blockIdx.x * tile_block_count_x + tile_block_x;
+        const int block_y = blockIdx.y * (TILE / (8 * (comp < data.comp_count ? data.sampling_v[comp] : 1))) + tile_block_y;
+        const bool processing = comp < data.comp_count && block_x < data.block_count_x[comp] && block_y < data.block_count_y[comp];
+
+        // Dequantize and transform column of the block (column is reordered for IDCT)
+        float x[8];
+        if ( processing ) {
+            const int16_t* block = data.d_data_quantized[comp] + (block_y * data.block_count_x[comp] + block_x) * 64;
+            const uint16_t* table = data.d_quantization_table[comp];
+            const int order[8] = { 0, 4, 6, 2, 7, 5, 3, 1 };
+            #pragma unroll
+            for ( int i = 0; i < 8; i++ ) {
+                x[i] = block[order[i] * 8 + lane] * table[order[i] * 8 + lane];
+            }
+            gpujpeg_idct_inverse_1d(x);
+            #pragma unroll
+            for ( int i = 0; i < 8; i++ ) {
+                s_block[slot][i][lane] = x[i];
+            }
+        }
+        __syncthreads();
+
+        // Transform row of the block and store it to component samples
+        if ( processing ) {
+            x[0] = s_block[slot][lane][0];
+            x[1] = s_block[slot][lane][4];
+            x[2] = s_block[slot][lane][6];
+            x[3] = s_block[slot][lane][2];
+            x[4] = s_block[slot][lane][7];
+            x[5] = s_block[slot][lane][5];
+            x[6] = s_block[slot][lane][3];
+            x[7] = s_block[slot][lane][1];
+            gpujpeg_idct_inverse_1d(x);
+            uint8_t* row = &s_comp[comp][tile_block_y * 8 + lane][tile_block_x * 8];
+            #pragma unroll
+            for ( int i = 0; i < 8; i++ ) {
+                row[i] = gpujpeg_idct_sample(x[i]);
+            }
+        }
+        __syncthreads();
+    }
+
+    // Upsample, color transform and store pixels of the tile
+    const int thread_count = blockDim.x * blockDim.y;
+    for ( int pixel = thread; pixel < TILE * TILE; pixel += thread_count ) {
+        const int tile_x = pixel % TILE;
+        const int tile_y = pixel / TILE;
+        const int x = blockIdx.x * TILE + tile_x;
+        const int y = blockIdx.y * TILE + tile_y;
+        if ( x >= image_width || y >= image_height ) {
+            continue;
+        }
+        if ( pixel_format == GPUJPEG_U8 ) {
+            planes.data[0][y * planes.pitch[0] + x] = s_comp[0][tile_y][tile_x];
+            continue;
+        }
+        uint8_t r1 = s_comp[0][tile_y / data.sampling_v[0]][tile_x / data.sampling_h[0]];
+        uint8_t r2 = s_comp[1][tile_y / data.sampling_v[1]][tile_x / data.sampling_h[1]];
+        uint8_t r3 = s_comp[2][tile_y / data.sampling_v[2]][tile_x / data.sampling_h[2]];
+        uint8_t r4 = data.alpha;
+        if ( pixel_format == GPUJPEG_4444_U8_P0123 ) {
+            r4 = s_comp[3][tile_y / data.sampling_v[3]][tile_x / data.sampling_h[3]];
+        }
+        gpujpeg_color_transform<color_space_internal, color_space>::perform(r1, r2, r3);
+        gpujpeg_preprocessor_planes_store<color_space>(planes, pixel_format, x, y, r1, r2, r3, r4);
+    }
+}
+
+/** Fused IDCT and postprocessor kernel type */
+typedef void (*gpujpeg_preprocessor_idct_kernel_t)(struct gpujpeg_preprocessor_idct_data data, struct gpujpeg_image_planes planes, enum gpujpeg_pixel_format pixel_format, int image_width, int image_height);
+
+/**
+ * Select fused IDCT and postprocessor kernel
+ *
+ * @param color_space  Color space of raw image
+ * @return kernel
+ */
+template<enum gpujpeg_color_space color_space_internal>
+static gpujpeg_preprocessor_idct_kernel_t
+gpujpeg_preprocessor_select_idct_kernel(enum gpujpeg_color_space color_space)
+{
+    switch ( color_space ) {
+    case GPUJPEG_NONE: return &gpujpeg_preprocessor_idct_kernel<color_space_internal, GPUJPEG_NONE>;
+    case GPUJPEG_RGB: return &gpujpeg_preprocessor_idct_kernel<color_space_internal, GPUJPEG_RGB>;
+    case GPUJPEG_YCBCR_BT601: return &gpujpeg_preprocessor_idct_kernel<color_space_internal, GPUJPEG_YCBCR_BT601>;
+    case GPUJPEG_YCBCR_BT601_256LVLS: return &gpujpeg_preprocessor_idct_kernel<color_space_internal, GPUJPEG_YCBCR_BT601_256LVLS>;
+    case GPUJPEG_YCBCR_BT709: return &gpujpeg_preprocessor_idct_kernel<color_space_internal, GPUJPEG_YCBCR_BT709>;
+    case GPUJPEG_YUV: return &gpujpeg_preprocessor_idct_kernel<color_space_internal, GPUJPEG_YUV>;
+    case GPUJPEG_CMYK: return &gpujpeg_preprocessor_idct_kernel<color_space_internal, GPUJPEG_CMYK>;
+    case GPUJPEG_YCCK: return &gpujpeg_preprocessor_idct_kernel<color_space_internal, GPUJPEG_YCCK>;
+    default: assert(false); return NULL;
+    }
+}
+
+/** Documented at declaration */
+int
+gpujpeg_preprocessor_decode_idct_available(struct gpujpeg_decoder* decoder)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    int comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+
+    // Resized, downscaled, tensor, 12-bit and filtered upsampling outputs use component planes
+    if ( coder->param.precision > 8 || coder->data_raw_width != 0 || coder->data_scale != 1 || coder->data_raw_tensor
+            || gpujpeg_preprocessor_sampling_filtered(coder, comp_count) ) {
+        return 0;
+    }
+    if ( pixel_format == GPUJPEG_U8 ? (comp_count != 1) : (comp_count != ((pixel_format == GPUJPEG_4444_U8_P0123) ? 4 : 3)) ) {
+        return 0;
+    }
+    for ( int comp = 0; comp < comp_count; comp++ ) {
+        int factor_h = coder->sampling_factor.horizontal / coder->component[comp].sampling_factor.horizontal;
+        int factor_v = coder->sampling_factor.vertical / coder->component[comp].sampling_factor.vertical;
+        if ( coder->sampling_factor.horizontal % coder->component[comp].sampling_factor.horizontal != 0
+                || coder->sampling_factor.vertical % coder->component[comp].sampling_factor.vertical != 0
+                || GPUJPEG_PREPROCESSOR_IDCT_TILE_SIZE % (8 * factor_h) != 0
+                || GPUJPEG_PREPROCESSOR_IDCT_TILE_SIZE % (8 * factor_v) != 0 ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_preprocessor_decode_idct(struct gpujpeg_decoder* decoder)
+{
+    struct gpujpeg_coder* coder = &decoder->coder;
+    enum gpujpeg_pixel_format pixel_format = coder->param_image.pixel_format;
+    assert(gpujpeg_preprocessor_decode_idct_available(decoder));
+
+    // Select kernel
+    gpujpeg_preprocessor_idct_kernel_t kernel = NULL;
+    if ( pixel_format == GPUJPEG_U8 ) {
+        kernel = &gpujpeg_preprocessor_idct_kernel<GPUJPEG_NONE, GPUJPEG_NONE>;
+    } else if ( coder->param.color_space_internal == GPUJPEG_NONE ) {
+        kernel = gpujpeg_preprocessor_select_idct_kernel<GPUJPEG_NONE>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_RGB ) {
+        kernel = gpujpeg_preprocessor_select_idct_kernel<GPUJPEG_RGB>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_YCBCR_BT601_256LVLS ) {
+        kernel = gpujpeg_preprocessor_select_idct_kernel<GPUJPEG_YCBCR_BT601_256LVLS>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_CMYK ) {
+        kernel = gpujpeg_preprocessor_select_idct_kernel<GPUJPEG_CMYK>(coder->param_image.color_space);
+    } else if ( coder->param.color_space_internal == GPUJPEG_YCCK ) {
+        kernel = gpujpeg_preprocessor_select_idct_kernel<GPUJPEG_YCCK>(coder->param_image.color_space);
+    } else {
+        assert(false);
+    }
+    if ( kernel == NULL ) {
+        return -1;
+    }
+
+    // Raw image is written to planes with row pitches
+    struct gpujpeg_image_planes planes = coder->data_raw_planes;
+    if ( planes.data[0] == NULL ) {
+        gpujpeg_image_planes_init(&coder->param_image, coder->d_data_raw, &planes);
+    }
+
+    int image_width = coder->param_image.width;
+    int image_height = coder->param_image.height;
+    if ( pixel_format == GPUJPEG_422_U8_P1020 || pixel_format == GPUJPEG_422_U8_P0102 ) {
+        image_width = gpujpeg_div_and_round_up(image_width, 2) * 2;
+    }
+
+    // Only luminance component is output when chroma was not decoded
+    struct gpujpeg_preprocessor_idct_data data;
+    data.comp_count = coder->luminance_only ? 1 : coder->param_image.comp_count;
+    for ( int comp = 0; comp < data.comp_count; comp++ ) {
+        struct gpujpeg_component* component = &coder->component[comp];
+        data.d_data_quantized[comp] = component->d_data_quantized;
+        data.d_quantization_table[comp] = decoder->table_quantization[component->type].d_table;
+        data.sampling_h[comp] = coder->sampling_factor.horizontal / component->sampling_factor.horizontal;
+        data.sampling_v[comp] = coder->sampling_factor.vertical / component->sampling_factor.vertical;
+        data.block_count_x[comp] = component->data_width / GPUJPEG_BLOCK_SIZE;
+        data.block_count_y[comp] = component->data_height / GPUJPEG_BLOCK_SIZE;
+    }
+    for ( int comp = data.comp_count; comp < GPUJPEG_MAX_COMPONENT_COUNT; comp++ ) {
+        data.sampling_h[comp] = 1;
+        data.sampling_v[comp] = 1;
+    }
+    data.alpha = coder->data_raw_alpha;
+
+    dim3 threads(GPUJPEG_PREPROCESSOR_IDCT_BLOCK_COUNT * 8);
+    dim3 grid(
+        gpujpeg_div_and_round_up(image_width, GPUJPEG_PREPROCESSOR_IDCT_TILE_SIZE),
+        gpujpeg_div_and_round_up(image_height, GPUJPEG_PREPROCESSOR_IDCT_TILE_SIZE)
+    );
+    kernel<<<grid, threads, 0, *(decoder->stream)>>>(
+        data,
+        planes,
+        pixel_format,
+        image_width,
+        image_height
+    );
+    gpujpeg_cuda_check_error("Postprocessor decoding with IDCT failed", return -1);
+
+    return 0;
+}
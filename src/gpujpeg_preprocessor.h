@@ -56,6 +56,40 @@ gpujpeg_preprocessor_encoder_init(struct gpujpeg_coder* coder);
 int
 gpujpeg_preprocessor_encode(struct gpujpeg_encoder * encoder);
 
+/**
+ * Check whether raw image can be preprocessed together with forward DCT and
+ * quantization by gpujpeg_preprocessor_encode_dct (8-bit image which is not
+ * resampled, components are subsampled by nearest sampling and alpha is not extracted)
+ *
+ * @param encoder  Encoder structure
+ * @return 1 if fused preprocessing is available, otherwise 0
+ */
+int
+gpujpeg_preprocessor_encode_dct_available(struct gpujpeg_encoder* encoder);
+
+/**
+ * Preprocessor encode fused with forward DCT and quantization, raw image is
+ * transformed by 8x8 blocks directly to quantized coefficients of components
+ * (component planes in coder->d_data are neither written nor read)
+ *
+ * @param encoder  Encoder structure
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_preprocessor_encode_dct(struct gpujpeg_encoder* encoder);
+
+/**
+ * Downsample component planes of previous pyramid level to half resolution
+ *
+ * @param coder  Coder structure already initialized for the target (half) resolution
+ * @param component  Components of the previous level, their d_data must not overlap coder->d_data
+ * @param filter  Downsampling filter
+ * @param stream  CUDA stream
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_preprocessor_downsample(struct gpujpeg_coder* coder, const struct gpujpeg_component* component, enum gpujpeg_resize_filter filter, cudaStream_t stream);
+
 /**
  * Init preprocessor decoder
  *
@@ -75,6 +109,28 @@ gpujpeg_preprocessor_decoder_init(struct gpujpeg_coder* coder);
 int
 gpujpeg_preprocessor_decode(struct gpujpeg_coder* coder, cudaStream_t stream);
 
+/**
+ * Check whether quantized coefficients can be inverse transformed together with
+ * postprocessing by gpujpeg_preprocessor_decode_idct (8-bit image which is not
+ * resized, downscaled or output as tensor and components are upsampled by nearest sampling)
+ *
+ * @param decoder  Decoder structure
+ * @return 1 if fused postprocessing is available, otherwise 0
+ */
+int
+gpujpeg_preprocessor_decode_idct_available(struct gpujpeg_decoder* decoder);
+
+/**
+ * Preprocessor decode fused with dequantization and inverse DCT, quantized
+ * coefficients of components are transformed by tiles directly to raw image
+ * pixels (component planes in coder->d_data are neither written nor read)
+ *
+ * @param decoder  Decoder structure
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_preprocessor_decode_idct(struct gpujpeg_decoder* decoder);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,7 @@
 #include <libgpujpeg/gpujpeg_reader.h>
 #include <libgpujpeg/gpujpeg_decoder.h>
 #include <libgpujpeg/gpujpeg_decoder_internal.h>
+#include <libgpujpeg/gpujpeg_stats_internal.h>
 #include <libgpujpeg/gpujpeg_util.h>
 
 /** Documented at declaration */
@@ -191,8 +192,7 @@ gpujpeg_reader_read_app14(uint8_t** image, enum gpujpeg_color_space *color_space
     } else if (color_transform == 1) {
         *color_space = GPUJPEG_YCBCR_BT601_256LVLS;
     } else if (color_transform == 2) {
-        fprintf(stderr, "[GPUJPEG] [Error] Unsupported YCCK color transformation was presented!\n");
-        return -1;
+        *color_space = GPUJPEG_YCCK;
     } else {
         fprintf(stderr, "[GPUJPEG] [Error] Unsupported color transformation value '%d' was presented in APP14 marker!\n", color_transform);
         return -1;
@@ -214,13 +214,16 @@ gpujpeg_reader_read_dqt(struct gpujpeg_decoder* decoder, uint8_t** image)
     int length = (int)gpujpeg_reader_read_2byte(*image);
     length -= 2;
 
-    if ( (length % 65) != 0 ) {
-        fprintf(stderr, "[GPUJPEG] [Error] DQT marker length should be 65 but %d was presented!\n", length);
+    while ( length > 0 ) {
+    // Table precision (0 for 8-bit and 1 for 16-bit values) and index
+    int precision_index = gpujpeg_reader_read_byte(*image);
+    int precision = precision_index >> 4;
+    int index = precision_index & 15;
+    int table_length = precision ? 129 : 65;
+    if ( precision > 1 || length < table_length ) {
+        fprintf(stderr, "[GPUJPEG] [Error] DQT marker length should be multiple of 65 or 129 but %d was presented!\n", length);
         return -1;
     }
-
-    for (;length > 0; length-=65) {
-    int index = gpujpeg_reader_read_byte(*image);
     struct gpujpeg_table_quantization* table;
     if( index == 0 ) {
         table = &decoder->table_quantization[GPUJPEG_COMPONENT_LUMINANCE];
@@ -231,11 +234,25 @@ gpujpeg_reader_read_dqt(struct gpujpeg_decoder* decoder, uint8_t** image)
         return -1;
     }
 
+    uint16_t table_raw[64];
     for ( int i = 0; i < 64; i++ ) {
-        table->table_raw[i] = gpujpeg_reader_read_byte(*image);
+        if ( precision ) {
+            table_raw[i] = gpujpeg_reader_read_2byte(*image);
+        } else {
+            table_raw[i] = gpujpeg_reader_read_byte(*image);
+        }
+    }
+    // Prepare quantization table for read raw table (streams usually repeat the same table)
+    if ( memcmp(table->table_raw, table_raw, sizeof(table_raw)) != 0 ) {
+        memcpy(table->table_raw, table_raw, sizeof(table_raw));
+        gpujpeg_stats_host_start(&decoder->coder, GPUJPEG_STATS_TABLES);
+        if ( gpujpeg_table_quantization_decoder_compute(table) != 0 ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Failed to prepare quantization table!\n");
+            return -1;
+        }
+        gpujpeg_stats_host_stop(&decoder->coder, GPUJPEG_STATS_TABLES);
     }
-    // Prepare quantization table for read raw table
-    gpujpeg_table_quantization_decoder_compute(table);
+    length -= table_length;
     }
     return 0;
 }
@@ -243,11 +260,14 @@ gpujpeg_reader_read_dqt(struct gpujpeg_decoder* decoder, uint8_t** image)
 /**
  * Read start of frame block from image
  *
+ * @param param
+ * @param param_image
+ * @param extended  Flag if frame is extended sequential (SOF1) and so 12-bit precision is allowed
  * @param image
  * @return 0 if succeeds, otherwise nonzero
  */
 int
-gpujpeg_reader_read_sof0(struct gpujpeg_parameters * param, struct gpujpeg_image_parameters * param_image, uint8_t** image)
+gpujpeg_reader_read_sof0(struct gpujpeg_parameters * param, struct gpujpeg_image_parameters * param_image, int extended, uint8_t** image)
 {
     int length = (int)gpujpeg_reader_read_2byte(*image);
     if ( length < 6 ) {
@@ -257,15 +277,25 @@ gpujpeg_reader_read_sof0(struct gpujpeg_parameters * param, struct gpujpeg_image
     length -= 2;
 
     int precision = (int)gpujpeg_reader_read_byte(*image);
-    if ( precision != 8 ) {
-        fprintf(stderr, "[GPUJPEG] [Error] SOF0 marker precision should be 8 but %d was presented!\n", precision);
+    if ( precision != 8 && (precision != 12 || !extended) ) {
+        fprintf(stderr, "[GPUJPEG] [Error] SOF%d marker precision should be 8%s but %d was presented!\n", extended, extended ? " or 12" : "", precision);
         return -1;
     }
+    param->precision = precision;
 
     param_image->height = (int)gpujpeg_reader_read_2byte(*image);
     param_image->width = (int)gpujpeg_reader_read_2byte(*image);
     param_image->comp_count = (int)gpujpeg_reader_read_byte(*image);
     length -= 6;
+    if ( param_image->comp_count != 1 && param_image->comp_count != 3 && param_image->comp_count != 4 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] SOF0 marker component count %d is not supported!\n", param_image->comp_count);
+        return -1;
+    }
+
+    // Four components are YCCK (Adobe transform 2) or CMYK (Adobe transform 0 or no APP14 marker)
+    if ( param_image->comp_count == 4 && param->color_space_internal != GPUJPEG_YCCK ) {
+        param->color_space_internal = GPUJPEG_CMYK;
+    }
 
     for ( int comp = 0; comp < param_image->comp_count; comp++ ) {
         int index = (int)gpujpeg_reader_read_byte(*image);
@@ -278,13 +308,11 @@ gpujpeg_reader_read_sof0(struct gpujpeg_parameters * param, struct gpujpeg_image
         param->sampling_factor[comp].horizontal = (sampling >> 4) & 15;
         param->sampling_factor[comp].vertical = (sampling) & 15;
 
+        // Tables are selected by component type
         int table_index = (int)gpujpeg_reader_read_byte(*image);
-        if ( comp == 0 && table_index != 0 ) {
-            fprintf(stderr, "[GPUJPEG] [Error] SOF0 marker component Y should have quantization table index 0 but %d was presented!\n", table_index);
-            return -1;
-        }
-        if ( (comp == 1 || comp == 2) && table_index != 1 ) {
-            fprintf(stderr, "[GPUJPEG] [Error] SOF0 marker component Cb or Cr should have quantization table index 1 but %d was presented!\n", table_index);
+        int type = (int)gpujpeg_component_get_type(param->color_space_internal, comp);
+        if ( table_index != type ) {
+            fprintf(stderr, "[GPUJPEG] [Error] SOF0 marker component %d should have quantization table index %d but %d was presented!\n", comp + 1, type, table_index);
             return -1;
         }
         length -= 3;
@@ -314,24 +342,24 @@ gpujpeg_reader_read_dht(struct gpujpeg_decoder* decoder, uint8_t** image)
 
     while (length > 0) {
     int index = gpujpeg_reader_read_byte(*image);
-    struct gpujpeg_table_huffman_decoder* table = NULL;
-    struct gpujpeg_table_huffman_decoder* d_table = NULL;
+    int comp_type;
+    int huff_type;
     switch(index) {
     case 0:
-        table = &decoder->table_huffman[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_DC];
-        d_table = decoder->d_table_huffman[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_DC];
+        comp_type = GPUJPEG_COMPONENT_LUMINANCE;
+        huff_type = GPUJPEG_HUFFMAN_DC;
         break;
     case 16:
-        table = &decoder->table_huffman[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_AC];
-        d_table = decoder->d_table_huffman[GPUJPEG_COMPONENT_LUMINANCE][GPUJPEG_HUFFMAN_AC];
+        comp_type = GPUJPEG_COMPONENT_LUMINANCE;
+        huff_type = GPUJPEG_HUFFMAN_AC;
         break;
     case 1:
-        table = &decoder->table_huffman[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_DC];
-        d_table = decoder->d_table_huffman[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_DC];
+        comp_type = GPUJPEG_COMPONENT_CHROMINANCE;
+        huff_type = GPUJPEG_HUFFMAN_DC;
         break;
     case 17:
-        table = &decoder->table_huffman[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_AC];
-        d_table = decoder->d_table_huffman[GPUJPEG_COMPONENT_CHROMINANCE][GPUJPEG_HUFFMAN_AC];
+        comp_type = GPUJPEG_COMPONENT_CHROMINANCE;
+        huff_type = GPUJPEG_HUFFMAN_AC;
         break;
     default:
         fprintf(stderr, "[GPUJPEG] [Error] DHT marker index should be 0, 1, 16 or 17 but %d was presented!\n", index);
@@ -340,11 +368,13 @@ gpujpeg_reader_read_dht(struct gpujpeg_decoder* decoder, uint8_t** image)
     length -= 1;
 
     // Read in bits[]
-    table->bits[0] = 0;
+    unsigned char bits[17];
+    unsigned char huffval[256];
+    bits[0] = 0;
     int count = 0;
     for ( int i = 1; i <= 16; i++ ) {
-        table->bits[i] = gpujpeg_reader_read_byte(*image);
-        count += table->bits[i];
+        bits[i] = gpujpeg_reader_read_byte(*image);
+        count += bits[i];
         if ( length > 0 ) {
         length--;
         } else {
@@ -353,9 +383,14 @@ gpujpeg_reader_read_dht(struct gpujpeg_decoder* decoder, uint8_t** image)
         }
     }
 
+    if ( count > 256 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] DHT marker contains %d huffman values but at most 256 are allowed!\n", count);
+        return -1;
+    }
+
     // Read in huffval
     for ( int i = 0; i < count; i++ ){
-        table->huffval[i] = gpujpeg_reader_read_byte(*image);
+        huffval[i] = gpujpeg_reader_read_byte(*image);
         if ( length > 0 ) {
         length--;
         } else {
@@ -363,8 +398,18 @@ gpujpeg_reader_read_dht(struct gpujpeg_decoder* decoder, uint8_t** image)
         return -1;
         }
     }
-    // Compute huffman table for read values
-    gpujpeg_table_huffman_decoder_compute(table, d_table);
+    // Compute huffman table for read values (table is built only when it is not cached)
+    gpujpeg_stats_host_start(&decoder->coder, GPUJPEG_STATS_TABLES);
+    int changed = gpujpeg_table_huffman_decoder_cache_set(&decoder->table_huffman_cache, &decoder->table_huffman_entry[comp_type][huff_type], bits, huffval);
+    gpujpeg_stats_host_stop(&decoder->coder, GPUJPEG_STATS_TABLES);
+    if ( changed < 0 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to prepare huffman table!\n");
+        return -1;
+    }
+    if ( changed ) {
+        decoder->table_huffman[comp_type][huff_type] = decoder->table_huffman_entry[comp_type][huff_type]->table;
+        decoder->d_table_huffman[comp_type][huff_type] = decoder->table_huffman_entry[comp_type][huff_type]->d_table;
+    }
     }
     return 0;
 }
@@ -684,12 +729,10 @@ gpujpeg_reader_read_sos(struct gpujpeg_decoder* decoder, uint8_t** image, uint8_
         int table_dc = (table >> 4) & 15;
         int table_ac = table & 15;
 
-        if ( index == 1 && (table_ac != 0 || table_dc != 0) ) {
-            fprintf(stderr, "[GPUJPEG] [Error] SOS marker for Y should have huffman tables 0,0 but %d,%d was presented!\n", table_dc, table_ac);
-            return -1;
-        }
-        if ( (index == 2 || index == 3) && (table_ac != 1 || table_dc != 1) ) {
-            fprintf(stderr, "[GPUJPEG] [Error] SOS marker for Cb or Cr should have huffman tables 1,1 but %d,%d was presented!\n", table_dc, table_ac);
+        // Tables are selected by component type
+        int type = (int)gpujpeg_component_get_type(decoder->reader->param.color_space_internal, index - 1);
+        if ( table_ac != type || table_dc != type ) {
+            fprintf(stderr, "[GPUJPEG] [Error] SOS marker for component %d should have huffman tables %d,%d but %d,%d was presented!\n", index, type, type, table_dc, table_ac);
             return -1;
         }
     }
@@ -703,7 +746,7 @@ gpujpeg_reader_read_sos(struct gpujpeg_decoder* decoder, uint8_t** image, uint8_
 
     // Check maximum scan count
     if ( decoder->reader->scan_count >= GPUJPEG_MAX_COMPONENT_COUNT ) {
-        fprintf(stderr, "[GPUJPEG] [Error] SOS marker reached maximum number of scans (3)!\n");
+        fprintf(stderr, "[GPUJPEG] [Error] SOS marker reached maximum number of scans (%d)!\n", GPUJPEG_MAX_COMPONENT_COUNT);
         return -1;
     }
 
@@ -803,13 +846,12 @@ gpujpeg_reader_read_image(struct gpujpeg_decoder* decoder, uint8_t* image, int i
 
         case GPUJPEG_MARKER_SOF0:
             // Baseline
-            if ( gpujpeg_reader_read_sof0(&decoder->reader->param, &decoder->reader->param_image, &image) != 0 )
+            if ( gpujpeg_reader_read_sof0(&decoder->reader->param, &decoder->reader->param_image, 0, &image) != 0 )
                 return -1;
             break;
         case GPUJPEG_MARKER_SOF1:
             // Extended sequential with Huffman coder
-            fprintf(stderr, "[GPUJPEG] [Warning] Reading SOF1 as it was SOF0 marker (should work but verify it)!\n", gpujpeg_marker_name((enum gpujpeg_marker_code)marker));
-            if ( gpujpeg_reader_read_sof0(&decoder->reader->param, &decoder->reader->param_image, &image) != 0 )
+            if ( gpujpeg_reader_read_sof0(&decoder->reader->param, &decoder->reader->param_image, 1, &image) != 0 )
                 return -1;
             break;
         case GPUJPEG_MARKER_SOF2:
@@ -944,9 +986,15 @@ gpujpeg_decoder_get_image_info(uint8_t* image, int image_size, struct gpujpeg_im
         case GPUJPEG_MARKER_SOF1: // Extended sequential with Huffman coder
         {
             struct gpujpeg_parameters param;
-            if (gpujpeg_reader_read_sof0(&param, param_image, &image) != 0) {
+            param.color_space_internal = param_image->color_space;
+            if (gpujpeg_reader_read_sof0(&param, param_image, marker == GPUJPEG_MARKER_SOF1, &image) != 0) {
                 return -1;
             }
+            param_image->color_space = param.color_space_internal;
+            // 12-bit images are decoded to 16-bit pixel formats
+            if (param.precision > 8) {
+                param_image->pixel_format = (param_image->comp_count == 1) ? GPUJPEG_U16 : GPUJPEG_444_U16_P012;
+            }
             return 0;
         }
         case GPUJPEG_MARKER_SOF2:
@@ -0,0 +1,383 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libgpujpeg/gpujpeg_route.h>
+#include <libgpujpeg/gpujpeg_encoder.h>
+#include <libgpujpeg/gpujpeg_encoder_internal.h>
+#include <libgpujpeg/gpujpeg_decoder.h>
+#include <libgpujpeg/gpujpeg_decoder_internal.h>
+#include <libgpujpeg/gpujpeg_util.h>
+#include "gpujpeg_device.h"
+#include "gpujpeg_thread.h"
+
+/** Description of cost model field used by profile file */
+struct gpujpeg_route_model_field
+{
+    // Key in profile file
+    const char* name;
+    // Offset of double field in gpujpeg_route_model (-1 for device_huffman_parallelism)
+    int offset;
+};
+
+#define GPUJPEG_ROUTE_MODEL_FIELD(name) { #name, (int)offsetof(struct gpujpeg_route_model, name) }
+
+/** Fields of cost model stored in profile file */
+static const struct gpujpeg_route_model_field gpujpeg_route_model_fields[] = {
+    GPUJPEG_ROUTE_MODEL_FIELD(host_overhead),
+    GPUJPEG_ROUTE_MODEL_FIELD(host_transform),
+    GPUJPEG_ROUTE_MODEL_FIELD(host_huffman),
+    GPUJPEG_ROUTE_MODEL_FIELD(device_overhead),
+    GPUJPEG_ROUTE_MODEL_FIELD(device_transform),
+    GPUJPEG_ROUTE_MODEL_FIELD(device_huffman_overhead),
+    GPUJPEG_ROUTE_MODEL_FIELD(device_huffman),
+    { "device_huffman_parallelism", -1 },
+    GPUJPEG_ROUTE_MODEL_FIELD(transfer),
+};
+
+#define GPUJPEG_ROUTE_MODEL_FIELD_COUNT (int)(sizeof(gpujpeg_route_model_fields) / sizeof(gpujpeg_route_model_fields[0]))
+
+/** Documented at declaration */
+void
+gpujpeg_route_model_set_default(struct gpujpeg_route_model* model)
+{
+    model->host_overhead = 20.0;
+    model->host_transform = 4.0;
+    model->host_huffman = 6.0;
+    model->device_overhead = 300.0;
+    model->device_transform = 0.05;
+    model->device_huffman_overhead = 30.0;
+    model->device_huffman = 60.0;
+    model->device_huffman_parallelism = 2048;
+    model->transfer = 0.1;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_route_model_load(struct gpujpeg_route_model* model, const char* filename)
+{
+    FILE* file = fopen(filename, "r");
+    if ( file == NULL ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed open %s for reading!\n", filename);
+        return -1;
+    }
+
+    char line[256];
+    int line_number = 0;
+    while ( fgets(line, sizeof(line), file) != NULL ) {
+        line_number++;
+        char name[64];
+        double value;
+        if ( line[0] == '#' || sscanf(line, "%63s", name) != 1 ) {
+            continue;
+        }
+        if ( sscanf(line, "%63s %lf", name, &value) != 2 ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Invalid line %d of route profile %s!\n", line_number, filename);
+            fclose(file);
+            return -1;
+        }
+        int index = 0;
+        while ( index < GPUJPEG_ROUTE_MODEL_FIELD_COUNT && strcmp(gpujpeg_route_model_fields[index].name, name) != 0 ) {
+            index++;
+        }
+        if ( index == GPUJPEG_ROUTE_MODEL_FIELD_COUNT ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Unknown key '%s' in route profile %s!\n", name, filename);
+            fclose(file);
+            return -1;
+        }
+        if ( gpujpeg_route_model_fields[index].offset < 0 ) {
+            model->device_huffman_parallelism = (int)value;
+        } else {
+            *(double*)((char*)model + gpujpeg_route_model_fields[index].offset) = value;
+        }
+    }
+    fclose(file);
+
+    if ( model->device_huffman_parallelism < 1 ) {
+        model->device_huffman_parallelism = 1;
+    }
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_route_model_save(const struct gpujpeg_route_model* model, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if ( file == NULL ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed open %s for writing!\n", filename);
+        return -1;
+    }
+    fprintf(file, "# GPUJPEG route profile (overheads in us, costs in ns per sample or byte)\n");
+    for ( int index = 0; index < GPUJPEG_ROUTE_MODEL_FIELD_COUNT; index++ ) {
+        if ( gpujpeg_route_model_fields[index].offset < 0 ) {
+            fprintf(file, "%s %d\n", gpujpeg_route_model_fields[index].name, model->device_huffman_parallelism);
+        } else {
+            fprintf(file, "%s %g\n", gpujpeg_route_model_fields[index].name,
+                    *(const double*)((const char*)model + gpujpeg_route_model_fields[index].offset));
+        }
+    }
+    if ( fclose(file) != 0 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to write %s!\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_route_decide(const struct gpujpeg_route_model* model, const struct gpujpeg_route_image* image, struct gpujpeg_route_decision* decision)
+{
+    double samples = (double)image->sample_count;
+    int segment_count = image->segment_count > 0 ? image->segment_count : 1;
+
+    // CPU pipeline spreads segments across threads
+    decision->duration_host = 0.0;
+    if ( image->host_image_supported ) {
+        int thread_count = image->host_thread_count;
+        if ( thread_count > segment_count )
+            thread_count = segment_count;
+        if ( thread_count < 1 )
+            thread_count = 1;
+        decision->duration_host = model->host_overhead * 1e-3
+            + samples * (model->host_transform + model->host_huffman) / thread_count * 1e-6;
+    }
+
+    // GPU pipeline codes huffman on one CPU thread (coefficients are transferred)
+    // or on GPU where each segment is coded by one GPU thread
+    double duration_huffman_host = (samples * model->host_huffman + samples * sizeof(short) * model->transfer) * 1e-6;
+    decision->huffman = GPUJPEG_ROUTE_HOST;
+    double duration_huffman = duration_huffman_host;
+    if ( image->device_huffman_supported ) {
+        int parallelism = model->device_huffman_parallelism > 0 ? model->device_huffman_parallelism : 1;
+        double waves = ceil((double)segment_count / parallelism);
+        double duration_huffman_device = model->device_huffman_overhead * 1e-3
+            + waves * (samples / segment_count) * model->device_huffman * 1e-6;
+        if ( duration_huffman_device < duration_huffman_host ) {
+            decision->huffman = GPUJPEG_ROUTE_DEVICE;
+            duration_huffman = duration_huffman_device;
+        }
+    }
+    decision->duration_device = model->device_overhead * 1e-3 + samples * model->device_transform * 1e-6
+        + (image->raw_on_device ? 0.0 : (double)image->raw_size * model->transfer * 1e-6) + duration_huffman;
+
+    decision->huffman_host_segment_count = 0;
+    decision->image = GPUJPEG_ROUTE_DEVICE;
+    if ( image->host_image_supported && decision->duration_host < decision->duration_device ) {
+        decision->image = GPUJPEG_ROUTE_HOST;
+    }
+}
+
+/** Calibration measurement of one image size */
+struct gpujpeg_route_measurement
+{
+    // Number of samples of all components
+    double samples;
+    // Raw image size in bytes
+    double raw_size;
+    // Number of threads used by CPU pipeline
+    int host_thread_count;
+    // Duration of CPU pipeline [s]
+    double duration_host;
+    // Duration of GPU pipeline [s]
+    double duration_device;
+};
+
+/** Number of timed runs of calibration (the fastest one is used) */
+#define GPUJPEG_ROUTE_CALIBRATE_RUN_COUNT 5
+
+/**
+ * Measure decoding durations of synthetic image on CPU and on GPU
+ *
+ * @param size  Image width and height
+ * @param host_thread_count  Number of CPU threads
+ * @param measurement  Measured durations
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_route_calibrate_measure(int size, int host_thread_count, struct gpujpeg_route_measurement* measurement)
+{
+    struct gpujpeg_parameters param;
+    gpujpeg_set_default_parameters(&param);
+    param.restart_interval = 8;
+    // CPU pipeline codes MCU rows of single interleaved scan
+    param.interleaved = 1;
+    struct gpujpeg_image_parameters param_image;
+    gpujpeg_image_set_default_parameters(&param_image);
+    param_image.width = size;
+    param_image.height = size;
+
+    // Smooth pattern with noise, similar to photographs in entropy
+    int image_size = gpujpeg_image_calculate_size(&param_image);
+    uint8_t* image = (uint8_t*)malloc(image_size);
+    if ( image == NULL ) {
+        return -1;
+    }
+    unsigned int seed = 1;
+    for ( int index = 0; index < image_size; index++ ) {
+        seed = seed * 1103515245 + 12345;
+        int pixel = index / 3;
+        image[index] = (uint8_t)((pixel % size) * 255 / size / (index % 3 + 1) + (pixel / size) / 2 + ((seed >> 16) & 15));
+    }
+
+    int result = -1;
+    struct gpujpeg_encoder* encoder = gpujpeg_encoder_create(NULL);
+    struct gpujpeg_decoder* decoder_host = gpujpeg_decoder_create(NULL);
+    struct gpujpeg_decoder* decoder_device = gpujpeg_decoder_create(NULL);
+    uint8_t* image_compressed = NULL;
+    int image_compressed_size = 0;
+    if ( encoder != NULL && decoder_host != NULL && decoder_device != NULL ) {
+        // Image is encoded by CPU pipeline, which is available also on host runtime
+        gpujpeg_encoder_set_host_threads(encoder, host_thread_count);
+        struct gpujpeg_encoder_input input;
+        gpujpeg_encoder_input_set_image(&input, image);
+        result = gpujpeg_encoder_encode(encoder, &param, &param_image, &input, &image_compressed, &image_compressed_size);
+        if ( result == 0 && encoder->coder.route.image != GPUJPEG_ROUTE_HOST ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Route calibration image wasn't encoded by CPU pipeline!\n");
+            result = -1;
+        }
+    }
+
+    if ( result == 0 ) {
+        // CPU pipeline is forced by host threads without routing, GPU pipeline
+        // (including huffman decoder) by model with prohibitive CPU costs
+        gpujpeg_decoder_set_host_threads(decoder_host, host_thread_count);
+        struct gpujpeg_route_model model_device;
+        gpujpeg_route_model_set_default(&model_device);
+        model_device.host_overhead = 1e12;
+        model_device.host_huffman = 1e12;
+        gpujpeg_decoder_set_route_model(decoder_device, &model_device);
+
+        measurement->duration_host = 1e30;
+        measurement->duration_device = 1e30;
+        for ( int run = 0; run <= GPUJPEG_ROUTE_CALIBRATE_RUN_COUNT && result == 0; run++ ) {
+            struct gpujpeg_decoder* decoder[2] = { decoder_host, decoder_device };
+            for ( int backend = 0; backend < 2 && result == 0; backend++ ) {
+                struct gpujpeg_decoder_output output;
+                gpujpeg_decoder_output_set_default(&output);
+                double start = gpujpeg_get_time();
+                result = gpujpeg_decoder_decode(decoder[backend], image_compressed, image_compressed_size, &output);
+                double duration = gpujpeg_get_time() - start;
+                // Measured pipeline must be the forced one (decoder falls back to GPU pipeline
+                // for images which can't be decoded by MCU rows)
+                enum gpujpeg_route_backend route = backend == 0 ? GPUJPEG_ROUTE_HOST : GPUJPEG_ROUTE_DEVICE;
+                if ( result == 0 && decoder[backend]->coder.route.image != route ) {
+                    fprintf(stderr, "[GPUJPEG] [Error] Route calibration image wasn't decoded by %s pipeline!\n",
+                            route == GPUJPEG_ROUTE_HOST ? "CPU" : "GPU");
+                    result = -1;
+                }
+                // The first run only warms up caches and allocates buffers
+                double* measured = backend == 0 ? &measurement->duration_host : &measurement->duration_device;
+                if ( run > 0 && duration < *measured ) {
+                    *measured = duration;
+                }
+            }
+        }
+    }
+    if ( result == 0 ) {
+        struct gpujpeg_coder* coder = &decoder_host->coder;
+        measurement->samples = coder->data_size;
+        measurement->raw_size = image_size;
+        measurement->host_thread_count = gpujpeg_thread_get_count(host_thread_count);
+        if ( measurement->host_thread_count > coder->segment_count )
+            measurement->host_thread_count = coder->segment_count;
+    }
+
+    if ( decoder_device != NULL )
+        gpujpeg_decoder_destroy(decoder_device);
+    if ( decoder_host != NULL )
+        gpujpeg_decoder_destroy(decoder_host);
+    if ( encoder != NULL )
+        gpujpeg_encoder_destroy(encoder);
+    free(image);
+    return result;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_route_model_calibrate(struct gpujpeg_route_model* model, int host_thread_count)
+{
+    // Transfer cost of pinned buffer to device memory
+    size_t transfer_size = 16 * 1024 * 1024;
+    uint8_t* buffer = NULL;
+    uint8_t* d_buffer = NULL;
+    if ( gpujpeg_device_malloc_host((void**)&buffer, transfer_size) != cudaSuccess || gpujpeg_device_malloc((void**)&d_buffer, transfer_size) != cudaSuccess ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Route calibration failed to allocate transfer buffers!\n");
+        gpujpeg_device_free_host(buffer);
+        return -1;
+    }
+    double duration_transfer = 1e30;
+    for ( int run = 0; run <= GPUJPEG_ROUTE_CALIBRATE_RUN_COUNT; run++ ) {
+        double start = gpujpeg_get_time();
+        gpujpeg_device_memcpy(d_buffer, buffer, transfer_size, cudaMemcpyHostToDevice);
+        double duration = gpujpeg_get_time() - start;
+        if ( run > 0 && duration < duration_transfer )
+            duration_transfer = duration;
+    }
+    gpujpeg_device_free(d_buffer);
+    gpujpeg_device_free_host(buffer);
+    gpujpeg_device_check_error("Route calibration transfer", return -1);
+    model->transfer = duration_transfer * 1e9 / transfer_size;
+
+    struct gpujpeg_route_measurement small;
+    struct gpujpeg_route_measurement large;
+    if ( gpujpeg_route_calibrate_measure(64, host_thread_count, &small) != 0
+            || gpujpeg_route_calibrate_measure(1024, host_thread_count, &large) != 0 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Route calibration failed!\n");
+        return -1;
+    }
+
+    // CPU: duration = overhead + samples / threads * cost, cost is split between
+    // transform and huffman coding in ratio of the current model
+    double host_cost = (large.duration_host - small.duration_host)
+        / (large.samples / large.host_thread_count - small.samples / small.host_thread_count);
+    if ( host_cost > 0.0 ) {
+        double host_overhead = small.duration_host - small.samples / small.host_thread_count * host_cost;
+        double transform_ratio = model->host_transform / (model->host_transform + model->host_huffman);
+        model->host_overhead = (host_overhead > 0.0 ? host_overhead : 0.0) * 1e6;
+        model->host_transform = host_cost * 1e9 * transform_ratio;
+        model->host_huffman = host_cost * 1e9 * (1.0 - transform_ratio);
+    }
+
+    // GPU: duration = overhead + samples * cost, cost includes transfer of raw
+    // image and huffman overhead is part of measured overhead (segments have
+    // the same size, so huffman duration does not depend on image size)
+    double device_cost = (large.duration_device - small.duration_device) / (large.samples - small.samples);
+    if ( device_cost > 0.0 ) {
+        double device_overhead = small.duration_device - small.samples * device_cost;
+        double device_transform = device_cost * 1e9 - large.raw_size / large.samples * model->transfer;
+        model->device_transform = device_transform > 0.0 ? device_transform : 0.0;
+        device_overhead = device_overhead * 1e6 - model->device_huffman_overhead;
+        model->device_overhead = device_overhead > 0.0 ? device_overhead : 0.0;
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_SAMPLING_H
+#define GPUJPEG_SAMPLING_H
+
+#include <libgpujpeg/gpujpeg_type.h>
+
+/**
+ * Sampling filter functions are usable in both device and host code
+ * (host implementation is in gpujpeg_sampling_cpu.h)
+ */
+#ifdef __CUDACC__
+#define GPUJPEG_SAMPLING_FUNC __host__ __device__
+#else
+#define GPUJPEG_SAMPLING_FUNC
+#endif
+
+/** Maximum supported ratio of component sampling factors in one dimension */
+#define GPUJPEG_SAMPLING_MAX_FACTOR 4
+
+/** Maximum number of filter taps in one dimension */
+#define GPUJPEG_SAMPLING_MAX_TAPS (2 * GPUJPEG_SAMPLING_MAX_FACTOR)
+
+/**
+ * Filter taps for one target sample in one dimension, source samples
+ * [first, first + count) are weighted by integer weights whose sum is norm
+ */
+struct gpujpeg_sampling_taps
+{
+    int first;
+    int count;
+    int weight[GPUJPEG_SAMPLING_MAX_TAPS];
+    int norm;
+};
+
+/**
+ * Get filter taps for downsampling (target sample covers factor source samples)
+ *
+ * @param filter  Sampling filter
+ * @param factor  Sampling factor ratio
+ * @param index  Target sample index
+ * @param taps  Output taps
+ */
+inline GPUJPEG_SAMPLING_FUNC void
+gpujpeg_sampling_downsample_taps(enum gpujpeg_sampling_filter filter, int factor, int index, struct gpujpeg_sampling_taps & taps)
+{
+    if ( filter == GPUJPEG_SAMPLING_FILTER_TRIANGLE ) {
+        // Weight is (2 * factor - |2 * distance|) where distance of sample centers is in source samples
+        taps.first = factor * index - factor / 2;
+        taps.count = 2 * factor;
+        taps.norm = 0;
+        for ( int k = 0; k < taps.count; k++ ) {
+            int distance = 2 * (k - factor / 2) - (factor - 1);
+            taps.weight[k] = 2 * factor - (distance >= 0 ? distance : -distance);
+            taps.norm += taps.weight[k];
+        }
+    } else {
+        taps.first = factor * index;
+        taps.count = (filter == GPUJPEG_SAMPLING_FILTER_BOX) ? factor : 1;
+        for ( int k = 0; k < taps.count; k++ ) {
+            taps.weight[k] = 1;
+        }
+        taps.norm = taps.count;
+    }
+}
+
+/**
+ * Get filter taps for upsampling (source sample covers factor target samples)
+ *
+ * @param filter  Sampling filter
+ * @param factor  Sampling factor ratio
+ * @param index  Target sample index
+ * @param taps  Output taps
+ */
+inline GPUJPEG_SAMPLING_FUNC void
+gpujpeg_sampling_upsample_taps(enum gpujpeg_sampling_filter filter, int factor, int index, struct gpujpeg_sampling_taps & taps)
+{
+    if ( filter == GPUJPEG_SAMPLING_FILTER_TRIANGLE ) {
+        // Position of target sample center in source samples multiplied by (2 * factor)
+        int position = 2 * index + 1 - factor;
+        int first = (position >= 0) ? position / (2 * factor) : -((2 * factor - 1 - position) / (2 * factor));
+        int fraction = position - first * 2 * factor;
+        taps.first = first;
+        taps.count = 2;
+        taps.weight[0] = 2 * factor - fraction;
+        taps.weight[1] = fraction;
+        taps.norm = 2 * factor;
+    } else {
+        taps.first = index / factor;
+        taps.count = 1;
+        taps.weight[0] = 1;
+        taps.norm = 1;
+    }
+}
+
+/**
+ * Compute one target sample from source plane, source samples outside
+ * the plane are replaced by the nearest edge sample
+ *
+ * @param source  Source plane
+ * @param width  Source plane width
+ * @param height  Source plane height
+ * @param pitch  Source plane row pitch
+ * @param taps_h  Horizontal taps
+ * @param taps_v  Vertical taps
+ * @return target sample
+ */
+inline GPUJPEG_SAMPLING_FUNC uint8_t
+gpujpeg_sampling_filter_sample(const uint8_t* source, int width, int height, int pitch,
+                               const struct gpujpeg_sampling_taps & taps_h, const struct gpujpeg_sampling_taps & taps_v)
+{
+    int sum = 0;
+    for ( int j = 0; j < taps_v.count; j++ ) {
+        int y = taps_v.first + j;
+        y = (y < 0) ? 0 : ((y >= height) ? height - 1 : y);
+        int row = 0;
+        for ( int i = 0; i < taps_h.count; i++ ) {
+            int x = taps_h.first + i;
+            x = (x < 0) ? 0 : ((x >= width) ? width - 1 : x);
+            row += taps_h.weight[i] * source[y * pitch + x];
+        }
+        sum += taps_v.weight[j] * row;
+    }
+    int norm = taps_h.norm * taps_v.norm;
+    return (uint8_t)((sum + norm / 2) / norm);
+}
+
+#endif // GPUJPEG_SAMPLING_H
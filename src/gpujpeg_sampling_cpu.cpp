@@ -0,0 +1,320 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gpujpeg_sampling_cpu.h"
+#include "gpujpeg_sampling.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GPUJPEG_SAMPLING_CPU_SSE2
+#include <emmintrin.h>
+#endif
+
+/** Number of replicated edge samples on both sides of intermediate row */
+#define GPUJPEG_SAMPLING_CPU_PADDING 32
+
+/**
+ * Horizontal filter pattern, taps of target sample x are taps[x % period]
+ * moved by (x / period) * step source samples
+ */
+struct gpujpeg_sampling_cpu_pattern
+{
+    struct gpujpeg_sampling_taps taps[GPUJPEG_SAMPLING_MAX_FACTOR];
+    int period;
+    int step;
+};
+
+/**
+ * Get source row of vertical tap clamped to plane
+ */
+static inline int
+gpujpeg_sampling_cpu_tap_row(const struct gpujpeg_sampling_taps & taps, int index, int height)
+{
+    int y = taps.first + index;
+    return (y < 0) ? 0 : ((y >= height) ? height - 1 : y);
+}
+
+/**
+ * Vertical pass, compute weighted sum of source rows to intermediate row and
+ * replicate its edge samples to padding (source points to plane row source_first)
+ */
+static void
+gpujpeg_sampling_cpu_vertical(const uint8_t* source, int width, int height, int pitch, int source_first,
+                              const struct gpujpeg_sampling_taps & taps, int16_t* row)
+{
+    const uint8_t* rows[GPUJPEG_SAMPLING_MAX_TAPS];
+    for ( int j = 0; j < taps.count; j++ ) {
+        rows[j] = &source[(size_t)(gpujpeg_sampling_cpu_tap_row(taps, j, height) - source_first) * pitch];
+    }
+
+    int x = 0;
+#ifdef GPUJPEG_SAMPLING_CPU_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for ( ; x + 16 <= width; x += 16 ) {
+        __m128i lo = zero;
+        __m128i hi = zero;
+        for ( int j = 0; j < taps.count; j++ ) {
+            __m128i sample = _mm_loadu_si128((const __m128i*)&rows[j][x]);
+            __m128i weight = _mm_set1_epi16((short)taps.weight[j]);
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(sample, zero), weight));
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(sample, zero), weight));
+        }
+        _mm_storeu_si128((__m128i*)&row[x], lo);
+        _mm_storeu_si128((__m128i*)&row[x + 8], hi);
+    }
+#endif
+    for ( ; x < width; x++ ) {
+        int sum = 0;
+        for ( int j = 0; j < taps.count; j++ ) {
+            sum += taps.weight[j] * rows[j][x];
+        }
+        row[x] = (int16_t)sum;
+    }
+
+    for ( int i = 1; i <= GPUJPEG_SAMPLING_CPU_PADDING; i++ ) {
+        row[-i] = row[0];
+        row[width - 1 + i] = row[width - 1];
+    }
+}
+
+#ifdef GPUJPEG_SAMPLING_CPU_SSE2
+
+/**
+ * Compute 8 target samples from two taps (w0 * s[i] + w1 * s[i + 1]) with rounding
+ *
+ * @return 8 target samples as 16-bit integers
+ */
+static inline __m128i
+gpujpeg_sampling_cpu_sse2_taps2(const int16_t* sample, const struct gpujpeg_sampling_taps & taps, __m128i round, int shift)
+{
+    __m128i sum = _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)sample), _mm_set1_epi16((short)taps.weight[0]));
+    if ( taps.count > 1 ) {
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(sample + 1)), _mm_set1_epi16((short)taps.weight[1])));
+    }
+    return _mm_srai_epi16(_mm_add_epi16(sum, round), shift);
+}
+
+/**
+ * Horizontal pass by SSE2 code for sampling factor ratio 1 or 2 and norm which is power of two
+ *
+ * @return number of computed target samples
+ */
+static int
+gpujpeg_sampling_cpu_horizontal_sse2(const int16_t* row, const struct gpujpeg_sampling_cpu_pattern & pattern, int norm,
+                                     uint8_t* target, int width)
+{
+    int shift = 0;
+    while ( (1 << shift) < norm ) {
+        shift++;
+    }
+
+    int x = 0;
+    if ( pattern.period == 1 && pattern.step == 2 && pattern.taps[0].count <= 4 ) {
+        // Downsampling by 2, pairs of source samples are weighted by one multiply-add
+        const struct gpujpeg_sampling_taps & taps = pattern.taps[0];
+        int weight[4] = { 0, 0, 0, 0 };
+        for ( int k = 0; k < taps.count; k++ ) {
+            weight[k] = taps.weight[k];
+        }
+        const __m128i weight01 = _mm_set1_epi32((int)(((uint32_t)(uint16_t)weight[1] << 16) | (uint16_t)weight[0]));
+        const __m128i weight23 = _mm_set1_epi32((int)(((uint32_t)(uint16_t)weight[3] << 16) | (uint16_t)weight[2]));
+        const __m128i round = _mm_set1_epi32(norm / 2);
+        for ( ; x + 8 <= width; x += 8 ) {
+            const int16_t* sample = &row[taps.first + 2 * x];
+            __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((const __m128i*)sample), weight01),
+                                       _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(sample + 2)), weight23));
+            __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((const __m128i*)(sample + 8)), weight01),
+                                       _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(sample + 10)), weight23));
+            lo = _mm_srai_epi32(_mm_add_epi32(lo, round), shift);
+            hi = _mm_srai_epi32(_mm_add_epi32(hi, round), shift);
+            __m128i value = _mm_packs_epi32(lo, hi);
+            _mm_storel_epi64((__m128i*)&target[x], _mm_packus_epi16(value, value));
+        }
+    } else if ( pattern.period == 1 && pattern.step == 1 && pattern.taps[0].count <= 2 ) {
+        // Sampling factor ratio 1
+        const struct gpujpeg_sampling_taps & taps = pattern.taps[0];
+        const __m128i round = _mm_set1_epi16((short)(norm / 2));
+        for ( ; x + 8 <= width; x += 8 ) {
+            __m128i value = gpujpeg_sampling_cpu_sse2_taps2(&row[taps.first + x], taps, round, shift);
+            _mm_storel_epi64((__m128i*)&target[x], _mm_packus_epi16(value, value));
+        }
+    } else if ( pattern.period == 2 && pattern.step == 1 && pattern.taps[0].count <= 2 && pattern.taps[1].count <= 2 ) {
+        // Upsampling by 2, even and odd target samples are computed separately and interleaved
+        const struct gpujpeg_sampling_taps & taps_even = pattern.taps[0];
+        const struct gpujpeg_sampling_taps & taps_odd = pattern.taps[1];
+        const __m128i round = _mm_set1_epi16((short)(norm / 2));
+        for ( ; x + 16 <= width; x += 16 ) {
+            __m128i even = gpujpeg_sampling_cpu_sse2_taps2(&row[taps_even.first + x / 2], taps_even, round, shift);
+            __m128i odd = gpujpeg_sampling_cpu_sse2_taps2(&row[taps_odd.first + x / 2], taps_odd, round, shift);
+            __m128i value = _mm_packus_epi16(_mm_unpacklo_epi16(even, odd), _mm_unpackhi_epi16(even, odd));
+            _mm_storeu_si128((__m128i*)&target[x], value);
+        }
+    }
+    return x;
+}
+
+#endif // GPUJPEG_SAMPLING_CPU_SSE2
+
+/**
+ * Horizontal pass, compute target row from intermediate row
+ */
+static void
+gpujpeg_sampling_cpu_horizontal(const int16_t* row, const struct gpujpeg_sampling_cpu_pattern & pattern, int norm,
+                                uint8_t* target, int width)
+{
+    int x = 0;
+#ifdef GPUJPEG_SAMPLING_CPU_SSE2
+    if ( (norm & (norm - 1)) == 0 ) {
+        x = gpujpeg_sampling_cpu_horizontal_sse2(row, pattern, norm, target, width);
+    }
+#endif
+    for ( ; x < width; x++ ) {
+        const struct gpujpeg_sampling_taps & taps = pattern.taps[x % pattern.period];
+        const int16_t* sample = &row[taps.first + (x / pattern.period) * pattern.step];
+        int sum = 0;
+        for ( int k = 0; k < taps.count; k++ ) {
+            sum += taps.weight[k] * sample[k];
+        }
+        target[x] = (uint8_t)((sum + norm / 2) / norm);
+    }
+}
+
+/**
+ * Resample band of component plane rows by separable filter (vertical pass to
+ * intermediate row followed by horizontal pass)
+ *
+ * @param upsample  Perform upsampling, otherwise downsampling
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_sampling_cpu_resample(int upsample, enum gpujpeg_sampling_filter filter, int factor_h, int factor_v,
+                              const uint8_t* source, int source_width, int source_height, int source_pitch,
+                              int source_first, int source_count,
+                              uint8_t* target, int target_width, int target_height, int target_pitch,
+                              int target_first, int target_count)
+{
+    if ( factor_h < 1 || factor_h > GPUJPEG_SAMPLING_MAX_FACTOR || factor_v < 1 || factor_v > GPUJPEG_SAMPLING_MAX_FACTOR ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Sampling factor ratio %dx%d is not supported!\n", factor_h, factor_v);
+        return -1;
+    }
+    // Taps of all target samples must lie within intermediate row including its padding
+    int max_width = upsample ? source_width * factor_h : (source_width + factor_h - 1) / factor_h;
+    int max_height = upsample ? source_height * factor_v : (source_height + factor_v - 1) / factor_v;
+    if ( source_width <= 0 || source_height <= 0 || target_width > max_width || target_height > max_height ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Sampling from %dx%d to %dx%d plane doesn't match sampling factor ratio %dx%d!\n",
+            source_width, source_height, target_width, target_height, factor_h, factor_v);
+        return -1;
+    }
+    if ( target_first < 0 || target_count < 0 || target_first + target_count > target_height ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Sampling target rows %d-%d are out of plane with %d rows!\n",
+            target_first, target_first + target_count, target_height);
+        return -1;
+    }
+
+    // Source band must contain all rows covered by taps of target band
+    for ( int y = target_first; y < target_first + target_count; y++ ) {
+        struct gpujpeg_sampling_taps taps_v;
+        if ( upsample )
+            gpujpeg_sampling_upsample_taps(filter, factor_v, y, taps_v);
+        else
+            gpujpeg_sampling_downsample_taps(filter, factor_v, y, taps_v);
+        for ( int j = 0; j < taps_v.count; j++ ) {
+            int row = gpujpeg_sampling_cpu_tap_row(taps_v, j, source_height);
+            if ( row < source_first || row >= source_first + source_count ) {
+                fprintf(stderr, "[GPUJPEG] [Error] Sampling source rows %d-%d don't cover target row %d!\n",
+                    source_first, source_first + source_count, y);
+                return -1;
+            }
+        }
+    }
+
+    struct gpujpeg_sampling_cpu_pattern pattern;
+    pattern.period = upsample ? factor_h : 1;
+    pattern.step = upsample ? 1 : factor_h;
+    for ( int index = 0; index < pattern.period; index++ ) {
+        if ( upsample )
+            gpujpeg_sampling_upsample_taps(filter, factor_h, index, pattern.taps[index]);
+        else
+            gpujpeg_sampling_downsample_taps(filter, factor_h, index, pattern.taps[index]);
+    }
+
+    int16_t* buffer = (int16_t*)malloc((source_width + 2 * GPUJPEG_SAMPLING_CPU_PADDING) * sizeof(int16_t));
+    if ( buffer == NULL ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate sampling buffer!\n");
+        return -1;
+    }
+    int16_t* row = buffer + GPUJPEG_SAMPLING_CPU_PADDING;
+    for ( int y = target_first; y < target_first + target_count; y++ ) {
+        struct gpujpeg_sampling_taps taps_v;
+        if ( upsample )
+            gpujpeg_sampling_upsample_taps(filter, factor_v, y, taps_v);
+        else
+            gpujpeg_sampling_downsample_taps(filter, factor_v, y, taps_v);
+        gpujpeg_sampling_cpu_vertical(source, source_width, source_height, source_pitch, source_first, taps_v, row);
+        gpujpeg_sampling_cpu_horizontal(row, pattern, pattern.taps[0].norm * taps_v.norm,
+                                        &target[(size_t)(y - target_first) * target_pitch], target_width);
+    }
+    free(buffer);
+
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_sampling_cpu_downsample(enum gpujpeg_sampling_filter filter, int factor_h, int factor_v,
+                                const uint8_t* source, int source_width, int source_height, int source_pitch,
+                                uint8_t* target, int target_width, int target_height, int target_pitch)
+{
+    return gpujpeg_sampling_cpu_resample(0, filter, factor_h, factor_v, source, source_width, source_height, source_pitch,
+                                         0, source_height, target, target_width, target_height, target_pitch, 0, target_height);
+}
+
+/** Documented at declaration */
+int
+gpujpeg_sampling_cpu_downsample_rows(enum gpujpeg_sampling_filter filter, int factor_h, int factor_v,
+                                     const uint8_t* source, int source_width, int source_height, int source_pitch,
+                                     int source_first, int source_count,
+                                     uint8_t* target, int target_width, int target_height, int target_pitch,
+                                     int target_first, int target_count)
+{
+    return gpujpeg_sampling_cpu_resample(0, filter, factor_h, factor_v, source, source_width, source_height, source_pitch,
+                                         source_first, source_count, target, target_width, target_height, target_pitch,
+                                         target_first, target_count);
+}
+
+/** Documented at declaration */
+int
+gpujpeg_sampling_cpu_upsample(enum gpujpeg_sampling_filter filter, int factor_h, int factor_v,
+                              const uint8_t* source, int source_width, int source_height, int source_pitch,
+                              uint8_t* target, int target_width, int target_height, int target_pitch)
+{
+    return gpujpeg_sampling_cpu_resample(1, filter, factor_h, factor_v, source, source_width, source_height, source_pitch,
+                                         0, source_height, target, target_width, target_height, target_pitch, 0, target_height);
+}
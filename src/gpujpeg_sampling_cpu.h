@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_SAMPLING_CPU_H
+#define GPUJPEG_SAMPLING_CPU_H
+
+#include <libgpujpeg/gpujpeg_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Downsample component plane on CPU. Results are identical with downsampling
+ * performed by preprocessor (the same filter taps from gpujpeg_sampling.h are
+ * used), SSE2 code is used for sampling factor ratios 1 and 2 (4:2:0, 4:2:2, 4:4:0).
+ *
+ * @param filter  Sampling filter
+ * @param factor_h  Horizontal ratio of sampling factors (1 to GPUJPEG_SAMPLING_MAX_FACTOR)
+ * @param factor_v  Vertical ratio of sampling factors (1 to GPUJPEG_SAMPLING_MAX_FACTOR)
+ * @param source  Full resolution source plane
+ * @param source_width  Source plane width
+ * @param source_height  Source plane height
+ * @param source_pitch  Source plane row pitch
+ * @param target  Subsampled target plane
+ * @param target_width  Target plane width (usually source width divided by factor and rounded up)
+ * @param target_height  Target plane height
+ * @param target_pitch  Target plane row pitch
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_sampling_cpu_downsample(enum gpujpeg_sampling_filter filter, int factor_h, int factor_v,
+                                const uint8_t* source, int source_width, int source_height, int source_pitch,
+                                uint8_t* target, int target_width, int target_height, int target_pitch);
+
+/**
+ * Downsample band of rows of component plane on CPU, target rows are identical
+ * with rows produced by gpujpeg_sampling_cpu_downsample for whole plane. Only
+ * source rows covered by filter taps of the band have to be present (with
+ * triangle filter the band of factor_v * target_count rows is extended by
+ * factor_v / 2 rows above and factor_v - factor_v / 2 rows below, clamped to plane).
+ *
+ * @param source  First present row of full resolution source plane
+ * @param source_width  Source plane width
+ * @param source_height  Source plane height (whole plane)
+ * @param source_pitch  Source plane row pitch
+ * @param source_first  Index of first present source row
+ * @param source_count  Number of present source rows
+ * @param target  First row of target band
+ * @param target_width  Target plane width
+ * @param target_height  Target plane height (whole plane)
+ * @param target_pitch  Target plane row pitch
+ * @param target_first  Index of first target row of the band
+ * @param target_count  Number of target rows of the band
+ * @return 0 if succeeds, otherwise nonzero (also when source rows don't cover the band)
+ */
+int
+gpujpeg_sampling_cpu_downsample_rows(enum gpujpeg_sampling_filter filter, int factor_h, int factor_v,
+                                     const uint8_t* source, int source_width, int source_height, int source_pitch,
+                                     int source_first, int source_count,
+                                     uint8_t* target, int target_width, int target_height, int target_pitch,
+                                     int target_first, int target_count);
+
+/**
+ * Upsample component plane on CPU. Results are identical with upsampling
+ * performed by postprocessor.
+ *
+ * @param filter  Sampling filter
+ * @param factor_h  Horizontal ratio of sampling factors (1 to GPUJPEG_SAMPLING_MAX_FACTOR)
+ * @param factor_v  Vertical ratio of sampling factors (1 to GPUJPEG_SAMPLING_MAX_FACTOR)
+ * @param source  Subsampled source plane
+ * @param source_width  Source plane width
+ * @param source_height  Source plane height
+ * @param source_pitch  Source plane row pitch
+ * @param target  Full resolution target plane
+ * @param target_width  Target plane width (at most source width multiplied by factor)
+ * @param target_height  Target plane height
+ * @param target_pitch  Target plane row pitch
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_sampling_cpu_upsample(enum gpujpeg_sampling_filter filter, int factor_h, int factor_v,
+                              const uint8_t* source, int source_width, int source_height, int source_pitch,
+                              uint8_t* target, int target_width, int target_height, int target_pitch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_SAMPLING_CPU_H
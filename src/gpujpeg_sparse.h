@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_SPARSE_H
+#define GPUJPEG_SPARSE_H
+
+#include <libgpujpeg/gpujpeg_common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Sparse coefficients store quantized coefficients of 8x8 blocks (64 consecutive
+ * values in coder->data_quantized layout) as 64-bit nonzero mask of each block
+ * (bit i is set for nonzero coefficient i) and nonzero values packed in block
+ * and coefficient order. Transfers of coefficients between host and device
+ * memory use them, because most of quantized coefficients are zero.
+ */
+
+/** Minimal number of blocks transferred as sparse coefficients (smaller buffers are transferred whole) */
+#define GPUJPEG_SPARSE_MIN_BLOCK_COUNT 4096
+
+/**
+ * Pack coefficients of blocks to sparse coefficients on CPU
+ *
+ * @param data  Coefficients of blocks
+ * @param block_count  Number of blocks
+ * @param mask  Nonzero mask of each block
+ * @param value  Packed nonzero values (must hold all coefficients of blocks)
+ * @return number of packed nonzero values
+ */
+size_t
+gpujpeg_sparse_pack(const int16_t* data, int block_count, uint64_t* mask, int16_t* value);
+
+/**
+ * Count packed nonzero values of sparse coefficients on CPU
+ *
+ * @param mask  Nonzero mask of each block
+ * @param block_count  Number of blocks
+ * @return number of packed nonzero values
+ */
+size_t
+gpujpeg_sparse_count(const uint64_t* mask, int block_count);
+
+/**
+ * Unpack sparse coefficients to coefficients of blocks on CPU
+ *
+ * @param mask  Nonzero mask of each block
+ * @param value  Packed nonzero values
+ * @param block_count  Number of blocks
+ * @param data  Coefficients of blocks
+ */
+void
+gpujpeg_sparse_unpack(const uint64_t* mask, const int16_t* value, int block_count, int16_t* data);
+
+/**
+ * Copy quantized coefficients from device memory to host memory (coder->d_data_quantized
+ * to coder->data_quantized), large buffers are packed on GPU and transferred as
+ * sparse coefficients (except by host runtime). The stream is synchronized.
+ *
+ * @param coder  Coder structure
+ * @param block_begin  Index of the first copied block
+ * @param block_count  Number of copied blocks
+ * @param stream  CUDA stream
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_sparse_download(struct gpujpeg_coder* coder, int block_begin, int block_count, cudaStream_t stream);
+
+/**
+ * Copy quantized coefficients from host memory to device memory (coder->data_quantized
+ * to coder->d_data_quantized), large buffers are packed on CPU, transferred as
+ * sparse coefficients and unpacked on GPU (except by host runtime). Copy is asynchronous, disjoint block
+ * ranges of the same image can be uploaded by consecutive calls.
+ *
+ * @param coder  Coder structure
+ * @param block_begin  Index of the first copied block
+ * @param block_count  Number of copied blocks
+ * @param stream  CUDA stream
+ * @return 0 if succeeds, otherwise nonzero
+ */
+int
+gpujpeg_sparse_upload(struct gpujpeg_coder* coder, int block_begin, int block_count, cudaStream_t stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_SPARSE_H
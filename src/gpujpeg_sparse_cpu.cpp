@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gpujpeg_sparse.h"
+
+/**
+ * Count set bits of mask
+ *
+ * @param mask  Mask
+ * @return number of set bits
+ */
+static inline int
+gpujpeg_sparse_popcount(uint64_t mask)
+{
+    mask = mask - ((mask >> 1) & 0x5555555555555555ULL);
+    mask = (mask & 0x3333333333333333ULL) + ((mask >> 2) & 0x3333333333333333ULL);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((mask * 0x0101010101010101ULL) >> 56);
+}
+
+/** Documented at declaration */
+size_t
+gpujpeg_sparse_pack(const int16_t* data, int block_count, uint64_t* mask, int16_t* value)
+{
+    size_t value_count = 0;
+    for ( int block = 0; block < block_count; block++ ) {
+        uint64_t block_mask = 0;
+        for ( int index = 0; index < 64; index++ ) {
+            int16_t coefficient = data[index];
+            // Value is stored always and overwritten by the next one when it is zero
+            value[value_count] = coefficient;
+            value_count += (coefficient != 0);
+            block_mask |= (uint64_t)(coefficient != 0) << index;
+        }
+        mask[block] = block_mask;
+        data += 64;
+    }
+    return value_count;
+}
+
+/** Documented at declaration */
+size_t
+gpujpeg_sparse_count(const uint64_t* mask, int block_count)
+{
+    size_t value_count = 0;
+    for ( int block = 0; block < block_count; block++ ) {
+        value_count += gpujpeg_sparse_popcount(mask[block]);
+    }
+    return value_count;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_sparse_unpack(const uint64_t* mask, const int16_t* value, int block_count, int16_t* data)
+{
+    for ( int block = 0; block < block_count; block++ ) {
+        uint64_t block_mask = mask[block];
+        for ( int index = 0; index < 64; index++ ) {
+            int nonzero = (int)((block_mask >> index) & 1);
+            data[index] = nonzero ? *value : 0;
+            value += nonzero;
+        }
+        data += 64;
+    }
+}
@@ -0,0 +1,353 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gpujpeg_sparse.h"
+#include "gpujpeg_device.h"
+#include <libgpujpeg/gpujpeg_util.h>
+
+/** Number of blocks processed by one thread block (one block per thread) */
+#define GPUJPEG_SPARSE_THREAD_BLOCK_SIZE 256
+
+/**
+ * Exclusive prefix sum of values of threads in thread block
+ *
+ * @param value  Value of current thread
+ * @param shared  Shared memory of GPUJPEG_SPARSE_THREAD_BLOCK_SIZE values
+ * @param total  Sum of values of all threads
+ * @return sum of values of preceding threads
+ */
+__device__ static unsigned int
+gpujpeg_sparse_scan(unsigned int value, unsigned int* shared, unsigned int & total)
+{
+    shared[threadIdx.x] = value;
+    __syncthreads();
+    for ( int offset = 1; offset < GPUJPEG_SPARSE_THREAD_BLOCK_SIZE; offset *= 2 ) {
+        unsigned int preceding = threadIdx.x >= offset ? shared[threadIdx.x - offset] : 0;
+        __syncthreads();
+        shared[threadIdx.x] += preceding;
+        __syncthreads();
+    }
+    total = shared[GPUJPEG_SPARSE_THREAD_BLOCK_SIZE - 1];
+    return shared[threadIdx.x] - value;
+}
+
+/**
+ * Compute offsets of packed values of blocks within thread block chunks (and
+ * nonzero masks of blocks when they are packed)
+ *
+ * @param data  Coefficients of blocks (NULL when masks are given)
+ * @param mask  Nonzero mask of each block (output when data is given)
+ * @param offset  Offset of packed values of each block in chunk
+ * @param chunk_offset  Number of packed values of each chunk
+ * @param block_count  Number of blocks
+ */
+__global__ static void
+gpujpeg_sparse_offset_kernel(const int16_t* data, uint64_t* mask, unsigned int* offset, unsigned int* chunk_offset, int block_count)
+{
+    __shared__ unsigned int shared[GPUJPEG_SPARSE_THREAD_BLOCK_SIZE];
+
+    const int block = blockIdx.x * GPUJPEG_SPARSE_THREAD_BLOCK_SIZE + threadIdx.x;
+    uint64_t block_mask = 0;
+    if ( block < block_count ) {
+        if ( data != NULL ) {
+            const int4* block_data = (const int4*)&data[block * 64];
+            for ( int index = 0; index < 8; index++ ) {
+                const int4 packed = block_data[index];
+                const int words[4] = { packed.x, packed.y, packed.z, packed.w };
+                for ( int word = 0; word < 4; word++ ) {
+                    block_mask |= (uint64_t)((words[word] & 0xFFFF) != 0) << (index * 8 + word * 2);
+                    block_mask |= (uint64_t)((words[word] >> 16) != 0) << (index * 8 + word * 2 + 1);
+                }
+            }
+            mask[block] = block_mask;
+        }
+        else {
+            block_mask = mask[block];
+        }
+    }
+
+    unsigned int total;
+    const unsigned int block_offset = gpujpeg_sparse_scan(__popcll(block_mask), shared, total);
+    if ( block < block_count ) {
+        offset[block] = block_offset;
+    }
+    if ( threadIdx.x == 0 ) {
+        chunk_offset[blockIdx.x] = total;
+    }
+}
+
+/**
+ * Exclusive prefix sum of numbers of packed values of chunks (by one thread block)
+ *
+ * @param chunk_offset  Number of packed values of each chunk, replaced by its offset
+ * @param chunk_count  Number of chunks
+ */
+__global__ static void
+gpujpeg_sparse_chunk_offset_kernel(unsigned int* chunk_offset, int chunk_count)
+{
+    __shared__ unsigned int shared[GPUJPEG_SPARSE_THREAD_BLOCK_SIZE];
+
+    unsigned int carry = 0;
+    for ( int begin = 0; begin < chunk_count; begin += GPUJPEG_SPARSE_THREAD_BLOCK_SIZE ) {
+        const int chunk = begin + threadIdx.x;
+        const unsigned int value = chunk < chunk_count ? chunk_offset[chunk] : 0;
+        unsigned int total;
+        const unsigned int preceding = gpujpeg_sparse_scan(value, shared, total);
+        if ( chunk < chunk_count ) {
+            chunk_offset[chunk] = carry + preceding;
+        }
+        carry += total;
+        __syncthreads();
+    }
+}
+
+/**
+ * Pack nonzero coefficients of blocks to packed values
+ *
+ * @param data  Coefficients of blocks
+ * @param mask  Nonzero mask of each block
+ * @param offset  Offset of packed values of each block in chunk
+ * @param chunk_offset  Offset of packed values of each chunk
+ * @param value  Packed nonzero values
+ * @param block_count  Number of blocks
+ */
+__global__ static void
+gpujpeg_sparse_pack_kernel(const int16_t* data, const uint64_t* mask, const unsigned int* offset, const unsigned int* chunk_offset,
+                           int16_t* value, int block_count)
+{
+    const int block = blockIdx.x * GPUJPEG_SPARSE_THREAD_BLOCK_SIZE + threadIdx.x;
+    if ( block >= block_count ) {
+        return;
+    }
+    uint64_t block_mask = mask[block];
+    int16_t* block_value = &value[chunk_offset[blockIdx.x] + offset[block]];
+    const int16_t* block_data = &data[block * 64];
+    while ( block_mask != 0 ) {
+        const int index = __ffsll((long long)block_mask) - 1;
+        *block_value++ = block_data[index];
+        block_mask &= block_mask - 1;
+    }
+}
+
+/**
+ * Unpack packed values to coefficients of blocks
+ *
+ * @param value  Packed nonzero values
+ * @param mask  Nonzero mask of each block
+ * @param offset  Offset of packed values of each block in chunk
+ * @param chunk_offset  Offset of packed values of each chunk
+ * @param data  Coefficients of blocks
+ * @param block_count  Number of blocks
+ */
+__global__ static void
+gpujpeg_sparse_unpack_kernel(const int16_t* value, const uint64_t* mask, const unsigned int* offset, const unsigned int* chunk_offset,
+                             int16_t* data, int block_count)
+{
+    const int block = blockIdx.x * GPUJPEG_SPARSE_THREAD_BLOCK_SIZE + threadIdx.x;
+    if ( block >= block_count ) {
+        return;
+    }
+    const uint64_t block_mask = mask[block];
+    const int16_t* block_value = &value[chunk_offset[blockIdx.x] + offset[block]];
+    int4* block_data = (int4*)&data[block * 64];
+    for ( int index = 0; index < 8; index++ ) {
+        unsigned int words[4];
+        for ( int word = 0; word < 4; word++ ) {
+            const int coefficient = index * 8 + word * 2;
+            unsigned int low = 0;
+            unsigned int high = 0;
+            if ( (block_mask >> coefficient) & 1 )
+                low = (uint16_t)*block_value++;
+            if ( (block_mask >> (coefficient + 1)) & 1 )
+                high = (uint16_t)*block_value++;
+            words[word] = low | (high << 16);
+        }
+        block_data[index] = make_int4((int)words[0], (int)words[1], (int)words[2], (int)words[3]);
+    }
+}
+
+/**
+ * Allocate sparse coefficient buffers of coder for all blocks of the image
+ * (buffers are indexed by block index, so disjoint block ranges don't overlap)
+ *
+ * @param coder  Coder structure
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_sparse_allocate(struct gpujpeg_coder* coder)
+{
+    const int block_count = coder->data_size / GPUJPEG_BLOCK_SQUARED_SIZE;
+    if ( block_count <= coder->data_sparse_allocated_count ) {
+        return 0;
+    }
+    if ( coder->data_sparse_mask != NULL )
+        gpujpeg_device_free_host(coder->data_sparse_mask);
+    if ( coder->d_data_sparse_mask != NULL )
+        gpujpeg_device_free(coder->d_data_sparse_mask);
+    if ( coder->data_sparse_value != NULL )
+        gpujpeg_device_free_host(coder->data_sparse_value);
+    if ( coder->d_data_sparse_value != NULL )
+        gpujpeg_device_free(coder->d_data_sparse_value);
+    if ( coder->d_data_sparse_offset != NULL )
+        gpujpeg_device_free(coder->d_data_sparse_offset);
+    coder->data_sparse_allocated_count = 0;
+
+    // Offsets of blocks are followed by offsets of chunks, chunks of block range
+    // are stored at the index of its first block (there is less chunks than blocks)
+    gpujpeg_device_malloc_host((void**)&coder->data_sparse_mask, block_count * sizeof(uint64_t));
+    gpujpeg_device_malloc((void**)&coder->d_data_sparse_mask, block_count * sizeof(uint64_t));
+    gpujpeg_device_malloc_host((void**)&coder->data_sparse_value, block_count * GPUJPEG_BLOCK_SQUARED_SIZE * sizeof(int16_t));
+    gpujpeg_device_malloc((void**)&coder->d_data_sparse_value, block_count * GPUJPEG_BLOCK_SQUARED_SIZE * sizeof(int16_t));
+    gpujpeg_device_malloc((void**)&coder->d_data_sparse_offset, 2 * block_count * sizeof(unsigned int));
+    gpujpeg_device_check_error("Sparse coefficients allocation", return -1);
+
+    coder->data_sparse_allocated_count = block_count;
+    return 0;
+}
+
+/**
+ * Compute offsets of packed values of block range on GPU
+ *
+ * @param coder  Coder structure
+ * @param pack  Pack coefficients of blocks from coder->d_data_quantized (otherwise masks are already in device memory)
+ * @param block_begin  Index of the first block
+ * @param block_count  Number of blocks
+ * @param stream  CUDA stream
+ * @return 0 if succeeds, otherwise nonzero
+ */
+static int
+gpujpeg_sparse_offset(struct gpujpeg_coder* coder, int pack, int block_begin, int block_count, cudaStream_t stream)
+{
+    const int chunk_count = gpujpeg_div_and_round_up(block_count, GPUJPEG_SPARSE_THREAD_BLOCK_SIZE);
+    gpujpeg_sparse_offset_kernel<<<chunk_count, GPUJPEG_SPARSE_THREAD_BLOCK_SIZE, 0, stream>>>(
+        pack ? coder->d_data_quantized + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE : NULL,
+        coder->d_data_sparse_mask + block_begin,
+        coder->d_data_sparse_offset + block_begin,
+        coder->d_data_sparse_offset + coder->data_sparse_allocated_count + block_begin,
+        block_count
+    );
+    gpujpeg_sparse_chunk_offset_kernel<<<1, GPUJPEG_SPARSE_THREAD_BLOCK_SIZE, 0, stream>>>(
+        coder->d_data_sparse_offset + coder->data_sparse_allocated_count + block_begin,
+        chunk_count
+    );
+    gpujpeg_device_check_error("Sparse coefficients offsets failed", return -1);
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_sparse_download(struct gpujpeg_coder* coder, int block_begin, int block_count, cudaStream_t stream)
+{
+    int16_t* data = coder->data_quantized + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE;
+    int16_t* d_data = coder->d_data_quantized + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE;
+    if ( block_count < GPUJPEG_SPARSE_MIN_BLOCK_COUNT || gpujpeg_device_get_runtime()->host ) {
+        gpujpeg_device_memcpy_async(data, d_data, block_count * GPUJPEG_BLOCK_SQUARED_SIZE * sizeof(int16_t), cudaMemcpyDeviceToHost, stream);
+        gpujpeg_device_stream_synchronize(stream);
+        gpujpeg_device_check_error("Coefficients copy from device failed", return -1);
+        coder->stats.download_size += block_count * GPUJPEG_BLOCK_SQUARED_SIZE * sizeof(int16_t);
+        return 0;
+    }
+    if ( gpujpeg_sparse_allocate(coder) != 0 ) {
+        return -1;
+    }
+    uint64_t* mask = coder->data_sparse_mask + block_begin;
+    int16_t* value = coder->data_sparse_value + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE;
+    int16_t* d_value = coder->d_data_sparse_value + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE;
+
+    // Pack on GPU
+    if ( gpujpeg_sparse_offset(coder, 1, block_begin, block_count, stream) != 0 ) {
+        return -1;
+    }
+    const int chunk_count = gpujpeg_div_and_round_up(block_count, GPUJPEG_SPARSE_THREAD_BLOCK_SIZE);
+    gpujpeg_sparse_pack_kernel<<<chunk_count, GPUJPEG_SPARSE_THREAD_BLOCK_SIZE, 0, stream>>>(
+        d_data,
+        coder->d_data_sparse_mask + block_begin,
+        coder->d_data_sparse_offset + block_begin,
+        coder->d_data_sparse_offset + coder->data_sparse_allocated_count + block_begin,
+        d_value,
+        block_count
+    );
+    gpujpeg_device_check_error("Sparse coefficients pack failed", return -1);
+
+    // Masks determine number of packed values to be copied
+    gpujpeg_device_memcpy_async(mask, coder->d_data_sparse_mask + block_begin, block_count * sizeof(uint64_t), cudaMemcpyDeviceToHost, stream);
+    gpujpeg_device_stream_synchronize(stream);
+    size_t value_count = gpujpeg_sparse_count(mask, block_count);
+    gpujpeg_device_memcpy_async(value, d_value, value_count * sizeof(int16_t), cudaMemcpyDeviceToHost, stream);
+    gpujpeg_device_stream_synchronize(stream);
+    gpujpeg_device_check_error("Sparse coefficients copy from device failed", return -1);
+    coder->stats.download_size += block_count * sizeof(uint64_t) + value_count * sizeof(int16_t);
+
+    // Unpack on CPU
+    gpujpeg_sparse_unpack(mask, value, block_count, data);
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_sparse_upload(struct gpujpeg_coder* coder, int block_begin, int block_count, cudaStream_t stream)
+{
+    const int16_t* data = coder->data_quantized + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE;
+    int16_t* d_data = coder->d_data_quantized + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE;
+    if ( block_count < GPUJPEG_SPARSE_MIN_BLOCK_COUNT || gpujpeg_device_get_runtime()->host ) {
+        gpujpeg_device_memcpy_async(d_data, data, block_count * GPUJPEG_BLOCK_SQUARED_SIZE * sizeof(int16_t), cudaMemcpyHostToDevice, stream);
+        gpujpeg_device_check_error("Coefficients copy to device failed", return -1);
+        coder->stats.upload_size += block_count * GPUJPEG_BLOCK_SQUARED_SIZE * sizeof(int16_t);
+        return 0;
+    }
+    if ( gpujpeg_sparse_allocate(coder) != 0 ) {
+        return -1;
+    }
+    uint64_t* mask = coder->data_sparse_mask + block_begin;
+    int16_t* value = coder->data_sparse_value + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE;
+    int16_t* d_value = coder->d_data_sparse_value + block_begin * GPUJPEG_BLOCK_SQUARED_SIZE;
+
+    // Pack on CPU
+    size_t value_count = gpujpeg_sparse_pack(data, block_count, mask, value);
+    gpujpeg_device_memcpy_async(coder->d_data_sparse_mask + block_begin, mask, block_count * sizeof(uint64_t), cudaMemcpyHostToDevice, stream);
+    gpujpeg_device_memcpy_async(d_value, value, value_count * sizeof(int16_t), cudaMemcpyHostToDevice, stream);
+    gpujpeg_device_check_error("Sparse coefficients copy to device failed", return -1);
+    coder->stats.upload_size += block_count * sizeof(uint64_t) + value_count * sizeof(int16_t);
+
+    // Unpack on GPU
+    if ( gpujpeg_sparse_offset(coder, 0, block_begin, block_count, stream) != 0 ) {
+        return -1;
+    }
+    const int chunk_count = gpujpeg_div_and_round_up(block_count, GPUJPEG_SPARSE_THREAD_BLOCK_SIZE);
+    gpujpeg_sparse_unpack_kernel<<<chunk_count, GPUJPEG_SPARSE_THREAD_BLOCK_SIZE, 0, stream>>>(
+        d_value,
+        coder->d_data_sparse_mask + block_begin,
+        coder->d_data_sparse_offset + block_begin,
+        coder->d_data_sparse_offset + coder->data_sparse_allocated_count + block_begin,
+        d_data,
+        block_count
+    );
+    gpujpeg_device_check_error("Sparse coefficients unpack failed", return -1);
+    return 0;
+}
@@ -0,0 +1,286 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <libgpujpeg/gpujpeg_stats_internal.h>
+#include "gpujpeg_device.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Documented at declaration */
+const char*
+gpujpeg_stats_stage_get_name(enum gpujpeg_stats_stage stage)
+{
+    switch ( stage ) {
+    case GPUJPEG_STATS_READER: return "reader";
+    case GPUJPEG_STATS_TABLES: return "tables";
+    case GPUJPEG_STATS_UPLOAD: return "upload";
+    case GPUJPEG_STATS_PREPROCESS: return "preprocess";
+    case GPUJPEG_STATS_DCT: return "dct";
+    case GPUJPEG_STATS_HUFFMAN: return "huffman";
+    case GPUJPEG_STATS_FORMATTER: return "formatter";
+    case GPUJPEG_STATS_DOWNLOAD: return "download";
+    case GPUJPEG_STATS_WAIT: return "wait";
+    case GPUJPEG_STATS_OPENGL: return "opengl";
+    default: return "unknown";
+    }
+}
+
+/**
+ * Get recorder of coder, create it when it doesn't exist
+ *
+ * @param coder  Coder structure
+ * @return recorder if succeeds, otherwise NULL
+ */
+static struct gpujpeg_stats_recorder*
+gpujpeg_stats_recorder_get(struct gpujpeg_coder* coder)
+{
+    if ( coder->stats_recorder == NULL ) {
+        coder->stats_recorder = (struct gpujpeg_stats_recorder*)calloc(1, sizeof(struct gpujpeg_stats_recorder));
+        if ( coder->stats_recorder == NULL ) {
+            fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate statistics recorder!\n");
+        }
+    }
+    return coder->stats_recorder;
+}
+
+/**
+ * Destroy recorder of coder when neither statistics nor trace need it
+ *
+ * @param coder  Coder structure
+ */
+static void
+gpujpeg_stats_recorder_release(struct gpujpeg_coder* coder)
+{
+    struct gpujpeg_stats_recorder* recorder = coder->stats_recorder;
+    if ( recorder == NULL || recorder->enabled || recorder->trace != NULL ) {
+        return;
+    }
+    for ( int index = 0; index < recorder->record_allocated_count; index++ ) {
+        gpujpeg_device_event_destroy(recorder->record[index].start);
+        gpujpeg_device_event_destroy(recorder->record[index].stop);
+    }
+    free(recorder);
+    coder->stats_recorder = NULL;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_stats_set_enabled(struct gpujpeg_coder* coder, int enabled)
+{
+    if ( enabled ) {
+        struct gpujpeg_stats_recorder* recorder = gpujpeg_stats_recorder_get(coder);
+        if ( recorder == NULL ) {
+            return -1;
+        }
+        recorder->enabled = 1;
+    }
+    else if ( coder->stats_recorder != NULL ) {
+        coder->stats_recorder->enabled = 0;
+        gpujpeg_stats_recorder_release(coder);
+    }
+    return 0;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_stats_set_trace(struct gpujpeg_coder* coder, struct gpujpeg_trace* trace, const char* name)
+{
+    if ( trace != NULL ) {
+        struct gpujpeg_stats_recorder* recorder = gpujpeg_stats_recorder_get(coder);
+        if ( recorder == NULL ) {
+            return -1;
+        }
+        if ( recorder->trace != trace ) {
+            recorder->trace = trace;
+            recorder->trace_process = gpujpeg_trace_add_process(trace, name);
+            recorder->trace_frame_count = 0;
+        }
+    }
+    else if ( coder->stats_recorder != NULL ) {
+        coder->stats_recorder->trace = NULL;
+        gpujpeg_stats_recorder_release(coder);
+    }
+    return 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_stats_deinit(struct gpujpeg_coder* coder)
+{
+    gpujpeg_stats_set_trace(coder, NULL, NULL);
+    gpujpeg_stats_set_enabled(coder, 0);
+}
+
+/** Documented at declaration */
+void
+gpujpeg_stats_begin(struct gpujpeg_coder* coder)
+{
+    memset(&coder->stats, 0, sizeof(struct gpujpeg_stats));
+
+    struct gpujpeg_stats_recorder* recorder = coder->stats_recorder;
+    if ( recorder == NULL ) {
+        return;
+    }
+    coder->stats.enabled = 1;
+    recorder->record_count = 0;
+    recorder->start = gpujpeg_get_time();
+}
+
+/** Documented at declaration */
+void
+gpujpeg_stats_end(struct gpujpeg_coder* coder)
+{
+    struct gpujpeg_stats_recorder* recorder = coder->stats_recorder;
+    if ( recorder == NULL ) {
+        return;
+    }
+    // Offset of each record from the first one is measured on device, device
+    // timeline is placed to the earliest time consistent with the times
+    // when CPU recorded the events
+    float offset[GPUJPEG_STATS_MAX_RECORD_COUNT];
+    float duration[GPUJPEG_STATS_MAX_RECORD_COUNT];
+    double device_start = recorder->start;
+    for ( int index = 0; index < recorder->record_count; index++ ) {
+        struct gpujpeg_stats_record* record = &recorder->record[index];
+        offset[index] = 0.0f;
+        duration[index] = -1.0f;
+        if ( record->stopped
+                && gpujpeg_device_event_synchronize(record->stop) == cudaSuccess
+                && gpujpeg_device_event_elapsed_time(&duration[index], record->start, record->stop) == cudaSuccess ) {
+            coder->stats.duration[record->stage] += duration[index];
+        }
+        if ( recorder->trace != NULL && index > 0 ) {
+            gpujpeg_device_event_elapsed_time(&offset[index], recorder->record[0].start, record->start);
+        }
+        if ( record->host_time - offset[index] / 1000.0 > device_start ) {
+            device_start = record->host_time - offset[index] / 1000.0;
+        }
+    }
+    double end = gpujpeg_get_time();
+    coder->stats.duration_total = (end - recorder->start) * 1000.0;
+
+    if ( recorder->trace != NULL ) {
+        for ( int index = 0; index < recorder->record_count; index++ ) {
+            if ( duration[index] >= 0.0f ) {
+                double begin = device_start + offset[index] / 1000.0;
+                gpujpeg_trace_add_event(recorder->trace, gpujpeg_stats_stage_get_name(recorder->record[index].stage),
+                                        recorder->trace_process, GPUJPEG_TRACE_THREAD_DEVICE, begin, begin + duration[index] / 1000.0, -1);
+            }
+        }
+        gpujpeg_trace_add_event(recorder->trace, "frame", recorder->trace_process, GPUJPEG_TRACE_THREAD_HOST,
+                                recorder->start, end, recorder->trace_frame_count++);
+    }
+    recorder->record_count = 0;
+
+    // Stage which couldn't be timed isn't an error of coding
+    gpujpeg_device_get_last_error();
+}
+
+/** Documented at declaration */
+void
+gpujpeg_stats_host_start(struct gpujpeg_coder* coder, enum gpujpeg_stats_stage stage)
+{
+    if ( coder->stats_recorder != NULL ) {
+        coder->stats_recorder->host_start[stage] = gpujpeg_get_time();
+    }
+}
+
+/** Documented at declaration */
+void
+gpujpeg_stats_host_stop(struct gpujpeg_coder* coder, enum gpujpeg_stats_stage stage)
+{
+    struct gpujpeg_stats_recorder* recorder = coder->stats_recorder;
+    if ( recorder == NULL ) {
+        return;
+    }
+    double end = gpujpeg_get_time();
+    coder->stats.duration[stage] += (end - recorder->host_start[stage]) * 1000.0;
+    if ( recorder->trace != NULL ) {
+        gpujpeg_trace_add_event(recorder->trace, gpujpeg_stats_stage_get_name(stage), recorder->trace_process,
+                                GPUJPEG_TRACE_THREAD_HOST, recorder->host_start[stage], end, -1);
+    }
+}
+
+/** Documented at declaration */
+void
+gpujpeg_stats_device_start(struct gpujpeg_coder* coder, enum gpujpeg_stats_stage stage, cudaStream_t stream)
+{
+    struct gpujpeg_stats_recorder* recorder = coder->stats_recorder;
+    if ( recorder == NULL || recorder->record_count == GPUJPEG_STATS_MAX_RECORD_COUNT ) {
+        return;
+    }
+
+    // Events are created on first use and then reused
+    struct gpujpeg_stats_record* record = &recorder->record[recorder->record_count];
+    if ( recorder->record_count == recorder->record_allocated_count ) {
+        if ( gpujpeg_device_event_create(&record->start) != cudaSuccess ) {
+            return;
+        }
+        if ( gpujpeg_device_event_create(&record->stop) != cudaSuccess ) {
+            gpujpeg_device_event_destroy(record->start);
+            return;
+        }
+        recorder->record_allocated_count++;
+    }
+    record->stage = stage;
+    record->stopped = 0;
+    record->host_time = gpujpeg_get_time();
+    gpujpeg_device_event_record(record->start, stream);
+    recorder->record_count++;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_stats_device_stop(struct gpujpeg_coder* coder, enum gpujpeg_stats_stage stage, cudaStream_t stream)
+{
+    struct gpujpeg_stats_recorder* recorder = coder->stats_recorder;
+    if ( recorder == NULL ) {
+        return;
+    }
+    for ( int index = recorder->record_count - 1; index >= 0; index-- ) {
+        struct gpujpeg_stats_record* record = &recorder->record[index];
+        if ( record->stage == stage && !record->stopped ) {
+            gpujpeg_device_event_record(record->stop, stream);
+            record->stopped = 1;
+            return;
+        }
+    }
+}
+
+/** Documented at declaration */
+void
+gpujpeg_stats_trace_worker(struct gpujpeg_coder* coder, int thread_index, double begin, double end)
+{
+    struct gpujpeg_stats_recorder* recorder = coder->stats_recorder;
+    if ( recorder != NULL && recorder->trace != NULL ) {
+        gpujpeg_trace_add_event(recorder->trace, "worker", recorder->trace_process,
+                                GPUJPEG_TRACE_THREAD_WORKER + thread_index, begin, end, -1);
+    }
+}
@@ -29,6 +29,8 @@
  
 #include <libgpujpeg/gpujpeg_table.h>
 #include <libgpujpeg/gpujpeg_util.h>
+#include "gpujpeg_device.h"
+#include <atomic>
 
 /** Default Quantization Table for Y component (zig-zag order)*/
 static uint8_t gpujpeg_table_default_quantization_luminance[] = { 
@@ -60,7 +62,7 @@ static uint8_t gpujpeg_table_default_quantization_chrominance[] = {
  * @param type  Quantization table type
  */
 void
-gpujpeg_table_quantization_set_default(uint8_t* table_raw, enum gpujpeg_component_type type)
+gpujpeg_table_quantization_set_default(uint16_t* table_raw, enum gpujpeg_component_type type)
 {
     uint8_t* table_default = NULL;
     if ( type == GPUJPEG_COMPONENT_LUMINANCE )
@@ -69,7 +71,8 @@ gpujpeg_table_quantization_set_default(uint8_t* table_raw, enum gpujpeg_componen
         table_default = gpujpeg_table_default_quantization_chrominance;
     else
         assert(0);
-    memcpy(table_raw, table_default, 64 * sizeof(uint8_t));
+    for ( int i = 0; i < 64; i++ )
+        table_raw[i] = table_default[i];
 }
 
 /**
@@ -79,7 +82,7 @@ gpujpeg_table_quantization_set_default(uint8_t* table_raw, enum gpujpeg_componen
  * @param quality  Quality to apply
  */
 void
-gpujpeg_table_quantization_apply_quality(uint8_t* table_raw, int quality)
+gpujpeg_table_quantization_apply_quality(uint16_t* table_raw, int quality)
 {
     int s = (quality < 50) ? (5000 / quality) : (200 - (2 * quality));
     for ( int i = 0; i < 64; i++ ) {
@@ -90,7 +93,7 @@ gpujpeg_table_quantization_apply_quality(uint8_t* table_raw, int quality)
         if ( value > 255 ) {
             value = 255;
         }
-        table_raw[i] = (uint8_t)value;
+        table_raw[i] = (uint16_t)value;
     }
 }
 
@@ -107,8 +110,8 @@ gpujpeg_table_quantization_encoder_init(struct gpujpeg_table_quantization* table
     // Scales of outputs of 1D DCT.
     const double dct_scales[8] = {1.0, 1.387039845, 1.306562965, 1.175875602, 1.0, 0.785694958, 0.541196100, 0.275899379};
     
-    // Prepare transposed float quantization table, pre-divided by output DCT weights
-    float h_quantization_table[64];
+    // Prepare transposed float quantization table, pre-divided by output DCT weights (host copy is used by host DCT)
+    float* h_quantization_table = table->table_forward;
     for( unsigned int i = 0; i < 64; i++ ) {
         const unsigned int x = gpujpeg_order_natural[i] % 8;
         const unsigned int y = gpujpeg_order_natural[i] / 8;
@@ -116,9 +119,9 @@ gpujpeg_table_quantization_encoder_init(struct gpujpeg_table_quantization* table
     }
     
     // Copy quantization table to constant memory
-    if ( cudaSuccess != cudaMemcpy(table->d_table_forward, h_quantization_table, 64 * sizeof(float), cudaMemcpyHostToDevice) )
+    if ( cudaSuccess != gpujpeg_device_memcpy(table->d_table_forward, h_quantization_table, 64 * sizeof(float), cudaMemcpyHostToDevice) )
         return  -1;
-    gpujpeg_cuda_check_error("Copy DCT quantization table to device memory", return -1);
+    gpujpeg_device_check_error("Copy DCT quantization table to device memory", return -1);
 
     // DCT loads the table into GPU memory itself, after premultiplying coefficients with DCT normalization constants.
     return 0;
@@ -140,7 +143,7 @@ gpujpeg_table_quantization_decoder_init(struct gpujpeg_table_quantization* table
     }
 
     // Copy tables to device memory
-    if ( cudaSuccess != cudaMemcpy(table->d_table, table->table, 64 * sizeof(uint16_t), cudaMemcpyHostToDevice) )
+    if ( cudaSuccess != gpujpeg_device_memcpy(table->d_table, table->table, 64 * sizeof(uint16_t), cudaMemcpyHostToDevice) )
         return -1;
         
     return 0;
@@ -155,7 +158,7 @@ gpujpeg_table_quantization_decoder_compute(struct gpujpeg_table_quantization* ta
     }
 
     // Copy tables to device memory
-    if ( cudaSuccess != cudaMemcpy(table->d_table, table->table, 64 * sizeof(uint16_t), cudaMemcpyHostToDevice) )
+    if ( cudaSuccess != gpujpeg_device_memcpy(table->d_table, table->table, 64 * sizeof(uint16_t), cudaMemcpyHostToDevice) )
         return -1;
         
     return 0;
@@ -301,9 +304,111 @@ gpujpeg_table_huffman_encoder_compute(struct gpujpeg_table_huffman_encoder* tabl
     }
 }
 
+/**
+ * Generate encoder huffman bits and values arrays from symbol frequencies, code lengths
+ * are limited to 16 bits (JPEG standard section K.2)
+ *
+ * @param table  Table structure
+ * @param freq  Symbol frequencies (zero for symbols without code), entry 256 is reserved and overwritten
+ * @return void
+ */
+static void
+gpujpeg_table_huffman_encoder_generate(struct gpujpeg_table_huffman_encoder* table, long freq[257])
+{
+    int codesize[257];
+    int others[257];
+    for ( int i = 0; i < 257; i++ ) {
+        codesize[i] = 0;
+        others[i] = -1;
+    }
+    // Reserved symbol guarantees that no code consists of all ones
+    freq[256] = 1;
+
+    // Figure K.1: find Huffman code sizes
+    for ( ;; ) {
+        // Find the smallest nonzero frequency, set c1 = its symbol (ties prefer larger symbol)
+        int c1 = -1;
+        long v = 1000000000L;
+        for ( int i = 0; i <= 256; i++ ) {
+            if ( freq[i] && freq[i] <= v ) {
+                v = freq[i];
+                c1 = i;
+            }
+        }
+        // Find the next smallest nonzero frequency, set c2 = its symbol
+        int c2 = -1;
+        v = 1000000000L;
+        for ( int i = 0; i <= 256; i++ ) {
+            if ( freq[i] && freq[i] <= v && i != c1 ) {
+                v = freq[i];
+                c2 = i;
+            }
+        }
+        // Done if we've merged everything into one frequency
+        if ( c2 < 0 )
+            break;
+
+        // Merge the two counts and increment the code sizes of both chains
+        freq[c1] += freq[c2];
+        freq[c2] = 0;
+        codesize[c1]++;
+        while ( others[c1] >= 0 ) {
+            c1 = others[c1];
+            codesize[c1]++;
+        }
+        others[c1] = c2;
+        codesize[c2]++;
+        while ( others[c2] >= 0 ) {
+            c2 = others[c2];
+            codesize[c2]++;
+        }
+    }
+
+    // Figure K.2: count the number of symbols of each code length
+    int bits[33];
+    memset(bits, 0, sizeof(bits));
+    for ( int i = 0; i <= 256; i++ ) {
+        if ( codesize[i] ) {
+            assert(codesize[i] <= 32);
+            bits[codesize[i]]++;
+        }
+    }
+
+    // Figure K.3: adjust code lengths to be no longer than 16 bits
+    for ( int i = 32; i > 16; i-- ) {
+        while ( bits[i] > 0 ) {
+            int j = i - 2;
+            while ( bits[j] == 0 )
+                j--;
+            bits[i] -= 2;
+            bits[i - 1]++;
+            bits[j + 1] += 2;
+            bits[j]--;
+        }
+    }
+    // Remove the count for the reserved symbol from the largest code length
+    int i = 16;
+    while ( bits[i] == 0 )
+        i--;
+    bits[i]--;
+
+    memset(table->bits, 0, sizeof(table->bits));
+    for ( i = 1; i <= 16; i++ )
+        table->bits[i] = (unsigned char)bits[i];
+
+    // Figure K.4: sort symbols by code length
+    int p = 0;
+    for ( i = 1; i <= 32; i++ ) {
+        for ( int j = 0; j <= 255; j++ ) {
+            if ( codesize[j] == i )
+                table->huffval[p++] = (unsigned char)j;
+        }
+    }
+}
+
 /** Documented at declaration */
 int
-gpujpeg_table_huffman_encoder_init(struct gpujpeg_table_huffman_encoder* table, enum gpujpeg_component_type comp_type, enum gpujpeg_huffman_type huff_type)
+gpujpeg_table_huffman_encoder_init(struct gpujpeg_table_huffman_encoder* table, enum gpujpeg_component_type comp_type, enum gpujpeg_huffman_type huff_type, int precision)
 {
     assert(comp_type == GPUJPEG_COMPONENT_LUMINANCE || comp_type == GPUJPEG_COMPONENT_CHROMINANCE);
     assert(huff_type == GPUJPEG_HUFFMAN_DC || huff_type == GPUJPEG_HUFFMAN_AC);
@@ -325,7 +430,28 @@ gpujpeg_table_huffman_encoder_init(struct gpujpeg_table_huffman_encoder* table,
         }
     }
     gpujpeg_table_huffman_encoder_compute(table);
-    
+
+    // Default tables have no codes for DC categories above 11 and AC categories above 10 which
+    // are needed by 12-bit coefficients, so the table is regenerated with those symbols added
+    // with the lowest frequency (default symbols keep frequencies matching their code lengths)
+    if ( precision > 8 ) {
+        long freq[257];
+        for ( int symbol = 0; symbol < 256; symbol++ ) {
+            freq[symbol] = table->size[symbol] ? (1L << (16 - table->size[symbol])) : 0;
+        }
+        if ( huff_type == GPUJPEG_HUFFMAN_DC ) {
+            for ( int category = 12; category <= 15; category++ )
+                freq[category] = 1;
+        } else {
+            for ( int run = 0; run < 16; run++ ) {
+                for ( int category = 11; category <= 14; category++ )
+                    freq[(run << 4) | category] = 1;
+            }
+        }
+        gpujpeg_table_huffman_encoder_generate(table, freq);
+        gpujpeg_table_huffman_encoder_compute(table);
+    }
+
     return 0;
 }
 
@@ -426,5 +552,118 @@ gpujpeg_table_huffman_decoder_compute(struct gpujpeg_table_huffman_decoder* tabl
     }
     
     // Copy table to device memory
-    cudaMemcpy(d_table, table, sizeof(struct gpujpeg_table_huffman_decoder), cudaMemcpyHostToDevice);
+    gpujpeg_device_memcpy(d_table, table, sizeof(struct gpujpeg_table_huffman_decoder), cudaMemcpyHostToDevice);
 }
+
+/** Last identifier of built huffman decoder table */
+static std::atomic<unsigned int> gpujpeg_table_huffman_decoder_cache_id(0);
+
+/**
+ * Compute hash of DHT content (FNV-1a)
+ *
+ * @param bits  Number of symbols with codes of length k bits
+ * @param huffval  Symbols
+ * @param count  Number of symbols
+ * @return hash
+ */
+static uint32_t
+gpujpeg_table_huffman_decoder_cache_hash(const unsigned char bits[17], const unsigned char* huffval, int count)
+{
+    uint32_t hash = 2166136261u;
+    for ( int i = 1; i <= 16; i++ )
+        hash = (hash ^ bits[i]) * 16777619u;
+    for ( int i = 0; i < count; i++ )
+        hash = (hash ^ huffval[i]) * 16777619u;
+    return hash;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_table_huffman_decoder_cache_init(struct gpujpeg_table_huffman_decoder_cache* cache)
+{
+    memset(cache, 0, sizeof(struct gpujpeg_table_huffman_decoder_cache));
+    for ( int index = 0; index < GPUJPEG_TABLE_HUFFMAN_DECODER_CACHE_SIZE; index++ ) {
+        if ( cudaSuccess != gpujpeg_device_malloc((void**)&cache->entry[index].d_table, sizeof(struct gpujpeg_table_huffman_decoder)) )
+            return -1;
+    }
+
+    // Standard tables are built beforehand (streams like MJPEG use them on every frame or even omit DHT)
+    int index = 0;
+    for ( int comp_type = 0; comp_type < GPUJPEG_COMPONENT_TYPE_COUNT; comp_type++ ) {
+        for ( int huff_type = 0; huff_type < GPUJPEG_HUFFMAN_TYPE_COUNT; huff_type++ ) {
+            struct gpujpeg_table_huffman_decoder_cache_entry* entry = &cache->entry[index++];
+            if ( gpujpeg_table_huffman_decoder_init(&entry->table, entry->d_table, (enum gpujpeg_component_type)comp_type, (enum gpujpeg_huffman_type)huff_type) != 0 )
+                return -1;
+            int count = 0;
+            for ( int i = 1; i <= 16; i++ )
+                count += entry->table.bits[i];
+            entry->hash = gpujpeg_table_huffman_decoder_cache_hash(entry->table.bits, entry->table.huffval, count);
+            entry->id = ++gpujpeg_table_huffman_decoder_cache_id;
+        }
+    }
+    gpujpeg_device_check_error("Huffman decoder table cache init", return -1);
+
+    return 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_table_huffman_decoder_cache_destroy(struct gpujpeg_table_huffman_decoder_cache* cache)
+{
+    for ( int index = 0; index < GPUJPEG_TABLE_HUFFMAN_DECODER_CACHE_SIZE; index++ ) {
+        if ( cache->entry[index].d_table != NULL ) {
+            gpujpeg_device_free(cache->entry[index].d_table);
+            cache->entry[index].d_table = NULL;
+        }
+    }
+}
+
+/** Documented at declaration */
+int
+gpujpeg_table_huffman_decoder_cache_set(struct gpujpeg_table_huffman_decoder_cache* cache, struct gpujpeg_table_huffman_decoder_cache_entry** slot,
+                                        const unsigned char bits[17], const unsigned char* huffval)
+{
+    int count = 0;
+    for ( int i = 1; i <= 16; i++ )
+        count += bits[i];
+    uint32_t hash = gpujpeg_table_huffman_decoder_cache_hash(bits, huffval, count);
+
+    // Find table with the same content, otherwise the least recently used entry is rebuilt
+    struct gpujpeg_table_huffman_decoder_cache_entry* entry = NULL;
+    struct gpujpeg_table_huffman_decoder_cache_entry* entry_replaced = NULL;
+    for ( int index = 0; index < GPUJPEG_TABLE_HUFFMAN_DECODER_CACHE_SIZE; index++ ) {
+        struct gpujpeg_table_huffman_decoder_cache_entry* item = &cache->entry[index];
+        if ( item->id != 0 && item->hash == hash && memcmp(item->table.bits + 1, bits + 1, 16) == 0
+                && memcmp(item->table.huffval, huffval, count) == 0 ) {
+            entry = item;
+            break;
+        }
+        if ( item->ref_count == 0 && (entry_replaced == NULL || item->id == 0 || (entry_replaced->id != 0 && item->last_use < entry_replaced->last_use)) ) {
+            entry_replaced = item;
+        }
+    }
+    if ( entry == NULL ) {
+        // Decoder refers to at most one table for each slot, so some entry is always free
+        assert(entry_replaced != NULL);
+        entry = entry_replaced;
+        entry->table.bits[0] = 0;
+        memcpy(entry->table.bits + 1, bits + 1, 16);
+        memcpy(entry->table.huffval, huffval, count);
+        gpujpeg_table_huffman_decoder_compute(&entry->table, entry->d_table);
+        gpujpeg_device_check_error("Huffman decoder table copy", return -1);
+        entry->hash = hash;
+        entry->id = ++gpujpeg_table_huffman_decoder_cache_id;
+    }
+    entry->last_use = ++cache->use_counter;
+
+    if ( *slot == entry ) {
+        return 0;
+    }
+    if ( *slot != NULL ) {
+        (*slot)->ref_count--;
+    }
+    entry->ref_count++;
+    *slot = entry;
+    return 1;
+}
+
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gpujpeg_thread.h"
+#include <thread>
+#include <vector>
+
+/** Documented at declaration */
+int
+gpujpeg_thread_get_count(int thread_count)
+{
+    if ( thread_count > 0 )
+        return thread_count;
+    int count = (int)std::thread::hardware_concurrency();
+    return (count > 0) ? count : 1;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_thread_run(int thread_count, gpujpeg_thread_function_t function, void* param)
+{
+    std::vector<int> result(thread_count, 0);
+    std::vector<std::thread> threads;
+    for ( int thread_index = 1; thread_index < thread_count; thread_index++ ) {
+        threads.push_back(std::thread([&result, function, param, thread_index]() {
+            result[thread_index] = function(thread_index, param);
+        }));
+    }
+    if ( thread_count > 0 )
+        result[0] = function(0, param);
+    for ( size_t index = 0; index < threads.size(); index++ )
+        threads[index].join();
+
+    for ( int thread_index = 0; thread_index < thread_count; thread_index++ ) {
+        if ( result[thread_index] != 0 )
+            return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GPUJPEG_THREAD_H
+#define GPUJPEG_THREAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Function performed by each worker thread
+ *
+ * @param thread_index  Index of worker thread (0 to thread_count - 1)
+ * @param param  Parameter passed to gpujpeg_thread_run
+ * @return 0 if succeeds, otherwise nonzero
+ */
+typedef int (*gpujpeg_thread_function_t)(int thread_index, void* param);
+
+/**
+ * Get number of worker threads
+ *
+ * @param thread_count  Requested number of threads (zero or negative for number of hardware threads)
+ * @return number of threads (at least 1)
+ */
+int
+gpujpeg_thread_get_count(int thread_count);
+
+/**
+ * Run function in worker threads and wait for all of them (the calling thread
+ * performs the function with index 0)
+ *
+ * @param thread_count  Number of worker threads
+ * @param function  Function performed by each thread
+ * @param param  Parameter passed to the function
+ * @return 0 if all functions succeed, otherwise nonzero
+ */
+int
+gpujpeg_thread_run(int thread_count, gpujpeg_thread_function_t function, void* param);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPUJPEG_THREAD_H
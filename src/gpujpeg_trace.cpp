@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <libgpujpeg/gpujpeg_stats_internal.h>
+#include <stdio.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** Event of trace */
+struct gpujpeg_trace_event
+{
+    // Name of event (static string)
+    const char* name;
+    // Coder process and its timeline
+    int process;
+    int thread;
+    // Begin and end of event [s]
+    double begin;
+    double end;
+    // Index of frame for frame events, otherwise -1
+    int frame;
+};
+
+/** Documented at declaration */
+struct gpujpeg_trace
+{
+    // Time of trace creation, timestamps are relative to it [s]
+    double start;
+    // Names of coder processes
+    std::vector<std::string> process;
+    // Recorded events
+    std::vector<struct gpujpeg_trace_event> event;
+    // Lock of processes and events (coders and their worker threads add events concurrently)
+    std::mutex mutex;
+};
+
+/** Documented at declaration */
+struct gpujpeg_trace*
+gpujpeg_trace_create(void)
+{
+    struct gpujpeg_trace* trace = new (std::nothrow) gpujpeg_trace;
+    if ( trace == NULL ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to allocate trace!\n");
+        return NULL;
+    }
+    trace->start = gpujpeg_get_time();
+    return trace;
+}
+
+/** Documented at declaration */
+int
+gpujpeg_trace_add_process(struct gpujpeg_trace* trace, const char* name)
+{
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    trace->process.push_back(name != NULL ? name : "coder");
+    return (int)trace->process.size() - 1;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_trace_add_event(struct gpujpeg_trace* trace, const char* name, int process, int thread, double begin, double end, int frame)
+{
+    struct gpujpeg_trace_event event;
+    event.name = name;
+    event.process = process;
+    event.thread = thread;
+    event.begin = begin;
+    event.end = end;
+    event.frame = frame;
+
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    trace->event.push_back(event);
+}
+
+/**
+ * Write name of timeline of coder process
+ *
+ * @param file  Output file
+ * @param process  Index of coder process
+ * @param thread  Timeline of the process
+ */
+static void
+gpujpeg_trace_write_thread_name(FILE* file, int process, int thread)
+{
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"", process, thread);
+    if ( thread == GPUJPEG_TRACE_THREAD_HOST ) {
+        fprintf(file, "host");
+    }
+    else if ( thread == GPUJPEG_TRACE_THREAD_DEVICE ) {
+        fprintf(file, "device stream");
+    }
+    else {
+        fprintf(file, "worker %d", thread - GPUJPEG_TRACE_THREAD_WORKER);
+    }
+    fprintf(file, "\"}}");
+}
+
+/** Documented at declaration */
+int
+gpujpeg_trace_save(struct gpujpeg_trace* trace, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if ( file == NULL ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to open trace file %s!\n", filename);
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    // Processes and their timelines (only those which contain events)
+    std::vector<std::vector<int> > thread_used(trace->process.size());
+    for ( size_t index = 0; index < trace->event.size(); index++ ) {
+        const struct gpujpeg_trace_event* event = &trace->event[index];
+        std::vector<int>& used = thread_used[event->process];
+        if ( (int)used.size() <= event->thread ) {
+            used.resize(event->thread + 1, 0);
+        }
+        used[event->thread] = 1;
+    }
+    for ( int process = 0; process < (int)trace->process.size(); process++ ) {
+        fprintf(file, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}",
+                process == 0 ? "" : ",\n", process, trace->process[process].c_str());
+        for ( int thread = 0; thread < (int)thread_used[process].size(); thread++ ) {
+            if ( thread_used[process][thread] ) {
+                gpujpeg_trace_write_thread_name(file, process, thread);
+            }
+        }
+    }
+
+    // Events as complete events with timestamps in microseconds
+    for ( size_t index = 0; index < trace->event.size(); index++ ) {
+        const struct gpujpeg_trace_event* event = &trace->event[index];
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                event->name, event->frame >= 0 ? "frame" : (event->thread == GPUJPEG_TRACE_THREAD_DEVICE ? "device" : "host"),
+                event->process, event->thread, (event->begin - trace->start) * 1e6, (event->end - event->begin) * 1e6);
+        if ( event->frame >= 0 ) {
+            fprintf(file, ",\"args\":{\"frame\":%d}", event->frame);
+        }
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n]}\n");
+
+    if ( fclose(file) != 0 ) {
+        fprintf(stderr, "[GPUJPEG] [Error] Failed to write trace file %s!\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+/** Documented at declaration */
+void
+gpujpeg_trace_destroy(struct gpujpeg_trace* trace)
+{
+    delete trace;
+}
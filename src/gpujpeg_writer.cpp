@@ -54,6 +54,9 @@ gpujpeg_writer_init(gpujpeg_writer * writer, gpujpeg_image_parameters * param_im
     // Allocate output buffer
     int buffer_size = 1000;
     buffer_size += param_image->width * param_image->height * param_image->comp_count * 2;
+    if (gpujpeg_pixel_format_get_precision(param_image->pixel_format) > 8) {
+        buffer_size += param_image->width * param_image->height * param_image->comp_count * 2;
+    }
 
     if (buffer_size > writer->buffer_allocated_size) {
         writer->buffer_allocated_size = 0;
@@ -144,12 +147,13 @@ void gpujpeg_writer_write_app0(struct gpujpeg_writer* writer)
 /**
  * Write APP14 block
  *
- * This marker is used for RGB images - JFIF supports only YCbCr. This Apple
- * marker allows us to store RGB files. Inspired by libjpeg-turbo.
+ * This marker is used for RGB and CMYK/YCCK images - JFIF supports only YCbCr.
+ * This Adobe marker allows us to store such files. Inspired by libjpeg-turbo.
  *
  * @param writer  Writer structure
+ * @param color_transform  Color transform (1 YCbCr, 2 YCCK, 0 otherwise)
  */
-static void gpujpeg_writer_write_app14(struct gpujpeg_writer* writer)
+static void gpujpeg_writer_write_app14(struct gpujpeg_writer* writer, int color_transform)
 {
     gpujpeg_writer_emit_marker(writer, GPUJPEG_MARKER_APP14);
 
@@ -166,7 +170,7 @@ static void gpujpeg_writer_write_app14(struct gpujpeg_writer* writer)
     gpujpeg_writer_emit_2byte(writer, 100); // Version
     gpujpeg_writer_emit_2byte(writer, 0);   // Flags0
     gpujpeg_writer_emit_2byte(writer, 0);   // Flags1
-    gpujpeg_writer_emit_byte(writer, 0);    // Color transform - 1 YCbCr, 2 YCCK, 0 otherwise (RGB or CMYK)
+    gpujpeg_writer_emit_byte(writer, color_transform); // Color transform - 1 YCbCr, 2 YCCK, 0 otherwise (RGB or CMYK)
 }
 
 /**
@@ -181,25 +185,37 @@ gpujpeg_writer_write_dqt(struct gpujpeg_encoder* encoder, enum gpujpeg_component
 {
     gpujpeg_writer_emit_marker(encoder->writer, GPUJPEG_MARKER_DQT);
 
-    // Length
-    gpujpeg_writer_emit_2byte(encoder->writer, 67);
+    // Table changed from default with quality
+    uint16_t* dqt = encoder->table_quantization[type].table_raw;
+
+    // 16-bit table entries are needed only for 12-bit precision with values above 255
+    int precision16 = 0;
+    if ( encoder->coder.param.precision > 8 ) {
+        for ( int i = 0; i < 64; i++ ) {
+            if ( dqt[i] > 255 )
+                precision16 = 1;
+        }
+    }
 
-    // Index: Y component = 0, Cb or Cr component = 1
-    gpujpeg_writer_emit_byte(encoder->writer, (int)type);
+    // Length
+    gpujpeg_writer_emit_2byte(encoder->writer, precision16 ? 131 : 67);
 
-    // Table changed from default with quality
-    uint8_t* dqt = encoder->table_quantization[type].table_raw;
+    // Precision (upper nibble) and index: Y component = 0, Cb or Cr component = 1
+    gpujpeg_writer_emit_byte(encoder->writer, (precision16 << 4) | (int)type);
 
     // Emit table in zig-zag order
-    unsigned char qval;
     for ( int i = 0; i < 64; i++ )  {
-        unsigned char qval = (unsigned char)((char)(dqt[i]));
-        gpujpeg_writer_emit_byte(encoder->writer, qval);
+        if ( precision16 ) {
+            gpujpeg_writer_emit_2byte(encoder->writer, dqt[i]);
+        } else {
+            gpujpeg_writer_emit_byte(encoder->writer, dqt[i]);
+        }
     }
 }
 
 /**
- * Currently support GPUJPEG_MARKER_SOF0 baseline implementation
+ * Write SOF0 block for baseline implementation or SOF1 block for extended
+ * sequential implementation when 12-bit precision is used
  *
  * @param encoder  Encoder structure
  * @return void
@@ -207,13 +223,14 @@ gpujpeg_writer_write_dqt(struct gpujpeg_encoder* encoder, enum gpujpeg_component
 void
 gpujpeg_writer_write_sof0(struct gpujpeg_encoder* encoder)
 {
-    gpujpeg_writer_emit_marker(encoder->writer, GPUJPEG_MARKER_SOF0);
+    int extended = encoder->coder.param.precision > 8;
+    gpujpeg_writer_emit_marker(encoder->writer, extended ? GPUJPEG_MARKER_SOF1 : GPUJPEG_MARKER_SOF0);
 
     // Length
     gpujpeg_writer_emit_2byte(encoder->writer, 8 + 3 * encoder->coder.param_image.comp_count);
 
     // Precision (bit depth)
-    gpujpeg_writer_emit_byte(encoder->writer, 8);
+    gpujpeg_writer_emit_byte(encoder->writer, extended ? 12 : 8);
     // Dimensions
     gpujpeg_writer_emit_2byte(encoder->writer, encoder->coder.param_image.height);
     gpujpeg_writer_emit_2byte(encoder->writer, encoder->coder.param_image.width);
@@ -335,8 +352,10 @@ void
 gpujpeg_writer_write_header(struct gpujpeg_encoder* encoder)
 {
     gpujpeg_writer_write_soi(encoder->writer);
-    if (encoder->coder.param.color_space_internal == GPUJPEG_RGB) {
-        gpujpeg_writer_write_app14(encoder->writer);
+    if (encoder->coder.param.color_space_internal == GPUJPEG_RGB || encoder->coder.param.color_space_internal == GPUJPEG_CMYK) {
+        gpujpeg_writer_write_app14(encoder->writer, 0);
+    } else if (encoder->coder.param.color_space_internal == GPUJPEG_YCCK) {
+        gpujpeg_writer_write_app14(encoder->writer, 2);
     } else { // ordinal JFIF
         gpujpeg_writer_write_app0(encoder->writer);
     }
@@ -360,6 +379,38 @@ gpujpeg_writer_write_header(struct gpujpeg_encoder* encoder)
     gpujpeg_writer_write_com(encoder);
 }
 
+/** Documented at declaration */
+int
+gpujpeg_writer_write_header_template(struct gpujpeg_encoder* encoder, const uint8_t* header, int header_size)
+{
+    uint8_t* header_begin = encoder->writer->buffer_current;
+    memcpy(header_begin, header, header_size);
+    encoder->writer->buffer_current += header_size;
+
+    // Skip SOI and walk marker blocks until SOF
+    int position = 2;
+    while ( position + 4 <= header_size ) {
+        if ( header_begin[position] != 0xFF ) {
+            break;
+        }
+        int marker = header_begin[position + 1];
+        int length = (header_begin[position + 2] << 8) | header_begin[position + 3];
+        if ( marker == GPUJPEG_MARKER_SOF0 || marker == GPUJPEG_MARKER_SOF1 ) {
+            // Marker (2 bytes), length (2 bytes), precision (1 byte), height and width (2 bytes each)
+            uint8_t* dimensions = &header_begin[position + 5];
+            dimensions[0] = (uint8_t)((encoder->coder.param_image.height >> 8) & 0xFF);
+            dimensions[1] = (uint8_t)(encoder->coder.param_image.height & 0xFF);
+            dimensions[2] = (uint8_t)((encoder->coder.param_image.width >> 8) & 0xFF);
+            dimensions[3] = (uint8_t)(encoder->coder.param_image.width & 0xFF);
+            return 0;
+        }
+        position += 2 + length;
+    }
+
+    fprintf(stderr, "[GPUJPEG] [Error] Header template doesn't contain SOF block!\n");
+    return -1;
+}
+
 /** Documented at declaration */
 void
 gpujpeg_writer_write_segment_info(struct gpujpeg_encoder* encoder)
@@ -499,3 +550,65 @@ gpujpeg_writer_write_scan_header(struct gpujpeg_encoder* encoder, int scan_index
     gpujpeg_writer_emit_byte(encoder->writer, 0x3F); // Se
     gpujpeg_writer_emit_byte(encoder->writer, 0);    // Ah/Al
 }
+
+/** Documented at declaration */
+void
+gpujpeg_writer_write_segments(struct gpujpeg_encoder* encoder)
+{
+    // Get coder
+    struct gpujpeg_coder* coder = &encoder->coder;
+
+    if ( coder->param.interleaved == 1 ) {
+        // Write scan header (only one scan is written, that contains all color components data)
+        gpujpeg_writer_write_scan_header(encoder, 0);
+
+        // Write scan data
+        for ( int segment_index = 0; segment_index < coder->segment_count; segment_index++ ) {
+            struct gpujpeg_segment* segment = &coder->segment[segment_index];
+
+            gpujpeg_writer_write_segment_info(encoder);
+
+            // Copy compressed data to writer
+            memcpy(
+                encoder->writer->buffer_current,
+                &coder->data_compressed[segment->data_compressed_index],
+                segment->data_compressed_size
+            );
+            encoder->writer->buffer_current += segment->data_compressed_size;
+            //printf("Compressed data %d bytes\n", segment->data_compressed_size);
+        }
+        // Remove last restart marker in scan (is not needed)
+        encoder->writer->buffer_current -= 2;
+
+        gpujpeg_writer_write_segment_info(encoder);
+    }
+    else {
+        // Write huffman coder results as one scan for each color component
+        int segment_index = 0;
+        for ( int comp = 0; comp < coder->param_image.comp_count; comp++ ) {
+            // Write scan header
+            gpujpeg_writer_write_scan_header(encoder, comp);
+            // Write scan data
+            for ( int index = 0; index < coder->component[comp].segment_count; index++ ) {
+                struct gpujpeg_segment* segment = &coder->segment[segment_index];
+
+                gpujpeg_writer_write_segment_info(encoder);
+
+                // Copy compressed data to writer
+                memcpy(
+                    encoder->writer->buffer_current,
+                    &coder->data_compressed[segment->data_compressed_index],
+                    segment->data_compressed_size
+                );
+                encoder->writer->buffer_current += segment->data_compressed_size;
+                //printf("Compressed data %d bytes\n", segment->data_compressed_size);
+
+                segment_index++;
+            }
+            // Remove last restart marker in scan (is not needed)
+            encoder->writer->buffer_current -= 2;
+
+            gpujpeg_writer_write_segment_info(encoder);
+        }
+    }
+}
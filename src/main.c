@@ -44,26 +44,45 @@ print_help()
            "   -v, --verbose          verbose output\n"
            "   -D, --device           set cuda device id (default 0)\n"
            "       --device-list      list cuda devices\n"
+           "       --host-runtime     run GPU pipeline on CPU without cuda device\n"
+           "                          (for testing)\n"
            "\n");
     printf("   -s, --size             set input image size in pixels, e.g. 1920x1080\n"
            "   -f, --pixel-format     set input/output image pixel format, one of the following:\n"
            "\n"
            "                          u8               422-u8-p1020\n"
-           "                          444-u8-p012      422-u8-p0p1p2\n"
-           "                          444-u8-p0p1p2    420-u8-p0p1p2\n"
+           "                          444-u8-p012      422-u8-p0102\n"
+           "                          444-u8-p0p1p2    422-u8-p0p1p2\n"
+           "                          444-u8-p012x     420-u8-p0p1p2\n"
+           "                          444-u8-p210x     420-u8-p0p12\n"
+           "                          4444-u8-p0123\n"
+           "\n"
+           "                          u16              444-u16-p012\n"
+           "                          (16-bit samples with 12-bit values coded with 12-bit precision,\n"
+           "                          only 4:4:4 sampling, huffman coding is performed on CPU)\n"
            "\n"
            "   -c, --colorspace       set input/output image colorspace, e.g. rgb, yuv,\n"
-           "                          ycbcr, ycbcr-jpeg, ycbcr-bt601, ycbcr-bt709\n"
+           "                          ycbcr, ycbcr-jpeg, ycbcr-bt601, ycbcr-bt709, cmyk\n"
            "\n");
     printf("   -q, --quality          set JPEG encoder quality level 0-100 (default 75)\n"
            "   -r, --restart          set JPEG encoder restart interval (default 8)\n"
            "       --subsampled       set JPEG encoder to use chroma subsampling\n"
+           "       --sampling-filter  set chroma downsampling/upsampling filter, one of\n"
+           "                          nearest (default), box, triangle\n"
            "   -i  --interleaved      set JPEG encoder to use interleaved stream\n"
            "   -g  --segment-info     set JPEG encoder to use segment info in stream\n"
            "                          for fast decoding\n"
            "\n");
     printf("   -e, --encode           perform JPEG encoding\n"
            "   -d, --decode           perform JPEG decoding\n"
+           "       --host-threads     perform JPEG encoding and decoding of images in\n"
+           "                          host memory on CPU by specified number of\n"
+           "                          threads (-1 for all cores)\n"
+           "       --route[=FILE]     route each image and huffman coding to CPU or\n"
+           "                          GPU by cost model (default model, profile FILE\n"
+           "                          or \"calibrate\" to measure the model at startup)\n"
+           "       --trace=FILE       save trace of pipeline stages and worker threads\n"
+           "                          (Chrome trace JSON, e.g. for Perfetto UI)\n"
            "       --convert          convert input image to output image (change\n"
            "                          color space and/or sampling factor)\n"
            "       --component-range  show samples range for each component in image\n"
@@ -112,6 +131,17 @@ static int print_image_info(const char *filename) {
     return 0;
 }
 
+static void print_stats(const struct gpujpeg_stats* stats) {
+    for (int stage = 0; stage < GPUJPEG_STATS_STAGE_COUNT; stage++) {
+        if (stats->duration[stage] != 0.0) {
+            printf(" -%-18s %10.2f ms\n", gpujpeg_stats_stage_get_name((enum gpujpeg_stats_stage)stage), stats->duration[stage]);
+        }
+    }
+    if (stats->upload_size != 0 || stats->download_size != 0) {
+        printf(" -Transfer:          %zu bytes to device, %zu bytes from device\n", stats->upload_size, stats->download_size);
+    }
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -135,6 +165,11 @@ main(int argc, char *argv[])
     int component_range = 0;
     int iterate = 1;
     int use_opengl = 0;
+    int host_threads = 0;
+    int host_runtime = 0;
+    int route = 0;
+    const char* route_profile = NULL;
+    const char* trace_filename = NULL;
 
     // Flags
     int restart_interval_default = 1;
@@ -148,11 +183,17 @@ main(int argc, char *argv[])
     #define OPTION_SUBSAMPLED      2
     #define OPTION_CONVERT         3
     #define OPTION_COMPONENT_RANGE 4
+    #define OPTION_SAMPLING_FILTER 5
+    #define OPTION_HOST_THREADS    6
+    #define OPTION_ROUTE           7
+    #define OPTION_HOST_RUNTIME    8
+    #define OPTION_TRACE           9
     struct option longopts[] = {
         {"help",                    no_argument,       0, 'h'},
         {"verbose",                 no_argument,       0, 'v'},
         {"device",                  required_argument, 0, 'D'},
         {"device-list",             no_argument,       0,  OPTION_DEVICE_INFO },
+        {"host-runtime",            no_argument,       0,  OPTION_HOST_RUNTIME },
         {"size",                    required_argument, 0, 's'},
         {"pixel-format",         required_argument, 0, 'f'},
         {"colorspace",              required_argument, 0, 'c'},
@@ -160,9 +201,13 @@ main(int argc, char *argv[])
         {"restart",                 required_argument, 0, 'r'},
         {"segment-info",            optional_argument, 0, 'g' },
         {"subsampled",              optional_argument, 0,  OPTION_SUBSAMPLED },
+        {"sampling-filter",         required_argument, 0,  OPTION_SAMPLING_FILTER },
         {"interleaved",             optional_argument, 0, 'i'},
         {"encode",                  no_argument,       0, 'e'},
         {"decode",                  no_argument,       0, 'd'},
+        {"host-threads",            required_argument, 0,  OPTION_HOST_THREADS },
+        {"route",                   optional_argument, 0,  OPTION_ROUTE },
+        {"trace",                   required_argument, 0,  OPTION_TRACE },
         {"convert",                 no_argument,       0,  OPTION_CONVERT },
         {"component-range",         no_argument,       0,  OPTION_COMPONENT_RANGE },
         {"iterate",                 required_argument, 0,  'n' },
@@ -203,6 +248,8 @@ main(int argc, char *argv[])
                 param_image.color_space = GPUJPEG_YCBCR_BT601;
             else if ( strcmp(optarg, "ycbcr-bt709") == 0 )
                 param_image.color_space = GPUJPEG_YCBCR_BT709;
+            else if ( strcmp(optarg, "cmyk") == 0 )
+                param_image.color_space = GPUJPEG_CMYK;
             else
                 fprintf(stderr, "Colorspace '%s' is not available!\n", optarg);
             break;
@@ -219,12 +266,26 @@ main(int argc, char *argv[])
                 param_image.comp_count = 3;
                 param_image.pixel_format = GPUJPEG_444_U8_P0P1P2;
             }
+            else if ( strcmp(optarg, "444-u8-p012x") == 0 ) {
+                param_image.comp_count = 3;
+                param_image.pixel_format = GPUJPEG_444_U8_P012X;
+            }
+            else if ( strcmp(optarg, "444-u8-p210x") == 0 ) {
+                param_image.comp_count = 3;
+                param_image.pixel_format = GPUJPEG_444_U8_P210X;
+            }
             else if ( strcmp(optarg, "422-u8-p1020") == 0 )  {
                 param_image.comp_count = 3;
                 param_image.pixel_format = GPUJPEG_422_U8_P1020;
                 gpujpeg_parameters_chroma_subsampling_422(&param);
                 chroma_subsampled = 1;
             }
+            else if ( strcmp(optarg, "422-u8-p0102") == 0 )  {
+                param_image.comp_count = 3;
+                param_image.pixel_format = GPUJPEG_422_U8_P0102;
+                gpujpeg_parameters_chroma_subsampling_422(&param);
+                chroma_subsampled = 1;
+            }
             else if ( strcmp(optarg, "422-u8-p0p1p2") == 0 ) {
                 param_image.comp_count = 3;
                 param_image.pixel_format = GPUJPEG_422_U8_P0P1P2;
@@ -237,6 +298,26 @@ main(int argc, char *argv[])
                 gpujpeg_parameters_chroma_subsampling_420(&param);
                 chroma_subsampled = 1;
             }
+            else if ( strcmp(optarg, "420-u8-p0p12") == 0 ) {
+                param_image.comp_count = 3;
+                param_image.pixel_format = GPUJPEG_420_U8_P0P12;
+                gpujpeg_parameters_chroma_subsampling_420(&param);
+                chroma_subsampled = 1;
+            }
+            else if ( strcmp(optarg, "4444-u8-p0123") == 0 ) {
+                param_image.comp_count = 4;
+                param_image.pixel_format = GPUJPEG_4444_U8_P0123;
+            }
+            else if ( strcmp(optarg, "u16") == 0 ) {
+                param_image.comp_count = 1;
+                param_image.pixel_format = GPUJPEG_U16;
+                param.precision = 12;
+            }
+            else if ( strcmp(optarg, "444-u16-p012") == 0 ) {
+                param_image.comp_count = 3;
+                param_image.pixel_format = GPUJPEG_444_U16_P012;
+                param.precision = 12;
+            }
             else { fprintf(stderr, "Unknown pixel format '%s'!\n", optarg); }
             break;
         case 'q':
@@ -262,9 +343,32 @@ main(int argc, char *argv[])
             gpujpeg_parameters_chroma_subsampling_420(&param);
             chroma_subsampled = 1;
             break;
+        case OPTION_SAMPLING_FILTER:
+            if ( strcmp(optarg, "nearest") == 0 )
+                param.sampling_filter = GPUJPEG_SAMPLING_FILTER_NEAREST;
+            else if ( strcmp(optarg, "box") == 0 )
+                param.sampling_filter = GPUJPEG_SAMPLING_FILTER_BOX;
+            else if ( strcmp(optarg, "triangle") == 0 )
+                param.sampling_filter = GPUJPEG_SAMPLING_FILTER_TRIANGLE;
+            else
+                fprintf(stderr, "Unknown sampling filter '%s'!\n", optarg);
+            break;
+        case OPTION_HOST_THREADS:
+            host_threads = atoi(optarg);
+            break;
+        case OPTION_ROUTE:
+            route = 1;
+            route_profile = optarg;
+            break;
+        case OPTION_TRACE:
+            trace_filename = optarg;
+            break;
         case OPTION_DEVICE_INFO:
             gpujpeg_print_devices_info();
             return 0;
+        case OPTION_HOST_RUNTIME:
+            host_runtime = 1;
+            break;
         case 'i':
             if ( optarg == NULL || strcmp(optarg, "true") == 0 || atoi(optarg) )
                 param.interleaved = 1;
@@ -331,9 +435,28 @@ main(int argc, char *argv[])
         flags |= GPUJPEG_OPENGL_INTEROPERABILITY;
         gpujpeg_opengl_init();
     }
+    if ( host_runtime ) {
+        flags |= GPUJPEG_HOST_RUNTIME;
+    }
     if ( gpujpeg_init_device(device_id, flags) != 0 )
         return -1;
 
+    // Prepare cost model for routing
+    struct gpujpeg_route_model route_model;
+    gpujpeg_route_model_set_default(&route_model);
+    if ( route_profile != NULL && strcmp(route_profile, "calibrate") == 0 ) {
+        if ( gpujpeg_route_model_calibrate(&route_model, host_threads) != 0 )
+            return -1;
+        if ( param.verbose ) {
+            printf("Route model: host %.1f us + %.2f ns/sample, device %.1f us + %.3f ns/sample, transfer %.3f ns/byte\n",
+                route_model.host_overhead, route_model.host_transform + route_model.host_huffman,
+                route_model.device_overhead, route_model.device_transform, route_model.transfer);
+        }
+    } else if ( route_profile != NULL ) {
+        if ( gpujpeg_route_model_load(&route_model, route_profile) != 0 )
+            return -1;
+    }
+
     // Convert
     if ( convert == 1 ) {
         // Encode images
@@ -347,6 +470,14 @@ main(int argc, char *argv[])
         return 0;
     }
 
+    // Create trace shared by encoder and decoder
+    struct gpujpeg_trace* trace = NULL;
+    if ( trace_filename != NULL ) {
+        trace = gpujpeg_trace_create();
+        if ( trace == NULL )
+            return -1;
+    }
+
     // Detect action if none is specified
     if ( encode == 0 && decode == 0 ) {
         enum gpujpeg_image_file_format input_format = gpujpeg_image_get_file_format(argv[0]);
@@ -362,6 +493,14 @@ main(int argc, char *argv[])
         }
     }
 
+    // Image with 4 components is CMYK image, that is encoded in YCCK color space
+    if ( param_image.comp_count == 4 ) {
+        if ( param_image.color_space == GPUJPEG_NONE ) {
+            param_image.color_space = GPUJPEG_CMYK;
+        }
+        param.color_space_internal = GPUJPEG_YCCK;
+    }
+
     // Detect color spalce
     if ( param_image.color_space == GPUJPEG_NONE ) {
         if ( gpujpeg_image_get_file_format(argv[0]) == GPUJPEG_IMAGE_FILE_YUV ) {
@@ -422,6 +561,13 @@ main(int argc, char *argv[])
             fprintf(stderr, "Failed to create encoder!\n");
             return -1;
         }
+        gpujpeg_encoder_set_host_threads(encoder, host_threads);
+        if ( param.verbose )
+            gpujpeg_encoder_set_stats(encoder, 1);
+        if ( trace != NULL )
+            gpujpeg_encoder_set_trace(encoder, trace);
+        if ( route )
+            gpujpeg_encoder_set_route_model(encoder, &route_model);
 
         // Encode images
         for ( int index = 0; index < argc; index += 2 ) {
@@ -485,19 +631,16 @@ main(int argc, char *argv[])
                 GPUJPEG_TIMER_STOP();
                 float duration = GPUJPEG_TIMER_DURATION();
                 if ( param.verbose ) {
-                    //printf(" -Copy To Device:    %10.2f ms\n", encoder->coder.duration_memory_to);
-                    if ( encoder->coder.duration_memory_map != 0.0 && encoder->coder.duration_memory_unmap != 0.0 ) {
-                        printf(" -OpenGL Memory Map: %10.2f ms\n", encoder->coder.duration_memory_map);
-                        printf(" -OpenGL Memory Unmap:%9.2f ms\n", encoder->coder.duration_memory_unmap);
+                    struct gpujpeg_stats stats;
+                    gpujpeg_encoder_get_stats(encoder, &stats);
+                    print_stats(&stats);
+                    if ( route ) {
+                        printf(" -Route:             %s (huffman %s, estimated CPU %.2f ms, GPU %.2f ms)\n",
+                            encoder->coder.route.image == GPUJPEG_ROUTE_HOST ? "CPU" : "GPU",
+                            encoder->coder.route.huffman == GPUJPEG_ROUTE_HOST ? "CPU" : "GPU",
+                            encoder->coder.route.duration_host, encoder->coder.route.duration_device);
                     }
-                    //printf(" -Preprocessing:     %10.2f ms\n", encoder->coder.duration_preprocessor);
-                    //printf(" -DCT & Quantization:%10.2f ms\n", encoder->coder.duration_dct_quantization);
-                    //printf(" -Huffman Encoder:   %10.2f ms\n", encoder->coder.duration_huffman_coder);
-                    //printf(" -Copy From Device:  %10.2f ms\n", encoder->coder.duration_memory_from);
-                    printf(" -Stream Formatter:  %10.2f ms\n", encoder->coder.duration_stream);
                 }
-                printf("Encode Image GPU:    %10.2f ms (only in-GPU processing)\n", encoder->coder.duration_in_gpu);
-                //printf("Encode Image Bare:   %10.2f ms (without copy to/from GPU memory)\n", duration - encoder->coder.duration_memory_to - encoder->coder.duration_memory_from);
                 printf("Encode Image:        %10.2f ms\n", duration);
             }
             if ( iterate > 1 ) {
@@ -549,6 +692,14 @@ main(int argc, char *argv[])
             fprintf(stderr, "Failed to create decoder!\n");
             return -1;
         }
+        gpujpeg_decoder_set_sampling_filter(decoder, param.sampling_filter);
+        gpujpeg_decoder_set_host_threads(decoder, host_threads);
+        if ( param.verbose )
+            gpujpeg_decoder_set_stats(decoder, 1);
+        if ( trace != NULL )
+            gpujpeg_decoder_set_trace(decoder, trace);
+        if ( route )
+            gpujpeg_decoder_set_route_model(decoder, &route_model);
 
         // Init decoder if image size is filled
         if ( param_image.width != 0 && param_image.height != 0 ) {
@@ -635,19 +786,20 @@ main(int argc, char *argv[])
                 GPUJPEG_TIMER_STOP();
                 float duration = GPUJPEG_TIMER_DURATION();
                 if ( param.verbose ) {
-                    printf(" -Stream Reader:     %10.2f ms\n", decoder->coder.duration_stream);
-                    //printf(" -Copy To Device:    %10.2f ms\n", decoder->coder.duration_memory_to);
-                    //printf(" -Huffman Decoder:   %10.2f ms\n", decoder->coder.duration_huffman_coder);
-                    //printf(" -DCT & Quantization:%10.2f ms\n", decoder->coder.duration_dct_quantization);
-                    //printf(" -Postprocessing:    %10.2f ms\n", decoder->coder.duration_preprocessor);
-                    printf(" -Copy From Device:  %10.2f ms\n", decoder->coder.duration_memory_from);
-                    if ( decoder->coder.duration_memory_map != 0.0 && decoder->coder.duration_memory_unmap != 0.0 ) {
-                        printf(" -OpenGL Memory Map: %10.2f ms\n", decoder->coder.duration_memory_map);
-                        printf(" -OpenGL Memory Unmap:%9.2f ms\n", decoder->coder.duration_memory_unmap);
+                    struct gpujpeg_stats stats;
+                    gpujpeg_decoder_get_stats(decoder, &stats);
+                    print_stats(&stats);
+                    if ( route ) {
+                        printf(" -Route:             %s (huffman %s, estimated CPU %.2f ms, GPU %.2f ms)\n",
+                            decoder->coder.route.image == GPUJPEG_ROUTE_HOST ? "CPU" : "GPU",
+                            decoder->coder.route.huffman == GPUJPEG_ROUTE_HOST ? "CPU" : "GPU",
+                            decoder->coder.route.duration_host, decoder->coder.route.duration_device);
+                    }
+                    if ( decoder->coder.route.huffman_host_segment_count > 0 ) {
+                        printf(" -Huffman Split:     %d of %d segments on CPU\n",
+                            decoder->coder.route.huffman_host_segment_count, decoder->segment_count);
                     }
                 }
-                printf("Decode Image GPU:    %10.2f ms (only in-GPU processing)\n", decoder->coder.duration_in_gpu);
-                //printf("Decode Image Bare:   %10.2f ms (without copy to/from GPU memory)\n", duration - decoder->coder.duration_memory_to - decoder->coder.duration_memory_from);
                 printf("Decode Image:        %10.2f ms\n", duration);
             }
             if ( iterate > 1 ) {
@@ -692,6 +844,14 @@ main(int argc, char *argv[])
         gpujpeg_decoder_destroy(decoder);
     }
 
+    // Save trace
+    if ( trace != NULL ) {
+        int result = gpujpeg_trace_save(trace, trace_filename);
+        gpujpeg_trace_destroy(trace);
+        if ( result != 0 )
+            return -1;
+    }
+
     return 0;
 }
 
@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Test of host color transformation (gpujpeg_color_transform_cpu), SSE2/AVX2
+ * and scalar code must produce exactly the same samples as the per-sample
+ * transforms from gpujpeg_colorspace.h which are used by preprocessor kernels
+ */
+
+#include "gpujpeg_colorspace_cpu.h"
+#include "gpujpeg_colorspace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/** Sample values at range edges and around rounding thresholds */
+static const uint8_t edge_values[] = { 0, 1, 2, 15, 16, 17, 127, 128, 129, 234, 235, 239, 240, 241, 253, 254, 255 };
+
+/** Sample counts covering AVX2 (16 samples), SSE2 (8 samples) and scalar code and their combinations */
+static const int counts[] = { 1, 7, 8, 9, 15, 16, 17, 23, 24, 25, 31, 32, 33, 1000, 4096, 4099 };
+
+/**
+ * Transform samples by per-sample transform of preprocessor kernels
+ */
+template<enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to>
+static void
+reference(uint8_t* c1, uint8_t* c2, uint8_t* c3, int count)
+{
+    for ( int index = 0; index < count; index++ )
+        gpujpeg_color_transform<color_space_from, color_space_to>::perform(c1[index], c2[index], c3[index]);
+}
+
+/**
+ * Compare host transformation with reference on given samples
+ *
+ * @return number of mismatching samples
+ */
+template<enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to>
+static int
+compare(const std::vector<uint8_t>& c1, const std::vector<uint8_t>& c2, const std::vector<uint8_t>& c3, int count)
+{
+    std::vector<uint8_t> r1(c1.begin(), c1.begin() + count), r2(c2.begin(), c2.begin() + count), r3(c3.begin(), c3.begin() + count);
+    std::vector<uint8_t> t1(r1), t2(r2), t3(r3);
+    reference<color_space_from, color_space_to>(&r1[0], &r2[0], &r3[0], count);
+    if ( gpujpeg_color_transform_cpu(color_space_from, color_space_to, &t1[0], &t2[0], &t3[0], count) != 0 ) {
+        fprintf(stderr, "Transformation %s -> %s failed!\n", gpujpeg_color_space_get_name(color_space_from), gpujpeg_color_space_get_name(color_space_to));
+        return count;
+    }
+
+    int mismatch_count = 0;
+    for ( int index = 0; index < count; index++ ) {
+        if ( t1[index] != r1[index] || t2[index] != r2[index] || t3[index] != r3[index] ) {
+            if ( mismatch_count == 0 ) {
+                fprintf(stderr, "%s -> %s: sample %d of %d is (%d, %d, %d) instead of (%d, %d, %d)\n",
+                    gpujpeg_color_space_get_name(color_space_from), gpujpeg_color_space_get_name(color_space_to), index, count,
+                    t1[index], t2[index], t3[index], r1[index], r2[index], r3[index]);
+            }
+            mismatch_count++;
+        }
+    }
+    return mismatch_count;
+}
+
+/**
+ * Test transformation on edge value combinations (shifted so that each of them
+ * is processed by every code path) and on random samples
+ *
+ * @return number of mismatching samples
+ */
+template<enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to>
+static int
+test()
+{
+    int mismatch_count = 0;
+    const int edge_count = sizeof(edge_values) / sizeof(edge_values[0]);
+
+    std::vector<uint8_t> c1, c2, c3;
+    for ( int i = 0; i < edge_count; i++ ) {
+        for ( int j = 0; j < edge_count; j++ ) {
+            for ( int k = 0; k < edge_count; k++ ) {
+                c1.push_back(edge_values[i]);
+                c2.push_back(edge_values[j]);
+                c3.push_back(edge_values[k]);
+            }
+        }
+    }
+    for ( int shift = 0; shift < 16; shift++ ) {
+        mismatch_count += compare<color_space_from, color_space_to>(c1, c2, c3, (int)c1.size());
+        c1.insert(c1.begin(), c1.back()); c1.pop_back();
+        c2.insert(c2.begin(), c2.back()); c2.pop_back();
+        c3.insert(c3.begin(), c3.back()); c3.pop_back();
+    }
+
+    for ( int count_index = 0; count_index < (int)(sizeof(counts) / sizeof(counts[0])); count_index++ ) {
+        int count = counts[count_index];
+        for ( int index = 0; index < count; index++ ) {
+            c1[index] = (uint8_t)rand();
+            c2[index] = (uint8_t)rand();
+            c3[index] = (uint8_t)rand();
+        }
+        mismatch_count += compare<color_space_from, color_space_to>(c1, c2, c3, count);
+    }
+
+    printf("%s -> %s: %s\n", gpujpeg_color_space_get_name(color_space_from), gpujpeg_color_space_get_name(color_space_to),
+        mismatch_count == 0 ? "OK" : "FAILED");
+    return mismatch_count;
+}
+
+/**
+ * Test interleaved transformation against load order, transform and store order of preprocessor kernels
+ *
+ * @return number of mismatching pixels
+ */
+template<enum gpujpeg_color_space color_space_from, enum gpujpeg_color_space color_space_to>
+static int
+test_interleaved()
+{
+    const int pixel_count = 3000;
+    std::vector<uint8_t> data(pixel_count * 3);
+    for ( int index = 0; index < pixel_count * 3; index++ )
+        data[index] = (uint8_t)rand();
+    std::vector<uint8_t> result(data);
+    if ( gpujpeg_color_transform_cpu_interleaved(color_space_from, color_space_to, &result[0], pixel_count) != 0 )
+        return pixel_count;
+
+    int mismatch_count = 0;
+    for ( int index = 0; index < pixel_count; index++ ) {
+        uint8_t c1 = data[index * 3 + 0];
+        uint8_t c2 = data[index * 3 + 1];
+        uint8_t c3 = data[index * 3 + 2];
+        gpujpeg_color_order<color_space_from>::perform_load(c1, c2, c3);
+        gpujpeg_color_transform<color_space_from, color_space_to>::perform(c1, c2, c3);
+        gpujpeg_color_order<color_space_to>::perform_store(c1, c2, c3);
+        if ( result[index * 3 + 0] != c1 || result[index * 3 + 1] != c2 || result[index * 3 + 2] != c3 )
+            mismatch_count++;
+    }
+
+    printf("%s -> %s interleaved: %s\n", gpujpeg_color_space_get_name(color_space_from), gpujpeg_color_space_get_name(color_space_to),
+        mismatch_count == 0 ? "OK" : "FAILED");
+    return mismatch_count;
+}
+
+int
+main()
+{
+    srand(1);
+
+    int mismatch_count = 0;
+    mismatch_count += test<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601>();
+    mismatch_count += test<GPUJPEG_YCBCR_BT601, GPUJPEG_RGB>();
+    mismatch_count += test<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601_256LVLS>();
+    mismatch_count += test<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB>();
+    mismatch_count += test<GPUJPEG_RGB, GPUJPEG_YCBCR_BT709>();
+    mismatch_count += test<GPUJPEG_YCBCR_BT709, GPUJPEG_RGB>();
+    mismatch_count += test<GPUJPEG_RGB, GPUJPEG_YUV>();
+    mismatch_count += test<GPUJPEG_YUV, GPUJPEG_RGB>();
+    mismatch_count += test<GPUJPEG_YCBCR_BT601, GPUJPEG_YCBCR_BT601_256LVLS>();
+    mismatch_count += test<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_YCBCR_BT601>();
+    mismatch_count += test<GPUJPEG_YCBCR_BT709, GPUJPEG_YCBCR_BT601_256LVLS>();
+    mismatch_count += test<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_YCBCR_BT709>();
+    mismatch_count += test<GPUJPEG_YUV, GPUJPEG_YCBCR_BT601_256LVLS>();
+    mismatch_count += test<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_YUV>();
+    mismatch_count += test<GPUJPEG_CMYK, GPUJPEG_YCCK>();
+    mismatch_count += test<GPUJPEG_YCCK, GPUJPEG_CMYK>();
+
+    mismatch_count += test_interleaved<GPUJPEG_RGB, GPUJPEG_YCBCR_BT601_256LVLS>();
+    mismatch_count += test_interleaved<GPUJPEG_YCBCR_BT601_256LVLS, GPUJPEG_RGB>();
+    mismatch_count += test_interleaved<GPUJPEG_RGB, GPUJPEG_YCBCR_BT709>();
+    mismatch_count += test_interleaved<GPUJPEG_YUV, GPUJPEG_RGB>();
+
+    return mismatch_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Test of decoding to coefficient output, coefficients of all components must
+ * be decoded for every output pixel format, including GPUJPEG_U8 which requests
+ * luminance only decoding of pixel output (decoded by host runtime)
+ */
+
+#include <libgpujpeg/gpujpeg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Image width and height (not multiple of MCU size) */
+#define IMAGE_WIDTH 72
+#define IMAGE_HEIGHT 40
+
+/**
+ * Decode image to coefficients with given output pixel format and compare them
+ * with reference coefficients
+ *
+ * @param image  Compressed image
+ * @param image_size  Compressed image size
+ * @param pixel_format  Output pixel format
+ * @param name  Name of output pixel format
+ * @param reference  Reference coefficients (filled when their component count is 0)
+ * @return number of failed checks
+ */
+static int
+test(uint8_t* image, int image_size, enum gpujpeg_pixel_format pixel_format, const char* name, struct gpujpeg_coefficients* reference)
+{
+    struct gpujpeg_decoder* decoder = gpujpeg_decoder_create(NULL);
+    if ( decoder == NULL ) {
+        return 1;
+    }
+    gpujpeg_decoder_set_output_format(decoder, GPUJPEG_RGB, pixel_format);
+
+    int fail_count = 0;
+    struct gpujpeg_decoder_output output;
+    gpujpeg_decoder_output_set_coefficients(&output);
+    struct gpujpeg_coefficients coefficients;
+    if ( gpujpeg_decoder_decode(decoder, image, image_size, &output) != 0
+            || gpujpeg_decoder_get_coefficients(decoder, &coefficients) != 0 ) {
+        fail_count++;
+    }
+    else if ( reference->comp_count == 0 ) {
+        // Reference coefficients are copied, they live in decoder buffer
+        *reference = coefficients;
+        for ( int comp = 0; comp < coefficients.comp_count; comp++ ) {
+            size_t size = (size_t)coefficients.block_count_x[comp] * coefficients.block_count_y[comp] * 64 * sizeof(int16_t);
+            reference->data[comp] = (int16_t*)malloc(size);
+            memcpy(reference->data[comp], coefficients.data[comp], size);
+        }
+        fail_count += coefficients.comp_count != 3;
+    }
+    else {
+        fail_count += coefficients.comp_count != reference->comp_count;
+        for ( int comp = 0; comp < coefficients.comp_count && fail_count == 0; comp++ ) {
+            size_t size = (size_t)coefficients.block_count_x[comp] * coefficients.block_count_y[comp] * 64 * sizeof(int16_t);
+            fail_count += coefficients.block_count_x[comp] != reference->block_count_x[comp]
+                || coefficients.block_count_y[comp] != reference->block_count_y[comp]
+                || memcmp(coefficients.data[comp], reference->data[comp], size) != 0;
+        }
+    }
+    gpujpeg_decoder_destroy(decoder);
+
+    printf("coefficients with %s output: %s\n", name, fail_count == 0 ? "OK" : "FAILED");
+    return fail_count;
+}
+
+int
+main()
+{
+    if ( gpujpeg_init_device(0, GPUJPEG_HOST_RUNTIME) != 0 ) {
+        return 1;
+    }
+
+    // Color image with 4:2:0 subsampling
+    struct gpujpeg_parameters param;
+    gpujpeg_set_default_parameters(&param);
+    param.restart_interval = 4;
+    param.interleaved = 1;
+    gpujpeg_parameters_chroma_subsampling_420(&param);
+    struct gpujpeg_image_parameters param_image;
+    gpujpeg_image_set_default_parameters(&param_image);
+    param_image.width = IMAGE_WIDTH;
+    param_image.height = IMAGE_HEIGHT;
+    uint8_t raw[IMAGE_WIDTH * IMAGE_HEIGHT * 3];
+    for ( int index = 0; index < IMAGE_WIDTH * IMAGE_HEIGHT * 3; index++ ) {
+        raw[index] = (uint8_t)(index * 7 % 251 + index / (IMAGE_WIDTH * 3));
+    }
+
+    struct gpujpeg_encoder* encoder = gpujpeg_encoder_create(NULL);
+    if ( encoder == NULL ) {
+        return 1;
+    }
+    gpujpeg_encoder_set_host_threads(encoder, 1);
+    struct gpujpeg_encoder_input input;
+    gpujpeg_encoder_input_set_image(&input, raw);
+    uint8_t* image = NULL;
+    int image_size = 0;
+    int fail_count = 0;
+    if ( gpujpeg_encoder_encode(encoder, &param, &param_image, &input, &image, &image_size) != 0 ) {
+        fail_count++;
+    }
+    else {
+        struct gpujpeg_coefficients reference;
+        memset(&reference, 0, sizeof(reference));
+        fail_count += test(image, image_size, GPUJPEG_444_U8_P012, "444-u8-p012", &reference);
+        fail_count += test(image, image_size, GPUJPEG_U8, "u8", &reference);
+        fail_count += test(image, image_size, GPUJPEG_420_U8_P0P1P2, "420-u8-p0p1p2", &reference);
+        for ( int comp = 0; comp < reference.comp_count; comp++ ) {
+            free(reference.data[comp]);
+        }
+    }
+    gpujpeg_encoder_destroy(encoder);
+
+    return fail_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Table-driven test of routing decision (gpujpeg_route_decide) around the
+ * threshold where CPU and GPU pipelines are estimated equally fast, on ties
+ * and when backends are missing, of default cost model with profile file and
+ * of calibration on host runtime
+ */
+
+#include <libgpujpeg/gpujpeg.h>
+#include <libgpujpeg/gpujpeg_route.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Routing test case */
+struct route_test
+{
+    // Case name
+    const char* name;
+    // Number of samples (raw size is the same)
+    size_t sample_count;
+    // Number of segments
+    int segment_count;
+    // Number of CPU threads
+    int host_thread_count;
+    // Flag if CPU pipeline is available
+    int host_image_supported;
+    // Flag if huffman coding on GPU is available
+    int device_huffman_supported;
+    // Expected backend of whole image
+    enum gpujpeg_route_backend image;
+    // Expected backend of huffman coding
+    enum gpujpeg_route_backend huffman;
+};
+
+/**
+ * Set cost model with simple costs, CPU pipeline costs 10 us + 2 ns per sample
+ * and thread, GPU pipeline costs 100 us, so single threaded pipelines are equally
+ * fast at 45000 samples (and at 90000 samples with two threads)
+ */
+static void
+model_set_threshold(struct gpujpeg_route_model* model)
+{
+    memset(model, 0, sizeof(struct gpujpeg_route_model));
+    model->host_overhead = 10.0;
+    model->host_transform = 1.0;
+    model->host_huffman = 1.0;
+    model->device_overhead = 100.0;
+    model->device_huffman_parallelism = 1;
+}
+
+/** Cases decided by model_set_threshold model */
+static const struct route_test threshold_tests[] = {
+    { "below threshold", 40000, 1, 1, 1, 1, GPUJPEG_ROUTE_HOST, GPUJPEG_ROUTE_DEVICE },
+    { "above threshold", 50000, 1, 1, 1, 1, GPUJPEG_ROUTE_DEVICE, GPUJPEG_ROUTE_DEVICE },
+    { "above threshold, two threads", 50000, 4, 2, 1, 1, GPUJPEG_ROUTE_HOST, GPUJPEG_ROUTE_DEVICE },
+    { "threads limited by segments", 50000, 1, 8, 1, 1, GPUJPEG_ROUTE_DEVICE, GPUJPEG_ROUTE_DEVICE },
+    { "no segments", 40000, 0, 8, 1, 1, GPUJPEG_ROUTE_HOST, GPUJPEG_ROUTE_DEVICE },
+    { "without CPU pipeline", 40000, 1, 1, 0, 1, GPUJPEG_ROUTE_DEVICE, GPUJPEG_ROUTE_DEVICE },
+    { "above threshold, without GPU huffman", 50000, 1, 1, 1, 0, GPUJPEG_ROUTE_HOST, GPUJPEG_ROUTE_HOST },
+    { "without both", 40000, 1, 1, 0, 0, GPUJPEG_ROUTE_DEVICE, GPUJPEG_ROUTE_HOST },
+};
+
+/**
+ * Set cost model where both pipelines cost 500 us + 2 ns per sample (on one
+ * thread) and both huffman backends are free, so every image is a tie
+ */
+static void
+model_set_tie(struct gpujpeg_route_model* model)
+{
+    memset(model, 0, sizeof(struct gpujpeg_route_model));
+    model->host_overhead = 500.0;
+    model->host_transform = 2.0;
+    model->device_overhead = 500.0;
+    model->device_transform = 2.0;
+    model->device_huffman_parallelism = 0; // treated as 1
+}
+
+/** Cases decided by model_set_tie model (ties are resolved to GPU) */
+static const struct route_test tie_tests[] = {
+    { "tie", 50000, 1, 1, 1, 1, GPUJPEG_ROUTE_DEVICE, GPUJPEG_ROUTE_HOST },
+    { "tie, empty image", 0, 1, 1, 1, 1, GPUJPEG_ROUTE_DEVICE, GPUJPEG_ROUTE_HOST },
+    { "tie broken by threads", 50000, 2, 2, 1, 1, GPUJPEG_ROUTE_HOST, GPUJPEG_ROUTE_HOST },
+};
+
+/**
+ * Run routing test cases with given model
+ *
+ * @return number of failed cases
+ */
+static int
+test(const char* model_name, const struct gpujpeg_route_model* model, const struct route_test* tests, int test_count)
+{
+    int fail_count = 0;
+    for ( int index = 0; index < test_count; index++ ) {
+        const struct route_test* test = &tests[index];
+        struct gpujpeg_route_image image;
+        image.raw_size = test->sample_count;
+        image.sample_count = test->sample_count;
+        image.segment_count = test->segment_count;
+        image.host_thread_count = test->host_thread_count;
+        image.host_image_supported = test->host_image_supported;
+        image.device_huffman_supported = test->device_huffman_supported;
+        image.raw_on_device = 0;
+
+        struct gpujpeg_route_decision decision;
+        gpujpeg_route_decide(model, &image, &decision);
+        int ok = decision.image == test->image && decision.huffman == test->huffman && decision.huffman_host_segment_count == 0
+            && (test->host_image_supported || decision.duration_host == 0.0);
+        printf("%s model, %s: %s\n", model_name, test->name, ok ? "OK" : "FAILED");
+        if ( !ok ) {
+            fprintf(stderr, "%s: image %d huffman %d (host %f ms, device %f ms) instead of image %d huffman %d\n", test->name,
+                decision.image, decision.huffman, decision.duration_host, decision.duration_device, test->image, test->huffman);
+            fail_count++;
+        }
+    }
+    return fail_count;
+}
+
+/**
+ * Test that default model routes tiny image to CPU and huge image to GPU and
+ * that profile file with missing keys keeps current values
+ *
+ * @return number of failed checks
+ */
+static int
+test_default()
+{
+    int fail_count = 0;
+    struct gpujpeg_route_model model;
+    gpujpeg_route_model_set_default(&model);
+
+    struct gpujpeg_route_image image;
+    memset(&image, 0, sizeof(image));
+    image.host_thread_count = 8;
+    image.host_image_supported = 1;
+    image.device_huffman_supported = 1;
+    struct gpujpeg_route_decision decision;
+    image.raw_size = image.sample_count = 64 * 64 * 3;
+    image.segment_count = 8;
+    gpujpeg_route_decide(&model, &image, &decision);
+    fail_count += decision.image != GPUJPEG_ROUTE_HOST;
+    image.raw_size = image.sample_count = (size_t)8192 * 8192 * 3;
+    image.segment_count = 8192 * 8192 / 512;
+    gpujpeg_route_decide(&model, &image, &decision);
+    fail_count += decision.image != GPUJPEG_ROUTE_DEVICE || decision.huffman != GPUJPEG_ROUTE_DEVICE;
+
+    const char* filename = "route_test_profile.txt";
+    FILE* file = fopen(filename, "w");
+    if ( file == NULL ) {
+        fail_count++;
+    } else {
+        fprintf(file, "# partial profile\nhost_huffman 3.5\ndevice_huffman_parallelism 0\n");
+        fclose(file);
+        struct gpujpeg_route_model loaded;
+        gpujpeg_route_model_set_default(&loaded);
+        fail_count += gpujpeg_route_model_load(&loaded, filename) != 0;
+        fail_count += loaded.host_huffman != 3.5 || loaded.device_huffman_parallelism != 1 || loaded.host_transform != model.host_transform
+            || loaded.device_overhead != model.device_overhead || loaded.transfer != model.transfer;
+        remove(filename);
+    }
+    fail_count += gpujpeg_route_model_load(&model, filename) == 0;
+
+    printf("default model: %s\n", fail_count == 0 ? "OK" : "FAILED");
+    return fail_count;
+}
+
+/**
+ * Test that cost model is calibrated on host runtime (both pipelines are then
+ * measured on CPU, so only successful fit of finite costs is checked)
+ *
+ * @return number of failed checks
+ */
+static int
+test_calibrate()
+{
+    int fail_count = 0;
+    if ( gpujpeg_init_device(0, GPUJPEG_HOST_RUNTIME) != 0 ) {
+        fail_count++;
+    } else {
+        struct gpujpeg_route_model model;
+        gpujpeg_route_model_set_default(&model);
+        fail_count += gpujpeg_route_model_calibrate(&model, 2) != 0;
+        const double cost[] = { model.host_overhead, model.host_transform, model.host_huffman, model.device_overhead,
+                                model.device_transform, model.transfer };
+        for ( size_t index = 0; index < sizeof(cost) / sizeof(cost[0]); index++ ) {
+            fail_count += !(cost[index] >= 0.0 && cost[index] < 1e12);
+        }
+    }
+
+    printf("calibration on host runtime: %s\n", fail_count == 0 ? "OK" : "FAILED");
+    return fail_count;
+}
+
+int
+main()
+{
+    int fail_count = 0;
+    struct gpujpeg_route_model model;
+    model_set_threshold(&model);
+    fail_count += test("threshold", &model, threshold_tests, (int)(sizeof(threshold_tests) / sizeof(threshold_tests[0])));
+    model_set_tie(&model);
+    fail_count += test("tie", &model, tie_tests, (int)(sizeof(tie_tests) / sizeof(tie_tests[0])));
+    fail_count += test_default();
+    fail_count += test_calibrate();
+
+    return fail_count == 0 ? 0 : 1;
+}
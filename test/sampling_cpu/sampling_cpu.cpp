@@ -0,0 +1,336 @@
+/**
+ * Copyright (c) 2011, CESNET z.s.p.o
+ * Copyright (c) 2011, Silicon Genome, LLC.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Test of host sampling (gpujpeg_sampling_cpu_downsample/upsample), SSE2 and
+ * scalar code must produce exactly the same samples as the per-sample filter
+ * from gpujpeg_sampling.h which is used by preprocessor kernels, bands of rows
+ * (gpujpeg_sampling_cpu_downsample_rows) must match whole plane and both must
+ * match values tabulated from libjpeg. Only 8-bit samples are tested, because
+ * components are never resampled for 12-bit precision.
+ */
+
+#include "gpujpeg_sampling_cpu.h"
+#include "gpujpeg_sampling.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/** Plane widths covering SSE2 (16 samples) and scalar code and their combinations */
+static const int widths[] = { 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 47, 100 };
+
+/** Plane heights */
+static const int heights[] = { 1, 2, 3, 5, 8, 13 };
+
+/**
+ * Subsampled plane (4x3) and its triangle upsampling by libjpeg fancy upsampling
+ * (h2v1_fancy_upsample and h2v2_fancy_upsample from jdsample.c), libjpeg alternates
+ * rounding bias while samples are rounded half up here, so the plane is chosen
+ * without ties
+ */
+static const uint8_t table_subsampled[3][4] = {
+    { 53, 181, 32, 120 },
+    { 84, 132, 136, 180 },
+    { 70, 7, 86, 119 }
+};
+static const uint8_t table_upsampled_h2v1[3][8] = {
+    { 53, 85, 149, 144, 69, 54, 98, 120 },
+    { 84, 96, 120, 133, 135, 147, 169, 180 },
+    { 70, 54, 23, 27, 66, 94, 111, 119 }
+};
+static const uint8_t table_upsampled_h2v2[6][8] = {
+    { 53, 85, 149, 144, 69, 54, 98, 120 },
+    { 61, 88, 142, 141, 86, 77, 116, 135 },
+    { 76, 93, 127, 136, 119, 124, 151, 165 },
+    { 81, 86, 96, 106, 118, 134, 154, 165 },
+    { 74, 65, 47, 53, 83, 107, 125, 134 },
+    { 70, 54, 23, 27, 66, 94, 111, 119 }
+};
+
+/**
+ * Full resolution plane (8x4) and its box downsampling by libjpeg (h2v2_downsample
+ * from jcsample.c), again without rounding ties
+ */
+static const uint8_t table_full[4][8] = {
+    { 115, 182, 82, 27, 49, 78, 68, 77 },
+    { 181, 89, 175, 121, 16, 24, 196, 24 },
+    { 45, 3, 152, 177, 91, 224, 117, 246 },
+    { 0, 143, 96, 180, 249, 141, 148, 237 }
+};
+static const uint8_t table_downsampled_h2v2[2][4] = {
+    { 142, 101, 42, 91 },
+    { 48, 151, 176, 187 }
+};
+
+/**
+ * Get name of sampling filter
+ */
+static const char*
+filter_name(enum gpujpeg_sampling_filter filter)
+{
+    switch ( filter ) {
+    case GPUJPEG_SAMPLING_FILTER_NEAREST: return "nearest";
+    case GPUJPEG_SAMPLING_FILTER_BOX: return "box";
+    case GPUJPEG_SAMPLING_FILTER_TRIANGLE: return "triangle";
+    }
+    return "unknown";
+}
+
+/**
+ * Compare host resampling of random plane with per-sample reference, planes
+ * have padding after each row which must stay untouched
+ *
+ * @return number of mismatching samples
+ */
+static int
+compare(enum gpujpeg_sampling_filter filter, int factor_h, int factor_v, bool upsample, int width, int height)
+{
+    // Source and target sizes (full resolution width and height are given)
+    int source_width = upsample ? (width + factor_h - 1) / factor_h : width;
+    int source_height = upsample ? (height + factor_v - 1) / factor_v : height;
+    int target_width = upsample ? width : (width + factor_h - 1) / factor_h;
+    int target_height = upsample ? height : (height + factor_v - 1) / factor_v;
+    int source_pitch = source_width + 5;
+    int target_pitch = target_width + 3;
+
+    std::vector<uint8_t> source(source_pitch * source_height);
+    for ( size_t index = 0; index < source.size(); index++ )
+        source[index] = (uint8_t)rand();
+    std::vector<uint8_t> target(target_pitch * target_height, 0xCD);
+    int result = upsample
+        ? gpujpeg_sampling_cpu_upsample(filter, factor_h, factor_v, &source[0], source_width, source_height, source_pitch,
+                                        &target[0], target_width, target_height, target_pitch)
+        : gpujpeg_sampling_cpu_downsample(filter, factor_h, factor_v, &source[0], source_width, source_height, source_pitch,
+                                          &target[0], target_width, target_height, target_pitch);
+    if ( result != 0 ) {
+        fprintf(stderr, "%s %s %dx%d of %dx%d failed!\n", upsample ? "Upsampling" : "Downsampling", filter_name(filter),
+            factor_h, factor_v, width, height);
+        return target_width * target_height;
+    }
+
+    int mismatch_count = 0;
+    for ( int y = 0; y < target_height; y++ ) {
+        struct gpujpeg_sampling_taps taps_v;
+        if ( upsample )
+            gpujpeg_sampling_upsample_taps(filter, factor_v, y, taps_v);
+        else
+            gpujpeg_sampling_downsample_taps(filter, factor_v, y, taps_v);
+        for ( int x = 0; x < target_pitch; x++ ) {
+            uint8_t expected = 0xCD;
+            if ( x < target_width ) {
+                struct gpujpeg_sampling_taps taps_h;
+                if ( upsample )
+                    gpujpeg_sampling_upsample_taps(filter, factor_h, x, taps_h);
+                else
+                    gpujpeg_sampling_downsample_taps(filter, factor_h, x, taps_h);
+                expected = gpujpeg_sampling_filter_sample(&source[0], source_width, source_height, source_pitch, taps_h, taps_v);
+            }
+            if ( target[y * target_pitch + x] != expected ) {
+                if ( mismatch_count == 0 ) {
+                    fprintf(stderr, "%s %s %dx%d of %dx%d: sample [%d, %d] is %d instead of %d\n", upsample ? "Upsampling" : "Downsampling",
+                        filter_name(filter), factor_h, factor_v, width, height, x, y, target[y * target_pitch + x], expected);
+                }
+                mismatch_count++;
+            }
+        }
+    }
+    return mismatch_count;
+}
+
+/**
+ * Compare resampling of tabulated plane by host code and by per-sample filter
+ * used by preprocessor kernels with tabulated libjpeg result
+ *
+ * @return number of mismatching samples
+ */
+static int
+compare_table(const char* name, enum gpujpeg_sampling_filter filter, int factor_h, int factor_v, bool upsample,
+              const uint8_t* source, int source_width, int source_height, const uint8_t* expected, int target_width, int target_height)
+{
+    std::vector<uint8_t> target(target_width * target_height);
+    int result = upsample
+        ? gpujpeg_sampling_cpu_upsample(filter, factor_h, factor_v, source, source_width, source_height, source_width,
+                                        &target[0], target_width, target_height, target_width)
+        : gpujpeg_sampling_cpu_downsample(filter, factor_h, factor_v, source, source_width, source_height, source_width,
+                                          &target[0], target_width, target_height, target_width);
+    if ( result != 0 ) {
+        fprintf(stderr, "Resampling %s failed!\n", name);
+        return target_width * target_height;
+    }
+
+    int mismatch_count = 0;
+    for ( int y = 0; y < target_height; y++ ) {
+        struct gpujpeg_sampling_taps taps_v;
+        if ( upsample )
+            gpujpeg_sampling_upsample_taps(filter, factor_v, y, taps_v);
+        else
+            gpujpeg_sampling_downsample_taps(filter, factor_v, y, taps_v);
+        for ( int x = 0; x < target_width; x++ ) {
+            struct gpujpeg_sampling_taps taps_h;
+            if ( upsample )
+                gpujpeg_sampling_upsample_taps(filter, factor_h, x, taps_h);
+            else
+                gpujpeg_sampling_downsample_taps(filter, factor_h, x, taps_h);
+            uint8_t sample = gpujpeg_sampling_filter_sample(source, source_width, source_height, source_width, taps_h, taps_v);
+            uint8_t value = expected[y * target_width + x];
+            if ( target[y * target_width + x] != value || sample != value ) {
+                if ( mismatch_count == 0 ) {
+                    fprintf(stderr, "Resampling %s: sample [%d, %d] is %d (per-sample %d) instead of %d\n", name, x, y,
+                        target[y * target_width + x], sample, value);
+                }
+                mismatch_count++;
+            }
+        }
+    }
+
+    printf("%s: %s\n", name, mismatch_count == 0 ? "OK" : "FAILED");
+    return mismatch_count;
+}
+
+/**
+ * Compare downsampling of random plane by bands of 8 target rows with whole plane
+ * downsampling, each band gets only its source rows with halo (1 row on both sides
+ * for ratios 1 and 2, 2 rows for ratios 3 and 4) copied to separate buffer
+ *
+ * @return number of mismatching samples
+ */
+static int
+compare_rows(enum gpujpeg_sampling_filter filter, int factor_h, int factor_v, int width, int height)
+{
+    int target_width = (width + factor_h - 1) / factor_h;
+    int target_height = (height + factor_v - 1) / factor_v;
+    std::vector<uint8_t> source(width * height);
+    for ( size_t index = 0; index < source.size(); index++ )
+        source[index] = (uint8_t)rand();
+    std::vector<uint8_t> expected(target_width * target_height);
+    std::vector<uint8_t> target(target_width * target_height);
+    if ( gpujpeg_sampling_cpu_downsample(filter, factor_h, factor_v, &source[0], width, height, width,
+                                         &expected[0], target_width, target_height, target_width) != 0 ) {
+        return target_width * target_height;
+    }
+
+    int halo = (factor_v + 1) / 2;
+    for ( int target_first = 0; target_first < target_height; target_first += 8 ) {
+        int target_count = (target_first + 8 < target_height) ? 8 : target_height - target_first;
+        int source_first = (target_first * factor_v - halo > 0) ? target_first * factor_v - halo : 0;
+        int source_end = (target_first + target_count) * factor_v + halo;
+        if ( source_end > height )
+            source_end = height;
+        std::vector<uint8_t> band(source.begin() + source_first * width, source.begin() + source_end * width);
+        if ( gpujpeg_sampling_cpu_downsample_rows(filter, factor_h, factor_v, &band[0], width, height, width,
+                                                  source_first, source_end - source_first,
+                                                  &target[target_first * target_width], target_width, target_height, target_width,
+                                                  target_first, target_count) != 0 ) {
+            fprintf(stderr, "Downsampling %s %dx%d of %dx%d rows %d-%d failed!\n", filter_name(filter),
+                factor_h, factor_v, width, height, target_first, target_first + target_count);
+            return target_width * target_height;
+        }
+    }
+
+    int mismatch_count = 0;
+    for ( size_t index = 0; index < target.size(); index++ ) {
+        if ( target[index] != expected[index] ) {
+            if ( mismatch_count == 0 ) {
+                fprintf(stderr, "Downsampling %s %dx%d of %dx%d by rows: sample [%d, %d] is %d instead of %d\n", filter_name(filter),
+                    factor_h, factor_v, width, height, (int)(index % target_width), (int)(index / target_width), target[index], expected[index]);
+            }
+            mismatch_count++;
+        }
+    }
+    return mismatch_count;
+}
+
+/**
+ * Test downsampling by bands of rows for all sampling factor ratios and plane sizes
+ *
+ * @return number of mismatching samples
+ */
+static int
+test_rows(enum gpujpeg_sampling_filter filter)
+{
+    int mismatch_count = 0;
+    for ( int factor_h = 1; factor_h <= GPUJPEG_SAMPLING_MAX_FACTOR; factor_h++ ) {
+        for ( int factor_v = 1; factor_v <= GPUJPEG_SAMPLING_MAX_FACTOR; factor_v++ ) {
+            for ( int i = 0; i < (int)(sizeof(widths) / sizeof(widths[0])); i++ ) {
+                for ( int height = 1; height <= 77; height += 19 )
+                    mismatch_count += compare_rows(filter, factor_h, factor_v, widths[i], height);
+            }
+        }
+    }
+
+    printf("downsample rows %s: %s\n", filter_name(filter), mismatch_count == 0 ? "OK" : "FAILED");
+    return mismatch_count;
+}
+
+/**
+ * Test resampling by filter for all sampling factor ratios and plane sizes
+ *
+ * @return number of mismatching samples
+ */
+static int
+test(enum gpujpeg_sampling_filter filter, bool upsample)
+{
+    int mismatch_count = 0;
+    for ( int factor_h = 1; factor_h <= GPUJPEG_SAMPLING_MAX_FACTOR; factor_h++ ) {
+        for ( int factor_v = 1; factor_v <= GPUJPEG_SAMPLING_MAX_FACTOR; factor_v++ ) {
+            for ( int i = 0; i < (int)(sizeof(widths) / sizeof(widths[0])); i++ ) {
+                for ( int j = 0; j < (int)(sizeof(heights) / sizeof(heights[0])); j++ )
+                    mismatch_count += compare(filter, factor_h, factor_v, upsample, widths[i], heights[j]);
+            }
+        }
+    }
+
+    printf("%s %s: %s\n", upsample ? "upsample" : "downsample", filter_name(filter), mismatch_count == 0 ? "OK" : "FAILED");
+    return mismatch_count;
+}
+
+int
+main()
+{
+    srand(1);
+
+    int mismatch_count = 0;
+    const enum gpujpeg_sampling_filter filters[] = {
+        GPUJPEG_SAMPLING_FILTER_NEAREST, GPUJPEG_SAMPLING_FILTER_BOX, GPUJPEG_SAMPLING_FILTER_TRIANGLE
+    };
+    for ( int i = 0; i < (int)(sizeof(filters) / sizeof(filters[0])); i++ ) {
+        mismatch_count += test(filters[i], false);
+        mismatch_count += test(filters[i], true);
+        mismatch_count += test_rows(filters[i]);
+    }
+
+    mismatch_count += compare_table("libjpeg upsample h2v1", GPUJPEG_SAMPLING_FILTER_TRIANGLE, 2, 1, true,
+                                    &table_subsampled[0][0], 4, 3, &table_upsampled_h2v1[0][0], 8, 3);
+    mismatch_count += compare_table("libjpeg upsample h2v2", GPUJPEG_SAMPLING_FILTER_TRIANGLE, 2, 2, true,
+                                    &table_subsampled[0][0], 4, 3, &table_upsampled_h2v2[0][0], 8, 6);
+    mismatch_count += compare_table("libjpeg downsample h2v2", GPUJPEG_SAMPLING_FILTER_BOX, 2, 2, false,
+                                    &table_full[0][0], 8, 4, &table_downsampled_h2v2[0][0], 4, 2);
+
+    return mismatch_count == 0 ? 0 : 1;
+}